@@ -16,6 +16,10 @@
 /* size of session hash container */
 #define SESSION_HASH_COUNT 4096
 
+/* average number of sessions per bucket at which the session hash container
+   doubles its size, 0 keeps the size fixed */
+#define SESSION_HASH_LOAD 4
+
 /* define to include dest port number into hash calculation
    note: this is useful for certain tests, but prohibits 100%-correct RSVP */
 #undef SESSION_HASH_PORTS
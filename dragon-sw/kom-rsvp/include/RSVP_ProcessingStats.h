@@ -0,0 +1 @@
+/root/DRAGON/dragon-sw/kom-rsvp/src/daemon/generic/RSVP_ProcessingStats.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/DRAGON/dragon-sw/kom-rsvp/src/daemon/unix/SwitchCtrl_Worker.h
\ No newline at end of file
@@ -222,6 +222,8 @@ void RSVP_API::process( Message& msg , zUpcall upcall) {
 			case Message::DeleteLocalId:
 			case Message::MonQuery:
 			case Message::MonReply:
+			case Message::StatsQuery:
+			case Message::StatsReply:
 				upcallPara.generalInfo = NULL;
 				break;
 			default:
@@ -287,6 +289,10 @@ void RSVP_API::process( Message& msg , zUpcall upcall) {
 		    zUpcallParam.monReplyPara = new (MON_Reply_Subobject);
 		    *zUpcallParam.monReplyPara = msg.getDRAGON_EXT_INFO_Object()->getMonReply();
  		}
+		else if (msg.getMsgType()==Message::StatsReply && msg.getDRAGON_EXT_INFO_Object())
+		{
+		    zUpcallParam.statsReplyPara = &msg.getDRAGON_EXT_INFO_Object()->getStatsReply();
+ 		}
 
 		//common objects for PATH, RESV, PTEAR, RTEAR upcalls
 		if(msg.getDRAGON_UNI_Object())
@@ -412,6 +418,16 @@ void RSVP_API::monitoringQuery(uint32 ucid, uint32 seqnum, char* gri, uint32 des
 	dragonExtInfo->destroy();
 }
 
+//$$$$ DRAGON
+// the daemon answers with a StatsReply to this API instance
+void RSVP_API::statisticsQuery()
+{
+	SESSION_Object session(NetAddress(0), 0, 0);
+	Message msgQuery( Message::StatsQuery, 1, session);
+	msgQuery.setRSVP_HOP_Object( *apiLif );
+	apiLif->sendMessage( msgQuery, NetAddress(0), apiLif->getLocalAddress() );
+}
+
 // the ip address in SENDER_TEMPLATE is set to 0, if no explicit one is given.
 // this is adjusted by message processing in the daemon
 void RSVP_API::createSender( SessionId iter, const NetAddress& addr, uint16 port, 
@@ -848,3 +864,7 @@ void zMonitoringQuery(void* api, uint32 ucid, uint32 seqnum, char* gri, uint32 d
 {
 	((RSVP_API *)api)->monitoringQuery(ucid, seqnum, gri, destAddrIp, tunnelId, extTunnelId); // last four argments: lspName, destIP, destPort, sourceIP
 }
+void zStatisticsQuery(void* api)
+{
+	((RSVP_API *)api)->statisticsQuery();
+}
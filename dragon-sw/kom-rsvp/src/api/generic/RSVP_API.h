@@ -61,6 +61,7 @@ struct _rsvp_upcall_parameter {
 	struct _Dragon_ExtInfo_Para* dragonExtInfoPara;
 	struct _Error_Spec_Para* errorSpecPara;
 	MON_Reply_Subobject* monReplyPara;
+	STATS_Reply_Subobject* statsReplyPara;	//only valid during the upcall
 	void* sendTSpec;  //Sender TSpec
 	void* adSpec;
 	void* session;	//RSVP_API::SessionId
@@ -282,6 +283,8 @@ public:
        void refreshLocalId(uint16 type, uint16 value, uint16 tag);
        //$$$$ DRAGON
 	void monitoringQuery(uint32 ucid, uint32 seqnum, char* gri, uint32 destAddrIp=0, uint16 tunnelId=0, uint32 extTunnelId=0);
+       //$$$$ DRAGON
+	void statisticsQuery();
 };
 
 //The following functions are called by outside C applications such as Zebra-OSPF-TE
@@ -297,6 +300,7 @@ extern "C" {
 	extern void zDeleteLocalId(void* api, uint16 type, uint16 value, uint16 tag);
 	extern void zRefreshLocalId(void* api, uint16 type, uint16 value, uint16 tag);
 	extern void zMonitoringQuery(void* api, uint32 ucid, uint32 seqnum, char* gri, uint32 destAddrIp, uint16 tunnelId, uint32 extTunnelId);
+	extern void zStatisticsQuery(void* api);
 }
 
 #endif /* _RSVP_API_h */
@@ -0,0 +1,116 @@
+/****************************************************************************
+
+  KOM RSVP Engine (release version 3.0f)
+  Copyright (C) 1999-2004 Martin Karsten
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+  Contact:	Martin Karsten
+		TU Darmstadt, FG KOM
+		Merckstr. 25
+		64283 Darmstadt
+		Germany
+		Martin.Karsten@KOM.tu-darmstadt.de
+
+  Other copyrights might apply to parts of this package and are so
+  noted when applicable. Please see file COPYRIGHT.other for details.
+
+****************************************************************************/
+#include "RSVP_BaseTimer.h"
+#include "RSVP_Log.h"
+#include <iostream>
+
+// Micro-benchmark for TimerSystem: restart, cancel and fire throughput
+// for a given number of timers (default: 10k, 100k and 1M).
+
+class BenchTimer : public BaseTimer {
+public:
+	static uint32 fired;
+	BenchTimer() : BaseTimer(TimeValue(0,0)) {}
+	virtual void internalFire() {
+		cancel();
+		fired += 1;
+	}
+};
+
+uint32 BenchTimer::fired = 0;
+
+static void report( const char* what, uint32 count, const TimeValue& start ) {
+	TimeValue elapsed = getCurrentSystemTime() - start;
+	ieee32float_p secs = elapsed.getFractionalValue();
+	cout << "  " << what << ": " << (PreciseTimeValue&)elapsed << ", ";
+	if ( secs > 0 ) {
+		cout << (uint64)(count / secs) << " ops/sec" << endl;
+	} else {
+		cout << "n/a" << endl;
+	}
+}
+
+static void runBenchmark( uint32 count ) {
+	BenchTimer* timers = new BenchTimer[count];
+	uint32 i;
+	cout << count << " timers:" << endl;
+
+	// spread over the default refresh timeout range of a PSB/RSB
+	TimeValue start = getCurrentSystemTime();
+	for ( i = 0; i < count; ++i ) {
+		timers[i].restart( TimeValue( 30 + drawRandomNumber(60), drawRandomNumber(USECS_PER_SEC-1) ) );
+	}
+	report( "start", count, start );
+
+	start = getCurrentSystemTime();
+	for ( i = 0; i < count; ++i ) {
+		timers[i].restart( TimeValue( 30 + drawRandomNumber(60), drawRandomNumber(USECS_PER_SEC-1) ) );
+	}
+	report( "restart", count, start );
+
+	start = getCurrentSystemTime();
+	for ( i = 0; i < count; ++i ) {
+		timers[i].cancel();
+	}
+	report( "cancel", count, start );
+
+	// let all timers expire within one second and wait for them
+	for ( i = 0; i < count; ++i ) {
+		timers[i].restart( TimeValue( 0, 1 + drawRandomNumber(USECS_PER_SEC-2) ) );
+	}
+	sleep( 1 );
+	BenchTimer::fired = 0;
+	TimeValue remainingTime;
+	start = getCurrentSystemTime();
+	while ( BenchTimer::fired < count ) {
+		RSVP_Global::currentTimerSystem->executeTimer( remainingTime );
+	}
+	report( "fire", count, start );
+	delete [] timers;
+}
+
+int main( int argc, char** argv ) {
+	Log::init( Log::Fatal | Log::Error );
+	RSVP_Global::currentTimerSystem = new TimerSystem;
+	RSVP_Global::currentTimerSystem->start();
+	if ( argc > 1 ) {
+		for ( int i = 1; i < argc; ++i ) {
+			runBenchmark( strtol( argv[i], NULL, 10 ) );
+		}
+	} else {
+		runBenchmark( 10000 );
+		runBenchmark( 100000 );
+		runBenchmark( 1000000 );
+	}
+	delete RSVP_Global::currentTimerSystem;
+	Log::close();
+	return 0;
+}
@@ -5,6 +5,10 @@
 
 #include "RSVP_System.h"
 
+// the free lists are not locked: threads other than the main loop (the
+// switch control worker) set this and use the system allocator instead
+extern __thread bool memoryMachineBypass;
+
 template <class T>
 class GeneralMemoryMachine {
 public:
@@ -76,6 +80,9 @@ public:
 	}
 
 	void* alloc( size_t size ) {
+		if ( memoryMachineBypass ) {
+			return ::operator new(size);
+		}
 		if ( endOfList.next == &endOfList ) {
                                                       assert( freeNodes == 0 );
 #if defined(RSVP_STATS)
@@ -90,6 +97,10 @@ public:
 	}
 
 	void dealloc( void* pnt ) {
+		if ( memoryMachineBypass ) {
+			::operator delete( pnt );
+			return;
+		}
 		insert_end( (MemNode*)pnt );
 #if defined(RSVP_STATS)
 		freeNodes += 1;
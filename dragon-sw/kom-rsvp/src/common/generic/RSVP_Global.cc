@@ -92,6 +92,9 @@ bool							RSVP_Global::mplsDefault = false;
 uint32						RSVP_Global::labelHashCount = LABEL_HASH_COUNT;
 
 // define instances of memory machines
+#if defined(RSVP_MEMORY_MACHINE)
+__thread bool memoryMachineBypass = false;
+#endif
 DEFINE_MEMORY_MACHINE( ListMemNode, listMemMachine )
 DEFINE_MEMORY_MACHINE( FILTER_SPEC_ObjectListMemNode, filterSpecListMemMachine )
 DEFINE_MEMORY_MACHINE( FlowDescriptorListMemNode, flowDescListMemMachine )
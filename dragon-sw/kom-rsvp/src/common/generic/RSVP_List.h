@@ -193,6 +193,18 @@ protected:
 		return first;
 	}	
 
+	// moves the node at pos of list 'from' in front of node, without copying it
+	void relink_node( ListNode* node, SimpleList& from, ListNode* pos ) {
+		pos->prev->next = pos->next;
+		pos->next->prev = pos->prev;
+		from.length -= 1;
+		pos->next = node;
+		pos->prev = node->prev;
+		node->prev->next = pos;
+		node->prev = pos;
+		length += 1;
+	}
+
 	ListNode* head() const { return endOfList->next; }
 	ListNode* tail() const { return endOfList; }
 
@@ -267,6 +279,10 @@ public:
 	Iterator erase( ConstIterator first, ConstIterator last ) {
 		return erase_range( first.node, last.node );
 	}
+	// iterators to the moved element stay valid
+	void move( ConstIterator pos, SimpleList& from, ConstIterator elem ) {
+		relink_node( pos.node, from, elem.node );
+	}
 	unsigned int size() const { return length; }
 	bool empty() const { return length == 0; }
 
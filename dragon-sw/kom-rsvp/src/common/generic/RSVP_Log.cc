@@ -35,12 +35,115 @@
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <unistd.h>
+
+class LogRing {
+public:
+	enum { Size = 1 << 18, MaxLine = 1024 };
+	struct Record {
+		ostream* stream;
+		uint32 sequence;
+		uint32 length;
+	};
+	volatile uint32 head;			// advanced by the producing thread only
+	volatile uint32 tail;			// advanced by the writer thread only
+	volatile uint32 dropped;		// counted by the producing thread only
+	uint32 reported;				// drops already reported by the writer
+	char data[Size];
+
+	LogRing() : head(0), tail(0), dropped(0), reported(0) {}
+	static uint32 recordSize( uint32 length ) {
+		return (sizeof(Record) + length + 7) & ~7;
+	}
+	void copyIn( uint32 pos, const void* src, uint32 n ) {
+		uint32 offset = pos & (Size - 1);
+		uint32 first = n < Size - offset ? n : Size - offset;
+		memcpy( data + offset, src, first );
+		memcpy( data, (const char*)src + first, n - first );
+	}
+	void copyOut( uint32 pos, void* dst, uint32 n ) const {
+		uint32 offset = pos & (Size - 1);
+		uint32 first = n < Size - offset ? n : Size - offset;
+		memcpy( dst, data + offset, first );
+		memcpy( (char*)dst + first, data, n - first );
+	}
+	bool pending() const {
+		bool result = (head != tail);
+		__sync_synchronize();
+		return result;
+	}
+	// producer side: never blocks, a line that does not fit is counted
+	bool push( ostream* stream, uint32 sequence, const char* text, uint32 length ) {
+		uint32 size = recordSize( length );
+		uint32 h = head;
+		uint32 t = tail;
+		__sync_synchronize();
+		if ( size > Size - (h - t) ) {
+			dropped += 1;
+			return false;
+		}
+		Record r;
+		r.stream = stream;
+		r.sequence = sequence;
+		r.length = length;
+		copyIn( h, &r, sizeof(Record) );
+		copyIn( h + sizeof(Record), text, length );
+		__sync_synchronize();
+		head = h + size;
+		return true;
+	}
+	// writer side: called after pending() returned true
+	void peek( Record& r ) const {
+		copyOut( tail, &r, sizeof(Record) );
+	}
+	void consume( const Record& r ) {
+		uint32 offset = (tail + sizeof(Record)) & (Size - 1);
+		uint32 first = r.length < Size - offset ? r.length : Size - offset;
+		r.stream->write( data + offset, first );
+		r.stream->write( data, r.length - first );
+		__sync_synchronize();
+		tail += recordSize( r.length );
+	}
+};
+
+// fixed per-thread line buffer, an overlong line is truncated
+class LogStream : public streambuf {
+	char buffer[LogRing::MaxLine];
+public:
+	ostream os;
+	LogStream() : os(this) {
+		os << setiosflags(ios::fixed) << setprecision(3);
+		reset();
+	}
+	void reset() {
+		setp( buffer, buffer + sizeof(buffer) - 1 );
+		os.clear();
+	}
+	void terminate() {
+		*pptr() = '\n';
+		pbump( 1 );
+	}
+	const char* text() const { return pbase(); }
+	uint32 length() const { return pptr() - pbase(); }
+};
+
+static const uint32 maxLogRings = 8;
+static const uint32 writerBatchSize = 512;
+static const uint32 writerInterval = 10000;	// usec
 
 uint32 Log::loglevel = Log::Fatal;
-ostream* Log::log = NULL;  
+__thread ostream* Log::log = NULL;
 ostream* Log::stdlog = &cout;
 ostream* Log::errlog = &cerr;
-bool Log::virtualTime = false;
+__thread bool Log::virtualTime = false;
+pthread_mutex_t Log::mutex = PTHREAD_MUTEX_INITIALIZER;
+LogRing* Log::rings[maxLogRings];
+volatile uint32 Log::ringCount = 0;
+volatile uint32 Log::sequence = 0;
+volatile bool Log::writerActive = false;
+pthread_t Log::writer;
+__thread LogRing* Log::threadRing = NULL;
+__thread LogStream* Log::threadStream = NULL;
 
 static struct __Logremove {
 	~__Logremove() { Log::close(); }
@@ -76,8 +179,9 @@ Log::debugOption Log::options[] = {
 	{ (char*)"mpls", Log::MPLS, 2 },
 	{ (char*)"ns2", Log::NS, 1 },
 	{ (char*)"short", Log::Short, 2 },
+	{ (char*)"async", Log::Async, 2 },
 	{ (char*)"append", static_cast<uint32>(Log::Append), 2 },
-	{ (char*)"all", static_cast<uint32>(Log::All), 2 }
+	{ (char*)"all", static_cast<uint32>(Log::All & ~Log::Async), 2 }
 };
 
 void Log::parse( const String& s, bool disable ) {
@@ -109,6 +213,7 @@ void Log::parse( const String& s, bool disable ) {
 }
 
 void Log::close() {
+	stopWriter();
 	if (stdlog && stdlog != &cout && stdlog != &cerr ) {
 		delete stdlog;
 	}
@@ -120,7 +225,7 @@ void Log::close() {
 }
 
 void Log::outInfo( ostream& os ) {
-	static TimeValue currentTime;
+	TimeValue currentTime;
 #if defined(NS2)
 	os << setw(4) << setfill('0') << getCurrentNodeNumber() << "|";
 #endif
@@ -166,6 +271,164 @@ void Log::internalInit( const String& filename, bool logErrorsInStdLog ) {
 		errlog = &cerr;
 		*errlog << setiosflags(ios::fixed) << setprecision(3);
 	}
+	if ( loglevel & Log::Async ) {
+		startWriter();
+	}
+}
+
+LogRing* Log::getThreadRing() {
+	Lock lock;
+	if ( ringCount < maxLogRings ) {
+		threadRing = new LogRing;
+		rings[ringCount] = threadRing;
+		__sync_synchronize();
+		ringCount += 1;
+	}
+	return threadRing;
+}
+
+uint32 Log::drain() {
+	Lock lock;
+	uint32 count = 0;
+	uint32 n = ringCount;
+	__sync_synchronize();
+	while ( count < writerBatchSize ) {
+		LogRing* next = NULL;
+		LogRing::Record nextRecord, record;
+		for ( uint32 i = 0; i < n; ++i ) {
+			if ( rings[i]->pending() ) {
+				rings[i]->peek( record );
+				if ( !next || (sint32)(record.sequence - nextRecord.sequence) < 0 ) {
+					next = rings[i];
+					nextRecord = record;
+				}
+			}
+		}
+		if ( !next ) {
+	break;
+		}
+		next->consume( nextRecord );
+		count += 1;
+	}
+	for ( uint32 i = 0; i < n; ++i ) {
+		uint32 dropped = rings[i]->dropped;
+		if ( dropped != rings[i]->reported && errlog ) {
+			outInfo( *errlog );
+			*errlog << "log ring full: " << dropped - rings[i]->reported << " lines dropped" << endl;
+			rings[i]->reported = dropped;
+		}
+	}
+	if ( count > 0 ) {
+		stdlog->flush();
+		if ( errlog != stdlog ) errlog->flush();
+	}
+	return count;
+}
+
+void* Log::writerMain( void* ) {
+	while ( writerActive ) {
+		if ( drain() < writerBatchSize ) {
+			usleep( writerInterval );
+		}
+	}
+	while ( drain() > 0 );
+	return NULL;
+}
+
+void Log::startWriter() {
+	static bool forkHandlersInstalled = false;
+	if ( !forkHandlersInstalled ) {
+		pthread_atfork( forkPrepare, forkParent, forkChild );
+		forkHandlersInstalled = true;
+	}
+	writerActive = true;
+	if ( pthread_create( &writer, NULL, writerMain, NULL ) != 0 ) {
+		writerActive = false;
+		cerr << "couldn't start log writer, logging synchronously" << endl;
+	}
+}
+
+void Log::stopWriter() {
+	if ( writerActive ) {
+		writerActive = false;
+		pthread_join( writer, NULL );
+	}
+}
+
+// a forked child has no writer thread: it drops the parent's queued lines
+// and logs synchronously; holding 'mutex' across fork() keeps the streams
+// consistent in both processes
+void Log::forkPrepare() {
+	pthread_mutex_lock( &mutex );
+}
+
+void Log::forkParent() {
+	pthread_mutex_unlock( &mutex );
+}
+
+void Log::forkChild() {
+	writerActive = false;
+	for ( uint32 i = 0; i < ringCount; ++i ) {
+		rings[i]->tail = rings[i]->head;
+	}
+	pthread_mutex_unlock( &mutex );
+}
+
+void Log::flush() {
+	while ( writerActive ) {
+		bool pending = false;
+		for ( uint32 i = 0; i < ringCount; ++i ) {
+			if ( rings[i]->pending() ) pending = true;
+		}
+		if ( !pending ) {
+	break;
+		}
+		usleep( 1000 );
+	}
+}
+
+uint32 Log::getDroppedLines() {
+	uint32 dropped = 0;
+	for ( uint32 i = 0; i < ringCount; ++i ) {
+		dropped += rings[i]->dropped;
+	}
+	return dropped;
+}
+
+Log::Line::Line( uint32 level, bool info, bool newline ) : os(NULL), queued(false), newline(newline) {
+	if ( writerActive ) {
+		if ( level & Log::Fatal ) {
+			Log::flush();
+		} else if ( threadRing || getThreadRing() ) {
+			if ( !threadStream ) {
+				threadStream = new LogStream;
+			}
+			threadStream->reset();
+			os = &threadStream->os;
+			queued = true;
+		}
+	}
+	if ( !queued ) {
+		pthread_mutex_lock( &Log::mutex );
+		os = Log::log;
+	}
+	if ( info ) {
+		outInfo( *os );
+	}
+}
+
+Log::Line::~Line() {
+	if ( queued ) {
+		if ( newline ) {
+			threadStream->terminate();
+		}
+		threadRing->push( Log::log, __sync_fetch_and_add( &sequence, 1 ), threadStream->text(), threadStream->length() );
+	} else {
+		if ( newline ) {
+			*os << endl;
+		}
+		pthread_mutex_unlock( &Log::mutex );
+	}
 }
 
 void Log::usage( ostream& os ) {
@@ -34,6 +34,11 @@
 #include "RSVP_System.h"
 #include "RSVP_String.h"
 
+#include <pthread.h>
+
+class LogRing;
+class LogStream;
+
 class Log {
 public:
 	enum {
@@ -66,6 +71,7 @@ public:
 		MPLS =				(1 << 25),           // 0x02000000
 		NS =				(1 << 26),           // 0x04000000
 		Short =				(1 << 27),           // 0x08000000
+		Async =				(1 << 30),           // 0x40000000
 		Append =			(1 << 31),	     //0x80000000
 		All = 				~0                   // 0xffffffff
 	};
@@ -78,12 +84,40 @@ private:
 	static debugOption options[];
 	static void internalInit( const String&, bool logErrorsInStdLog );
 	static void parse( const String& s, bool disable = false );
+
+	// asynchronous logging: each producing thread owns a single-producer
+	// ring of pre-formatted lines, the writer thread drains all rings in
+	// sequence order and flushes once per batch; a full ring drops the line
+	static LogRing* rings[];
+	static volatile uint32 ringCount;
+	static volatile uint32 sequence;
+	static volatile bool writerActive;
+	static pthread_t writer;
+	static __thread LogRing* threadRing;
+	static __thread LogStream* threadStream;
+	static LogRing* getThreadRing();
+	static void* writerMain( void* );
+	static uint32 drain();
+	static void startWriter();
+	static void stopWriter();
+	static void forkPrepare();
+	static void forkParent();
+	static void forkChild();
 public:
 	static uint32 loglevel;
-	static ostream* log;
+	// the switch control worker logs, too: the selected stream is per thread
+	// and each line is either queued to the thread's ring or written while
+	// holding 'mutex'
+	static __thread ostream* log;
 	static ostream* stdlog;
 	static ostream* errlog;
-	static bool virtualTime;
+	static __thread bool virtualTime;
+	static pthread_mutex_t mutex;
+	class Lock {
+	public:
+		Lock() { pthread_mutex_lock( &Log::mutex ); }
+		~Lock() { pthread_mutex_unlock( &Log::mutex ); }
+	};
 	Log( uint32 loglevel = Fatal, const String& filename = "", bool logErrorsInStdLog = false ) {
 		init( loglevel, filename, logErrorsInStdLog );
 	}
@@ -94,7 +128,21 @@ public:
 	static void init( const String& enable, const String& disable = "", const String& filename = "", bool logErrorsInStdLog = false );
 	static void outInfo( ostream& os );
 	static void usage( ostream& os );
+	static void flush();
 	static void close();
+	static uint32 getDroppedLines();
+
+	// one log line: formatted into a per-thread buffer and queued when the
+	// writer thread runs, written to the stream under 'mutex' otherwise
+	class Line {
+		ostream* os;
+		bool queued;
+		bool newline;
+	public:
+		Line( uint32 level, bool info = true, bool newline = true );
+		~Line();
+		ostream& stream() { return *os; }
+	};
 };
 
 inline ostream& operator<< ( ostream& os, void (*func)(void) ) {
@@ -103,40 +151,40 @@ inline ostream& operator<< ( ostream& os, void (*func)(void) ) {
 }
 
 #define LOG_BASE1( level, o1 ) \
-	if ( (level & Log::loglevel) && Log::log ) { Log::outInfo( *Log::log ); *Log::log << o1 << endl; }
+	if ( (level & Log::loglevel) && Log::log ) { Log::Line logLine( level ); logLine.stream() << o1; }
 
 #define LOG_BASE2( level, o1, o2 ) \
-	if ( (level & Log::loglevel) && Log::log ) { Log::outInfo( *Log::log ); *Log::log << o1 << " " << o2 << endl; }
+	if ( (level & Log::loglevel) && Log::log ) { Log::Line logLine( level ); logLine.stream() << o1 << " " << o2; }
 
 #define LOG_BASE3( level, o1, o2, o3 ) \
-	if ( (level & Log::loglevel) && Log::log ) { Log::outInfo( *Log::log ); *Log::log << o1 << " " << o2 << " " << o3 << endl; }
+	if ( (level & Log::loglevel) && Log::log ) { Log::Line logLine( level ); logLine.stream() << o1 << " " << o2 << " " << o3; }
 
 #define LOG_BASE4( level, o1, o2, o3, o4 ) \
-	if ( (level & Log::loglevel) && Log::log ) { Log::outInfo( *Log::log ); *Log::log << o1 << " " << o2 << " " << o3 << " " << o4 << endl; }
+	if ( (level & Log::loglevel) && Log::log ) { Log::Line logLine( level ); logLine.stream() << o1 << " " << o2 << " " << o3 << " " << o4; }
 
 #define LOG_BASE5( level, o1, o2, o3, o4, o5 ) \
-	if ( (level & Log::loglevel) && Log::log ) { Log::outInfo( *Log::log ); *Log::log << o1 << " " << o2 << " " << o3 << " " << o4 << " " << o5 << endl; }
+	if ( (level & Log::loglevel) && Log::log ) { Log::Line logLine( level ); logLine.stream() << o1 << " " << o2 << " " << o3 << " " << o4 << " " << o5; }
 
 #define LOG_BASE6( level, o1, o2, o3, o4, o5, o6 ) \
-	if ( (level & Log::loglevel) && Log::log ) { Log::outInfo( *Log::log ); *Log::log << o1 << " " << o2 << " " << o3 << " " << o4 << " " << o5 << " " << o6 << endl; }
+	if ( (level & Log::loglevel) && Log::log ) { Log::Line logLine( level ); logLine.stream() << o1 << " " << o2 << " " << o3 << " " << o4 << " " << o5 << " " << o6; }
 
 #define LOG_BASE7( level, o1, o2, o3, o4, o5, o6, o7 ) \
-	if ( (level & Log::loglevel) && Log::log ) { Log::outInfo( *Log::log ); *Log::log << o1 << " " << o2 << " " << o3 << " " << o4 << " " << o5 << " " << o6 << " " << o7 << endl; }
+	if ( (level & Log::loglevel) && Log::log ) { Log::Line logLine( level ); logLine.stream() << o1 << " " << o2 << " " << o3 << " " << o4 << " " << o5 << " " << o6 << " " << o7; }
 
 #define LOG_BASE8( level, o1, o2, o3, o4, o5, o6, o7, o8 ) \
-	if ( (level & Log::loglevel) && Log::log ) { Log::outInfo( *Log::log ); *Log::log << o1 << " " << o2 << " " << o3 << " " << o4 << " " << o5 << " " << o6 << " " << o7 << " " << o8 << endl; }
+	if ( (level & Log::loglevel) && Log::log ) { Log::Line logLine( level ); logLine.stream() << o1 << " " << o2 << " " << o3 << " " << o4 << " " << o5 << " " << o6 << " " << o7 << " " << o8; }
 
 #define LOG_BASE9( level, o1, o2, o3, o4, o5, o6, o7, o8, o9 ) \
-	if ( (level & Log::loglevel) && Log::log ) { Log::outInfo( *Log::log ); *Log::log << o1 << " " << o2 << " " << o3 << " " << o4 << " " << o5 << " " << o6 << " " << o7 << " " << o8 << " " << o9 << endl; }
+	if ( (level & Log::loglevel) && Log::log ) { Log::Line logLine( level ); logLine.stream() << o1 << " " << o2 << " " << o3 << " " << o4 << " " << o5 << " " << o6 << " " << o7 << " " << o8 << " " << o9; }
 
 #define LOG_BASE10( level, o1, o2, o3, o4, o5, o6, o7, o8, o9, o10 ) \
-	if ( (level & Log::loglevel) && Log::log ) { Log::outInfo( *Log::log ); *Log::log << o1 << " " << o2 << " " << o3 << " " << o4 << " " << o5 << " " << o6 << " " << o7 << " " << o8 << " " << o9 << " " << o10 << endl; }
+	if ( (level & Log::loglevel) && Log::log ) { Log::Line logLine( level ); logLine.stream() << o1 << " " << o2 << " " << o3 << " " << o4 << " " << o5 << " " << o6 << " " << o7 << " " << o8 << " " << o9 << " " << o10; }
 
 #define LOG_BASES( level, o1 ) \
-	if ( (level & Log::loglevel) && Log::log ) { Log::outInfo( *Log::log ); *Log::log << o1; }
+	if ( (level & Log::loglevel) && Log::log ) { Log::Line logLine( level, true, false ); logLine.stream() << o1; }
 
 #define LOG_BASEC( level, o1 ) \
-	if ( (level & Log::loglevel) && Log::log ) { *Log::log << o1; }
+	if ( (level & Log::loglevel) && Log::log ) { Log::Line logLine( level, false, false ); logLine.stream() << o1; }
 
 
 #define LOG_NONE1( level, o1 ) ;
@@ -599,6 +599,8 @@ ostream& operator<< ( ostream& os, const Message& m ) {
 		case Message::RefreshLocalId: os << "DRAGON_RefreshLocalId"; break;
 		case Message::MonQuery: os << "DRAGON_MonQuery"; break;
 		case Message::MonReply: os << "DRAGON_MonReply"; break;
+		case Message::StatsQuery: os << "DRAGON_StatsQuery"; break;
+		case Message::StatsReply: os << "DRAGON_StatsReply"; break;
 		default: os << "UNKNOWN"; break;
 	}
 	os << " " << (uint32)m.getVersion() << " " << (uint32)m.getFlags()
@@ -863,6 +865,8 @@ void Message::checkStatus() const {
 	case Message::RefreshLocalId:
 	case Message::MonQuery:
 	case Message::MonReply:
+	case Message::StatsQuery:
+	case Message::StatsReply:
 		break;
 
 	default:
@@ -949,6 +953,8 @@ ostream& operator<< ( ostream& os, const MessagePrintShort& m ) {
 		case Message::RefreshLocalId: os << "DRAGON_RefreshLocalId"; break;
 		case Message::MonQuery: os << "DRAGON_MonQuery"; break;
 		case Message::MonReply: os << "DRAGON_MonReply"; break;
+		case Message::StatsQuery: os << "DRAGON_StatsQuery"; break;
+		case Message::StatsReply: os << "DRAGON_StatsReply"; break;
 		default: os << "UNKNOWN"; break;
 	}
 	os << " for " << m.getSESSION_Object().getDestAddress()
@@ -836,6 +836,28 @@ void DRAGON_EXT_INFO_Object::readFromBuffer(INetworkBuffer& buffer, uint16 len)
 			readLength += tlvLength;
 			break;
 /************** ^^^ Extension for DRAGON Monitoring ^^^ *****************/
+		case DRAGON_EXT_SUBOBJ_STATS_REPLY:
+			memset(&statsReply, 0, sizeof(STATS_Reply_Subobject));
+			statsReply.length = tlvLength;
+			statsReply.type = tlvType;
+			statsReply.sub_type = tlvSubType;
+			buffer >> statsReply.interval >> statsReply.num_probes;
+			buffer >> statsReply.path_fast_count >> statsReply.path_full_count;
+			// probes unknown to this side are skipped
+			for (i = 0; i < statsReply.num_probes; i++)
+			{
+				STATS_Probe_Info probe;
+				buffer >> probe.count >> probe.mean_usec >> probe.max_usec;
+				for (j = 0; j < STATS_HISTOGRAM_BUCKETS; j++)
+					buffer >> probe.buckets[j];
+				if (i < STATS_NUM_PROBES)
+					statsReply.probes[i] = probe;
+			}
+			if (statsReply.num_probes > STATS_NUM_PROBES)
+				statsReply.num_probes = STATS_NUM_PROBES;
+			SetSubobjFlag(DRAGON_EXT_SUBOBJ_STATS_REPLY);
+			readLength += tlvLength;
+			break;
 		default:
 			readLength += tlvLength;
 			while( (tlvLength--) > 4 ) buffer >> tlvChar;
@@ -941,6 +963,20 @@ ONetworkBuffer& operator<< ( ONetworkBuffer& buffer, const DRAGON_EXT_INFO_Objec
 
 /************** ^^^ Extension for DRAGON Monitoring ^^^ *****************/
 
+	if (o.HasSubobj(DRAGON_EXT_SUBOBJ_STATS_REPLY)) {
+		uint32 i;
+		int j;
+		buffer << o.statsReply.length << o.statsReply.type << o.statsReply.sub_type;
+		buffer << o.statsReply.interval << o.statsReply.num_probes;
+		buffer << o.statsReply.path_fast_count << o.statsReply.path_full_count;
+		for (i = 0; i < o.statsReply.num_probes; i++)
+		{
+			buffer << o.statsReply.probes[i].count << o.statsReply.probes[i].mean_usec << o.statsReply.probes[i].max_usec;
+			for (j = 0; j < STATS_HISTOGRAM_BUCKETS; j++)
+				buffer << o.statsReply.probes[i].buckets[j];
+		}
+	}
+
 	return buffer;
 }
 
@@ -1005,6 +1041,9 @@ ostream& operator<< ( ostream& os, const DRAGON_EXT_INFO_Object& o ) {
 		os << ")";
 	}
 /************** ^^^ Extension for DRAGON Monitoring ^^^ *****************/
+	if (o.HasSubobj(DRAGON_EXT_SUBOBJ_STATS_REPLY)) {
+		os << "(7: StatsReply: interval=" << o.statsReply.interval << ", probes=" << o.statsReply.num_probes << ", path fast/full=" << o.statsReply.path_fast_count << "/" << o.statsReply.path_full_count << ")";
+	}
 	os <<"]";
 	return os;
 }
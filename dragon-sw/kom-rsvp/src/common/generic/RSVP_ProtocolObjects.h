@@ -400,6 +400,10 @@ public:
 	void readFromBuffer( INetworkBuffer& buffer, uint16 len, uint8 C_Type);
 	uint16 total_size() const { return size() + RSVP_ObjectHeader::size(); }
 	const bool hasRA() const{ return (excludeAny || includeAny || includeAll);}
+	uint32 getExcludeAny() const { return excludeAny; }
+	uint32 getIncludeAny() const { return includeAny; }
+	uint32 getIncludeAll() const { return includeAll; }
+	uint8 getSetupPri() const { return setupPri; }
 	const String& getSessionName() const { return sessionName; }
 	bool operator==(const SESSION_ATTRIBUTE_Object& s){
 		return (sessionName == s.sessionName);
@@ -1060,6 +1064,7 @@ public:
 #define DRAGON_EXT_SUBOBJ_MON_QUERY 0x0008
 #define DRAGON_EXT_SUBOBJ_MON_REPLY 0x0010
 #define DRAGON_EXT_SUBOBJ_MON_NODE_LIST 0x0020
+#define DRAGON_EXT_SUBOBJ_STATS_REPLY 0x0040
 
 typedef struct  {
 	uint16 length;
@@ -1186,6 +1191,51 @@ typedef struct {
 
 /************** ^^^ Extension for DRAGON Monitoring ^^^ *****************/
 
+/************** vvv Extension for RSVPD processing statistics vvv *****************/
+
+// probes timed by the daemon; the message probes cover processMessage()
+#define STATS_PROBE_MSG_PATH			0
+#define STATS_PROBE_MSG_RESV			1
+#define STATS_PROBE_MSG_PATH_ERR		2
+#define STATS_PROBE_MSG_RESV_ERR		3
+#define STATS_PROBE_MSG_PATH_TEAR		4
+#define STATS_PROBE_MSG_RESV_TEAR		5
+#define STATS_PROBE_MSG_RESV_CONF		6
+#define STATS_PROBE_MSG_SREFRESH		7	// Srefresh and Ack
+#define STATS_PROBE_MSG_API			8	// messages from API clients
+#define STATS_PROBE_PROCESS_PATH		9	// Session::processPATH
+#define STATS_PROBE_PROCESS_RESV		10	// Session::processRESV
+#define STATS_PROBE_BIND_IN_AND_OUT	11	// MPLS::bindInAndOut
+#define STATS_PROBE_SWITCH_JOB		12	// switch control job on the worker thread
+#define STATS_PROBE_OSPF_QUERY		13	// request to OSPFd until its reply
+#define STATS_PROBE_NARB_QUERY		14	// query to NARB until its reply
+#define STATS_NUM_PROBES			15
+
+// bucket 0 counts latencies below 2 usec, bucket i those in [2^i, 2^(i+1))
+// usec, the last bucket everything from 2^(STATS_HISTOGRAM_BUCKETS-1) usec
+#define STATS_HISTOGRAM_BUCKETS 24
+typedef struct {
+	uint32 count;
+	uint32 mean_usec;
+	uint32 max_usec;
+	uint32 buckets[STATS_HISTOGRAM_BUCKETS];
+} STATS_Probe_Info;
+
+typedef struct {
+	uint16 length;
+	uint8 type;	//DRAGON_EXT_SUBOBJ_STATS_REPLY
+	uint8 sub_type; //0
+	uint32 interval;	// seconds the statistics have been collected for
+	uint32 num_probes;
+	uint32 path_fast_count;	// PATH refreshes matched against the stored image
+	uint32 path_full_count;	// PATH messages run through full processing
+	STATS_Probe_Info probes[STATS_NUM_PROBES];
+} STATS_Reply_Subobject;
+
+#define STATS_REPLY_BASE_SIZE 20
+
+/************** ^^^ Extension for RSVPD processing statistics ^^^ *****************/
+
 class DRAGON_EXT_INFO_Object : public RefObject<DRAGON_EXT_INFO_Object> {
 	uint32 subobj_flags;
 	ServiceConfirmationID_Subobject serviceConfID;
@@ -1194,6 +1244,7 @@ class DRAGON_EXT_INFO_Object : public RefObject<DRAGON_EXT_INFO_Object> {
 	MON_Query_Subobject monQuery;
 	MON_Reply_Subobject monReply;
 	MON_NodeList_Suboject monNodeList;
+	STATS_Reply_Subobject statsReply;
 
 	REF_OBJECT_METHODS(DRAGON_EXT_INFO_Object)
 	friend ostream& operator<< ( ostream&, const DRAGON_EXT_INFO_Object& );
@@ -1210,6 +1261,7 @@ class DRAGON_EXT_INFO_Object : public RefObject<DRAGON_EXT_INFO_Object> {
 			x += monReply.length; //Variable length
 		}
 		if (HasSubobj(DRAGON_EXT_SUBOBJ_MON_NODE_LIST)) x += (8+sizeof(in_addr)*monNodeList.count);
+		if (HasSubobj(DRAGON_EXT_SUBOBJ_STATS_REPLY)) x += statsReply.length;
 		return x;
 	}
 public:
@@ -1336,6 +1388,16 @@ public:
 
 /************** ^^^ Extension for DRAGON Monitoring ^^^ *****************/
 
+	void SetStatsReply(STATS_Reply_Subobject& obj) {
+		assert(obj.num_probes <= STATS_NUM_PROBES);
+		SetSubobjFlag(DRAGON_EXT_SUBOBJ_STATS_REPLY);
+		statsReply = obj;
+		statsReply.length = STATS_REPLY_BASE_SIZE + sizeof(STATS_Probe_Info)*obj.num_probes;
+		statsReply.type = DRAGON_EXT_SUBOBJ_STATS_REPLY;
+		statsReply.sub_type = 0;
+	}
+	STATS_Reply_Subobject& getStatsReply() { return statsReply; }
+
 };
 extern inline DRAGON_EXT_INFO_Object::~DRAGON_EXT_INFO_Object() {}
 
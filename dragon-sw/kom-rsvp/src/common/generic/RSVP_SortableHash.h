@@ -38,12 +38,26 @@ struct GetHash {
 	unsigned int operator()( const Key& k, unsigned int hashCount ) const { return k.getHashValue(hashCount); }
 };
 
+// If maxLoad is given, the hash doubles its number of buckets once the
+// average bucket holds more than maxLoad elements. The elements are moved to
+// the new buckets incrementally, one old bucket with every insert, so that no
+// single insert pays for the whole rehash. Moving keeps the list nodes, all
+// iterators stay valid; however, inserting while walking a bucket is not safe.
+// Elements with the same hash value always share a bucket, which lower_bound
+// scans rely on.
+
 template <class Value, class Key = Value, class Compare = Less<Key>, class HashValue = GetHash<Key>, unsigned int defaultSize = 1 >
 class SortableHash {
 
 public:
 	typedef SortableList<Value,Key,Compare> HashBucket;
 
+	struct BucketStats {
+		unsigned int bucketCount;
+		unsigned int usedCount;
+		unsigned int maxLength;
+	};
+
 private:
 	SortableHash& operator=( const SortableHash& );
 	SortableHash( const SortableHash& );
@@ -54,6 +68,40 @@ protected:
 	HashBucket* hash;
 	unsigned int hashCount;
 	unsigned int elemCount;
+	unsigned int maxLoad;
+
+	// buckets being rehashed, the ones below rehashIndex are empty already
+	HashBucket* oldHash;
+	unsigned int oldHashCount;
+	unsigned int rehashIndex;
+
+	HashBucket& bucket( const Key& elem ) const {
+		if ( oldHash ) {
+			unsigned int x = getHashValue(elem,oldHashCount);
+			if ( x >= rehashIndex ) return oldHash[x];
+		}
+		return hash[getHashValue(elem,hashCount)];
+	}
+
+	void rehashStep() {
+		if ( oldHash ) {
+			HashBucket& from = oldHash[rehashIndex];
+			while ( !from.empty() ) {
+				hash[getHashValue(from.front(),hashCount)].move_sorted( from, from.begin() );
+			}
+			rehashIndex += 1;
+			if ( rehashIndex == oldHashCount ) {
+				delete [] oldHash;
+				oldHash = NULL;
+			}
+		} else if ( maxLoad && elemCount > hashCount * maxLoad ) {
+			oldHash = hash;
+			oldHashCount = hashCount;
+			rehashIndex = 0;
+			hashCount *= 2;
+			hash = new HashBucket[hashCount];
+		}
+	}
 
 public:
 	class ConstIterator : public HashBucket::ConstIterator {
@@ -75,17 +123,18 @@ public:
 		Iterator( const typename HashBucket::Iterator& iter ) : HashBucket::Iterator(iter) {}
 	};
 
-	SortableHash( unsigned int hashCount = defaultSize )
-		: hash(new HashBucket[hashCount]), hashCount(hashCount), elemCount(0) {}
-	~SortableHash() { delete [] hash; }
+	SortableHash( unsigned int hashCount = defaultSize, unsigned int maxLoad = 0 )
+		: hash(new HashBucket[hashCount]), hashCount(hashCount), elemCount(0), maxLoad(maxLoad),
+		oldHash(NULL), oldHashCount(0), rehashIndex(0) {}
+	~SortableHash() { delete [] hash; if ( oldHash ) delete [] oldHash; }
 
 	bool operator==( const SortableHash& h ) const {
-		if ( hashCount == h.hashCount && elemCount == h.elemCount ) {
+		if ( getHashCount() == h.getHashCount() && elemCount == h.elemCount ) {
 			unsigned int x = 0;
-			for ( ; x < hashCount; x += 1 ) {
-				typename HashBucket::ConstIterator iter1 = hash[x].begin();
-				typename HashBucket::ConstIterator iter2 = h.hash[x].begin();
-				for ( ; iter1 != hash[x].end() && iter2 = h.hash[x].end(); ++iter1, ++iter2 ) {
+			for ( ; x < getHashCount(); x += 1 ) {
+				typename HashBucket::ConstIterator iter1 = (*this)[x].begin();
+				typename HashBucket::ConstIterator iter2 = h[x].begin();
+				for ( ; iter1 != (*this)[x].end() && iter2 != h[x].end(); ++iter1, ++iter2 ) {
 					if ( *iter1 != *iter2 ) return false;
 				}
 			}
@@ -94,67 +143,87 @@ public:
 		return false;
 	}
 
-	bool operator!=( const SortableHash& l ) const { return !operator==(this->h); }
+	bool operator!=( const SortableHash& h ) const { return !operator==(h); }
 
 	unsigned int size() const { return elemCount; }
 	bool empty() const { return elemCount == 0; }
 
 	Iterator lower_bound( const Key& elem ) const {
-		return hash[getHashValue(elem,hashCount)].lower_bound( elem );
+		return bucket(elem).lower_bound( elem );
 	}
 
 	Iterator find( const Key& elem ) const {
-		return hash[getHashValue(elem,hashCount)].find( elem );
+		return bucket(elem).find( elem );
 	}
 
 	bool contains( const Key& key ) const {
-		return hash[getHashValue(this->elem,hashCount)].find(key) != hash[getHashValue(this->elem,hashCount)].end();
+		return bucket(key).find(key) != bucket(key).end();
 	}
 
 	Iterator insert( ConstIterator pos, const Value& elem ) {
 		elemCount += 1;
-		return hash[getHashValue(elem,hashCount)].insert( pos, elem );
+		Iterator i = bucket(elem).insert( pos, elem );
+		rehashStep();
+		return i;
 	}
 
 	Iterator insert_sorted( const Value& elem ) {
 		elemCount += 1;
-		return hash[getHashValue(elem,hashCount)].insert_sorted( elem );
+		Iterator i = bucket(elem).insert_sorted( elem );
+		rehashStep();
+		return i;
 	}
 
 	Iterator insert_unique( const Value& elem ) {
-		unsigned int preCount = hash[getHashValue(elem,hashCount)].size();
-		Iterator i = hash[getHashValue(elem,hashCount)].insert_unique( elem );
-		elemCount += (hash[getHashValue(elem,hashCount)].size() - preCount);
+		HashBucket& b = bucket(elem);
+		unsigned int preCount = b.size();
+		Iterator i = b.insert_unique( elem );
+		elemCount += (b.size() - preCount);
+		rehashStep();
 		return i;
 	}
 
 	Iterator erase_key( const Key& elem ) {
-		unsigned int preCount = hash[getHashValue(elem,hashCount)].size();
-		Iterator i = hash[getHashValue(elem,hashCount)].erase_key( elem );
-		elemCount -= (preCount - hash[getHashValue(elem,hashCount)].size());
+		HashBucket& b = bucket(elem);
+		unsigned int preCount = b.size();
+		Iterator i = b.erase_key( elem );
+		elemCount -= (preCount - b.size());
 		return i;
 	}
 
 	Iterator erase( ConstIterator pos ) {
 		elemCount -= 1;
-		return hash[getHashValue(*pos,hashCount)].erase( pos );
+		return bucket(*pos).erase( pos );
 	}
 
+	// x < getHashCount(); while rehashing, the old buckets follow the new ones
 	const HashBucket& operator[]( unsigned int x ) const {
-		return hash[x];
+		return (x < hashCount) ? hash[x] : oldHash[x - hashCount];
 	}
 
 	const HashBucket& getHashBucket( const Key& elem ) const {
-		return hash[getHashValue(elem,hashCount)];
+		return bucket(elem);
 	}
 
-	unsigned int getHashCount() const { return hashCount; }
+	unsigned int getHashCount() const { return oldHash ? hashCount + oldHashCount : hashCount; }
+
+	void getBucketStats( BucketStats& stats ) const {
+		stats.bucketCount = getHashCount();
+		stats.usedCount = 0;
+		stats.maxLength = 0;
+		unsigned int x = 0;
+		for ( ; x < getHashCount(); x += 1 ) {
+			unsigned int length = (*this)[x].size();
+			if ( length > 0 ) stats.usedCount += 1;
+			if ( length > stats.maxLength ) stats.maxLength = length;
+		}
+	}
 
 	void callForAll( typename HashBucket::CallForAllVoid call ) {
 		unsigned int x = 0;
-		for ( ; x < hashCount; x += 1 ) {
-			typename HashBucket::Iterator i = hash[x].begin();
-			for ( ; i != hash[x].end(); ++i ) {
+		for ( ; x < getHashCount(); x += 1 ) {
+			typename HashBucket::ConstIterator i = (*this)[x].begin();
+			for ( ; i != (*this)[x].end(); ++i ) {
 				call( *i );
 			}
 		}
@@ -126,6 +126,15 @@ public:
 			return this->tail();
 	}
 
+	// moves elem of list 'from' to its place in this list, iterators to it stay valid
+	void move_sorted( SortableList& from, ConstIterator elem ) {
+		if ( this->empty() || comp( KEY_CAST this->back(), KEY_CAST *elem ) ) {
+			this->move( this->end(), from, elem );
+		} else {
+			this->move( lower_bound_node( KEY_CAST *elem ), from, elem );
+		}
+	}
+
 	void union_with( const SortableList& s ) {
 		ListNode* iter1 = this->head(); ListNode* iter2 = s.head();
 		while ( iter1 != this->tail() && iter2 != s.tail() ) {
@@ -37,9 +37,165 @@
 #include <sys/types.h>                           // needed for other includes
 #include <sys/socket.h>                          // socket, bind, sendto, recvf
 #include <sys/time.h>                            // FD_SET, etc.
+#if defined(USE_EPOLL)
+#include <sys/epoll.h>                           // epoll_create, epoll_ctl, epoll_wait
+#include <sys/poll.h>                            // poll
+#endif
 
 InterfaceHandleMask NetworkService::fdmask;
 int NetworkService::maxSelectFDs = 0;
+#if defined(USE_EPOLL)
+int NetworkService::epollFD = -1;
+NetworkService::HandleEntry* NetworkService::handleTable = NULL;
+int NetworkService::handleTableSize = 0;
+InterfaceHandle* NetworkService::pendingHandles = NULL;
+int NetworkService::pendingCount = 0;
+
+static const int maxEpollEvents = 64;
+#endif
+
+void NetworkService::registerHandle( InterfaceHandle fd, HandleCallback callback, void* data ) {
+#if defined(USE_EPOLL)
+	if ( epollFD == -1 ) {
+		epollFD = CHECK( epoll_create( maxEpollEvents ) );
+	}
+	if ( fd >= handleTableSize ) {
+		int newSize = handleTableSize ? handleTableSize : 64;
+		while ( newSize <= fd ) newSize *= 2;
+		HandleEntry* newTable = new HandleEntry[newSize];
+		initMemoryWithZero( newTable, sizeof(HandleEntry) * newSize );
+		InterfaceHandle* newPending = new InterfaceHandle[newSize];
+		if ( handleTable ) {
+			copyMemory( newTable, handleTable, sizeof(HandleEntry) * handleTableSize );
+			copyMemory( newPending, pendingHandles, sizeof(InterfaceHandle) * pendingCount );
+			delete [] handleTable;
+			delete [] pendingHandles;
+		}
+		handleTable = newTable;
+		pendingHandles = newPending;
+		handleTableSize = newSize;
+	}
+	HandleEntry& entry = handleTable[fd];
+	if ( callback ) {
+		entry.callback = callback;
+		entry.data = data;
+	}
+	if ( entry.registered ) return;
+	struct epoll_event ev;
+	initMemoryWithZero( &ev, sizeof(ev) );
+	ev.events = EPOLLIN | EPOLLET;
+	ev.data.fd = fd;
+	// a handle closed without deregistration has left the epoll set already
+	if ( epoll_ctl( epollFD, EPOLL_CTL_ADD, fd, &ev ) < 0 && errno != EEXIST ) {
+		ERROR(4)( Log::Error, "cannot add handle", fd, "to epoll set:", strerror(errno) );
+		return;
+	}
+	entry.registered = true;
+#else
+	FD_SET( fd, &fdmask );
+#endif
+	if ( fd >= maxSelectFDs ) maxSelectFDs = fd + 1;
+}
+
+// attach a callback to a handle that has been registered before
+void NetworkService::bindHandle( InterfaceHandle fd, HandleCallback callback, void* data ) {
+#if defined(USE_EPOLL)
+	if ( fd < 0 || fd >= handleTableSize || !handleTable[fd].registered ) return;
+	handleTable[fd].callback = callback;
+	handleTable[fd].data = data;
+#endif
+}
+
+void NetworkService::deregisterHandle( InterfaceHandle fd ) {
+#if defined(USE_EPOLL)
+	if ( fd < 0 || fd >= handleTableSize || !handleTable[fd].registered ) return;
+	epoll_ctl( epollFD, EPOLL_CTL_DEL, fd, NULL );
+	initMemoryWithZero( &handleTable[fd], sizeof(HandleEntry) );
+	for ( int i = 0; i < pendingCount; ++i ) {
+		if ( pendingHandles[i] == fd ) {
+			pendingHandles[i] = pendingHandles[--pendingCount];
+	break;
+		}
+	}
+#else
+	FD_CLR( fd, &fdmask );
+#endif
+}
+
+#if defined(USE_EPOLL)
+// call the handle's callback and remember it for the next round: the
+// epoll set is edge-triggered and the receiver reads one packet at a time
+bool NetworkService::dispatchHandle( InterfaceHandle fd ) {
+	HandleEntry& entry = handleTable[fd];
+	if ( !entry.registered ) return false;
+	if ( !entry.callback || !entry.callback( fd, entry.data ) ) {
+		LOG(2)( Log::Select, "no receiver for ready handle", fd );
+		return false;
+	}
+	if ( !entry.pending ) {
+		entry.pending = true;
+		pendingHandles[pendingCount++] = fd;
+	}
+	return true;
+}
+
+// re-check handles served earlier, those that are drained leave the list
+int NetworkService::dispatchPending() {
+	if ( pendingCount == 0 ) return 0;
+	static struct pollfd* pollSet = NULL;
+	static int pollSetSize = 0;
+	if ( pollSetSize < handleTableSize ) {
+		if ( pollSet ) delete [] pollSet;
+		pollSet = new struct pollfd[handleTableSize];
+		pollSetSize = handleTableSize;
+	}
+	int i;
+	for ( i = 0; i < pendingCount; ++i ) {
+		pollSet[i].fd = pendingHandles[i];
+		pollSet[i].events = POLLIN;
+		pollSet[i].revents = 0;
+	}
+	int count = poll( pollSet, pendingCount, 0 );
+	if ( count < 0 ) return count;
+	int pollCount = pendingCount;
+	pendingCount = 0;
+	count = 0;
+	for ( i = 0; i < pollCount; ++i ) {
+		InterfaceHandle fd = pollSet[i].fd;
+		handleTable[fd].pending = false;
+		if ( (pollSet[i].revents & (POLLIN|POLLERR|POLLHUP)) && dispatchHandle( fd ) ) {
+			count += 1;
+		}
+	}
+	return count;
+}
+
+// Wait for ready handles and call their callbacks. Returns the number of
+// handles delivered to a receiver, or -1 with errno set. A NULL timeout
+// blocks until at least one handle becomes ready.
+int NetworkService::dispatchHandles( const TimeValue* timeout ) {
+	if ( epollFD == -1 ) {
+		epollFD = CHECK( epoll_create( maxEpollEvents ) );
+	}
+	int count = dispatchPending();
+	if ( count < 0 ) return count;
+	int waitMSecs = -1;
+	if ( count > 0 ) {
+		waitMSecs = 0;
+	} else if ( timeout ) {
+		waitMSecs = timeout->tv_sec * MSECS_PER_SEC + (timeout->tv_usec + USECS_PER_MSEC - 1) / USECS_PER_MSEC;
+	}
+	static struct epoll_event events[maxEpollEvents];
+	int eventCount = epoll_wait( epollFD, events, maxEpollEvents, waitMSecs );
+	if ( eventCount < 0 ) return count > 0 ? count : eventCount;
+	for ( int i = 0; i < eventCount; ++i ) {
+		if ( !handleTable[events[i].data.fd].pending && dispatchHandle( events[i].data.fd ) ) {
+			count += 1;
+		}
+	}
+	return count;
+}
+#endif
 
 void NetworkService::joinMCastGroupIP4( InterfaceHandle fd, const NetAddress& group ) {
 #if defined(REAL_NETWORK)
@@ -90,8 +246,7 @@ void NetworkService::initReceiveInterface( InterfaceHandle fd, bool dedicatedRSV
 		CHECK( setsockopt( fd, SOL_SOCKET, SO_RCVBUF, (char *)&sockbufsize, sizeof(sockbufsize) ));
 	}
 	// set file description for select
-	FD_SET( fd, &fdmask );
-	if ( fd >= maxSelectFDs ) maxSelectFDs = fd + 1;
+	registerHandle( fd );
 }
 
 bool NetworkService::waitForPacket( InterfaceHandle fd, bool setTimeout, TimeValue timeout ) {
@@ -155,6 +310,6 @@ bool NetworkService::sendPacket( InterfaceHandle fd, const ONetworkBuffer& buffe
 }
 
 void NetworkService::shutdownInterface( InterfaceHandle fd ) {
-	FD_CLR( fd, &fdmask );
+	deregisterHandle( fd );
 	close(fd);
 }
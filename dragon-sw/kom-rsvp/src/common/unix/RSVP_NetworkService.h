@@ -34,12 +34,44 @@
 #include "RSVP_BasicTypes.h"
 #include "RSVP_TimeValue.h"
 
+// Linux: the daemon waits on an edge-triggered epoll set and every
+// registered handle carries its own ready callback, see dispatchHandles
+#if defined(Linux) && !defined(NO_EPOLL)
+#define USE_EPOLL 1
+#endif
+
 class NetworkService {
+public:
+	// returns false if nobody is going to read from the handle
+	typedef bool (*HandleCallback)( InterfaceHandle, void* );
+private:
 	static InterfaceHandleMask fdmask;
 	static int maxSelectFDs;
 	// defined in RSVP_System.cc
 	static const int sockbufsize;
-	friend class NetworkServiceDaemon;             // access: fdmask, maxSelectFDs
+#if defined(USE_EPOLL)
+	struct HandleEntry {
+		HandleCallback callback;
+		void* data;
+		bool registered;
+		bool pending;
+	};
+	static int epollFD;
+	static HandleEntry* handleTable;
+	static int handleTableSize;
+	// handles that were ready and may not have been drained yet
+	static InterfaceHandle* pendingHandles;
+	static int pendingCount;
+	static int dispatchPending();
+	static bool dispatchHandle( InterfaceHandle );
+#endif
+	static void registerHandle( InterfaceHandle, HandleCallback = NULL, void* = NULL );
+	static void bindHandle( InterfaceHandle, HandleCallback, void* );
+	static void deregisterHandle( InterfaceHandle );
+#if defined(USE_EPOLL)
+	static int dispatchHandles( const TimeValue* timeout );
+#endif
+	friend class NetworkServiceDaemon;             // access: fdmask, maxSelectFDs, (de)registerHandle, bindHandle, dispatchHandles
 public:
 	static InterfaceHandle initInterfaceUDP( uint16& );
 	static void initReceiveInterface( InterfaceHandle, bool dedicatedRSVP = false );
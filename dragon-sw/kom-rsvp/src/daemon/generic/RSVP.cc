@@ -48,6 +48,9 @@
 #include "RSVP_RoutingService.h"
 #include "RSVP_Session.h"
 #include "RSVP_SignalHandling.h"
+#include "NARB_APIClient.h"
+#include "SwitchCtrl_Global.h"
+#include "SwitchCtrl_Worker.h"
 
 #if defined(WITH_API)
 API_Server* RSVP::apiServer = NULL;
@@ -129,7 +132,7 @@ RSVP::RSVP( const String& confFile, LogicalInterfaceList tmpLifList )
 
 //	RSVP_Global::reportSettings();
 
-	sessionHash = new SessionHash(RSVP_Global::sessionHashCount);
+	sessionHash = new SessionHash(RSVP_Global::sessionHashCount, SESSION_HASH_LOAD);
 
 #if defined(WITH_API)
 	// create api server, create api interface with LIH = 0
@@ -150,7 +153,12 @@ RSVP::RSVP( const String& confFile, LogicalInterfaceList tmpLifList )
 
 	LogicalInterfaceList::Iterator iter = tmpLifList.begin();
 	for ( ;iter != tmpLifList.end(); ++iter ) {
-		if ( !(*iter)->isDisabled() ) (*iter)->init( interfaceCount );
+		if ( !(*iter)->isDisabled() ) {
+			(*iter)->init( interfaceCount );
+#if !defined(NS2)
+			NetworkServiceDaemon::registerInterface( *iter );
+#endif
+		}
 		lifArray[interfaceCount] = *iter;
 		interfaceCount += 1;
 	}
@@ -213,7 +221,7 @@ RSVP::~RSVP() {
 	if ( sessionHash ) {
 		RSVP_Global::messageProcessor->prepareExit();
 		uint32 x = 0;
-		for ( ; x < RSVP_Global::sessionHashCount; ++x ) {
+		for ( ; x < sessionHash->getHashCount(); ++x ) {
 			SessionHash::HashBucket::ConstIterator iterSession = (*sessionHash)[x].begin();
 			while ( iterSession != (*sessionHash)[x].end() ) {
 				Session *s = *iterSession;
@@ -276,6 +284,9 @@ int RSVP::main() {
 		 //@@@@ Xi2007 >>
 		if ( RSVP_Global::messageProcessor->queryEnqueuedMessages() ) {
 			RSVP_Global::messageProcessor->processMessage(); // processMessage based on restored scene
+			routing->clearResumedOspfRequest();
+			NARB_APIClient::clearResumedRequest();
+			RSVP_Global::switchController->clearResumedVLANSync();
 		}
 		 //@@@@ Xi2007 <<		
 		const LogicalInterface* currentLif = NetworkServiceDaemon::queryInterfaces();
@@ -303,6 +314,13 @@ int RSVP::main() {
 					RSVP_Global::messageProcessor->processAsyncRoutingEvent( *sessionIter, src, *inLif, lifList );
 				}
 			}
+		} else if ( NetworkServiceDaemon::queryAndClearOspfReply() ) {
+			// deferred PATH messages are resumed by queryEnqueuedMessages
+			routing->readOspfReplies();
+		} else if ( NetworkServiceDaemon::queryAndClearNarbReply() ) {
+			NARB_APIClient::readReplies();
+		} else if ( NetworkServiceDaemon::queryAndClearSwitchCtrlCompletion() ) {
+			SwitchCtrl_Worker::processCompletions();
 		} else if ( !endFlag ) {
 			FATAL(1)( Log::Fatal, "returned from queryInterfaces but without result" );
 			abortProcess();
@@ -461,6 +479,14 @@ inline void RSVP::logStats() {
 	printSafe( "current session count is %d\n", currentSessionCount );
 	printSafe( "max session count is %d\n", maxSessionCount );
 	printSafe( "current reservation count is %d\n", currentReservationCount );
+	printSafe( "PATH fast refreshes: %u, full processing: %u\n", Session::pathFastCount, Session::pathFullCount );
+	SessionHash::BucketStats hashStats;
+	sessionHash->getBucketStats( hashStats );
+	printSafe( "session hash buckets: %d, used: %d, longest: %d\n", hashStats.bucketCount, hashStats.usedCount, hashStats.maxLength );
+	if ( mpls ) {
+		const MPLS_LabelAllocator& labels = mpls->getLabelAllocator();
+		printSafe( "MPLS labels in use: %d, peak: %d, label map: %d of %d\n", labels.getUsedCount(), labels.getPeakCount(), labels.getMapSize(), labels.getSpaceSize() );
+	}
 #if defined(WITH_API)
 	printSafe( "number of API clients is %d\n", getApiServer().getNumberOfClients() );
 #endif
@@ -38,6 +38,7 @@
 #include "RSVP_LogicalInterface.h"
 #include "RSVP_Message.h"
 #include "RSVP_MessageProcessor.h"
+#include "RSVP_ProcessingStats.h"
 #include "RSVP_ProtocolObjects.h"
 #include "RSVP_TrafficControl.h"
 #include "RSVP_RoutingService.h"
@@ -121,8 +122,29 @@ inline void API_Server::requestRefreshAPI( const SESSION_Object& session, const
 	currentPort = 0;
 }
 
+// statistics are sent back to the querying client only, which need not have
+// registered any session
+void API_Server::sendStatistics( const Message& query ) {
+	STATS_Reply_Subobject statsReply;
+	ProcessingStats::getStatistics( statsReply );
+	Message replyMsg( Message::StatsReply, 1, query.getSESSION_Object() );
+	DRAGON_EXT_INFO_Object* dragonExtInfo = new DRAGON_EXT_INFO_Object;
+	dragonExtInfo->SetStatsReply( statsReply );
+	replyMsg.setDRAGON_EXT_INFO_Object( *dragonExtInfo );
+	currentAddress = &query.getRSVP_HOP_Object().getAddress();
+	currentPort = query.getRSVP_HOP_Object().getLIH();
+	LOG(4)( Log::API, "sending processing statistics to API at", *currentAddress, "/", currentPort );
+	sendMessage( replyMsg );
+	currentPort = 0;
+	dragonExtInfo->destroy();
+}
+
 void API_Server::processMessage( const Message& msg, MessageProcessor& mp) {
-       assert( msg.getMsgType() == Message::InitAPI  || msg.getMsgType() == Message::RemoveAPI);
+       assert( msg.getMsgType() == Message::InitAPI  || msg.getMsgType() == Message::RemoveAPI || msg.getMsgType() == Message::StatsQuery );
+	if ( msg.getMsgType() == Message::StatsQuery ) {
+		sendStatistics( msg );
+		return;
+	}
 	currentProcessor = &mp;
 	SESSION_Object session = msg.getSESSION_Object();
 	uint16 port = msg.getRSVP_HOP_Object().getLIH();
@@ -55,6 +55,7 @@ class API_Server {
 	uint16 currentPort;
 	const NetAddress* currentAddress;
 	void deregisterAPI( const ApiEntryList::ConstIterator );
+	void sendStatistics( const Message& query );
 	// statistics data
 	uint32 clientCount;
 public:
@@ -31,7 +31,7 @@
 #include "RSVP_BaseTimer.h"
 #include "RSVP_Log.h"
 
-TimerSystem::TimerSystem() : endFlag(false) {
+TimerSystem::TimerSystem() : timerCount(0), expiredList(NULL), endFlag(false) {
 #if defined(NO_TIMERS) || defined(NS2)
 	slotCount = 1;
 	slotLength = totalPeriod;
@@ -61,13 +61,12 @@ TimerSystem::TimerSystem() : endFlag(false) {
 #else
 	maxDeltaSlots = TimeValue(1,0) / slotLength;
 #endif
-	timerList = new BaseTimerList[slotCount];
-	endOfList = timerList + slotCount;
+	slotUsecs = slotLength.getUsec();
+	initMemoryWithZero( wheel, sizeof(wheel) );
 	getCurrentSystemTime(currentTime);
 	epochBaseTime = (currentTime / totalPeriod) * totalPeriod;
-	currentSlot = getSlotNumber( currentTime ) % slotCount;
-	currentFireList = timerList + currentSlot;
-	ERROR(7)( Log::Error, "Timer:", currentTime, currentSlot, totalPeriod, slotLength, slotCount, epochBaseTime );
+	currentTick = getTickNumber( currentTime );
+	ERROR(7)( Log::Error, "Timer:", currentTime, currentTick, totalPeriod, slotLength, slotCount, epochBaseTime );
 	return;
 abort:
 	reportSettings();
@@ -76,16 +75,15 @@ abort:
 }
 
 TimerSystem::~TimerSystem() {
-	sint32 t = 0;
-	sint32 i = 0;
-	for ( ; i < slotCount; i += 1 ) {
-		t += timerList[i].size();
-		timerList[i].clear();
+	if ( timerCount != 0 ) {
+		cerr << "found " << timerCount << " remaining timers during system cleanup" << endl;
 	}
-	if ( t != 0 ) {
-		cerr << "found " << t << " remaining timers during system cleanup" << endl;
+	// detach remaining timers, so that their destructors leave the wheel alone
+	uint32 i = 0;
+	for ( ; i < sizeof(wheel)/sizeof(wheel[0]); i += 1 ) {
+		while ( wheel[i] ) unlink( wheel[i] );
 	}
-	delete [] timerList;
+	while ( expiredList ) unlink( expiredList );
 }
 
 void TimerSystem::reportSettings() {
@@ -97,115 +95,157 @@ void TimerSystem::reportSettings() {
 		<< "TimerSystem::totalPeriod = " << (PreciseTimeValue&)totalPeriod << " sec" << endl;
 }
 
-extern inline sint32 TimerSystem::getSlotNumber( const TimeValue& t ) {
-                                                    assert(t >= epochBaseTime);
-	return (t - epochBaseTime) / slotLength;
+extern inline sint64 TimerSystem::getTickNumber( const TimeValue& t ) const {
+	sint64 usecs = (t - epochBaseTime).getUsec();
+	return usecs > 0 ? usecs / slotUsecs : 0;
 }
 
-extern inline BaseTimer* TimerSystem::getNextAlarm() {
-	return currentFireList->empty() ? (BaseTimer*)0 : currentFireList->front();
+extern inline void TimerSystem::link( BaseTimer* b, BaseTimer** head ) {
+	b->nextTimer = *head;
+	if ( *head ) (*head)->prevLink = &b->nextTimer;
+	*head = b;
+	b->prevLink = head;
 }
 
-BaseTimerList::ConstIterator TimerSystem::insertTimer( BaseTimer* b ) {
-#if defined(NO_TIMERS)
-	return timerList[0].end();
-#endif
-	BaseTimerList::ConstIterator iter;
-	sint32 timerSlot = getSlotNumber( b->getAlarmTime() );
-                                              assert(timerSlot >= currentSlot);
-	if ( (timerSlot - currentSlot) >= slotCount ) {
-		iter = futureTimerList.insert_sorted( b );
-	} else {
-#if defined(FUZZY_TIMERS)
-		iter = timerList[timerSlot%slotCount].push_back( b );
-#else
-		iter = timerList[timerSlot%slotCount].insert_sorted( b );
-#endif
+extern inline void TimerSystem::unlink( BaseTimer* b ) {
+	*b->prevLink = b->nextTimer;
+	if ( b->nextTimer ) b->nextTimer->prevLink = b->prevLink;
+	b->nextTimer = NULL;
+	b->prevLink = NULL;
+}
+
+// put timer into the slot for its tick, relative to 'currentTick'
+void TimerSystem::enqueue( BaseTimer* b ) {
+	sint64 tick = getTickNumber( b->getAlarmTime() );
+	if ( tick < currentTick ) tick = currentTick;
+	sint64 delta = tick - currentTick;
+	if ( delta < rootSize ) {
+		link( b, &wheel[tick & (rootSize-1)] );
+		return;
 	}
-	LOG(4)( Log::Timer, "timer", b, *b, "scheduled" );
-	return iter;
+	if ( delta > maxTicks ) {
+		delta = maxTicks;
+		tick = currentTick + maxTicks;
+	}
+	BaseTimer** level = wheel + rootSize;
+	sint32 shift = rootBits;
+	while ( (delta >> shift) >= levelSize ) {
+		level += levelSize;
+		shift += levelBits;
+	}
+	link( b, &level[(tick >> shift) & (levelSize-1)] );
+}
+
+// move the timers of the current slot of 'level' one level down
+void TimerSystem::cascade( sint32 level ) {
+	sint32 shift = rootBits + (level - 1) * levelBits;
+	BaseTimer** slot = wheel + rootSize + (level - 1) * levelSize + ((currentTick >> shift) & (levelSize-1));
+	BaseTimer* b = *slot;
+	*slot = NULL;
+	while ( b ) {
+		BaseTimer* next = b->nextTimer;
+		b->prevLink = NULL;
+		enqueue( b );
+		b = next;
+	}
+}
+
+void TimerSystem::advance() {
+	currentTick += 1;
+	sint32 level = 1;
+	sint32 shift = rootBits;
+	// cascade upper levels when the lower one wraps around
+	while ( level <= wheelLevels && (currentTick & ((sint64(1) << shift) - 1)) == 0 ) {
+		cascade( level );
+		level += 1;
+		shift += levelBits;
+	}
+}
+
+// move due timers of a slot to the expired list
+bool TimerSystem::expire( BaseTimer** slot, bool all ) {
+	bool found = false;
+	BaseTimer* b = *slot;
+	while ( b ) {
+		BaseTimer* next = b->nextTimer;
+		if ( all || b->getAlarmTime() - currentTime <= timerResolution ) {
+			unlink( b );
+			link( b, &expiredList );
+			found = true;
+		}
+		b = next;
+	}
+	return found;
 }
 
-void TimerSystem::eraseTimer( BaseTimerList::ConstIterator iter ) {
+// a timer either restarts, cancels or deletes itself when fired
+void TimerSystem::fireExpired( bool late ) {
+	while ( expiredList ) {
+		BaseTimer* b = expiredList;
+		if ( late ) {
+			LOG(5)( Log::Timer, "timer", b, *b, "fired late at time" , (DaytimeTimeValue&)currentTime );
+		} else {
+			LOG(5)( Log::Timer, "timer", b, *b, "fired at time" , (DaytimeTimeValue&)currentTime );
+		}
+		b->internalFire();
+		if ( expiredList == b ) {
+			unlink( b );
+			timerCount -= 1;
+		}
+	}
+}
+
+void TimerSystem::insertTimer( BaseTimer* b ) {
 #if defined(NO_TIMERS)
 	return;
 #endif
-	sint32 timerSlot = getSlotNumber( (*iter)->getAlarmTime() );
-                                              assert(timerSlot >= currentSlot);
-	if ( (timerSlot - currentSlot) >= slotCount ) {
-		if ( futureTimerList.empty() ) {
-			FATAL(4)( Log::Fatal, "attempt to remove from empty futureTimerList - currentSlot", currentSlot, "timerSlot", timerSlot );
-			abortProcess();
-		}
-		futureTimerList.erase( iter );
-	} else {
-		timerList[timerSlot%slotCount].erase( iter );
-	}
+	enqueue( b );
+	timerCount += 1;
+	LOG(4)( Log::Timer, "timer", b, *b, "scheduled" );
+}
+
+void TimerSystem::eraseTimer( BaseTimer* b ) {
+	unlink( b );
+	timerCount -= 1;
 }
 
 bool TimerSystem::executeTimer( TimeValue& remainingTime ) {
 	getCurrentSystemTime( currentTime );
-	sint32 targetSlot = getSlotNumber( currentTime );
-	if ( currentSlot - targetSlot > 0 ) {
-		ERROR(2)( Log::Error, "WARNING: clock has probably moved backwards by ", (currentSlot - targetSlot) * slotLength );
-		currentSlot = targetSlot;
-		currentFireList = timerList + currentSlot;
-	} else if ( targetSlot - currentSlot > maxDeltaSlots ) {
-		ERROR(2)( Log::Error, "WARNING: timer system overloaded, deviation is ", (targetSlot - currentSlot) * slotLength );
-	}
-
-	// fire all old timers, increase slot number until current slot is reached
-	BaseTimer* nextAlarm = getNextAlarm();
-	while ( targetSlot - currentSlot > 0 ) {
-		while ( nextAlarm ) {
-			LOG(5)( Log::Timer, "timer", nextAlarm, *nextAlarm, "fired late at time" , (DaytimeTimeValue&)currentTime );
-			nextAlarm->internalFire();
-			nextAlarm = getNextAlarm();
-		}
-		currentSlot += 1;
-		currentFireList += 1;
-		if ( currentFireList >= endOfList ) {
-                 assert( currentSlot == slotCount && targetSlot >= slotCount );
-			currentFireList = timerList;
-			currentSlot = 0;
-			epochBaseTime += totalPeriod;
-                                        assert( epochBaseTime <= currentTime );
-			targetSlot -= slotCount;
-		}
-		while( !futureTimerList.empty() ) {
-			BaseTimer* t = futureTimerList.front();
-			if ( (getSlotNumber( t->getAlarmTime() ) - currentSlot) < slotCount ) {
-				futureTimerList.pop_front();
-				t->reschedule();
-				LOG(5)( Log::Timer, "timer", t, *t, "rescheduling into current epoch at time" , (DaytimeTimeValue&)currentTime );
-			} else {
-		break;
-			}
+	sint64 targetTick = getTickNumber( currentTime );
+	if ( currentTick - targetTick > 0 ) {
+		ERROR(2)( Log::Error, "WARNING: clock has probably moved backwards by ", slotLength * sint32(currentTick - targetTick) );
+	} else if ( targetTick - currentTick > maxDeltaSlots ) {
+		ERROR(2)( Log::Error, "WARNING: timer system overloaded, deviation is ", slotLength * sint32(targetTick - currentTick) );
+	}
+
+	// fire all old timers, advance tick until current tick is reached
+	while ( targetTick - currentTick > 0 ) {
+		while ( expire( &wheel[currentTick & (rootSize-1)], true ) ) {
+			fireExpired( true );
 		}
-		nextAlarm = getNextAlarm();
+		advance();
 	}
 
 	// fuzzy timers: fire all timers of this slot!
-	for (;;) {
-		if ( nextAlarm ) {
-#if !defined(FUZZY_TIMERS)
-			remainingTime = nextAlarm->getAlarmTime() - currentTime;
-			if ( remainingTime > timerResolution )
-	break;
-#endif
-		}	else {
+	BaseTimer** slot = &wheel[currentTick & (rootSize-1)];
 #if defined(FUZZY_TIMERS)
-			// 'select' call will take minimum time of timerResolution anyway
-			remainingTime = slotLength/2;
+	while ( expire( slot, true ) ) {
+		fireExpired( false );
+	}
+	// 'select' call will take minimum time of timerResolution anyway
+	remainingTime = slotLength/2;
 #else
-			remainingTime = ( slotLength - currentTime % slotLength );
-#endif
-	break;
+	while ( expire( slot, false ) ) {
+		fireExpired( false );
+	}
+	remainingTime = ( slotLength - currentTime % slotLength );
+	BaseTimer* b = *slot;
+	for ( ; b; b = b->nextTimer ) {
+		if ( b->getAlarmTime() - currentTime < remainingTime ) {
+			remainingTime = b->getAlarmTime() - currentTime;
 		}
-		LOG(5)( Log::Timer, "timer", nextAlarm, *nextAlarm, "fired at time" , (DaytimeTimeValue&)currentTime );
-		nextAlarm->internalFire();
-		nextAlarm = getNextAlarm();
 	}
+#endif
 	return true;
 }
 
@@ -215,6 +255,6 @@ void TimerSystem::start() {
 }
 
 TimeValue TimerSystem::checkDrift() {
-	sint32 diff = getSlotNumber( getCurrentSystemTime() ) - currentSlot;
+	sint32 diff = getTickNumber( getCurrentSystemTime() ) - currentTick;
 	return slotLength * ( diff > 0 ? diff -1 : diff );
 }
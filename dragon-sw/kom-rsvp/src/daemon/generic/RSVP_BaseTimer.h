@@ -34,16 +34,16 @@
 #include "RSVP_Global.h"
 #include "RSVP_Log.h"
 #include "RSVP_TimeValue.h"
-#include "RSVP_SortedList.h"
 
 class BaseTimer;
-template <> struct Less<BaseTimer*> {
-	inline bool operator()( BaseTimer*, BaseTimer* ) const;
-};
-typedef SortableList<BaseTimer*,BaseTimer*> BaseTimerList;
 
 namespace TG { class TrafficGenerator; }
 
+// Hierarchical timing wheel: level 0 has one slot per 'slotLength' tick,
+// each of the 'wheelLevels' upper levels has 64 slots covering 64 slots of
+// the level below. Timers are linked into their slot directly, so insert
+// and cancel are O(1) and do not allocate; timers from an upper level are
+// cascaded into the lower levels when level 0 wraps around.
 class TimerSystem {
 	// static members are defined in RSVP_Global.cc
 	static sint32 slotCount;
@@ -51,16 +51,27 @@ class TimerSystem {
 	static TimeValue slotLength;
 	static TimeValue timerResolution;
 	static sint32 maxDeltaSlots;
-	sint32 currentSlot;
+	static const sint32 rootBits = 8;
+	static const sint32 levelBits = 6;
+	static const sint32 wheelLevels = 4;
+	static const sint32 rootSize = 1 << rootBits;
+	static const sint32 levelSize = 1 << levelBits;
+	static const sint64 maxTicks = (sint64(1) << (rootBits + wheelLevels * levelBits)) - 1;
+	sint64 currentTick;                                  // next tick to expire
+	sint64 slotUsecs;
+	uint32 timerCount;
 	TimeValue currentTime;
 	TimeValue epochBaseTime;
-	BaseTimerList* currentFireList;
-	BaseTimerList* timerList;
-	BaseTimerList* endOfList;
-	BaseTimerList futureTimerList;
-	inline void fire();
-	inline sint32 getSlotNumber( const TimeValue& t );
-	inline BaseTimer* getNextAlarm();
+	BaseTimer* wheel[rootSize + wheelLevels * levelSize];
+	BaseTimer* expiredList;
+	inline sint64 getTickNumber( const TimeValue& t ) const;
+	inline void link( BaseTimer*, BaseTimer** );
+	inline void unlink( BaseTimer* );
+	void enqueue( BaseTimer* );
+	void cascade( sint32 level );
+	void advance();
+	bool expire( BaseTimer** slot, bool all );
+	void fireExpired( bool late );
 	bool endFlag;
 	friend class ConfigFileReader;                      // access: totalPeriod, slotCount, slotLength
 	friend class TG::TrafficGenerator;                  // access: totalPeriod, slotCount, slotLength
@@ -74,9 +85,10 @@ public:
 	TimerSystem();
 	~TimerSystem();
 	void reportSettings();
-	BaseTimerList::ConstIterator insertTimer( BaseTimer* );
-	void eraseTimer( BaseTimerList::ConstIterator );
+	void insertTimer( BaseTimer* );
+	void eraseTimer( BaseTimer* );
 	bool executeTimer( TimeValue& );
+	uint32 getTimerCount() const { return timerCount; }
 #if defined(NS2)
 	const TimeValue& getCurrentTime() { currentTime = getCurrentSystemTime(); return currentTime; }
 #else
@@ -87,36 +99,32 @@ public:
 class BaseTimer {
 protected:
 	TimeValue alarmTime;                              // absolut time value
-	BaseTimerList::ConstIterator myIterator;
+	// intrusive link into the timer wheel, 'prevLink' is NULL when idle
+	BaseTimer* nextTimer;
+	BaseTimer** prevLink;
 	friend ostream& operator<< ( ostream&, const BaseTimer& );
-	friend class TimerSystem;                         // access: reschedule
+	friend class TimerSystem;                         // access: nextTimer, prevLink
 	void start() {
-                                                         assert( !myIterator );
-		myIterator = RSVP_Global::currentTimerSystem->insertTimer( this );
-	}
-	void reschedule() {
-                                                          assert( myIterator );
-		myIterator.reset();
-		start();
+                                                         assert( !prevLink );
+		RSVP_Global::currentTimerSystem->insertTimer( this );
 	}
 public:
 	virtual void internalFire() = 0;
 public:
-	BaseTimer( const TimeValue& timeout ) {
+	BaseTimer( const TimeValue& timeout ) : nextTimer(NULL), prevLink(NULL) {
 		if ( timeout != TimeValue(0,0) ) {
 			alarmTime = timeout + getCurrentSystemTime();
 			start();
 		}
 	}
-	BaseTimer( const BaseTimer& b ) : alarmTime(b.alarmTime) {}
+	BaseTimer( const BaseTimer& b ) : alarmTime(b.alarmTime), nextTimer(NULL), prevLink(NULL) {}
 	virtual ~BaseTimer() {
 		LOG(4)( Log::Timer, "timer", this, *this, "deleted" );
 		cancel();
 	}
 	void cancel() {
-		if ( myIterator ) {
-			RSVP_Global::currentTimerSystem->eraseTimer( myIterator );
-			myIterator.reset();
+		if ( prevLink ) {
+			RSVP_Global::currentTimerSystem->eraseTimer( this );
 		}
 	}
 	void restart( const TimeValue& timeout ) {
@@ -126,7 +134,7 @@ public:
 			start();
 		}
 	}
-	bool isActive() const { return myIterator; }
+	bool isActive() const { return prevLink != NULL; }
 	const TimeValue& getAlarmTime() const { return alarmTime; }
 	TimeValue getRemainingTime() const {
 		return alarmTime - getCurrentSystemTime();
@@ -135,9 +143,6 @@ public:
 };
 
 IMPLEMENT_ORDER1(BaseTimer,alarmTime)
-inline bool Less<BaseTimer*>::operator()( BaseTimer* b1, BaseTimer* b2 ) const {
-	return *b1 < *b2;
-}
 
 inline ostream& operator<< ( ostream& os, const BaseTimer& bt ) {
 	os << (DaytimeTimeValue&)bt.alarmTime;
@@ -312,6 +312,14 @@ void ConfigFileReader::setSwitchVlanOption(String sw_vlan_option)
 	else if (sw_vlan_option == "force10-no-qos" || sw_vlan_option == "switch-no-qos") {
 		RSVP_Global::switchController->setSwitchVlanOption(SW_VLAN_NO_QOS);
 	}
+	else if (sw_vlan_option.leftequal("snmp-bulk-")) {
+		//snmp-bulk-<n>: max-repetitions of the GETBULK requests reading the VLAN tables
+		int n = atoi(sw_vlan_option.chars() + strlen("snmp-bulk-"));
+		if (n > 0)
+			RSVP_Global::switchController->setSnmpBulkRepetitions(n);
+		else
+			ERROR(2)( Log::Error, "ERROR: wrong snmp-bulk repetitions: ", sw_vlan_option);
+	}
 }
 
 void ConfigFileReader::cleanup() {
@@ -79,8 +79,8 @@ Hop::Hop( const LogicalInterface& lif, const NetAddress& addr )
 	initMemoryWithZero( idSend, sizeof(SendStorageID) * RSVP_Global::idHashCountSend );
 	idRecv = new ID_List[RSVP_Global::idHashCountRecv];
 	idRecvCount = 0;
-	currentRecvID = 0;
 	currentRecvEpoch = 0;
+	recvEpochValid = false;
 	maxNackSize = getLogicalInterface().getMaxUnfragmentMsgSize() - MESSAGE_ID_NACK_Object::total_size();
 #endif
 	if ( addr && addr != LogicalInterface::loopbackAddress ) {
@@ -118,135 +118,157 @@ void Hop::sendMessageReliable( const Message& msg, const NetAddress& dest, const
 	}
 }
 
+// refresh a PSB whose message ID has been seen again, either listed in a
+// Srefresh or carried by an unchanged PATH message; returns false if the PSB
+// needs full processing, so a PATH is processed and a Srefresh ID is NACKed
+bool Hop::refreshRecvPSB( PSB* psb, const Message& msg ) {
+	if ( !psb->getSession().refreshPSB( *psb ) ) {
+		LOG(2)( Log::Reduct, "ID refresh needs full PATH processing for", *psb );
+		return false;
+	}
+#if defined(CHECK_UNICAST_ROUTING_FOR_PATH_REFRESH)
+	static NetAddress gw(0);
+	const LogicalInterface* lif;
+
+	//@@@@ UNI related hacks
+	DRAGON_UNI_Object* dragonUni = (DRAGON_UNI_Object*)psb->getDRAGON_UNI_Object();
+	GENERALIZED_UNI_Object* generalizedUni = (GENERALIZED_UNI_Object*)psb->getGENERALIZED_UNI_Object();
+#if defined(WITH_API)
+	if (Session::ospfRouterID.rawAddress() == 0)
+		Session::ospfRouterID = RSVP_Global::rsvp->getRoutingService().getLoopbackAddress();
+	if (psb->getSession().getDestAddress() == Session::ospfRouterID) {
+		if (dragonUni != NULL) {
+			const String egressChanName = (const char*)dragonUni->getEgressCtrlChannel().name;
+			if (egressChanName == "implicit")
+				lif = RSVP_Global::rsvp->findInterfaceByLocalId((const uint32)dragonUni->getDestTNA().local_id);
+			else
+				lif = RSVP_Global::rsvp->findInterfaceByName(egressChanName);
+		}
+		else { //non-UNI or Generalized UNI
+			lif = RSVP_Global::rsvp->getApiLif();
+		}
+	}
+	else
+#endif
+		if ( psb->getEXPLICIT_ROUTE_Object() )
+	{
+		EXPLICIT_ROUTE_Object* ero = const_cast<EXPLICIT_ROUTE_Object*>(psb->getEXPLICIT_ROUTE_Object());
+		if (ero->getAbstractNodeList().front().getType() == AbstractNode::IPv4)
+			lif = RSVP_Global::rsvp->getRoutingService().findOutLifByOSPF(ero->getAbstractNodeList().front().getAddress(), 0, gw);
+		else if (ero->getAbstractNodeList().front().getType() == AbstractNode::UNumIfID)
+		{
+			uint32 uNumIfID = ero->getAbstractNodeList().front().getInterfaceID();
+			lif = RSVP_Global::rsvp->getRoutingService().findOutLifByOSPF(ero->getAbstractNodeList().front().getAddress(), uNumIfID, gw);
+		}
+		else
+			lif = RSVP_Global::rsvp->getRoutingService().getUnicastRoute( psb->getSession().getDestAddress(), gw );
+	}
+	else if (generalizedUni) {
+		lif = NULL;
+		if (SwitchCtrl_Session_SubnetUNI::subnetUniApiClientList) {
+			SwitchCtrl_Session_SubnetUNI_List::Iterator uniSessionIter = SwitchCtrl_Session_SubnetUNI::subnetUniApiClientList->begin();
+			for ( ; uniSessionIter != SwitchCtrl_Session_SubnetUNI::subnetUniApiClientList->end(); ++uniSessionIter) {
+				if ((*uniSessionIter)->isSessionOwner(msg)) {
+					lif = (*uniSessionIter)->getControlInterface(gw);
+				}
+			}
+		}
+		if (!lif )
+			lif = RSVP_Global::rsvp->getApiLif();
+	}
+	else if (dragonUni) {
+		lif = RSVP_Global::rsvp->findInterfaceByName(String((const char*)dragonUni->getEgressCtrlChannel().name));
+	}
+	else {
+		lif = RSVP_Global::rsvp->getRoutingService().getUnicastRoute( psb->getSession().getDestAddress(), gw );
+	}
+	//@@@@ UNI related hacks END
+
+#if defined(WITH_API)
+	if ( !lif
+		&& ( RSVP_Global::rsvp->findInterfaceByAddress( psb->getSession().getDestAddress() )
+			|| psb->getSession().getDestAddress().isMulticast() ) ) {
+		lif = RSVP_Global::rsvp->getApiLif();
+	}
+#endif
+	if ( !lif ) {
+		ERROR(4)( Log::Error, "ERROR: cannot find outgoing interface for PSB", *psb, "from", *this );
+		return false;
+	} else if ( !psb->matchOI( *lif ) ) {
+		psb->updateRoutingInfo( lif, gw, false, true );
+	}
+#endif
+	psb->restartTimeout();
+	return true;
+}
+
+void Hop::sendNackMessage( Message*& nackMsg ) {
+	if (getLogicalInterface().getAddress() != LogicalInterface::noGatewayAddress){
+		NetAddress peer;
+		RSVP_Global::rsvp->getRoutingService().getPeerIPAddr(getLogicalInterface().getAddress(), peer);
+		getLogicalInterface().sendMessage( *nackMsg, peer );
+	}
+	else
+		getLogicalInterface().sendMessage( *nackMsg, getAddress() );
+	delete nackMsg;
+	nackMsg = new Message( Message::Ack, 15 );
+}
+
 void Hop::processSrefresh( const Message& msg ) {
-       //static int switch_refresh_counter = 1;
-       const SimpleList<sint32>& msgIdList = msg.getMESSAGE_ID_LIST_Object().getID_List();
+	if ( !idRecv ) return;
+	const MESSAGE_ID_LIST_Object& idListObject = msg.getMESSAGE_ID_LIST_Object();
+	const SimpleList<sint32>& msgIdList = idListObject.getID_List();
+	// a new epoch means the neighbor has restarted; none of the listed IDs
+	// can refer to state installed under the old epoch -> NACK all of them
+	bool epochChanged = !recvEpochValid || idListObject.getEpoch() != currentRecvEpoch;
+	if ( epochChanged ) {
+		LOG(4)( Log::Reduct, "Srefresh with unknown epoch", idListObject.getEpoch(), "from", *this );
+	}
 	SimpleList<sint32>::ConstIterator msgIter = msgIdList.begin();
 	Message* nackMsg = new Message( Message::Ack, 15 );
 	for ( ; msgIter != msgIdList.end(); ++msgIter ) {
 		// Search for matching state block(s). Either find a PSB and terminate
 		// loop or find one or multiple RSBs, thus continue loop on RSB.
 		bool foundRSB = false;
-		ID_List& stateIdList = idRecv[recvHash(*msgIter)];
-		ID_List::ConstIterator stateIter = stateIdList.begin();
-		for ( ; stateIter != stateIdList.end(); ++stateIter ) {
-			if ( (*stateIter).id == *msgIter ) {
-				switch( (*stateIter).type ) {
-				case RecvStorageID::Path:
-				{
-					LOG(4)( Log::Reduct, "found PSB for ID", *msgIter, "from", *this );
-					if ( foundRSB ) {
-						ERROR(5)( Log::Error, "already found RSB (and now PSB) for ID", *msgIter, "from", *this, "ignoring PSB" );
-	goto nextMsgIter;
-					}
-#if defined(CHECK_UNICAST_ROUTING_FOR_PATH_REFRESH)
-					static NetAddress gw(0);
-					const LogicalInterface* lif;
-
-					//@@@@ UNI related hacks
-					DRAGON_UNI_Object* dragonUni = (DRAGON_UNI_Object*)(*stateIter).sb.psb->getDRAGON_UNI_Object();
-					GENERALIZED_UNI_Object* generalizedUni = (GENERALIZED_UNI_Object*)(*stateIter).sb.psb->getGENERALIZED_UNI_Object();
-#if defined(WITH_API)
-					if (Session::ospfRouterID.rawAddress() == 0)
-						Session::ospfRouterID = RSVP_Global::rsvp->getRoutingService().getLoopbackAddress();
-					if ((*stateIter).sb.psb->getSession().getDestAddress() == Session::ospfRouterID) {
-						if (dragonUni != NULL) {
-							const String egressChanName = (const char*)dragonUni->getEgressCtrlChannel().name;
-							if (egressChanName == "implicit")
-								lif = RSVP_Global::rsvp->findInterfaceByLocalId((const uint32)dragonUni->getDestTNA().local_id);
-							else
-								lif = RSVP_Global::rsvp->findInterfaceByName(egressChanName);
-						}
-						else { //non-UNI or Generalized UNI
-							lif = RSVP_Global::rsvp->getApiLif();
-						}
-					}
-					else
-#endif
-						if ( (*stateIter).sb.psb->getEXPLICIT_ROUTE_Object() )
+		if ( !epochChanged ) {
+			ID_List& stateIdList = idRecv[recvHash(*msgIter)];
+			ID_List::ConstIterator stateIter = stateIdList.begin();
+			for ( ; stateIter != stateIdList.end(); ++stateIter ) {
+				if ( (*stateIter).id == *msgIter ) {
+					switch( (*stateIter).type ) {
+					case RecvStorageID::Path:
 					{
-						EXPLICIT_ROUTE_Object* ero = const_cast<EXPLICIT_ROUTE_Object*>((*stateIter).sb.psb->getEXPLICIT_ROUTE_Object());
-						if (ero->getAbstractNodeList().front().getType() == AbstractNode::IPv4)
-							lif = RSVP_Global::rsvp->getRoutingService().findOutLifByOSPF(ero->getAbstractNodeList().front().getAddress(), 0, gw);
-						else if (ero->getAbstractNodeList().front().getType() == AbstractNode::UNumIfID)
-						{
-							uint32 uNumIfID = ero->getAbstractNodeList().front().getInterfaceID();
-							lif = RSVP_Global::rsvp->getRoutingService().findOutLifByOSPF(ero->getAbstractNodeList().front().getAddress(), uNumIfID, gw);
+						LOG(4)( Log::Reduct, "found PSB for ID", *msgIter, "from", *this );
+						if ( foundRSB ) {
+							ERROR(5)( Log::Error, "already found RSB (and now PSB) for ID", *msgIter, "from", *this, "ignoring PSB" );
+	goto nextMsgIter;
 						}
-						else
-							lif = RSVP_Global::rsvp->getRoutingService().getUnicastRoute( (*stateIter).sb.psb->getSession().getDestAddress(), gw );
-					}
-					else if (generalizedUni) {
-                                		lif = NULL;
-						if (SwitchCtrl_Session_SubnetUNI::subnetUniApiClientList) {
-	                                		SwitchCtrl_Session_SubnetUNI_List::Iterator uniSessionIter = SwitchCtrl_Session_SubnetUNI::subnetUniApiClientList->begin();
-	                                		for ( ; uniSessionIter != SwitchCtrl_Session_SubnetUNI::subnetUniApiClientList->end(); ++uniSessionIter) {
-	                                			if ((*uniSessionIter)->isSessionOwner(msg)) {
-	                                				lif = (*uniSessionIter)->getControlInterface(gw);
-	                                			}
-	                                		}
+						if ( refreshRecvPSB( (*stateIter).sb.psb, msg ) ) {
+	goto nextMsgIter;
 						}
- 						if (!lif )
-							lif = RSVP_Global::rsvp->getApiLif();
-					}
-					else if (dragonUni) {
-						lif = RSVP_Global::rsvp->findInterfaceByName(String((const char*)dragonUni->getEgressCtrlChannel().name));
-					}
-					else {
-						lif = RSVP_Global::rsvp->getRoutingService().getUnicastRoute( (*stateIter).sb.psb->getSession().getDestAddress(), gw );
-					}
-					//@@@@ UNI related hacks END
-
-#if defined(WITH_API)
-					if ( !lif
-						&& ( RSVP_Global::rsvp->findInterfaceByAddress( (*stateIter).sb.psb->getSession().getDestAddress() )
-							|| (*stateIter).sb.psb->getSession().getDestAddress().isMulticast() ) ) {
-						lif = RSVP_Global::rsvp->getApiLif();
 					}
-#endif
-					if ( !lif ) {
-						ERROR(4)( Log::Error, "ERROR: cannot find outgoing interface for PSB", *(*stateIter).sb.psb, "from", *this );
-		break;
-					} else if ( !(*stateIter).sb.psb->matchOI( *lif ) ) {
-						(*stateIter).sb.psb->updateRoutingInfo( lif, gw, false, true );
+					break;
+					case RecvStorageID::Resv:
+						foundRSB = true;
+						LOG(4)( Log::Reduct, "found RSB for ID", *msgIter, "from", *this );
+						(*stateIter).sb.rsb->restartTimeout();
 					}
-#endif
-					(*stateIter).sb.psb->restartTimeout();
-	goto nextMsgIter;
-				}
-				case RecvStorageID::Resv:
-					foundRSB = true;
-					LOG(4)( Log::Reduct, "found RSB for ID", *msgIter, "from", *this );
-					(*stateIter).sb.rsb->restartTimeout();
-				}
-			} // found matching ID
+				} // found matching ID
+			}
 		}
 		if ( !foundRSB ) {
 			ERROR(4)( Log::Error, "no state found for ID", *msgIter, "from", *this );
-			nackMsg->addMESSAGE_ID_NACK_Object( MESSAGE_ID_NACK_Object( 0, sendEpoch, *msgIter ) );
+			// the NACK must carry the epoch the ID was received with (RFC 2961, 5.4)
+			nackMsg->addMESSAGE_ID_NACK_Object( MESSAGE_ID_NACK_Object( 0, idListObject.getEpoch(), *msgIter ) );
 			if ( nackMsg->getLength() >= maxNackSize ) {
 				LOG(1)( Log::Reduct, "splitting NACK message" );
-				if (getLogicalInterface().getAddress() != LogicalInterface::noGatewayAddress){
-					NetAddress peer;
-					RSVP_Global::rsvp->getRoutingService().getPeerIPAddr(getLogicalInterface().getAddress(), peer);
-					getLogicalInterface().sendMessage( *nackMsg, peer );
-				}
-				else
-					getLogicalInterface().sendMessage( *nackMsg, getAddress() );
-				delete nackMsg;
-				nackMsg = new Message( Message::Ack, 15 );
+				sendNackMessage( nackMsg );
 			}
 		}
 nextMsgIter: ;
 	}
 	if ( nackMsg->getLength() != Message::headerSize() ) {
-		if (getLogicalInterface().getAddress() != LogicalInterface::noGatewayAddress){
-			NetAddress peer;
-			RSVP_Global::rsvp->getRoutingService().getPeerIPAddr(getLogicalInterface().getAddress(), peer);
-			getLogicalInterface().sendMessage( *nackMsg, peer );
-		}
-		else
-			getLogicalInterface().sendMessage( *nackMsg, getAddress() );
+		sendNackMessage( nackMsg );
 	}
 	delete nackMsg;
 }
@@ -274,47 +296,52 @@ void Hop::processAckMessage( const Message& msg ) {
 	}
 }
 
+// Returns true if msg is a pure refresh of state that has already been
+// installed under the same message ID. In that case the state's timeout has
+// been restarted here and the message needs no further processing.
 bool Hop::checkMessageID( const Message& msg ) {
-	sint32 id = msg.getMESSAGE_ID_Object().getID();
-	sint32 state_id = 0;
-	if ( msg.getMESSAGE_ID_Object().getEpoch() != currentRecvEpoch ) {
-		currentRecvEpoch = msg.getMESSAGE_ID_Object().getEpoch();
+	if ( !idRecv ) return false;
+	const MESSAGE_ID_Object& msgID = msg.getMESSAGE_ID_Object();
+	sint32 id = msgID.getID();
+	if ( !recvEpochValid || msgID.getEpoch() != currentRecvEpoch ) {
+		if ( recvEpochValid ) {
+			LOG(4)( Log::Reduct, "new epoch", msgID.getEpoch(), "from", *this );
+		}
+		currentRecvEpoch = msgID.getEpoch();
+		recvEpochValid = true;
 		return false;
 	}
 	switch ( msg.getMsgType() ) {
-	case Message::Path:
-#if defined(ONEPASS_RESERVATION)
-	case Message::PathResv:
-#endif
-	case Message::PathTear:
-	case Message::PathErr:
-		if ( currentRecvID == id ) {
-			PSB *psb = getRecvPSB(id);
-			if ( psb && *psb == msg.getSENDER_TEMPLATE_Object() ) {
-	return true;
-			}
-		} else if ( currentRecvID - id > 0 ) {
-			if ( getRecvPSB(id) != NULL ) {
-				state_id = getRecvPSB(id)->getRecvID()->id;
-	goto check_state_id;
-			}
+	case Message::Path: {
+		PSB *psb = getRecvPSB(id);
+		if ( psb && (SESSION_Object&)psb->getSession() == msg.getSESSION_Object()
+			&& *psb == msg.getSENDER_TEMPLATE_Object() ) {
+			LOG(4)( Log::Reduct, "PATH refresh with known ID", id, "from", *this );
+			return refreshRecvPSB( psb, msg );
 		}
-	break;
-	case Message::Resv:
-	case Message::ResvTear:
-	case Message::ResvErr:
-		if ( currentRecvID - id >= 0 ) {
-			if ( getRecvRSB(id) != NULL ) {
-				state_id = getRecvRSB(id)->getRecvID()->id;
-	goto check_state_id;
+	} break;
+	case Message::Resv: {
+		// one Resv message may have installed several RSBs with the same ID
+		bool found = false;
+		ID_List& stateIdList = idRecv[recvHash(id)];
+		ID_List::ConstIterator stateIter = stateIdList.begin();
+		for ( ; stateIter != stateIdList.end(); ++stateIter ) {
+			if ( (*stateIter).id == id && (*stateIter).type == RecvStorageID::Resv
+				&& !(*stateIter).sb.rsb->getPSB_List().empty()
+				&& (SESSION_Object&)(*stateIter).sb.rsb->getSession() == msg.getSESSION_Object() ) {
+				(*stateIter).sb.rsb->restartTimeout();
+				found = true;
 			}
 		}
+		if ( found ) {
+			LOG(4)( Log::Reduct, "RESV refresh with known ID", id, "from", *this );
+		}
+		return found;
+	}
+	default:
 	break;
 	}
-	currentRecvID = id;
 	return false;
-check_state_id:
-	return ( id - state_id > 0 );
 }
 
 void Hop::refresh() {
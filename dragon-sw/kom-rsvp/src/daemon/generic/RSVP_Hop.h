@@ -94,8 +94,8 @@ private:
 	uint32 noOfRefreshMessages;
 	ID_List* idRecv;
 	uint32 idRecvCount;
-	sint32 currentRecvID;
 	uint32 currentRecvEpoch;
+	bool recvEpochValid;
 	uint32 maxNackSize;
 	RandomRefreshTimer<Hop> refreshTimer;
 	inline uint32 sendHash( sint32 id );
@@ -103,6 +103,8 @@ private:
 	inline void recalcTimer( sint32 change );
 	inline void increaseSendID();
 	inline bool getNextSendStorageID();
+	bool refreshRecvPSB( PSB* psb, const Message& msg );
+	void sendNackMessage( Message*& nackMsg );
 	void sendMessageReliable( const Message& msg, const NetAddress& dest, const NetAddress& src, const NetAddress& gw = LogicalInterface::noGatewayAddress );
 	void sendMessageReliable( const Message& msg, const NetAddress& dest ) {
 		sendMessageReliable( msg, dest, getLogicalInterface().getAddress() );
@@ -39,10 +39,12 @@
 #include "RSVP_PHopSB.h"
 #include "RSVP_PSB.h"
 #include "RSVP_PolicyObjects.h"
+#include "RSVP_ProcessingStats.h"
 #include "RSVP_ProtocolObjects.h"
 #include "RSVP_RoutingService.h"
 #include "RSVP_Session.h"
 #include "RSVP_OutISB.h"
+#include "NARB_APIClient.h"
 #include "SwitchCtrl_Global.h"
 #include "SwitchCtrl_Session_SubnetUNI.h"
 //#include "SNMP_Session.h"
@@ -90,6 +92,7 @@ extern pid_t pid_verifySNCStateWorkingState;
 //$$$$ Xi2008 <<
 
 void MessageProcessor::processMessage() {
+	ProcessingTimer timer( ProcessingStats::messageProbe( currentMessage.getMsgType() ) );
 
 #if defined(WITH_API)
 	// fix hop information, if message is from API client -> avoid confusion with onepass messages
@@ -115,7 +118,8 @@ void MessageProcessor::processMessage() {
 		return;
 	}
 	//$$$$ Xi2007 <<
-	if ( currentMessage.getMsgType() == Message::InitAPI || currentMessage.getMsgType() == Message::RemoveAPI ) {
+	if ( currentMessage.getMsgType() == Message::InitAPI || currentMessage.getMsgType() == Message::RemoveAPI
+		|| currentMessage.getMsgType() == Message::StatsQuery ) {
 		RSVP::getApiServer().processMessage( currentMessage, *this );
 		return;
 	}
@@ -159,7 +163,9 @@ void MessageProcessor::processMessage() {
 
 #if defined(REFRESH_REDUCTION)
 	if ( currentMessage.getMsgType() == Message::Srefresh ) {
-		sendingHop->processSrefresh( currentMessage );
+		if ( sendingHop ) {
+			sendingHop->processSrefresh( currentMessage );
+		}
 	return;
 	} else if ( currentMessage.getMsgType() == Message::Ack ) {
 		if ( sendingHop ) {
@@ -167,13 +173,12 @@ void MessageProcessor::processMessage() {
 		}
 	return;
 	} else if ( currentMessage.hasMESSAGE_ID_Object() ) {
-		//@@@@ DRAGON hack! ==> Force processing all PATH/RESV messages even if MESSAGE_ID is present.
-		/*
-		if ( sendingHop && sendingHop->checkMessageID( currentMessage ) ) {
-			LOG(3)( Log::Msg, "ID", currentMessage.getMESSAGE_ID_Object().getID(), "recognized -> ignoring message" );
+		// sendingHop is not updated for PathErr/PathTear/ResvConf, see findSendingHop()
+		if ( ( currentMessage.getMsgType() == Message::Path || currentMessage.getMsgType() == Message::Resv )
+			&& sendingHop && sendingHop->checkMessageID( currentMessage ) ) {
+			LOG(3)( Log::Msg, "ID", currentMessage.getMESSAGE_ID_Object().getID(), "recognized -> refreshed state, ignoring message" );
 	return;
 		}
-		*/
 		if ( currentMessage.getMsgType() != Message::Path && currentMessage.getMsgType() != Message::Resv ) {
 			currentMessage.clearMESSAGE_ID_Object();
 		}
@@ -834,26 +839,50 @@ void MessageProcessor::sendResvErrMessage( uint8 errorFlags, uint8 errorCode, ui
 }
 
 void MessageProcessor::sendResvErrMessage( uint8 errorFlags, uint8 errorCode, uint16 errorValue, const FlowDescriptor& fd ) {
+	assert( currentMessage.getMsgType() == Message::Resv );
+	sendResvErrMessage( errorFlags, errorCode, errorValue, fd, currentMessage, *currentLif );
+}
+
+INetworkBuffer* MessageProcessor::copyCurrentResv() const {
+	if ( currentMessage.getMsgType() != Message::Resv ) return NULL;
+	ONetworkBuffer obuffer( LogicalInterface::maxPayloadLength );
+	obuffer << currentMessage;
+	INetworkBuffer* resv = new INetworkBuffer( obuffer.getUsedSize() );
+	resv->cloneFrom( obuffer.getContents(), obuffer.getUsedSize() );
+	return resv;
+}
+
+void MessageProcessor::sendResvErrMessage( uint8 errorFlags, uint8 errorCode, uint16 errorValue, INetworkBuffer& resvBuffer, const LogicalInterface& lif ) {
+	Message resv;
+	resvBuffer.init();
+	resvBuffer.setWriteLength( resvBuffer.getSize() );
+	resvBuffer >> resv;
+	FlowDescriptorList::ConstIterator flowdescIter = resv.getFlowDescriptorList().begin();
+	for ( ; flowdescIter != resv.getFlowDescriptorList().end() ; ++flowdescIter ) {
+		sendResvErrMessage( errorFlags, errorCode, errorValue, *flowdescIter, resv, lif );
+	}
+}
+
+void MessageProcessor::sendResvErrMessage( uint8 errorFlags, uint8 errorCode, uint16 errorValue, const FlowDescriptor& fd, const Message& resv, const LogicalInterface& lif ) {
 	if (Session::ospfRouterID.rawAddress() == 0)
 		Session::ospfRouterID = RSVP_Global::rsvp->getRoutingService().getLoopbackAddress();
 
-	assert( currentMessage.getMsgType() == Message::Resv );
-	ERROR_SPEC_Object error( Session::ospfRouterID.rawAddress()==0?currentLif->getLocalAddress():Session::ospfRouterID, errorFlags, errorCode, errorValue );
-	Message errorMsg( Message::ResvErr, 63, currentMessage.getSESSION_Object() );
+	ERROR_SPEC_Object error( Session::ospfRouterID.rawAddress()==0?lif.getLocalAddress():Session::ospfRouterID, errorFlags, errorCode, errorValue );
+	Message errorMsg( Message::ResvErr, 63, resv.getSESSION_Object() );
 	errorMsg.setERROR_SPEC_Object( error );
-	if ( currentMessage.getSCOPE_Object() ) {
-		errorMsg.setSCOPE_Object( *currentMessage.getSCOPE_Object() );
+	if ( resv.getSCOPE_Object() ) {
+		errorMsg.setSCOPE_Object( *resv.getSCOPE_Object() );
 	}
-	errorMsg.setSTYLE_Object( currentMessage.getSTYLE_Object() );
+	errorMsg.setSTYLE_Object( resv.getSTYLE_Object() );
 	addToMessage( errorMsg, *fd.getFlowspec(), fd.filterSpecList );
-	errorMsg.setRSVP_HOP_Object( *currentLif );
-	if (currentLif->getAddress() != LogicalInterface::noGatewayAddress) {
+	errorMsg.setRSVP_HOP_Object( lif );
+	if (lif.getAddress() != LogicalInterface::noGatewayAddress) {
 		NetAddress peer;
-		RSVP_Global::rsvp->getRoutingService().getPeerIPAddr(currentLif->getAddress(), peer);
-		currentLif->sendMessage( errorMsg, peer );
+		RSVP_Global::rsvp->getRoutingService().getPeerIPAddr(lif.getAddress(), peer);
+		lif.sendMessage( errorMsg, peer );
 	}
 	else
-		currentLif->sendMessage( errorMsg, currentMessage.getRSVP_HOP_Object().getAddress() );
+		lif.sendMessage( errorMsg, resv.getRSVP_HOP_Object().getAddress() );
 }
 
 void MessageProcessor::sendPathErrMessage( uint8 errorCode, uint16 errorValue ) {
@@ -901,6 +930,34 @@ bool MessageProcessor::queryEnqueuedMessages( ) {
 	MessageQueue::Iterator msgIter = msgQueue->begin();
 	for ( ; msgIter != msgQueue->end(); ++msgIter ) {
 		msgEntry = *msgIter;
+		if ( msgEntry->getOspfRequestID() ) {
+			if ( !RSVP_Global::rsvp->getRoutingService().ospfReplyArrived( msgEntry->getOspfRequestID() ) )
+				continue;
+			// processMessage() looks the session up again
+			msgEntry->resumeMessage( (LogicalInterface* &)currentLif, currentHeader, currentMessage );
+			RSVP_Global::rsvp->getRoutingService().resumeOspfRequest( msgEntry->getOspfRequestID() );
+			msgQueue->erase(msgIter);
+			delete msgEntry;
+			return true;
+		}
+		if ( msgEntry->getNarbUcid() ) {
+			if ( !NARB_APIClient::replyArrived( msgEntry->getNarbUcid(), msgEntry->getNarbSeqnum() ) )
+				continue;
+			msgEntry->resumeMessage( (LogicalInterface* &)currentLif, currentHeader, currentMessage );
+			NARB_APIClient::resumeRequest( msgEntry->getNarbUcid(), msgEntry->getNarbSeqnum() );
+			msgQueue->erase(msgIter);
+			delete msgEntry;
+			return true;
+		}
+		if ( msgEntry->getVlanSyncID() ) {
+			if ( !RSVP_Global::switchController->vlanSyncDone( msgEntry->getVlanSyncID() ) )
+				continue;
+			msgEntry->resumeMessage( (LogicalInterface* &)currentLif, currentHeader, currentMessage );
+			RSVP_Global::switchController->resumeVLANSync( msgEntry->getVlanSyncID() );
+			msgQueue->erase(msgIter);
+			delete msgEntry;
+			return true;
+		}
 		if (msgEntry->getCurrentSession() && msgEntry->getCurrentSession()->getSubnetUniSrc() ) {
 			switch (msgEntry->getCurrentSession()->getSubnetUniSrc()->getUniState()) {
 			case Message::Resv:
@@ -931,15 +988,38 @@ bool MessageProcessor::queryEnqueuedMessages( ) {
 	return false;
 }
 
+void MessageProcessor::deferCurrentMessage( uint32 requestID ) {
+	MessageEntry* msgEntry = new MessageEntry;
+	msgEntry->deferMessage( (LogicalInterface*)currentLif, currentHeader, currentMessage, requestID );
+	msgQueue->push_back( msgEntry );
+}
+
+void MessageProcessor::deferCurrentMessageForNarb( uint32 ucid, uint32 seqnum ) {
+	MessageEntry* msgEntry = new MessageEntry;
+	msgEntry->deferMessageForNarb( (LogicalInterface*)currentLif, currentHeader, currentMessage, ucid, seqnum );
+	msgQueue->push_back( msgEntry );
+}
+
+void MessageProcessor::deferCurrentMessageForVlanSync( uint32 syncID ) {
+	MessageEntry* msgEntry = new MessageEntry;
+	msgEntry->deferMessageForVlanSync( (LogicalInterface*)currentLif, currentHeader, currentMessage, syncID );
+	msgQueue->push_back( msgEntry );
+}
+
+bool MessageProcessor::hasDeferredMessage( const Message& msg ) {
+	MessageQueue::Iterator msgIter = msgQueue->begin();
+	for ( ; msgIter != msgQueue->end(); ++msgIter ) {
+		if ( (*msgIter)->isDeferred() && (*msgIter)->isSamePath( msg ) )
+			return true;
+	}
+	return false;
+}
+
 // Xi2007 <<
 
 // DRAGON Monitoring >>
 void MessageProcessor::processDragonMonQuery(SESSION_Object& sessionObject, MON_Query_Subobject& monQuery)
 {
-	uint8 msgType = Message::MonReply;
-	uint8 TTL = 1;
-	Message replyMsg( msgType, TTL, sessionObject);
-	DRAGON_EXT_INFO_Object* dragonExtInfo = new DRAGON_EXT_INFO_Object;
 	MON_Reply_Subobject monReply;
 	memset (&monReply, 0, sizeof(MON_Reply_Subobject));
        monReply.type = DRAGON_EXT_SUBOBJ_MON_REPLY;
@@ -947,9 +1027,16 @@ void MessageProcessor::processDragonMonQuery(SESSION_Object& sessionObject, MON_
 	monReply.seqnum = monQuery.seqnum;
        strncpy(monReply.gri, monQuery.gri, MAX_MON_NAME_LEN-1);
 
-	//$$$$ retrieve switch/circuit information
-	RSVP_Global::switchController->getMonitoringInfo(monQuery, monReply, sessionObject.getDestAddress().rawAddress());
+	//$$$$ retrieve switch/circuit information, replied to by sendDragonMonReply
+	RSVP_Global::switchController->getMonitoringInfo(sessionObject, monQuery, monReply);
+}
 
+void MessageProcessor::sendDragonMonReply(const SESSION_Object& sessionObject, MON_Reply_Subobject& monReply)
+{
+	uint8 msgType = Message::MonReply;
+	uint8 TTL = 1;
+	Message replyMsg( msgType, TTL, sessionObject);
+	DRAGON_EXT_INFO_Object* dragonExtInfo = new DRAGON_EXT_INFO_Object;
 	dragonExtInfo->SetMonReply(monReply);
 	replyMsg.setDRAGON_EXT_INFO_Object(*dragonExtInfo);
 	RSVP::getApiServer().sendMessage(replyMsg);
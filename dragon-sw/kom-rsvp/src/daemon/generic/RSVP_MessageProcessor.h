@@ -57,11 +57,29 @@ class MessageEntry {
 	INetworkBuffer ibuffer;
 	LogicalInterface* currentLif;
 	Session* currentSession;
+	// PATH message waiting for the reply to an OSPFd request
+	uint32 ospfRequestID;
+	// PATH message waiting for the reply to a NARB query
+	uint32 narbUcid;
+	uint32 narbSeqnum;
+	// PATH message waiting for the VLANs of an Ethernet switch to be read
+	uint32 vlanSyncID;
+	PacketHeader currentHeader;
+	SESSION_Object session;
+	SENDER_TEMPLATE_Object sender;
 
 public:
-	MessageEntry():ibuffer(65000), currentLif(NULL), currentSession(NULL) {}
+	MessageEntry():ibuffer(65000), currentLif(NULL), currentSession(NULL), ospfRequestID(0), narbUcid(0), narbSeqnum(0), vlanSyncID(0) {}
 	LogicalInterface* getCurrentLif() { return currentLif; }
 	Session* getCurrentSession() { return currentSession; }
+	uint32 getOspfRequestID() const { return ospfRequestID; }
+	uint32 getNarbUcid() const { return narbUcid; }
+	uint32 getNarbSeqnum() const { return narbSeqnum; }
+	uint32 getVlanSyncID() const { return vlanSyncID; }
+	bool isDeferred() const { return ospfRequestID != 0 || narbUcid != 0 || vlanSyncID != 0; }
+	bool isSamePath( const Message& msg ) const {
+		return session == msg.getSESSION_Object() && sender == msg.getSENDER_TEMPLATE_Object();
+	}
 	void preserveMessage(LogicalInterface *lif,  Session *session, Message& msg) {
 		currentLif = lif;
 		currentSession = session;
@@ -79,6 +97,29 @@ public:
 		msg.init();
 		ibuffer >> msg;
 	}
+	// the session is not kept: it may be gone by the time the reply arrives
+	void deferMessage(LogicalInterface *lif, const PacketHeader& header, Message& msg, uint32 requestID) {
+		preserveMessage(lif, NULL, msg);
+		currentHeader = header;
+		ospfRequestID = requestID;
+		session = msg.getSESSION_Object();
+		sender = msg.getSENDER_TEMPLATE_Object();
+	}
+	void deferMessageForNarb(LogicalInterface *lif, const PacketHeader& header, Message& msg, uint32 ucid, uint32 seqnum) {
+		deferMessage(lif, header, msg, 0);
+		narbUcid = ucid;
+		narbSeqnum = seqnum;
+	}
+	void deferMessageForVlanSync(LogicalInterface *lif, const PacketHeader& header, Message& msg, uint32 syncID) {
+		deferMessage(lif, header, msg, 0);
+		vlanSyncID = syncID;
+	}
+	void resumeMessage(LogicalInterface* &lif, PacketHeader& header, Message& msg) {
+		lif = currentLif;
+		header = currentHeader;
+		msg.init();
+		ibuffer >> msg;
+	}
 };
 
 typedef SimpleList<MessageEntry*> MessageQueue;
@@ -144,6 +185,8 @@ private:
 	inline void prepareConfirmMsg();
 	inline void finishAndSendConfirmMsg();
 
+	void sendResvErrMessage( uint8 errorFlags, uint8 errorCode, uint16 errorValue, const FlowDescriptor&, const Message& resv, const LogicalInterface& lif );
+
 public:
 	MessageProcessor();
 	~MessageProcessor();
@@ -185,14 +228,26 @@ public:
 
 	void sendResvErrMessage( uint8 errorFlags, uint8 errorCode, uint16 errorValue, const FlowDescriptor& );
 	void sendResvErrMessage( uint8 errorFlags, uint8 errorCode, uint16 errorValue );
+	// ResvErr for a RESV that has been processed already, e.g. when switch
+	// provisioning fails on the switch control worker
+	INetworkBuffer* copyCurrentResv() const;
+	const LogicalInterface* getCurrentLif() const { return currentLif; }
+	void sendResvErrMessage( uint8 errorFlags, uint8 errorCode, uint16 errorValue, INetworkBuffer& resv, const LogicalInterface& lif );
 	void sendPathErrMessage( uint8 errorCode, uint16 errorValue );
 
 // Xi2007 for SubnetUNI>>
 	bool queryEnqueuedMessages();
 // Xi2007 for SubnetUNI<<
+	// park the current PATH message until OSPFd answers 'requestID'
+	void deferCurrentMessage( uint32 requestID );
+	// park the current PATH message until NARB answers the query (ucid, seqnum)
+	void deferCurrentMessageForNarb( uint32 ucid, uint32 seqnum );
+	void deferCurrentMessageForVlanSync( uint32 syncID );
+	bool hasDeferredMessage( const Message& msg );
 
 // DRAGON Monitoring >>
 	void processDragonMonQuery(SESSION_Object& sessionObject, MON_Query_Subobject& monQuery);
+	void sendDragonMonReply(const SESSION_Object& sessionObject, MON_Reply_Subobject& monReply);
 // DRAGON Monitoring <<
 };
 
@@ -90,13 +90,18 @@ PSB::PSB( const SENDER_Object& senderTemplate )
 	labelSet = NULL;
 	hasSuggestedLabel = false;
 	hasUpstreamInLabel = hasUpstreamOutLabel = false;
+	upstreamInLabelAllocated = false;
 	E_Police = false;
 	vlanTagAsSuggestedLabel = 0;
 	vlsrErrorCode = 0;
+	pathDigest = 0;
+	pathImage = NULL;
+	pathImageLength = 0;
 }
 
 PSB::~PSB() {
 	LOG(2)( Log::SB, "deleting", *this );
+	setPathDigest( 0 );
 	updateRoutingInfo( LogicalInterfaceSet(), LogicalInterface::noGatewayAddress, true, false );
 	if ( inLabel ) RSVP_Global::rsvp->getMPLS().deleteInLabel(*this, inLabel );
 	if (hasUpstreamInLabel) {
@@ -127,6 +132,20 @@ PSB::~PSB() {
 	//@@@@ Xi 2008 <<
 }
 
+void PSB::setPathDigest( uint32 d, const ONetworkBuffer* image ) {
+	pathDigest = d;
+	if ( pathImage ) {
+		delete [] pathImage;
+		pathImage = NULL;
+		pathImageLength = 0;
+	}
+	if ( d && image ) {
+		pathImageLength = image->getUsedSize();
+		pathImage = new uint8[pathImageLength];
+		memcpy( pathImage, image->getContents(), pathImageLength );
+	}
+}
+
 OutISB* PSB::getOutISB( uint32 i ) const {
 	if ( getOIatPSB(i) ) {
 		return getOIatPSB(i)->getOutISB();
@@ -336,11 +355,21 @@ void PSB::updateRoutingInfo( const LogicalInterfaceSet& lifList,
 	LOG(4)( Log::SB, "PSB::updateRoutingInfo done, gateway is", gateway, ", new lif count:", outLifSet.size() );
 }
 
+// allocate the upstream in-label ahead of any reservation state, so that
+// an exhausted label space can reject the RESV before an RSB is installed
+bool PSB::reserveInLabel() {
+	if ( inLabelRequested && !inLabel ) {
+		inLabel = RSVP_Global::rsvp->getMPLS().setInLabel( *this );
+	}
+	return !inLabelRequested || inLabel;
+}
+
 bool PSB::addReservation( OutISB* oisb, const Hop& nhop ) {
 	OIatPSB* oiatpsb = getOIatPSB( oisb->getOI().getLIH() );
        assert( oiatpsb );
 	if ( oiatpsb->addRSB( oisb ) ) {
-		if ( inLabelRequested && !inLabel ) inLabel = RSVP_Global::rsvp->getMPLS().setInLabel( *this );
+		// Session::processRESV_FDesc has reserved the label already
+		if ( !reserveInLabel() ) return false;
 
               if (outLabel == 0 && vlsrt.size() > 0 && vlsrt.back().outPort != 0) //@@@@ hacked
               {
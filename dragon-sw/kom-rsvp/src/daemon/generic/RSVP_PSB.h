@@ -102,6 +102,7 @@ class PSB :	public RelationshipPSB_Session,
 	bool hasUpstreamOutLabel; 
 	UPSTREAM_LABEL_Object upstreamInLabel;
 	bool hasUpstreamInLabel; 
+	bool upstreamInLabelAllocated;	// taken from the MPLS label allocator
 	SESSION_ATTRIBUTE_Object sessionAttributeObject;
 	bool hasSessionAttributeObject;
 	EXPLICIT_ROUTE_Object* explicitRoute;
@@ -116,6 +117,12 @@ class PSB :	public RelationshipPSB_Session,
 	uint32 vlanTagAsSuggestedLabel;
 	uint16 vlsrErrorCode;
 
+	// digest of the last fully processed PATH message, 0 if none, and a
+	// copy of the objects it was computed over to rule out collisions
+	uint32 pathDigest;
+	uint8* pathImage;
+	uint16 pathImageLength;
+
 	friend ostream& operator<< ( ostream&, const PSB& );
 	PSB(const PSB&);
 	PSB& operator=( const PSB&);
@@ -142,6 +149,7 @@ public:
 
 	// return value indicates that this is the first reservation for this PSB
 	// used for refresh/confirm decision
+	bool reserveInLabel();
 	bool addReservation( OutISB*, const Hop& );
 	void removeReservation( uint32 );
 	void refreshReservation( uint32, uint32 );
@@ -199,6 +207,8 @@ public:
 	bool updateUPSTREAM_IN_LABEL_Object( UPSTREAM_LABEL_Object uInLabel);
 	bool updateUPSTREAM_IN_LABEL_Object( uint32 uInLabel);
 	bool hasUPSTREAM_IN_LABEL_Object() { return hasUpstreamInLabel; }
+	bool isUpstreamInLabelAllocated() const { return upstreamInLabelAllocated; }
+	void setUpstreamInLabelAllocated() { upstreamInLabelAllocated = true; }
 	const UPSTREAM_LABEL_Object&  getUPSTREAM_IN_LABEL_Object() const { return upstreamInLabel; }
 	bool updateSESSION_ATTRIBUTE_Object(SESSION_ATTRIBUTE_Object ssAttrib);
 	bool hasSESSION_ATTRIBUTE_Object() { return hasSessionAttributeObject; }
@@ -215,6 +225,12 @@ public:
 	const DRAGON_EXT_INFO_Object* getDRAGON_EXT_INFO_Object() const { return dragonExtInfo; }
 	uint16 getVLSRError() { return vlsrErrorCode; }
 	void setVLSRError(uint8 errCode, uint8 errValue) { vlsrErrorCode = ((errCode << 8) | errValue); }
+	uint32 getPathDigest() const { return pathDigest; }
+	void setPathDigest( uint32 d, const ONetworkBuffer* image = NULL );
+	bool matchesPathImage( const ONetworkBuffer& image ) const {
+		return pathImage && pathImageLength == image.getUsedSize()
+			&& memcmp( pathImage, image.getContents(), pathImageLength ) == 0;
+	}
 
 #if defined(REFRESH_REDUCTION) || defined(ONEPASS_RESERVATION)
 	Hop* getNextHop() { return nextHop; }
@@ -0,0 +1,65 @@
+/****************************************************************************
+
+Processing statistics source file RSVP_ProcessingStats.cc
+Per-probe counters and latency histograms of the RSVP daemon
+To be incorporated into KOM-RSVP-TE package
+
+****************************************************************************/
+
+#include "RSVP_ProcessingStats.h"
+#include "RSVP_Message.h"
+#include "RSVP_RoutingService.h"
+#include "RSVP_Session.h"
+
+ProcessingStats::Probe ProcessingStats::probes[STATS_NUM_PROBES];
+TimeValue ProcessingStats::startTime = getCurrentSystemTime();
+
+void ProcessingStats::record( uint32 probe, sint64 usec ) {
+	assert( probe < STATS_NUM_PROBES );
+	// the system clock may have been set back meanwhile
+	if ( usec < 0 ) usec = 0;
+	Probe& p = probes[probe];
+	p.count += 1;
+	p.totalUsec += usec;
+	if ( usec > p.maxUsec ) {
+		p.maxUsec = usec > 0xffffffff ? 0xffffffff : (uint32)usec;
+	}
+	uint32 bucket = 0;
+	while ( (usec >>= 1) > 0 && bucket < STATS_HISTOGRAM_BUCKETS - 1 ) {
+		bucket += 1;
+	}
+	p.buckets[bucket] += 1;
+}
+
+uint32 ProcessingStats::messageProbe( uint8 msgType ) {
+	switch ( msgType ) {
+	case Message::Path: return STATS_PROBE_MSG_PATH;
+	case Message::Resv: return STATS_PROBE_MSG_RESV;
+	case Message::PathErr: return STATS_PROBE_MSG_PATH_ERR;
+	case Message::ResvErr: return STATS_PROBE_MSG_RESV_ERR;
+	case Message::PathTear: return STATS_PROBE_MSG_PATH_TEAR;
+	case Message::ResvTear: return STATS_PROBE_MSG_RESV_TEAR;
+	case Message::ResvConf: return STATS_PROBE_MSG_RESV_CONF;
+	case Message::Ack:
+	case Message::Srefresh: return STATS_PROBE_MSG_SREFRESH;
+	default: return STATS_PROBE_MSG_API;
+	}
+}
+
+void ProcessingStats::getStatistics( STATS_Reply_Subobject& reply ) {
+	memset( &reply, 0, sizeof(STATS_Reply_Subobject) );
+	TimeValue now = getCurrentSystemTime();
+	now -= startTime;
+	reply.interval = now.tv_sec;
+	reply.num_probes = STATS_NUM_PROBES;
+	reply.path_fast_count = Session::pathFastCount;
+	reply.path_full_count = Session::pathFullCount;
+	for ( uint32 i = 0; i < STATS_NUM_PROBES; ++i ) {
+		const Probe& p = probes[i];
+		STATS_Probe_Info& info = reply.probes[i];
+		info.count = p.count;
+		info.mean_usec = p.count ? p.totalUsec / p.count : 0;
+		info.max_usec = p.maxUsec;
+		memcpy( info.buckets, p.buckets, sizeof(info.buckets) );
+	}
+}
@@ -0,0 +1,52 @@
+/****************************************************************************
+
+Processing statistics header file RSVP_ProcessingStats.h
+Per-probe counters and latency histograms of the RSVP daemon
+To be incorporated into KOM-RSVP-TE package
+
+****************************************************************************/
+
+#ifndef _RSVP_PROCESSINGSTATS_H_
+#define _RSVP_PROCESSINGSTATS_H_
+
+#include "RSVP_TimeValue.h"
+#include "RSVP_ProtocolObjects.h"
+
+// Always-on instrumentation: each probe keeps a count, the sum and maximum
+// of its latencies and a histogram of power-of-two buckets (see
+// STATS_HISTOGRAM_BUCKETS), so that recording stays a handful of additions.
+// A probe is only recorded from one thread (the switch control job probe
+// from the worker, all others from the main loop); reading a snapshot
+// while the worker records may see a job half-counted, which is harmless.
+class ProcessingStats {
+	struct Probe {
+		uint32 count;
+		uint32 maxUsec;
+		uint64 totalUsec;
+		uint32 buckets[STATS_HISTOGRAM_BUCKETS];
+	};
+	static Probe probes[STATS_NUM_PROBES];
+	static TimeValue startTime;
+public:
+	static void record( uint32 probe, sint64 usec );
+	static uint32 messageProbe( uint8 msgType );
+	static void getStatistics( STATS_Reply_Subobject& reply );
+};
+
+// times its own scope and records it to 'probe'
+class ProcessingTimer {
+	uint32 probe;
+	TimeValue start;
+public:
+	ProcessingTimer( uint32 probe ) : probe(probe) {
+		getCurrentSystemTime( start );
+	}
+	~ProcessingTimer() {
+		TimeValue now;
+		getCurrentSystemTime( now );
+		now -= start;
+		ProcessingStats::record( probe, now.getUsec() );
+	}
+};
+
+#endif /* _RSVP_PROCESSINGSTATS_H_ */
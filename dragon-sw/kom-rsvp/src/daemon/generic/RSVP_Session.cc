@@ -38,6 +38,7 @@
 #include "RSVP_MPLS.h"
 #include "RSVP_RoutingService.h"
 #include "RSVP_PHopSB.h"
+#include "RSVP_ProcessingStats.h"
 #include "RSVP_OIatPSB.h"
 #include "RSVP_OutISB.h"
 #include "RSVP_RSB.h"
@@ -48,10 +49,13 @@
 #include "SwitchCtrl_Global.h"
 #include "SwitchCtrl_Session_SubnetUNI.h"
 #include "SwitchCtrl_Session_CienaCN4200.h"
+#include "SwitchCtrl_Worker.h"
 
 // #define BETWEEN_APIS 1
 
 NetAddress Session::ospfRouterID;
+uint32 Session::pathFastCount = 0;
+uint32 Session::pathFullCount = 0;
 
 Session::Session( const SESSION_Object &session) : SESSION_Object(session),
 	style(None), rsbCount(0) {
@@ -184,6 +188,71 @@ PHopSB* Session::findOrCreatePHopSB( Hop& hop, uint32 LIH ) {
 	}
 }
 
+// FNV-1a hash over the objects that determine the outcome of processPATH,
+// which are written to 'buffer'; returns 0 if the message must always be
+// processed in full
+uint32 Session::getPathDigest( const Message& msg, uint8 TTL, ONetworkBuffer& buffer ) {
+#if defined(ONEPASS_RESERVATION)
+	if ( msg.getMsgType() == Message::PathResv ) return 0;
+#endif
+	if ( !msg.getUnknownObjectList().empty() ) return 0;
+	Message& m = const_cast<Message&>(msg);
+	buffer << msg.getSESSION_Object() << msg.getRSVP_HOP_Object();
+	buffer << msg.getSENDER_TEMPLATE_Object() << msg.getSENDER_TSPEC_Object();
+	if ( msg.getEXPLICIT_ROUTE_Object() ) buffer << *msg.getEXPLICIT_ROUTE_Object();
+	if ( msg.hasLABEL_REQUEST_Object() ) buffer << msg.getLABEL_REQUEST_Object();
+	if ( msg.getLABEL_SET_Object() ) buffer << *msg.getLABEL_SET_Object();
+	if ( msg.hasUPSTREAM_LABEL_Object() ) buffer << msg.getUPSTREAM_LABEL_Object();
+	if ( msg.hasSESSION_ATTRIBUTE_Object() ) buffer << msg.getSESSION_ATTRIBUTE_Object();
+	if ( msg.getADSPEC_Object() ) buffer << *msg.getADSPEC_Object();
+	if ( m.getDRAGON_UNI_Object() ) buffer << *m.getDRAGON_UNI_Object();
+	if ( m.getGENERALIZED_UNI_Object() ) buffer << *m.getGENERALIZED_UNI_Object();
+	if ( m.getDRAGON_EXT_INFO_Object() ) buffer << *m.getDRAGON_EXT_INFO_Object();
+	buffer << TTL << msg.getTTL();
+	uint32 digest = 2166136261U;
+	const uint8* ptr = buffer.getContents();
+	for ( uint16 i = 0; i < buffer.getUsedSize(); ++i ) {
+		digest = (digest ^ ptr[i]) * 16777619U;
+	}
+	return digest ? digest : 1;
+}
+
+// If a PSB from the same PHOP has already been set up by a PATH message with
+// the same digest and the same objects, the message is a pure refresh: restart the PSB lifetime
+// and skip ERO processing, label handling and routing queries.
+bool Session::refreshPATH( const Message& msg, Hop& hop, uint32 digest, const ONetworkBuffer& image ) {
+	const SENDER_TEMPLATE_Object& senderTemplate = msg.getSENDER_TEMPLATE_Object();
+	uint32 phopLIH = msg.getRSVP_HOP_Object().getLIH();
+	PSB_List::Iterator psbIter = RelationshipSession_PSB::followRelationship().lower_bound( const_cast<SENDER_TEMPLATE_Object*>(&senderTemplate) );
+	for ( ; psbIter != RelationshipSession_PSB::followRelationship().end() && **psbIter == senderTemplate; ++psbIter ) {
+		PSB* psb = *psbIter;
+		if ( psb->getPathDigest() != digest || !psb->matchesPathImage( image )
+			|| !psb->getPHopSB().checkPHOP_Data( hop, phopLIH ) || !refreshPSB( *psb ) ) {
+			continue;
+		}
+#if defined(REFRESH_REDUCTION)
+		if ( msg.hasMESSAGE_ID_Object() ) {
+			psb->setRecvID( msg.getMESSAGE_ID_Object().getID() );
+		}
+#endif
+		psb->setTimeoutTime( msg.getTIME_VALUES_Object().getRefreshPeriod() );
+		LOG(5)( Log::Process, "unchanged PATH refresh for", *psb, "fast/full:", pathFastCount + 1, pathFullCount );
+		return true;
+	}
+	return false;
+}
+
+// Returns false if a refresh must not bypass full PATH processing for psb:
+// a failed VLSR setup is only retried there. Otherwise the refresh work that
+// full processing would do is done here, i.e. the subnet UNI path is re-created.
+bool Session::refreshPSB( PSB& psb ) {
+	if ( psb.getVLSRError() != 0 ) return false;
+	if (CLI_SESSION_TYPE != CLI_TL1_TELNET && pSubnetUniSrc) {
+		pSubnetUniSrc->createRsvpUniPath();
+	}
+	return true;
+}
+
 OutISB* Session::findOutISB( const LogicalInterface& lif, const PSB& sender ) {
 	PSB_List::Iterator psbIter = RelationshipSession_PSB::followRelationship().begin();
 	for (; psbIter != RelationshipSession_PSB::followRelationship().end(); ++psbIter ) {
@@ -316,7 +385,8 @@ bool Session::processERO(const Message& msg, Hop& hop, EXPLICIT_ROUTE_Object* ex
 				EXPLICIT_ROUTE_Object* ero = RSVP_Global::rsvp->getRoutingService().getExplicitRouteByOSPF(
 								hop.getLogicalInterface().getAddress(),
 								explicitRoute->getAbstractNodeList().front().getAddress(), 
-								msg.getSENDER_TSPEC_Object(), msg.getLABEL_REQUEST_Object());
+								msg.getSENDER_TSPEC_Object(), msg.getLABEL_REQUEST_Object(),
+								msg.hasSESSION_ATTRIBUTE_Object() ? &msg.getSESSION_ATTRIBUTE_Object() : NULL);
 				if (ero && (!ero->getAbstractNodeList().front().isLoose())){
 					explicitRoute->popFront();
 					while (!ero->getAbstractNodeList().empty()){
@@ -410,7 +480,14 @@ bool Session::processERO(const Message& msg, Hop& hop, EXPLICIT_ROUTE_Object* ex
 			outRtId = Session::ospfRouterID;
 		}
 
-		RSVP_Global::rsvp->getRoutingService().getVLSRRoutebyOSPF(inRtId, outRtId, inUnumIfID, outUnumIfID, vlsr);
+		if (!RSVP_Global::rsvp->getRoutingService().getVLSRRoutebyOSPF(inRtId, outRtId, inUnumIfID, outUnumIfID, vlsr)) {
+			//an empty vlsr triggers a PERR (mpls label alloc failure) in processPATH.
+			LOG(4)( Log::MPLS,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
+				"processERO: getVLSRRoutebyOSPF got no answer from OSPFd.");
+			memset(&vlsr, 0, sizeof(VLSR_Route));
+			vLSRoute.push_back(vlsr);
+			return false;
+		}
 		vlsr.bandwidth = msg.getSENDER_TSPEC_Object().get_r(); //bandwidth in Mbps (* 1000000/8 => Bps)
 		if (vlsr.vlanTag == 0) {
 			//extract VLAN tag from DRAGON_EXT_INFO_Object::EdgeVlanMapping_Subobject if available
@@ -644,6 +721,24 @@ bool Session::processERO(const Message& msg, Hop& hop, EXPLICIT_ROUTE_Object* ex
 		}
 		//creating Ethernet switch session
 		else if (vlsr.inPort && vlsr.outPort && vlsr.switchID != NetAddress(0)) {
+			//The switch is not talked to from here: the session is created and its VLANs are read by the
+			//switch control worker, and this PATH message is processed again once that has completed
+			//(see MessageProcessor::queryEnqueuedMessages).
+			if (RSVP_Global::messageProcessor->hasDeferredMessage(msg)) {
+				LOG(4)( Log::MPLS,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
+					"VLSR: still waiting for Ethernet switch VLANs...");
+				return false;
+			}
+			uint32 syncErrCode = 0;
+			bool vlanSyncResumed = RSVP_Global::switchController->takeResumedVLANSync(vlsr.switchID, syncErrCode);
+			if (syncErrCode != 0) {
+				LOG(5)( Log::MPLS,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
+					"VLSR: Cannot prepare SwitchCtrl Session for Ethernet switch : ", vlsr.switchID);
+				memset(&vlsr, 0, sizeof(VLSR_Route)); 
+				vlsr.errCode = syncErrCode;
+				vLSRoute.push_back(vlsr);                    
+				return false;
+			}
 			//prepare SwitchCtrl session connection
 			sessionIter = RSVP_Global::switchController->getSessionList().begin();
 			foundSession = false;
@@ -653,43 +748,22 @@ bool Session::processERO(const Message& msg, Hop& hop, EXPLICIT_ROUTE_Object* ex
 					break;
 				}
 			}
-			if (!foundSession){
-				LOG(5)( Log::MPLS,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
-					"VLSR: SwitchCtrl Session not found. Now creating new session for ", vlsr.switchID);
-                            ssNew = RSVP_Global::switchController->createSession(vlsr.switchID);
-                            if (!ssNew) {
-					LOG(4)( Log::MPLS,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
-						"Failed to create VLSR SwitchCtrl Session: Unknown switch Vendor/Model -- verify switch-ip is correct in ospfd.conf");
-					memset(&vlsr, 0, sizeof(VLSR_Route)); 
-					vlsr.errCode = (ERROR_SPEC_Object::Notify << 16 | ERROR_SPEC_Object::SwitchSessionFailed);
-					vLSRoute.push_back(vlsr);                    
-        				return false;
-                            }
-
-				if (!ssNew->connectSwitch()){
+			ssNew = foundSession ? (*sessionIter) : NULL;
+			//the VLAN cache of a session is only looked at while the worker has no job for it
+			if (!ssNew || SwitchCtrl_Worker::isBusy(ssNew) || (!vlanSyncResumed && !ssNew->isVLANCacheValid()
+				&& !RSVP_Global::switchController->hasSwitchVlanOption(SW_VLAN_REDUCE_SNMP_SYNC))) {
+				if (!ssNew && vlanSyncResumed) {
 					LOG(5)( Log::MPLS,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
-						"VLSR: Cannot connect to Ethernet switch : ", vlsr.switchID);
-					delete(ssNew);
+						"VLSR: SwitchCtrl Session went away for ", vlsr.switchID);
 					memset(&vlsr, 0, sizeof(VLSR_Route)); 
-					vlsr.errCode = (ERROR_SPEC_Object::Notify << 16 | ERROR_SPEC_Object::RSVPSwitchConnectFailure);
+					vlsr.errCode = (ERROR_SPEC_Object::Notify << 16 | ERROR_SPEC_Object::SwitchSessionFailed);
 					vLSRoute.push_back(vlsr);                    
 					return false;
 				}
-				else{
-					RSVP_Global::switchController->addSession(ssNew);
-				}
-			}
-			else {
-				ssNew = (*sessionIter);
-			}
-			bool vlanSyncSuccessful = (ssNew && !RSVP_Global::switchController->hasSwitchVlanOption(SW_VLAN_REDUCE_SNMP_SYNC)) ? ssNew->readVLANFromSwitch() : true;
-			if (!ssNew || !vlanSyncSuccessful) { //Read/Sync to Ethernet switch
-			       //syncWithSwitch ... !
-				LOG(5)( Log::MPLS,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
-					"VLSR: Cannot read from Ethernet switch : ", vlsr.switchID);
-				memset(&vlsr, 0, sizeof(VLSR_Route)); 
-				vlsr.errCode = (ERROR_SPEC_Object::Notify << 16 | ERROR_SPEC_Object::RSVPSwitchSNMPFailure);
-				vLSRoute.push_back(vlsr);                    
+				LOG(6)( Log::MPLS,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
+					"VLSR: reading VLANs from Ethernet switch ", vlsr.switchID, (ssNew ? "" : " (new SwitchCtrl Session)"));
+				uint32 syncID = RSVP_Global::switchController->requestVLANSync(vlsr.switchID, ssNew);
+				RSVP_Global::messageProcessor->deferCurrentMessageForVlanSync(syncID);
 				return false;
 			}
 
@@ -778,6 +852,7 @@ bool Session::shouldReroute( const EXPLICIT_ROUTE_Object* ero ) {
 
 
 void Session::processPATH( const Message& msg, Hop& hop, uint8 TTL ) {
+	ProcessingTimer timer( STATS_PROBE_PROCESS_PATH );
 
 #if defined(ONEPASS_RESERVATION)
 	SENDER_TEMPLATE_Object& senderTemplate =
@@ -791,6 +866,14 @@ void Session::processPATH( const Message& msg, Hop& hop, uint8 TTL ) {
 	if (Session::ospfRouterID.rawAddress() == 0)
 		Session::ospfRouterID = RSVP_Global::rsvp->getRoutingService().getLoopbackAddress();
 
+	ONetworkBuffer pathImage( msg.getLength() + 2 );
+	uint32 pathDigest = getPathDigest( msg, TTL, pathImage );
+	if ( pathDigest && refreshPATH( msg, hop, pathDigest, pathImage ) ) {
+		pathFastCount += 1;
+		return;
+	}
+	pathFullCount += 1;
+
 #if defined(WITH_API)
 /* OLD @@@@
 	bool fromLocalAPI = (&hop.getLogicalInterface() == RSVP_Global::rsvp->getApiLif()
@@ -889,6 +972,9 @@ void Session::processPATH( const Message& msg, Hop& hop, uint8 TTL ) {
 					   : const_cast<EXPLICIT_ROUTE_Object*>(msg.getEXPLICIT_ROUTE_Object());
 		if (explicitRoute && (!processERO(msg, hop, explicitRoute, fromLocalAPI, dataInRsvpHop, dataOutRsvpHop, vLSRoute)))
 		{
+			//processed again once the Ethernet switch has been read
+			if (RSVP_Global::messageProcessor->hasDeferredMessage(msg))
+				return;
 			if (vLSRoute.size() > 0) {
 				VLSR_Route& vlsr = vLSRoute.back();
 				if (vlsr.inPort == 0 && vlsr.outPort == 0 && vlsr.switchID.rawAddress() == 0) {
@@ -1009,6 +1095,20 @@ void Session::processPATH( const Message& msg, Hop& hop, uint8 TTL ) {
 
 	                     //explicit routing using NARB
 	                     if (!explicitRoute) {
+					//The NARB query is not waited for either: this PATH message is processed
+					//again once NARB has answered (see MessageProcessor::queryEnqueuedMessages).
+					if (RSVP_Global::messageProcessor->hasDeferredMessage(msg)) {
+						LOG(4)( Log::MPLS,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
+							"MPLS: still waiting for a deferred ERO request...");
+						return;
+					}
+					if (NARB_APIClient::resumedRequestExpired()) {
+						LOG(4)( Log::MPLS,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
+							"MPLS: NARB did not answer the ERO request in time (PATH processing stopped)!");
+						NARB_APIClient::clearResumedRequest();
+						RSVP_Global::messageProcessor->sendPathErrMessage( ERROR_SPEC_Object::RoutingProblem, ERROR_SPEC_Object::NoRouteAvailToDest );
+						return;
+					}
 					if (narbClient || NARB_APIClient::operational()) {
 						if (!narbClient)
 							narbClient = new NARB_APIClient;
@@ -1017,8 +1117,15 @@ void Session::processPATH( const Message& msg, Hop& hop, uint8 TTL ) {
 						if (narbClient->active()) {
 			                            //@@@@ Missing ingress port/interface on this VLSR?!
 			                            //@@@@ oldExplicitRoute = explicitRoute;
-			                            explicitRoute = narbClient->getExplicitRoute(msg, hasReceivedExplicitRoute, (void*)this);
+							narb_query_id narbQuery;
+			                            explicitRoute = narbClient->getExplicitRoute(msg, hasReceivedExplicitRoute, (void*)this, narbQuery);
 			                            //@@@@ push_front ... those TE addreses of local interfaces not in the new ERO
+							if (!explicitRoute && narbQuery.ucid != 0) {
+								LOG(4)( Log::MPLS,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
+									"MPLS: requesting ERO from NARB...");
+								RSVP_Global::messageProcessor->deferCurrentMessageForNarb(narbQuery.ucid, narbQuery.seqnum);
+								return;
+							}
 							if (explicitRoute) {
 								if (!narbClient->handleRsvpMessage(msg)) {
 									LOG(6)( Log::Routing,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
@@ -1045,11 +1152,27 @@ void Session::processPATH( const Message& msg, Hop& hop, uint8 TTL ) {
 					}
 					else if (!explicitRoute)//explicit routing using OSPFd
 					{
-						LOG(4)( Log::MPLS,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
-							"MPLS: requesting ERO from OSPF daemon...");
-						explicitRoute = RSVP_Global::rsvp->getRoutingService().getExplicitRouteByOSPF(
-							hop.getLogicalInterface().getAddress(),
-							destAddress, msg.getSENDER_TSPEC_Object(), msg.getLABEL_REQUEST_Object());
+						//The path computation is not waited for: this PATH message is processed
+						//again once OSPFd has answered (see MessageProcessor::queryEnqueuedMessages).
+						if (!RSVP_Global::rsvp->getRoutingService().takeResumedExplicitRoute(explicitRoute)) {
+							if (RSVP_Global::messageProcessor->hasDeferredMessage(msg)) {
+								LOG(4)( Log::MPLS,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
+									"MPLS: still waiting for ERO from OSPF daemon...");
+								return;
+							}
+							LOG(4)( Log::MPLS,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
+								"MPLS: requesting ERO from OSPF daemon...");
+							DRAGON_UNI_Object* uni = ((Message*)&msg)->getDRAGON_UNI_Object();
+							uint32 requestID = RSVP_Global::rsvp->getRoutingService().requestExplicitRouteByOSPF(
+								hop.getLogicalInterface().getAddress(),
+								destAddress, msg.getSENDER_TSPEC_Object(), msg.getLABEL_REQUEST_Object(),
+								msg.hasSESSION_ATTRIBUTE_Object() ? &msg.getSESSION_ATTRIBUTE_Object() : NULL,
+								uni ? uni->getVlanTag().vtag : 0);
+							if (requestID) {
+								RSVP_Global::messageProcessor->deferCurrentMessage(requestID);
+								return;
+							}
+						}
 					}
 					if (!explicitRoute) {
 						LOG(4)( Log::MPLS,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
@@ -1086,6 +1209,9 @@ void Session::processPATH( const Message& msg, Hop& hop, uint8 TTL ) {
 
 		if (explicitRoute && (!processERO(msg, hop, explicitRoute, fromLocalAPI, dataInRsvpHop, dataOutRsvpHop, vLSRoute)))
 		{
+			//processed again once the Ethernet switch has been read
+			if (RSVP_Global::messageProcessor->hasDeferredMessage(msg))
+				return;
 			
 			if (vLSRoute.size() > 0) {
 				VLSR_Route& vlsr = vLSRoute.back();
@@ -1327,6 +1453,7 @@ search_psb:
 		RelationshipSession_PSB::setRelationshipFull( this, cPSB, psbIter );
 	} else {
 		LOG(5)( Log::Process,  "LSP=", msg.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "found", *cPSB );
+		cPSB->setPathDigest( 0 );
 	}
 
 	// if the PSB is not new and the PHOP has changed -> send reservations upstream
@@ -1381,7 +1508,13 @@ search_psb:
 			cPSB->updateUPSTREAM_OUT_LABEL_Object(msg.getUPSTREAM_LABEL_Object());
 			if (!RSVP_Global::rsvp->findInterfaceByAddress(destAddress)){
 				uint32 upstreamInLabel = ((LogicalInterface*)outLif)->getUpstreamLabel();
-				if (upstreamInLabel == 0) upstreamInLabel = RSVP_Global::rsvp->getMPLS().allocUpstreamInLabel();
+				if (upstreamInLabel == 0) {
+					// PATH refreshes keep the label allocated for the first PATH
+					if (cPSB->isUpstreamInLabelAllocated())
+						upstreamInLabel = cPSB->getUPSTREAM_IN_LABEL_Object().getLabel();
+					else if ((upstreamInLabel = RSVP_Global::rsvp->getMPLS().allocUpstreamInLabel()) != 0)
+						cPSB->setUpstreamInLabelAllocated();
+				}
 				if (upstreamInLabel==0){
 					RSVP_Global::messageProcessor->sendPathErrMessage( ERROR_SPEC_Object::RoutingProblem, ERROR_SPEC_Object::MPLSLabelAllocationFailure);
 					return;
@@ -1471,6 +1604,7 @@ goto update_basic_psb;
 	}
 	cPSB->setFromAPI( &hop.getLogicalInterface() == RSVP_Global::rsvp->getApiLif() );
 #endif
+	cPSB->setPathDigest( pathDigest, &pathImage );
 
 #if defined(ONEPASS_RESERVATION)
 update_basic_psb:
@@ -1616,7 +1750,7 @@ void Session::processPERR( Message& msg, const LogicalInterface& inLif ) {
 }
 
 inline ERROR_SPEC_Object::ErrorCode Session::processRESV_FDesc( const FLOWSPEC_Object& flowspec,
-	const FilterSpecList& filterList, const Message& msg, Hop& nhop ) {
+	const FilterSpecList& filterList, const Message& msg, Hop& nhop, uint16& errorValue ) {
 	RSB* currentRSB = NULL;
 	OutISB* currentOutISB = NULL;
 	RSB_Contents* oldRSB = NULL;
@@ -1648,6 +1782,16 @@ inline ERROR_SPEC_Object::ErrorCode Session::processRESV_FDesc( const FLOWSPEC_O
 		bool weakRSB = ( currentOutISB && currentOutISB->getRSB_List().front()->getNextHop().getAddress() == NetAddress(0) );
 #endif
 
+		// no state is touched yet, so running out of labels rejects the RESV as a whole
+		PSB_List::ConstIterator labelIter = matchingPSB_List.begin();
+		for ( ; labelIter != matchingPSB_List.end(); ++labelIter ) {
+			if ( !(*labelIter)->reserveInLabel() ) {
+				LOG(2)( Log::Process, "no MPLS label left for", **labelIter );
+				errorValue = ERROR_SPEC_Object::MPLSLabelAllocationFailure;
+	return ERROR_SPEC_Object::RoutingProblem;
+			}
+		}
+
 		// find RSB at OutISB
 		RSB_List::ConstIterator rsbIter;
 		if ( !currentOutISB ) {
@@ -1823,6 +1967,7 @@ inline ERROR_SPEC_Object::ErrorCode Session::processRESV_FDesc( const FLOWSPEC_O
 }
 
 void Session::processRESV( const Message& msg, Hop& nhop ) {
+	ProcessingTimer timer( STATS_PROBE_PROCESS_RESV );
 
 	// check style; special case of rsbCount == 1 is in processRESV_FDesc
 	FilterStyle msgStyle = msg.getSTYLE_Object().getStyle();
@@ -1846,10 +1991,11 @@ void Session::processRESV( const Message& msg, Hop& nhop ) {
 	for ( ; flowdescIter != flowDescriptorList.end() ; ++flowdescIter ) {
 		LOG(2)( Log::Process,  "processing flow descriptor", *flowdescIter );
 		/* ieee32float bandwidth = ((*flowdescIter).getFlowspec())? ((*flowdescIter).getFlowspec())->getEffectiveRate():0; */
-		ERROR_SPEC_Object::ErrorCode result = processRESV_FDesc( *(*flowdescIter).getFlowspec(), (*flowdescIter).filterSpecList, msg, nhop );
+		uint16 errorValue = 0;
+		ERROR_SPEC_Object::ErrorCode result = processRESV_FDesc( *(*flowdescIter).getFlowspec(), (*flowdescIter).filterSpecList, msg, nhop, errorValue );
 		if ( result != ERROR_SPEC_Object::Confirmation ) {
 			if ( msg.getMsgType() != Message::ResvTear ) {
-				RSVP_Global::messageProcessor->sendResvErrMessage( 0, result, 0, *flowdescIter );
+				RSVP_Global::messageProcessor->sendResvErrMessage( 0, result, errorValue, *flowdescIter );
 			}
 		}
 		else{  //Send notification to OSPF
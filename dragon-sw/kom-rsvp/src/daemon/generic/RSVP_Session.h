@@ -79,12 +79,13 @@ class Session :	public RelationshipSession_PSB,
 	SwitchCtrl_Session_SubnetUNI* pSubnetUniDest;
 
 	PHopSB* findOrCreatePHopSB( Hop&, uint32 );
+	bool refreshPATH( const Message&, Hop&, uint32, const ONetworkBuffer& );
 
 	void matchPSBsAndFiltersAndOutInterface( const FilterSpecList&, const LogicalInterface&, PSB_List& result, OutISB*& );
 #if defined(USE_SCOPE_OBJECT)
 	void matchPSBsAndSCOPEandOutInterface( const AddressList&, const LogicalInterface&, PSB_List& result, OutISB*& );
 #endif
-	inline ERROR_SPEC_Object::ErrorCode processRESV_FDesc( const FLOWSPEC_Object&, const FilterSpecList&, const Message& msg, Hop& ); 
+	inline ERROR_SPEC_Object::ErrorCode processRESV_FDesc( const FLOWSPEC_Object&, const FilterSpecList&, const Message& msg, Hop&, uint16& errorValue ); 
 
 public:
 	Session( const SESSION_Object& );
@@ -129,6 +130,13 @@ public:
 
 	static NetAddress ospfRouterID;
 
+	// PATH messages handled as pure refresh vs. fully processed
+	static uint32 pathFastCount;
+	static uint32 pathFullCount;
+	static uint32 getPathDigest( const Message&, uint8 TTL, ONetworkBuffer& image );
+	// also used for PATH refreshes recognized by message ID, see Hop::refreshRecvPSB
+	bool refreshPSB( PSB& );
+
 	PSB* getPSBbyLSPName(const char* name);
 
 	DECLARE_MEMORY_MACHINE_IN_CLASS(Session)
@@ -14,6 +14,9 @@ To be incorporated into KOM-RSVP-TE package
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <time.h>
 #include <errno.h>
 #include "CLI_Session.h"
 
@@ -126,6 +129,13 @@ bool CLI_Session::engage(const char *loginString)
     if (CLI_SESSION_TYPE == CLI_NONE)
         return false;
 
+    loginPrompt = loginString;
+    loginPromptSet = true;
+
+    // another session may have left a logged in channel to the switch
+    if (takePooledConnection())
+        return true;
+
     // we need pipes to communicate between the programs 
     if (pipe(fdpipe[0]) < 0) {
         err_msg("%s: pipe failed: errno=%d\n", progname, errno);
@@ -235,12 +245,14 @@ bool CLI_Session::engage(const char *loginString)
         // close the childs end of the pipes 
         close(fdpipe[0][0]);
         close(fdpipe[1][1]);
+        childPid = pid;
         break;
     }
 
     // now communicate with the 'telnet' process 
     fdin = fdpipe[1][0];
     fdout = fdpipe[0][1];
+    readStart = readEnd = 0;
 
     if (CLI_SESSION_TYPE == CLI_TELNET) {   
         if (loginString != NULL)
@@ -334,6 +346,9 @@ bool CLI_Session::engage(const char *loginString)
 void CLI_Session::disengage(const char *exitString)
 {
     int n = 0;
+    loginPromptSet = false; // not to be logged in again by reengage()
+    if (returnPooledConnection(exitString))
+        return;
     if (pipeAlive()) {
         if (exitString != NULL && (n = writeShell(exitString, 5)) >= 0) {
           sleep(1);
@@ -341,7 +356,7 @@ void CLI_Session::disengage(const char *exitString)
               n = readShell(SWITCH_PROMPT, NULL, 1, 10);
         }
     }
-    else {
+    else if (fdin >= 0 || fdout >= 0) { // not yet disconnected
         LOG(1)(Log::Error, "CLI_Session::disengage encountered broken pipe!");
     }
 
@@ -349,6 +364,121 @@ void CLI_Session::disengage(const char *exitString)
     stop();
 }
 
+// log in again with the prompt of the last engage() if the channel has died,
+// e.g. by an idle timeout on the switch
+bool CLI_Session::reengage()
+{
+    if (pipeAlive())
+        return true;
+    if (!loginPromptSet || vendor == JUNOS) // JUNOScript needs more than a login
+        return false;
+    LOG(2)(Log::MPLS, "VLSR: CLI connection lost, logging in again to", switchInetAddr);
+    closePipe();
+    pid = childPid;
+    stop();
+    return engage(loginPrompt);
+}
+
+bool CLI_Session::takePooledConnection()
+{
+    cli_conn_entry conn;
+    while (SwitchCtrl_Global::takeCLIConnection(switchInetAddr, cli_port, conn)) {
+        fdin = conn.fdin;
+        fdout = conn.fdout;
+        childPid = pid = conn.pid;
+        readStart = readEnd = 0;
+        if (pipeAlive()) {
+            LOG(2)(Log::MPLS, "VLSR: reusing pooled CLI connection to", switchInetAddr);
+            return true;
+        }
+        closePipe();
+        stop();
+    }
+    return false;
+}
+
+// hand the channel to the pool instead of logging out; a JUNOScript session
+// cannot be taken over by the next session. The pool logs the channel out
+// with 'exitString' once it is closed.
+bool CLI_Session::returnPooledConnection(const char *exitString)
+{
+    cli_conn_entry conn;
+    if (vendor == JUNOS || !pipeAlive())
+        return false;
+    if (exitString != NULL && strlen(exitString) >= CLI_EXIT_STRING_LEN)
+        return false;
+    conn.switchAddr = switchInetAddr;
+    conn.port = cli_port;
+    conn.fdin = fdin;
+    conn.fdout = fdout;
+    conn.pid = childPid;
+    conn.lastUsed = time(NULL);
+    strcpy(conn.exitString, exitString != NULL ? exitString : "");
+    if (!SwitchCtrl_Global::returnCLIConnection(conn))
+        return false;
+    if (pid == childPid)
+        pid = -1;
+    fdin = fdout = -1;
+    childPid = -1;
+    readStart = readEnd = 0;
+    return true;
+}
+
+// log the channel out like disengage() does, then reap its child
+void CLI_Session::closeConnection(const cli_conn_entry& conn)
+{
+    char buf[READ_CHUNK];
+    fd_set fds;
+    struct timeval tv;
+    int len = strlen(conn.exitString);
+
+    if (len > 0 && write(conn.fdout, conn.exitString, len) == len) {
+        tv.tv_sec = 1;
+        tv.tv_usec = 0;
+        for (;;) {
+            FD_ZERO(&fds);
+            FD_SET(conn.fdin, &fds);
+            if (select(conn.fdin+1, &fds, NULL, NULL, &tv) <= 0 || read(conn.fdin, buf, sizeof(buf)) <= 0)
+                break;
+        }
+    }
+    close(conn.fdin);
+    close(conn.fdout);
+    if (conn.pid > 0) {
+        kill(conn.pid, SIGTERM);
+        kill(conn.pid, SIGKILL);
+        waitpid(conn.pid, NULL, 0);
+    }
+}
+
+// send an empty command and take whatever comes back; select() is used
+// instead of the alarm, which belongs to the engaged sessions
+bool CLI_Session::keepAliveConnection(const cli_conn_entry& conn, int timeout)
+{
+    char buf[READ_CHUNK];
+    fd_set fds;
+    struct timeval tv;
+    bool replied = false;
+
+    if (write(conn.fdout, CLI_SESSION_TYPE == CLI_TL1_TELNET? ";" : "\n", 1) != 1)
+        return false;
+    tv.tv_sec = timeout;
+    tv.tv_usec = 0;
+    for (;;) {
+        FD_ZERO(&fds);
+        FD_SET(conn.fdin, &fds);
+        int n = select(conn.fdin+1, &fds, NULL, NULL, &tv);
+        if (n == 0)
+            return replied;
+        if (n < 0 || read(conn.fdin, buf, sizeof(buf)) <= 0)
+            return false;
+        replied = true;
+        // drain the rest of the reply
+        tv.tv_sec = 0;
+        tv.tv_usec = 200000;
+    }
+}
+
 void CLI_Session::closePipe()
 {
     if (fdin >= 0)
@@ -356,6 +486,7 @@ void CLI_Session::closePipe()
     if (fdout >= 0)
         close(fdout);
     fdin = fdout = -1;
+    readStart = readEnd = 0;
 }
 
 void CLI_Session::stop()
@@ -375,8 +506,8 @@ void CLI_Session::stop()
 }
 bool CLI_Session::refresh()
 {
-    if (!pipeAlive()) {
-        fdin = fdout = -1;
+    if (!reengage()) {
+        closePipe();
         LOG(1)(Log::Error, "CLI_Session::refresh has broken pipe!");
         return false;
     }
@@ -418,15 +549,56 @@ bool CLI_Session::isSwitchPrompt(char *p, int len)
   return (found == 1);
 }
 
+// next character from 'telnet', which is read in chunks of up to READ_CHUNK
+// bytes; returns 1 or the failed read()'s result
+int CLI_Session::readShellChar(char* c)
+{
+  if (readStart == readEnd) {
+    int m = read(fdin, readBuffer, READ_CHUNK);
+    if (m <= 0)
+      return m;
+    readStart = 0;
+    readEnd = m;
+  }
+  *c = readBuffer[readStart++];
+  return 1;
+}
+
+// a pager prompt ends in buf[n]: ask for the next page and drop the prompt,
+// 'n' is set to where it started
+bool CLI_Session::skipPager(char* buf, int& n)
+{
+  static const int len = strlen(PAGER_PROMPT);
+  if (n < len-1 || strncmp(buf+n-len+1, PAGER_PROMPT, len) != 0)
+    return false;
+  write(fdout, " ", 1);
+  n -= len-1;
+  buf[n] = 0;
+  return true;
+}
+
+// 'text' ends in buf[n], anywhere in the line or only at its beginning
+static inline bool matchShellText(const char* buf, int n, const char* text, int len, bool matchAnyWhere)
+{
+  if (len == 0)
+    return true;
+  if (n < len-1 || (!matchAnyWhere && n != len-1))
+    return false;
+  return strncmp(buf+n-len+1, text, len) == 0;
+}
+
 // read information from 'telnet', stop reading upon errors, on a timeout 
 // and when the beginning of a line equals to 'text1' (and then return 1) 
 // or when the beginning of a line equals to 'text2' (and then return 2), 
 // if 'show' is non zero we display the information to the screen         
 // (using 'stdout').                                                      
+// Each character is checked against the ends of 'text1' and 'text2' only,
+// so a line is not searched again for every character that is added.
 
 int CLI_Session::readShellBuffer(char* buffer, const char *text1, const char *text2, const bool matchAnyWhere, int verbose, int timeout)
 {
-  int n, len1, len2, count = 0, m, err;
+  int n, len1, len2;
+  bool prompt;
 
   if (fdin < 0)
     return (-1);
@@ -441,54 +613,39 @@ int CLI_Session::readShellBuffer(char* buffer, const char *text1, const char *te
   // start reading from 'telnet'
   for(;;) {
     n = 0;
+    prompt = false;
     for(;;) {
       if (n == LINELEN-1) {
 	alarm(0); // disable alarm
 	stop();
 	err_exit("%s: too long line!\n", progname);
       }
-      m = read(fdin, &buffer[n], 1);
-      buffer[n+1] = 0;
-      if (m != 1) {
-	err = errno;
+      if (readShellChar(&buffer[n]) != 1) {
 	alarm(0); // disable alarm
 	return(-1);
       }
+      buffer[n+1] = 0;
 ///////// debug info ////////
       fputc(0xff & (int)buffer[n], stdout);
 ///////// debug info ////////
       if (buffer[n] == '\r') {
         continue;
       }
-      if (text1 == SWITCH_PROMPT) {
-	if (isSwitchPrompt(buffer, n+1)) {
-	  // we found the keyword we were searching for
-	  alarm(0); // disable alarm
-	  return(1);
-	}
-      }
-      else if (n >= len1-1) {
-      	char *matchPtr = strstr(buffer, text1);
-	if (matchPtr != 0 && (matchAnyWhere || matchPtr == buffer)) {
-	  // we found the keyword we were searching for 
-	  alarm(0); // disable alarm 
-	  return(1);
-	}
+      if (skipPager(buffer, n)) {
+        continue;
       }
-      if (text2 == SWITCH_PROMPT) {
-	if (isSwitchPrompt(buffer, n+1)) {
-	  // we found the keyword we were searching for 
-	  alarm(0); // disable alarm 
-	  return(2);
-	}
+      // the prompt characters may be anywhere in the line
+      if (!prompt)
+        prompt = isSwitchPrompt(&buffer[n], 1);
+      if (text1 == SWITCH_PROMPT ? prompt : matchShellText(buffer, n, text1, len1, matchAnyWhere)) {
+	// we found the keyword we were searching for
+	alarm(0); // disable alarm
+	return(1);
       }
-      else if ((text2 != NULL) && (n >= len2-1)) {
-      	char *matchPtr = strstr(buffer, text2);
-	if (matchPtr != 0 && (matchAnyWhere || matchPtr == buffer)) {
-	  // we found the keyword we were searching for 
-	  alarm(0); // disable alarm 
-	  return(2);
-	}
+      if (text2 == SWITCH_PROMPT ? prompt : (text2 != NULL && matchShellText(buffer, n, text2, len2, matchAnyWhere))) {
+	// we found the keyword we were searching for 
+	alarm(0); // disable alarm 
+	return(2);
       }
       if (buffer[n] == '\n') {
         buffer = buffer+n;
@@ -496,17 +653,6 @@ int CLI_Session::readShellBuffer(char* buffer, const char *text1, const char *te
       }
       n++;
     }
-///////// debug info ////////
-      /*
-      buffer[++n] = '\0';
-      if (++count > 1) {
-	// the very first line of information is the remains of  
-	// a previously issued command and should be ignored.    
-        fprintf(stdout, "READ:");
-	fputs(buffer, stdout);
-	fflush(stdout);
-      }
-      */
   }
 }
 
@@ -548,19 +694,20 @@ int CLI_Session::ReadShellPattern(char *buf, char *pattern1, char *pattern2, cha
 	LOG(1)(Log::MPLS, "Failed to read from telnet output -- too long line!");
 	return TOO_LONG_LINE;
       }
-      m = read(fdin, &buf[n], 1);
+      m = readShellChar(&buf[n]);
+      if (m != 1) {
+	alarm(0); // disable alarm
+	//exception handling
+	closePipe();
+	return(-1);
+      }
 ///////// debug info ////////
       fputc(0xff & (int)buf[n], stdout);
 ///////// debug info ////////
 
       buf[n+1] = 0;
-      if (m != 1) {
-	alarm(0); // disable alarm
-	//exception handling
-	close(fdout);
-	close(fdin);
-	fdin = fdout = -1;
-	return(-1);
+      if (skipPager(buf, n)) {
+	continue;
       }
 
       if (ret == 0 && len1 > 0 && n >= len1-1) {
@@ -627,9 +774,7 @@ int CLI_Session::writeShell(const char *text, int timeout, bool echo_back)
     err = errno;
     alarm(0); // disable alarm 
     //exception handling
-    close(fdout);
-    close(fdin);
-    fdin = fdout = -1;
+    closePipe();
     return(-1);
   }
   else {
@@ -640,7 +785,7 @@ int CLI_Session::writeShell(const char *text, int timeout, bool echo_back)
 
 bool CLI_Session::preAction()
 {
-    if (!active || !pipeAlive())
+    if (!active || !reengage())
         return false;
     DIE_IF_NEGATIVE(writeShell("configure\n", 5));
     DIE_IF_NEGATIVE(readShell(SWITCH_PROMPT, NULL, 1, 10));
@@ -683,7 +828,7 @@ int CLI_Session::readShellOutput(CLICommandParser &parser, int timeout) {
   while(!foundSwitchPrompt) {
     int i;
     for(i = 0; i < LINELEN+1; i++) {
-      int m = read(fdin, &line[i], 1);
+      int m = readShellChar(&line[i]);
       if (m != 1) {
 	err = errno;
 	alarm(0); // disable alarm
@@ -702,7 +847,12 @@ int CLI_Session::readShellOutput(CLICommandParser &parser, int timeout) {
 	break;
       }
 
-      if(isSwitchPrompt(line, i + 1)) {
+      if (skipPager(line, i)) {
+	i--;
+	continue;
+      }
+
+      if(isSwitchPrompt(&line[i], 1)) {
 	alarm(0); // disable alarm
 	foundSwitchPrompt = true;
 	break;
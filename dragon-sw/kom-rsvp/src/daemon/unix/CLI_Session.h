@@ -30,6 +30,8 @@ extern pid_t pid;
 extern int    got_alarm;
 
 #define LINELEN  8192
+#define READ_CHUNK 4096 // bytes taken from the CLI child per read()
+#define PAGER_PROMPT "--More--"
 #define SWITCH_PROMPT ((char*)-1) // a pointer == (-1), indicating that a switch prompt is expected.
 #define TOO_LONG_LINE (-2)
 #define READ_STOP (-3)
@@ -51,9 +53,10 @@ class CLICommandParser;
 class CLI_Session: public SwitchCtrl_Session
 {
 public:
-	CLI_Session(int port = 0): SwitchCtrl_Session(), cli_port(port) { fdin = fdout = -1; }
+	CLI_Session(int port = 0): SwitchCtrl_Session(), cli_port(port)
+		{ fdin = fdout = -1; readStart = readEnd = 0; childPid = -1; loginPrompt = NULL; loginPromptSet = false; }
 	CLI_Session(const String& sName, const NetAddress& swAddr, int port = 0): SwitchCtrl_Session(sName, swAddr), cli_port(port)
-		{ fdin = fdout = -1;  }
+		{ fdin = fdout = -1; readStart = readEnd = 0; childPid = -1; loginPrompt = NULL; loginPromptSet = false; }
 	virtual ~CLI_Session() { disconnectSwitch(); }
 
 	void setPort(int port) { cli_port = port; }
@@ -64,9 +67,14 @@ public:
 
 	bool engage(const char *loginString = "ogin: ");
 	void disengage(const char *exitString = "exit\n");
+	bool reengage();
 	void closePipe();
 	void stop();
 
+	// pooled channels, see SwitchCtrl_Global::takeCLIConnection
+	static void closeConnection(const cli_conn_entry& conn);
+	static bool keepAliveConnection(const cli_conn_entry& conn, int timeout = 3);
+
 	///////////------QoS Functions ------/////////
 	virtual bool policeInputBandwidth(bool do_undo, uint32 input_port, uint32 vlan_id, float committed_rate, int burst_size=0, float peak_rate=0.0,  int peak_burst_size=0) { return false; }
 	virtual bool limitOutputBandwidth(bool do_undo,  uint32 output_port, uint32 vlan_id, float committed_rate, int burst_size=0, float peak_rate=0.0,  int peak_burst_size=0) { return false; }
@@ -75,8 +83,21 @@ protected:
 	int cli_port;
 	int fdin;
 	int fdout;
+	// output of the CLI child that has been read but not yet consumed,
+	// e.g. whatever followed the prompt that ended the last read
+	char readBuffer[READ_CHUNK];
+	int readStart, readEnd;
+	pid_t childPid;
+	// what engage() was last called with, for logging in again
+	const char* loginPrompt;
+	bool loginPromptSet;
+
+	bool takePooledConnection();
+	bool returnPooledConnection(const char *exitString);
 
 	virtual bool pipeAlive();
+	int readShellChar(char* c);
+	bool skipPager(char* buf, int& n);
 	int readShellBuffer(char* buffer, const char *text1, const char *text2, const bool matchAnyWhere, int verbose, int timeout);
 	int readShell(const char *text1, const char *text2, const bool matchAnyWhere, int verbose, int timeout);
 	int readShell(const char *text1, const char *text2, int verbose, int timeout);
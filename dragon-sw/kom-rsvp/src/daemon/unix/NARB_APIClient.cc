@@ -17,37 +17,22 @@ To be incorporated into KOM-RSVP-TE package
 #include "RSVP_ProtocolObjects.h"
 #include "RSVP_Message.h"
 #include "RSVP_Session.h"
+#include "RSVP_NetworkServiceDaemon.h"
+#include "RSVP_ProcessingStats.h"
 #include "NARB_APIClient.h"
 
 String NARB_APIClient::_host = "";
 int NARB_APIClient::_port = 0;
 uint32 NARB_APIClient::extra_options = 0;
 UsedVtagList* NARB_APIClient::vtagsAllowedforUse;
-
-
-int readn (int fd, char *ptr, int nbytes)
-{
-  int nleft;
-  int nread;
-
-  nleft = nbytes;
-
-  while (nleft > 0) 
-    {
-      nread = read (fd, ptr, nleft);
-
-      if (nread < 0) 
-	return (nread);
-      else
-	if (nread == 0) 
-	  break;
-
-      nleft -= nread;
-      ptr += nread;
-    }
-
-  return nbytes - nleft;
-}  
+int NARB_APIClient::fd = -1;
+TimeValue NARB_APIClient::nextConnectAttempt(0, 0);
+NarbRequestList NARB_APIClient::narbRequests;
+NarbRequest* NARB_APIClient::resumedRequest = NULL;
+char NARB_APIClient::readBuffer[NARB_APIClient::readBufferSize];
+int NARB_APIClient::readLength = 0;
+EroSearchHash NARB_APIClient::eroSearchHash(64, 4);
+EroPointerHash NARB_APIClient::eroPointerHash(64, 4);
 
 
 int writen(int fd, char *ptr, int nbytes)
@@ -78,10 +63,26 @@ void NARB_APIClient::setHostPort(const char *host, int port)
 }
 
 bool NARB_APIClient::operational()
+{
+    return active() || connectNarb();
+}
+
+// open the shared connection; connecting gives up after one second, so that
+// a NARB that is down does not hold up the main loop for long, and is not
+// tried again for narbReconnectInterval seconds
+bool NARB_APIClient::connectNarb()
 {
     if (_host.length() == 0 || _port == 0)
         return false;
 
+    TimeValue now = getCurrentSystemTime();
+    TimeValue wait = nextConnectAttempt;
+    wait -= now;
+    if (wait.getUsec() > 0)
+        return false;
+    nextConnectAttempt = now;
+    nextConnectAttempt += TimeValue(narbReconnectInterval, 0);
+
     int val, ret=0;
     int sock;
     struct sockaddr_in addr;
@@ -93,7 +94,7 @@ bool NARB_APIClient::operational()
 
     sock = socket (AF_INET, SOCK_STREAM, 0);
     if (sock < 0)
-      return -1;
+      return false;
 
     flags = old_flags = fcntl(sock, F_GETFL, 0);
 #if defined(O_NONBLOCK)
@@ -105,13 +106,15 @@ bool NARB_APIClient::operational()
 #endif
 
     if (fcntl(sock, F_SETFL, flags) == -1) {
+        close (sock);
         return false;
     }
 
     hp = gethostbyname (_host.chars());
     if (!hp)
     {
-        LOG(2)(Log::Routing, "NARB_APIClient::Connect: no such host %s\n", _host);
+        LOG(2)(Log::Routing, "NARB_APIClient::Connect: no such host ", _host);
+        close (sock);
         return (false);
     }
 
@@ -122,130 +125,62 @@ bool NARB_APIClient::operational()
 
     ret = connect (sock, (struct sockaddr *) &addr, sizeof(struct sockaddr_in));
     if(ret < 0) {
-       if (errno == EINPROGRESS) {
-           tv.tv_sec = 1;
-           tv.tv_usec = 0;
-           FD_ZERO(&sset);
-           FD_SET(sock, &sset);
-           if(select(sock+1, NULL, &sset, NULL, &tv) > 0) {
-               lon = sizeof(int);
-               getsockopt(sock, SOL_SOCKET, SO_ERROR, (void*)(&val), &lon); 
-               close (sock);
-               return ((val != 0)? false : true);
-           }
-           else {
-               close (sock);
-               return false;
-           }
+       if (errno != EINPROGRESS) {
+           close (sock);
+           return false;
+       }
+       tv.tv_sec = 1;
+       tv.tv_usec = 0;
+       FD_ZERO(&sset);
+       FD_SET(sock, &sset);
+       if(select(sock+1, NULL, &sset, NULL, &tv) <= 0) {
+           close (sock);
+           return false;
        }
-       else {
+       lon = sizeof(int);
+       getsockopt(sock, SOL_SOCKET, SO_ERROR, (void*)(&val), &lon); 
+       if (val != 0) {
            close (sock);
            return false;
        }
    }
 
+    // queries are written blocking, replies are read without waiting
     if (fcntl(sock, F_SETFL, old_flags) == -1) {
          close (sock);
          return false;
     }
-    close (sock);
+
+    fd = sock;
+    readLength = 0;
+    nextConnectAttempt = TimeValue(0, 0);
+    NetworkServiceDaemon::registerNarb_Handle(fd);
+    LOG(4)(Log::Routing, "NARB_APIClient connected to ", _host, ":", _port);
     return true;
 }
 
 NARB_APIClient::~NARB_APIClient()
 {
-    disconnect();
-    EroSearchList::Iterator iter = eroSearchList.begin();
-    for ( ; iter != eroSearchList.end(); ++iter)
-    {
-            if ((*iter)->ero)
-                (*iter)->ero->destroy();
-            delete (*iter);
-    }
+    // the connection is shared and stays open
+    while (!eroSearchList.empty())
+        deleteEntry(eroSearchList.front());
 }
 
 int NARB_APIClient::doConnect(char *host, int port)
 {
-      struct sockaddr_in addr;
-      struct hostent *hp;
-      int ret;
-      int on = 1;
-
-      _host = host;
-      _port = port;
-  
-      assert (strlen(host) > 0 || port > 0);
-  	
-      hp = gethostbyname (host);
-      if (!hp)
-      {
-          LOG(2)( Log::Routing, "NARB_APIClient::Connect: no such host %s\n", host);
-          return (-1);
-      }
-  
-      fd = socket (AF_INET, SOCK_STREAM, 0);
-      if (fd < 0)
-      {
-  	  LOG(2)( Log::Routing, "NARB_APIClient::Connect: socket(): ", strerror (errno));
-  	  return (-1);
-      }
-                                                                                 
-      /* Reuse addr and port */
-      ret = setsockopt (fd, SOL_SOCKET,  SO_REUSEADDR, (void *) &on, sizeof (on));
-      if (ret < 0)
-      {
-          LOG(1)( Log::Routing, "NARB_APIClient::Connect: SO_REUSEADDR failed.");
-          close (fd);
-          fd = -1;
-          return (-1);
-      }
-  
-  #ifdef SO_REUSEPORT
-    ret = setsockopt (fd, SOL_SOCKET, SO_REUSEPORT,
-                      (void *) &on, sizeof (on));
-    if (ret < 0)
-    {
-        LOG(1)( Log::Routing, "NARB_APIClient::Connect: SO_REUSEPORT failed.");
-        close (fd);
-        fd = -1;
-        return (-1);
-    }
-  #endif /* SO_REUSEPORT */
-
-    /* Prepare address structure for connect */
-    memset (&addr, 0, sizeof (struct sockaddr_in));                                                                                
-    memcpy (&addr.sin_addr, hp->h_addr, hp->h_length);
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons (port);
-    //addr.sin_len = sizeof (struct sockaddr_in);
-   
-    /* Now establish synchronous channel with NARB daemon */
-    ret = connect (fd, (struct sockaddr *) &addr,
-                   sizeof (struct sockaddr_in));
-    if (ret < 0)
-    {
-        LOG(2)( Log::Routing, "NARB_APIClient::Connect: connect(): ", strerror (errno));
-        close (fd);
-        fd = -1;
-        return (-1);
-    }
-
-    return fd;
+    _host = host;
+    _port = port;
+    return doConnect();
 }
 
 int NARB_APIClient::doConnect()
 {
     LOG(1)(Log::Routing, "NARB_APIClient connecting ... \n");
 
-    if (_host.length() == 0 || _port == 0)
-        return -1;
-
     if (fd > 0)
-        close (fd);
-    if ((fd = doConnect((char*)(_host.chars()), _port)) < 0)
-    {
+        disconnect();
+    if (!connectNarb())
         return -1;
-    }
 
     return fd;
 }
@@ -254,9 +189,15 @@ void NARB_APIClient::disconnect()
 {
     if (fd > 0)
     {
+        NetworkServiceDaemon::deregisterNarb_Handle(fd);
         close (fd);
         fd = -1;
     }
+    readLength = 0;
+    // outstanding queries are not going to be answered anymore
+    NarbRequestList::Iterator iter = narbRequests.begin();
+    for ( ; iter != narbRequests.end(); ++iter)
+        (*iter)->answered = true;
 }
 
 bool NARB_APIClient::active()
@@ -396,15 +337,12 @@ static void deleteNarbApiMessage(narb_api_msg_header* apiMsg)
    delete []((char*)apiMsg);
 }
 
-EXPLICIT_ROUTE_Object* NARB_APIClient::getExplicitRoute(uint32 src, uint32 dest, uint8 swtype, uint8 encoding, float bandwidth, 
-	uint32& vtag, uint32& srcLocalId, uint32& destLocalId, uint32 hopBackAddr, uint32 excl_options, uint32 ucid, uint32 seqnum)
+// send an ERO query without waiting for the reply, see readReplies()
+bool NARB_APIClient::requestExplicitRoute(uint32 src, uint32 dest, uint8 swtype, uint8 encoding, float bandwidth, 
+	uint32 vtag, uint32 hopBackAddr, uint32 excl_options, uint32 ucid, uint32 seqnum)
 {
-    char buf[1024];
-    EXPLICIT_ROUTE_Object* ero = NULL;
-    te_tlv_header *tlv;
-    int len, offset;
-    ipv4_prefix_subobj* subobj_ipv4;
-    unum_if_subobj* subobj_unum;
+    bool ret = false;
+    int len;
     struct narb_api_msg_header* msgheader = buildNarbApiMessage(DMSG_CLI_TOPO_CREATE
             , src, dest, swtype, encoding, bandwidth, vtag,  ucid, seqnum, hopBackAddr);
     msgheader->options = htonl(ntohl(msgheader->options) | excl_options | NARB_APIClient::extra_options); //@@@@
@@ -417,48 +355,166 @@ EXPLICIT_ROUTE_Object* NARB_APIClient::getExplicitRoute(uint32 src, uint32 dest,
     len = writen(fd, (char*)msgheader, sizeof(struct narb_api_msg_header)+ntohs(msgheader->length));
     if (len < 0)
     {
-        LOG(2)(Log::Routing, "NARB_APIClient::getExplicitRoute failed to write to: ", fd);
+        LOG(2)(Log::Routing, "NARB_APIClient::requestExplicitRoute failed to write to: ", fd);
 	goto _RETURN;
     }
     else if (len ==0)
     {
        disconnect();
-	LOG(1)(Log::Routing, "connection closed for NARB_APIClient in ::getExplicitRoute.");
+	LOG(1)(Log::Routing, "connection closed for NARB_APIClient in ::requestExplicitRoute.");
         goto _RETURN;
     }
     else if (len != (int)(sizeof(struct narb_api_msg_header)+ntohs(msgheader->length)))
     {
-        LOG(2)(Log::Routing, "NARB_APIClient::getExplicitRoute cannot write the message to: ", fd);
+        LOG(2)(Log::Routing, "NARB_APIClient::requestExplicitRoute cannot write the message to: ", fd);
         goto _RETURN; 
     } 
 
-    //read reply
-    len = readn(fd, buf, sizeof(struct narb_api_msg_header));
-    if (len < 0)
+    narbRequests.push_back(new NarbRequest(ucid, seqnum));
+    ret = true;
+
+_RETURN:
+    deleteNarbApiMessage(msgheader);
+    return ret;
+}
+
+// read whatever NARB has sent and hand complete replies to their queries
+void NARB_APIClient::readReplies()
+{
+    if (fd <= 0)
+        return;
+    int n = recv(fd, readBuffer + readLength, readBufferSize - readLength, MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        return;
+    if (n <= 0)
     {
-        LOG(2)(Log::Routing, "NARB_APIClient::getExplicitRoute failed to read from: ", fd);
-	goto _RETURN;
+        LOG(1)(Log::Routing, "NARB closed the connection");
+        disconnect();
+        return;
     }
+    readLength += n;
 
-    tlv = (te_tlv_header*)((char*)buf + sizeof(struct narb_api_msg_header));
-    len = readn(fd, buf+sizeof(struct narb_api_msg_header), ntohs(((struct narb_api_msg_header*)buf)->length));
-    if (len < 0)
+    int start = 0;
+    while (readLength - start >= (int)sizeof(struct narb_api_msg_header))
     {
-        LOG(2)(Log::Routing, "NARB_APIClient::getExplicitRoute failed to read from: ", fd);
-	goto _RETURN;
+        struct narb_api_msg_header* msgheader = (struct narb_api_msg_header*)(readBuffer + start);
+        int length = sizeof(struct narb_api_msg_header) + ntohs(msgheader->length);
+        if (length > readBufferSize)
+        {
+            ERROR(2)(Log::Error, "NARB_APIClient: message from NARB too long: ", length);
+            disconnect();
+            return;
+        }
+        if (readLength - start < length)
+            break;
+        uint32 ucid = ntohl(msgheader->ucid);
+        uint32 seqnum = ntohl(msgheader->seqnum);
+
+        NarbRequestList::Iterator iter = narbRequests.begin();
+        for ( ; iter != narbRequests.end() && ((*iter)->id.ucid != ucid || (*iter)->id.seqnum != seqnum); ++iter);
+        if (iter == narbRequests.end() || (*iter)->answered)
+        {
+            LOG(4)(Log::Routing, "NARB_APIClient: ignoring message type ", ntohs(msgheader->type), " for seqnum ", seqnum);
+        }
+        else
+        {
+            (*iter)->answered = true;
+            (*iter)->replyLength = length - sizeof(struct narb_api_msg_header);
+            (*iter)->reply = new char[(*iter)->replyLength];
+            memcpy((*iter)->reply, readBuffer + start + sizeof(struct narb_api_msg_header), (*iter)->replyLength);
+            TimeValue now = getCurrentSystemTime();
+            now -= (*iter)->sent;
+            ProcessingStats::record(STATS_PROBE_NARB_QUERY, now.getUsec());
+        }
+        start += length;
+    }
+    if (start > 0)
+    {
+        readLength -= start;
+        memmove(readBuffer, readBuffer + start, readLength);
+    }
+}
+
+// a query that is still unanswered after narbReplyTimeout counts as answered
+// from now on, the late reply is ignored
+bool NARB_APIClient::replyArrived(uint32 ucid, uint32 seqnum)
+{
+    NarbRequestList::ConstIterator iter = narbRequests.begin();
+    for ( ; iter != narbRequests.end(); ++iter)
+    {
+        if ((*iter)->id.ucid == ucid && (*iter)->id.seqnum == seqnum)
+        {
+            if (!(*iter)->answered)
+            {
+                TimeValue elapsed = getCurrentSystemTime();
+                elapsed -= (*iter)->sent;
+                if (elapsed.tv_sec >= narbReplyTimeout)
+                {
+                    ERROR(3)(Log::Error, "NARB_APIClient: no reply in time to query with seqnum ", seqnum, ", giving up");
+                    (*iter)->answered = (*iter)->expired = true;
+                }
+            }
+            return (*iter)->answered;
+        }
+    }
+    return true;
+}
+
+// make the reply to (ucid, seqnum) available to the message that is
+// processed again now, see getExplicitRoute()
+void NARB_APIClient::resumeRequest(uint32 ucid, uint32 seqnum)
+{
+    clearResumedRequest();
+    NarbRequestList::Iterator iter = narbRequests.begin();
+    for ( ; iter != narbRequests.end(); ++iter)
+    {
+        if ((*iter)->id.ucid == ucid && (*iter)->id.seqnum == seqnum)
+        {
+            resumedRequest = *iter;
+            narbRequests.erase(iter);
+            return;
+        }
+    }
+    // the query was dropped, resume as if NARB had gone away
+    resumedRequest = new NarbRequest(ucid, seqnum);
+    resumedRequest->answered = true;
+}
+
+bool NARB_APIClient::resumedRequestExpired()
+{
+    return resumedRequest && resumedRequest->expired;
+}
+
+void NARB_APIClient::clearResumedRequest()
+{
+    if (resumedRequest)
+    {
+        delete resumedRequest;
+        resumedRequest = NULL;
     }
+}
+
+EXPLICIT_ROUTE_Object* NARB_APIClient::parseExplicitRoute(const char* body, int length, uint32 src, uint32 dest,
+	uint32& vtag, uint32& srcLocalId, uint32& destLocalId)
+{
+    EXPLICIT_ROUTE_Object* ero = NULL;
+    te_tlv_header *tlv = (te_tlv_header*)body;
+    int len, offset;
+    ipv4_prefix_subobj* subobj_ipv4;
+    unum_if_subobj* subobj_unum;
 
     //parse NARB reply
-    if (ntohs(tlv->type) != 3) // 3 == TLV_TYPE_NARB_ERO
-        goto _RETURN;
+    if (!body || length < (int)sizeof(struct te_tlv_header) || ntohs(tlv->type) != 3) // 3 == TLV_TYPE_NARB_ERO
+        return NULL;
 
     ero = new EXPLICIT_ROUTE_Object;
     len = ntohs(tlv->length) ;
-    assert( len > 0);
+    if (len > length - (int)sizeof(struct te_tlv_header))
+        len = length - sizeof(struct te_tlv_header);
     offset = sizeof(struct te_tlv_header);
 
     subobj_ipv4  = (ipv4_prefix_subobj *)((char *)tlv + offset);
-    while (len > 0)
+    while (len >= (int)sizeof(ipv4_prefix_subobj))
     {
         if ((subobj_ipv4->l_and_type & 0x7f) == 4) //UnNumInterface
             subobj_unum = (unum_if_subobj *)((char *)tlv + offset);
@@ -467,6 +523,8 @@ EXPLICIT_ROUTE_Object* NARB_APIClient::getExplicitRoute(uint32 src, uint32 dest,
 
         if (subobj_unum)
         {
+            if (len < (int)sizeof(unum_if_subobj))
+                break;
             AbstractNode node(((subobj_unum->l_and_type>>7) == 1), NetAddress(subobj_unum->addr.s_addr), (uint32)ntohl(subobj_unum->ifid));
       	     ero->pushBack(node);
             len -= sizeof(unum_if_subobj);
@@ -520,14 +578,15 @@ EXPLICIT_ROUTE_Object* NARB_APIClient::getExplicitRoute(uint32 src, uint32 dest,
         }
     }
     
-_RETURN:
-    deleteNarbApiMessage(msgheader);
     return ero;
 }
 
-EXPLICIT_ROUTE_Object* NARB_APIClient::getExplicitRoute(const Message& msg, bool hasReceivedEro, void* ss_ptr)
+// Returns the ERO from the cache or from the reply to an earlier query. If
+// a query has been sent instead, NULL is returned and 'query' identifies it.
+EXPLICIT_ROUTE_Object* NARB_APIClient::getExplicitRoute(const Message& msg, bool hasReceivedEro, void* ss_ptr, narb_query_id& query)
 {
     uint32 srcAddr = 0, destAddr = 0, srcLocalId = 0, destLocalId = 0, vtag = 0, hopBackAddr = 0;
+    query.ucid = query.seqnum = 0;
     DRAGON_UNI_Object* uni = ((Message*)&msg)->getDRAGON_UNI_Object();
     DRAGON_EXT_INFO_Object* dragonExtInfo = ((Message*)&msg)->getDRAGON_EXT_INFO_Object();
 
@@ -598,10 +657,25 @@ EXPLICIT_ROUTE_Object* NARB_APIClient::getExplicitRoute(const Message& msg, bool
                 hopBackAddr = headNode.getAddress().rawAddress();
         }
 
-        ero = getExplicitRoute(srcAddr, destAddr, msg.getLABEL_REQUEST_Object().getSwitchingType(), 
-                msg.getLABEL_REQUEST_Object().getLspEncodingType(), 
-                msg.getSENDER_TSPEC_Object().get_r(),
-                vtag, srcLocalId, destLocalId, hopBackAddr, excl_options, ucid, seqnum);
+        if (!resumedRequest)
+        {
+            if (requestExplicitRoute(srcAddr, destAddr, msg.getLABEL_REQUEST_Object().getSwitchingType(), 
+                    msg.getLABEL_REQUEST_Object().getLspEncodingType(), 
+                    msg.getSENDER_TSPEC_Object().get_r(),
+                    vtag, hopBackAddr, excl_options, ucid, seqnum))
+            {
+                query.ucid = ucid;
+                query.seqnum = seqnum;
+            }
+            return NULL;
+        }
+
+        // processing the message again after the reply has arrived: the
+        // reply belongs to the query as it was sent
+        ucid = resumedRequest->id.ucid;
+        seqnum = resumedRequest->id.seqnum;
+        ero = parseExplicitRoute(resumedRequest->reply, resumedRequest->replyLength, srcAddr, destAddr, vtag, srcLocalId, destLocalId);
+        clearResumedRequest();
 	 if (ero) {
             if (uni && uni->getVlanTag().vtag == ANY_VTAG)
             {
@@ -622,13 +696,14 @@ EXPLICIT_ROUTE_Object* NARB_APIClient::getExplicitRoute(const Message& msg, bool
             entry->index.lsp_id = (uint32)msg.getSENDER_TEMPLATE_Object().getLspId();
             entry->index.bw = (float)((const TSpec &)msg.getSENDER_TSPEC_Object()).get_r();
             entry->session_ptr = ss_ptr;
+            entry->client = this;
             //$$$$ setting entry->qconf_id
             if (ucid != 0 && ucid != srcAddr || (NARB_APIClient::extra_options & (0x0200 << 16)) != 0)
             {
                 entry->qconf_id.ucid = ucid;
                 entry->qconf_id.seqnum = seqnum;
             }
-            eroSearchList.push_back(entry);
+            insertEntry(entry);
 	 }
 	 else
 	 	return NULL;
@@ -670,12 +745,11 @@ EXPLICIT_ROUTE_Object* NARB_APIClient::lookupExplicitRoute(uint32 dest_addr, uin
     target.index.dest_addr = dest_addr;
     target.index.tunnel_id = tunnel_id;
     target.index.ext_tunnel_id = ext_tunnel_id;
-    target.session_ptr = session_ptr;
 
-    EroSearchList::Iterator iter = eroSearchList.begin();
-    for ( ; iter != eroSearchList.end(); ++iter)
+    EroSearchHash::HashBucket::Iterator iter = eroSearchHash.lower_bound(&target);
+    for ( ; iter != eroSearchHash.getHashBucket(&target).end() && memcmp(&(*iter)->index, &target.index, 12) == 0; ++iter)
     {
-        if (*(*iter) == target)
+        if ((*iter)->client == this && (session_ptr == NULL || (*iter)->session_ptr == NULL || (*iter)->session_ptr == session_ptr))
             return (*iter)->ero;
     }
 
@@ -684,16 +758,51 @@ EXPLICIT_ROUTE_Object* NARB_APIClient::lookupExplicitRoute(uint32 dest_addr, uin
 
 struct ero_search_entry* NARB_APIClient::lookupEntry(EXPLICIT_ROUTE_Object* ero)
 {
-    EroSearchList::Iterator iter = eroSearchList.begin();
-    for ( ; iter != eroSearchList.end(); ++iter)
-    {
-        if ((*iter)->ero == ero)
-            return (*iter);
-    }
+    struct ero_search_entry target;
+    memset(&target, 0, sizeof(struct ero_search_entry));
+    target.ero = ero;
+
+    EroPointerHash::HashBucket::Iterator iter = eroPointerHash.find(&target);
+    if (iter != eroPointerHash.getHashBucket(&target).end() && (*iter)->client == this)
+        return (*iter);
 
     return NULL;
 }
 
+void NARB_APIClient::insertEntry(struct ero_search_entry* entry)
+{
+    eroSearchHash.insert_sorted(entry);
+    eroPointerHash.insert_sorted(entry);
+    eroSearchList.push_back(entry);
+}
+
+// unindex and free an entry of this client, together with its ERO
+void NARB_APIClient::deleteEntry(struct ero_search_entry* entry)
+{
+    EroSearchHash::HashBucket::Iterator iter = eroSearchHash.lower_bound(entry);
+    for ( ; iter != eroSearchHash.getHashBucket(entry).end(); ++iter)
+    {
+        if (*iter == entry) {
+            eroSearchHash.erase(iter);
+            break;
+        }
+    }
+    iter = eroPointerHash.find(entry);
+    if (iter != eroPointerHash.getHashBucket(entry).end())
+        eroPointerHash.erase(iter);
+    EroSearchList::Iterator listIter = eroSearchList.begin();
+    for ( ; listIter != eroSearchList.end(); ++listIter)
+    {
+        if (*listIter == entry) {
+            eroSearchList.erase(listIter);
+            break;
+        }
+    }
+    if (entry->ero)
+        entry->ero->destroy();
+    delete entry;
+}
+
 uint32 NARB_APIClient::getVtagFromERO(EXPLICIT_ROUTE_Object* ero)
 {
     if (!ero)
@@ -717,12 +826,11 @@ void NARB_APIClient::removeExplicitRoute(uint32 dest_addr, uint32 tunnel_id, uin
     //target.index.src_addr = src_addr;
     //target.index.lsp_id = lsp_id;
 
-    EroSearchList::Iterator iter = eroSearchList.begin();
-    for ( ; iter != eroSearchList.end(); ++iter)
+    EroSearchHash::HashBucket::Iterator iter = eroSearchHash.lower_bound(&target);
+    for ( ; iter != eroSearchHash.getHashBucket(&target).end() && memcmp(&(*iter)->index, &target.index, 12) == 0; ++iter)
     {
-        if (*(*iter) == target) {
-            (*iter)->ero->destroy();
-            eroSearchList.erase(iter);
+        if ((*iter)->client == this) {
+            deleteEntry(*iter);
             return;
       	}
     }
@@ -730,15 +838,9 @@ void NARB_APIClient::removeExplicitRoute(uint32 dest_addr, uint32 tunnel_id, uin
 
 void NARB_APIClient::removeExplicitRoute(EXPLICIT_ROUTE_Object* ero)
 {
-    EroSearchList::Iterator iter = eroSearchList.begin();
-    for ( ; iter != eroSearchList.end(); ++iter)
-    {
-        if ((*iter)->ero == ero) {
-            (*iter)->ero->destroy();
-            eroSearchList.erase(iter);
-            return;
-      	}
-    }
+    struct ero_search_entry* entry = lookupEntry(ero);
+    if (entry)
+        deleteEntry(entry);
 }
 
 void NARB_APIClient::confirmReservation(const Message& msg)
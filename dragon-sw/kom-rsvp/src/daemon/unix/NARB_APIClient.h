@@ -9,6 +9,9 @@ To be incorporated into KOM-RSVP-TE package
 #ifndef _NARB_APICLIENT_H_
 #define _NARB_APICLIENT_H_
 
+#include "RSVP_SortableHash.h"
+#include "RSVP_TimeValue.h"
+
 //App-NARB API message types
 #define MSG_APP_REQUEST 0x0001
 #define DMSG_CLI_TO_NARB_BASE			0x01	/* 0x01 -- 0x1F */
@@ -105,6 +108,7 @@ enum  narb_tlv_type
 #define ANY_TIMESLOT 0xff
 
 class EXPLICIT_ROUTE_Object;
+class NARB_APIClient;
 
 struct ero_search_entry
 {
@@ -121,6 +125,7 @@ struct ero_search_entry
 		uint32 seqnum;
 	} qconf_id;
 	void * session_ptr;
+	NARB_APIClient* client; // owner of the entry
 	EXPLICIT_ROUTE_Object *ero;
 };
 extern inline bool operator== (struct ero_search_entry& a, struct ero_search_entry& b)
@@ -141,6 +146,76 @@ extern inline bool operator!= (struct ero_search_entry& a, struct ero_search_ent
 typedef SimpleList<struct ero_search_entry*> EroSearchList;
 typedef SimpleList<uint32> UsedVtagList;
 
+// The ERO cache is shared by all clients and indexed twice: by
+// (dest_addr, tunnel_id, ext_tunnel_id) for lookupExplicitRoute() and by
+// the cached ERO for lookupEntry() and removeExplicitRoute().
+struct EroSearchLess {
+	bool operator()( const ero_search_entry* a, const ero_search_entry* b ) const {
+		return memcmp(&a->index, &b->index, 12) < 0;
+	}
+};
+struct GetEroSearchHash {
+	unsigned int operator()( const ero_search_entry* e, unsigned int hashCount ) const {
+		return (e->index.dest_addr ^ e->index.tunnel_id ^ e->index.ext_tunnel_id) % hashCount;
+	}
+};
+struct EroPointerLess {
+	bool operator()( const ero_search_entry* a, const ero_search_entry* b ) const {
+		return a->ero < b->ero;
+	}
+};
+struct GetEroPointerHash {
+	unsigned int operator()( const ero_search_entry* e, unsigned int hashCount ) const {
+		return ((unsigned long)e->ero >> 4) % hashCount;
+	}
+};
+typedef SortableHash<ero_search_entry*,ero_search_entry*,EroSearchLess,GetEroSearchHash> EroSearchHash;
+typedef SortableHash<ero_search_entry*,ero_search_entry*,EroPointerLess,GetEroPointerHash> EroPointerHash;
+
+// (ucid, seqnum) of an ERO query, NARB echoes it in the header of its reply
+struct narb_query_id
+{
+	uint32 ucid;
+	uint32 seqnum;
+};
+
+// ERO query that has been sent to NARB but whose reply has not been picked
+// up yet; 'reply' stays NULL if the connection went away before the answer
+// or NARB did not answer in time ('expired')
+class NarbRequest {
+	narb_query_id id;
+	bool answered;
+	bool expired;
+	char* reply;		// message body following the API header
+	int replyLength;
+	TimeValue sent;
+	NarbRequest( uint32 ucid, uint32 seqnum ) : answered(false), expired(false), reply(NULL), replyLength(0) {
+		id.ucid = ucid; id.seqnum = seqnum;
+		getCurrentSystemTime( sent );
+	}
+	~NarbRequest() { if (reply) delete [] reply; }
+	friend class NARB_APIClient;
+};
+typedef SimpleList<NarbRequest*> NarbRequestList;
+
+/****************************************************************************
+
+Notes:
+1. All clients share one connection to NARB. It is kept open and registered
+    with the RSVP main loop, which calls readReplies() when it is readable.
+2. Queries do not wait for NARB: getExplicitRoute() sends the query, returns
+    NULL and sets 'query', the PATH message is deferred until the reply has
+    arrived and then processed again (see MessageProcessor::queryEnqueuedMessages),
+    this time finding the reply through resumeRequest().
+3. Several queries can be outstanding, replies are matched by (ucid, seqnum).
+    Messages that do not answer an outstanding query (e.g., acknowledgements
+    of confirmations and releases) are discarded.
+4. A query that NARB has not answered within narbReplyTimeout seconds expires,
+    its PATH message is resumed and answered with a PathErr. While NARB is
+    down, connecting is tried at most every narbReconnectInterval seconds.
+
+****************************************************************************/
+
 class Message;
 class NARB_APIClient{
 public:
@@ -148,14 +223,19 @@ public:
 	NARB_APIClient(const char *host, int port) { _host = host; _port = port; Init(); }
 	~NARB_APIClient();
 	void Init() {
-		fd = -1; lastState = 0;
+		lastState = 0;
 	}
-	int doConnect(char *host, int port);
-	int doConnect();
-	void disconnect();
-	bool active();
-	EXPLICIT_ROUTE_Object* getExplicitRoute(uint32 src, uint32 dest, uint8 swtype, uint8 encoding, float bandwidth, uint32& vtag, uint32& srcLclId, uint32& destLclId, uint32 hopBackAddr, uint32 excl_options, uint32 ucid, uint32 seqnum);
-	EXPLICIT_ROUTE_Object* getExplicitRoute(const Message& msg, bool hasReceivedEro, void* ss_ptr = NULL);
+	static int doConnect(char *host, int port);
+	static int doConnect();
+	static void disconnect();
+	static bool active();
+	// asynchronous queries, see Notes above
+	static void readReplies();
+	static bool replyArrived(uint32 ucid, uint32 seqnum);
+	static void resumeRequest(uint32 ucid, uint32 seqnum);
+	static void clearResumedRequest();
+	static bool resumedRequestExpired();
+	EXPLICIT_ROUTE_Object* getExplicitRoute(const Message& msg, bool hasReceivedEro, void* ss_ptr, narb_query_id& query);
 	//EXPLICIT_ROUTE_Object* lookupExplicitRoute(uint32 src_addr, uint32 dest_addr, uint32 lsp_id, uint32 tunnel_id, uint32 ext_tunnel_id);
 	EXPLICIT_ROUTE_Object* lookupExplicitRoute(uint32 dest_addr, uint32 tunnel_id, uint32 ext_tunnel_id, void* session_ptr = NULL);
 	struct ero_search_entry* lookupEntry(EXPLICIT_ROUTE_Object* ero);
@@ -183,9 +263,26 @@ public:
 
 
 private:
-	int fd;
+	static int fd;
+	static const sint32 narbReplyTimeout = 10;
+	static const sint32 narbReconnectInterval = 10;
+	static TimeValue nextConnectAttempt;
+	static NarbRequestList narbRequests;
+	static NarbRequest* resumedRequest;
+	static const int readBufferSize = 4096;
+	static char readBuffer[readBufferSize];
+	static int readLength;
+	static bool connectNarb();
+	static bool requestExplicitRoute(uint32 src, uint32 dest, uint8 swtype, uint8 encoding, float bandwidth, uint32 vtag, uint32 hopBackAddr, uint32 excl_options, uint32 ucid, uint32 seqnum);
+	static EXPLICIT_ROUTE_Object* parseExplicitRoute(const char* body, int length, uint32 src, uint32 dest, uint32& vtag, uint32& srcLclId, uint32& destLclId);
+
+	static EroSearchHash eroSearchHash;
+	static EroPointerHash eroPointerHash;
+	void insertEntry(struct ero_search_entry* entry);
+	void deleteEntry(struct ero_search_entry* entry);
+
 	uint32 lastState; // last state == last processed message type ...
-	EroSearchList eroSearchList; 
+	EroSearchList eroSearchList; // entries owned by this client
 };
 
 #endif
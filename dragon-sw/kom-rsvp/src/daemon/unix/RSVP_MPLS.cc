@@ -8,8 +8,11 @@
 #include "RSVP_Session.h"
 #include "RSVP_Message.h"
 #include "RSVP_MessageProcessor.h"
+#include "RSVP_ProcessingStats.h"
 #include "RSVP_Global.h"
 #include "SwitchCtrl_Global.h"
+#include "SwitchCtrl_Worker.h"
+#include <strings.h>                               // ffs
 //#include "SNMP_Session.h"
 //#include "CLI_Session.h"
 #if MPLS_REAL
@@ -61,19 +64,126 @@ const uint32 MPLS::maxLabel = (1 << 20) - 1;
 pid_t pid_verifySNCStateWorkingState = 1; //child process forked in in bindInAndOut
 //@@@@ Xi2008 <<
 
+MPLS_LabelAllocator::MPLS_LabelAllocator()
+: begin(0), size(0), mapSize(0), words(NULL), fullWords(NULL), next(0), usedCount(0), peakCount(0) {}
+
+MPLS_LabelAllocator::~MPLS_LabelAllocator() {
+    if (words) delete [] words;
+    if (fullWords) delete [] fullWords;
+}
+
+void MPLS_LabelAllocator::init(uint32 firstLabel, uint32 lastLabel, uint32 initialSize) {
+    begin = firstLabel;
+    size = (lastLabel >= firstLabel) ? lastLabel - firstLabel + 1 : 0;
+    resize(initialSize);
+}
+
+inline void MPLS_LabelAllocator::setBit(uint32 x) {
+    words[x / 32] |= 1U << (x % 32);
+    if (words[x / 32] == ~0U)
+        fullWords[x / 1024] |= 1U << ((x / 32) % 32);
+}
+
+inline void MPLS_LabelAllocator::clearBit(uint32 x) {
+    words[x / 32] &= ~(1U << (x % 32));
+    fullWords[x / 1024] &= ~(1U << ((x / 32) % 32));
+}
+
+// offset of the first free label at or after 'from', mapSize if there is none
+uint32 MPLS_LabelAllocator::findFree(uint32 from) const {
+    if (from >= mapSize)
+        return mapSize;
+    uint32 w = from / 32;
+    uint32 bits = ~words[w] & (~0U << (from % 32));
+    if (bits)
+        return w * 32 + ffs(bits) - 1;
+    uint32 wordCount = mapSize / 32;
+    for (w += 1; w < wordCount; ) {
+        uint32 notFull = ~fullWords[w / 32] & (~0U << (w % 32));
+        if (notFull) {
+            w = (w / 32) * 32 + ffs(notFull) - 1;
+            if (w >= wordCount)
+                break;
+            return w * 32 + ffs(~words[w]) - 1;
+        }
+        w = (w / 32 + 1) * 32;
+    }
+    return mapSize;
+}
+
+// let the map cover 'count' labels, rounded up to whole words and limited to
+// the label space; false if the map does not grow
+bool MPLS_LabelAllocator::resize(uint32 count) {
+    uint32 limit = (size + 31) & ~31U;
+    if (count < 32) count = 32;
+    count = (count + 31) & ~31U;
+    if (count > limit) count = limit;
+    if (count <= mapSize)
+        return false;
+    uint32 oldWordCount = mapSize / 32;
+    uint32 wordCount = count / 32;
+    uint32* newWords = new uint32[wordCount];
+    uint32* newFullWords = new uint32[(wordCount + 31) / 32];
+    initMemoryWithZero(newWords, sizeof (uint32) * wordCount);
+    initMemoryWithZero(newFullWords, sizeof (uint32) * ((wordCount + 31) / 32));
+    if (words) {
+        memcpy(newWords, words, sizeof (uint32) * oldWordCount);
+        memcpy(newFullWords, fullWords, sizeof (uint32) * ((oldWordCount + 31) / 32));
+        delete [] words;
+        delete [] fullWords;
+    }
+    words = newWords;
+    fullWords = newFullWords;
+    mapSize = count;
+    // the rest of the last word lies beyond the label space
+    uint32 x = size;
+    for (; x < mapSize; ++x)
+        setBit(x);
+    LOG(4)(Log::MPLS, "MPLS: label map covers", mapSize, "labels of", size);
+    return true;
+}
+
+uint32 MPLS_LabelAllocator::allocate() {
+    uint32 x = findFree(next);
+    if (x == mapSize)
+        x = findFree(0);
+    if (x == mapSize) {
+        uint32 oldMapSize = mapSize;
+        if (!resize(mapSize * 2))
+            return 0;
+        x = findFree(oldMapSize);
+        if (x == mapSize)
+            return 0;
+    }
+    setBit(x);
+    next = x + 1;
+    usedCount += 1;
+    if (usedCount > peakCount)
+        peakCount = usedCount;
+    return begin + x;
+}
+
+bool MPLS_LabelAllocator::release(uint32 label) {
+    if (label < begin || label - begin >= size || label - begin >= mapSize)
+        return false;
+    uint32 x = label - begin;
+    if ((words[x / 32] & (1U << (x % 32))) == 0)
+        return false;
+    clearBit(x);
+    usedCount -= 1;
+    return true;
+}
+
 MPLS::MPLS(uint32 num, uint32 begin, uint32 end)
-: labelSpaceNum(num), labelSpaceBegin(begin), labelSpaceEnd(end), currentLabel(0),
-numberOfAllocatedLabels(0), labelHash(NULL),
+: labelSpaceNum(num), labelSpaceBegin(begin), labelSpaceEnd(end),
 ingressClassifiers(filterHashSize) {
 
     if (labelSpaceBegin < minLabel) labelSpaceBegin = minLabel;
     if (!labelSpaceEnd) labelSpaceEnd = maxLabel;
-    currentLabel = labelSpaceBegin - 1;
 }
 
 bool MPLS::init() {
-    labelHash = new uint32[RSVP_Global::labelHashCount];
-    initMemoryWithZero(labelHash, sizeof (uint32) * RSVP_Global::labelHashCount);
+    labelAllocator.init(labelSpaceBegin, labelSpaceEnd, RSVP_Global::labelHashCount);
 #if defined(MPLS_WISCONSIN)
     netlink = CHECK(rtnl_open());
     int fd = CHECK(socket(AF_INET, SOCK_DGRAM, 0));
@@ -134,31 +244,25 @@ MPLS::~MPLS() {
     mpls_flush_all();
     mpls_cleanup();
 #endif
-
-    if (labelHash) delete [] labelHash;
 }
 
+// returns 0 if all labels of the label space are in use
 inline uint32 MPLS::allocateInLabel() {
-    if (numberOfAllocatedLabels >= RSVP_Global::labelHashCount) {
-        FATAL(4)(Log::Fatal, "FATAL ERROR: number of labels", numberOfAllocatedLabels, "has exceeded the hash container size", RSVP_Global::labelHashCount);
-        abortProcess();
+    uint32 label = labelAllocator.allocate();
+    if (label == 0) {
+        ERROR(3)(Log::Error, "MPLS: label space exhausted, labels in use:", labelAllocator.getUsedCount(), labelSpaceNum);
+        return 0;
     }
-    do {
-        currentLabel += 1;
-        if (currentLabel > labelSpaceEnd) currentLabel = labelSpaceBegin;
-    } while (labelHash[currentLabel % RSVP_Global::labelHashCount] != 0);
-    LOG(2)(Log::MPLS, "MPLS: allocated label", currentLabel);
-    numberOfAllocatedLabels += 1;
-    return currentLabel;
+    LOG(2)(Log::MPLS, "MPLS: allocated label", label);
+    return label;
     //return (uint32)1089538;  //port 1-1-10-2, just for current test, since we don't have any LMP nor do we have LabelSet from Movaz RE!
 }
 
 inline void MPLS::freeInLabel(uint32 label) {
     LOG(2)(Log::MPLS, "MPLS: freeing label", label);
-    numberOfAllocatedLabels -= 1;
-    if (numberOfAllocatedLabels >= RSVP_Global::labelHashCount)
-        numberOfAllocatedLabels = 0;
-    labelHash[label % RSVP_Global::labelHashCount] = 0;
+    if (!labelAllocator.release(label)) {
+        LOG(2)(Log::MPLS, "MPLS: label was not allocated", label);
+    }
 }
 
 inline MPLS_Classifier* MPLS::internCreateClassifier(const SESSION_Object& session, const SENDER_Object& sender, uint32 handle) {
@@ -221,8 +325,13 @@ const MPLS_InLabel* MPLS::setInLabel(PSB& psb) {
         inLabel = new MPLS_InLabel(psb.getSUGGESTED_LABEL_Object().getLabel());
     else if (psb.hasUPSTREAM_OUT_LABEL_Object()) //Make the best guess, just set the return label to be the same as the upstream label
         inLabel = new MPLS_InLabel(psb.getUPSTREAM_OUT_LABEL_Object().getLabel());
-    else
-        inLabel = new MPLS_InLabel(allocateInLabel());
+    else {
+        uint32 label = allocateInLabel();
+        if (label == 0)
+            return NULL;
+        inLabel = new MPLS_InLabel(label);
+        inLabel->allocated = true;
+    }
     inLabel->setLabelCType(psb.getLABEL_REQUEST_Object().getRequestedLabelType());
 
 #if defined(MPLS_WISCONSIN)
@@ -238,9 +347,779 @@ const MPLS_InLabel* MPLS::setInLabel(PSB& psb) {
     return inLabel;
 }
 
+//@@@@ switch control worker >>
+// VLSR hops are set up and torn down on the switch control worker (see
+// SwitchCtrl_Worker.h). Local-ids are resolved before a job is queued and the
+// OSPFd holds are applied after it has completed, both on the main loop.
+
+struct VLSR_Hop {
+    VLSR_Route route;
+    PortList inPorts; // Ethernet hops only
+    PortList outPorts;
+    bool portsKnown; // false: unrecognized port/localID, fails the setup
+    u_int32_t ucid, seqnum;
+    String lspName;
+};
+
+// return value false: unrecognized port/localID
+static bool getVLSRPorts(PSB& psb, uint32 port, bool ingress, PortList& portList) {
+    if ((port >> 16) == LOCAL_ID_TYPE_NONE)
+        portList.push_back(port);
+    else if ((port >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL)
+        portList.push_back(port & 0xffff);
+    else {
+        DRAGON_UNI_Object* uni = (DRAGON_UNI_Object*) psb.getDRAGON_UNI_Object();
+        if (ingress && uni && uni->getSrcTNA().local_id == UNI_AUTO_TAGGED_LCLID)
+            port = RSVP_Global::rsvp->getLocalIdByIfName((char*) uni->getIngressCtrlChannel().name);
+        else if (!ingress && uni && uni->getDestTNA().local_id == UNI_AUTO_TAGGED_LCLID)
+            port = RSVP_Global::rsvp->getLocalIdByIfName((char*) uni->getEgressCtrlChannel().name);
+        SwitchCtrl_Global::getPortsByLocalId(portList, port);
+    }
+    if (port == ((LOCAL_ID_TYPE_TAGGED_GROUP << 16) | 0)) //NULL local-ID
+    {
+        portList.clear();
+    } else if (portList.size() == 0) {
+        LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
+                (ingress ? "VLSR: Unrecognized port/localID at ingress: " : "VLSR: Unrecognized port/localID at egress: "), port);
+        return false;
+    }
+    return true;
+}
+
+// no egress ports, if in and out are the same tagged group
+static bool hasVLSREgressPorts(const VLSR_Route& route) {
+    return route.outPort != route.inPort
+            ||
+            !(((route.inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL || (route.inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP)
+            && ((route.outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL || (route.outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP)
+            && (route.inPort & 0xffff) == (route.outPort & 0xffff));
+}
+
+static inline bool isVLSRTaggedPort(uint32 port) {
+    return (port >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP || (port >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL;
+}
+
+// rate policing and limitation is only done for edge ports of port, group or tagged-group local-id types
+static inline bool isVLSREdgePort(uint32 port) {
+    return (port >> 16) == LOCAL_ID_TYPE_PORT || (port >> 16) == LOCAL_ID_TYPE_GROUP || (port >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP;
+}
+
+static void initVLSRHop(PSB& psb, const VLSR_Route& route, VLSR_Hop& hop) {
+    hop.route = route;
+    hop.lspName = psb.getSESSION_ATTRIBUTE_Object().getSessionName();
+    hop.portsKnown = true;
+    hop.ucid = hop.seqnum = 0;
+    if (psb.getDRAGON_EXT_INFO_Object() != NULL && ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->HasSubobj(DRAGON_EXT_SUBOBJ_SERVICE_CONF_ID)) {
+        hop.ucid = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().ucid;
+        hop.seqnum = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().seqnum;
+    }
+}
+
+static void initEthernetHop(PSB& psb, const VLSR_Route& route, VLSR_Hop& hop) {
+    initVLSRHop(psb, route, hop);
+    hop.portsKnown = getVLSRPorts(psb, route.inPort, true, hop.inPorts);
+    if (hasVLSREgressPorts(route) && !getVLSRPorts(psb, route.outPort, false, hop.outPorts))
+        hop.portsKnown = false;
+}
+
+static inline bool isSameVLSRHop(const VLSR_Route& r1, const VLSR_Route& r2) {
+    return r1.switchID == r2.switchID && r1.inPort == r2.inPort && r1.outPort == r2.outPort;
+}
+
+static bool hasVLSRHop(const VLSRRoute& route, const VLSR_Route& hop) {
+    VLSRRoute::ConstIterator iter = route.begin();
+    for (; iter != route.end(); ++iter) {
+        if (isSameVLSRHop(*iter, hop)) return true;
+    }
+    return false;
+}
+
+class VLSR_EthernetTeardownJob : public SwitchCtrl_Job {
+    VLSR_Hop hop;
+    bool releaseHolds; // false: the setup has not taken any
+    bool emptyCheckBypass;
+    PortList removedPorts;
+    void removePorts(const PortList& portList, uint32 localId, const char* side, uint32& vlanID);
+public:
+    VLSR_EthernetTeardownJob(SwitchCtrl_Session* session, bool releaseHolds) : SwitchCtrl_Job(session), releaseHolds(releaseHolds),
+            emptyCheckBypass(RSVP_Global::switchController->hasSwitchVlanOption(SW_VLAN_EMPTY_CHECK_BYPASS)) {}
+    VLSR_Hop& getHop() { return hop; }
+    virtual bool run();
+    virtual void complete(bool result);
+};
+
+void VLSR_EthernetTeardownJob::removePorts(const PortList& portList, uint32 localId, const char* side, uint32& vlanID) {
+    PortList::ConstIterator iter = portList.begin();
+    for (; iter != portList.end(); ++iter) {
+        uint32 port = *iter;
+        vlanID = hop.route.vlanTag;
+        if (vlanID == 0)
+            vlanID = getSession()->getActiveVlanId(port);
+        if (vlanID == 0) {
+            LOG(6)(Log::MPLS, "LSP=", hop.lspName, ": ", "VLSR: Cannot identify the VLAN to be operated for", side, "port.");
+            continue;
+        }
+        if (!getSession()->removePortFromVLAN(port, vlanID))
+            getSession()->invalidateVLANCache();
+        LOG(9)(Log::MPLS, "LSP=", hop.lspName, ": ", "VLSR: Removing", side, "port#", GetSwitchPortString(port), "from VLAN #", vlanID);
+        removedPorts.push_back(port);
+
+        //Undo rate policing and limitation on the port, which is both input and output port as the VLAN is duplex.
+        LOG(7)(Log::MPLS, "LSP=", hop.lspName, ": ", "VLSR: Undo bandwidth policing and limitation on port#", GetSwitchPortString(port), "for VLAN #", vlanID);
+        if (isVLSREdgePort(localId)) {
+            getSession()->policeInputBandwidth(false, port, hop.route.vlanTag, hop.route.bandwidth);
+            getSession()->limitOutputBandwidth(false, port, hop.route.vlanTag, hop.route.bandwidth); //$$$$ To be moved into deleteUpstreamInLabel
+        }
+    }
+}
+
+bool VLSR_EthernetTeardownJob::run() {
+    if (!getSession()->startTransaction())
+        return false;
+    uint32 vlanID = hop.route.vlanTag;
+    removePorts(hop.inPorts, hop.route.inPort, "ingress", vlanID);
+    removePorts(hop.outPorts, hop.route.outPort, "egress", vlanID);
+    if (emptyCheckBypass || getSession()->isVLANEmpty(vlanID)) {
+        if (!getSession()->removeVLAN(vlanID)) {
+            LOG(5)(Log::MPLS, "LSP=", hop.lspName, ": ", "VLSR: Failed to remove the empty VLAN: ", vlanID);
+            getSession()->invalidateVLANCache();
+        }
+        LOG(5)(Log::MPLS, "LSP=", hop.lspName, ": ", "VLSR: Removed the empty VLAN: ", vlanID);
+    }
+    getSession()->endTransaction();
+    return true;
+}
+
+void VLSR_EthernetTeardownJob::complete(bool result) {
+    if (!result) {
+        LOG(5)(Log::MPLS, "LSP=", hop.lspName, ": ", "VLSR: Cannot start a transaction on switch : ", hop.route.switchID);
+        return;
+    }
+    if (!releaseHolds)
+        return;
+    OspfHoldBatch holdBatch(RSVP_Global::rsvp->getRoutingService());
+    //increase the bandwidth by the amount taken by the removed LSP (on revserse link for bidirectional LSP only)
+    PortList::ConstIterator iter = removedPorts.begin();
+    for (; iter != removedPorts.end(); ++iter) {
+        RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF(*iter, hop.route.bandwidth, false, hop.ucid, hop.seqnum); //false == increase
+    }
+    if (hop.route.vlanTag != 0) {
+        //restore the VTAG that has been released from removing the VLAN.
+        if ((hop.route.inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL) //$$$$ To be moved into deleteUpstreamInLabel
+            RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF(hop.route.inPort & 0xffff, hop.route.vlanTag, false); //false == release
+        if ((hop.route.outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL)
+            RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF(hop.route.outPort & 0xffff, hop.route.vlanTag, false); //false == release
+    }
+}
+
+class VLSR_SetupJob;
+typedef SimpleList<VLSR_SetupJob*> VLSR_SetupJobList;
+
+// hops of one PSB that are being set up
+struct VLSR_Setup {
+    PSB* psb; // NULL once the PSB has been deleted
+    bool failed;
+    uint16 errorValue; // of the ResvErr, taken from the first hop that failed
+    bool verifyingSNC; // the RESV refresh waits for sigfunc_snc_stable
+    INetworkBuffer* resv; // RESV that is answered with a ResvErr if the setup fails
+    const LogicalInterface* resvLif;
+    VLSR_SetupJobList jobs; // not yet completed
+    VLSR_Setup(PSB* psb) : psb(psb), failed(false), errorValue(0), verifyingSNC(false),
+            resv(RSVP_Global::messageProcessor->copyCurrentResv()), resvLif(RSVP_Global::messageProcessor->getCurrentLif()) {}
+    ~VLSR_Setup() { if (resv) delete resv; }
+};
+
+typedef SimpleList<VLSR_Setup*> VLSR_SetupList;
+static VLSR_SetupList vlsrSetupList;
+
+static VLSR_Setup* findVLSRSetup(const PSB& psb) {
+    VLSR_SetupList::ConstIterator iter = vlsrSetupList.begin();
+    for (; iter != vlsrSetupList.end(); ++iter) {
+        if ((*iter)->psb == &psb) return *iter;
+    }
+    return NULL;
+}
+
+static void removeVLSRSetup(VLSR_Setup* setup) {
+    VLSR_SetupList::Iterator iter = vlsrSetupList.begin();
+    for (; *iter != setup; ++iter);
+    vlsrSetupList.erase(iter);
+    delete setup;
+}
+
+// sets up one hop of a VLSR_Setup
+class VLSR_SetupJob : public SwitchCtrl_Job {
+protected:
+    VLSR_Setup* setup;
+    VLSR_Hop hop;
+    VLSR_SetupJob(SwitchCtrl_Session* session, VLSR_Setup* setup) : SwitchCtrl_Job(session), setup(setup) {}
+    // main loop: returns the PSB of the setup, NULL if it has been deleted meanwhile
+    PSB* leaveSetup(bool result, uint16 errorValue);
+    // main loop: answers the RESV once the last hop has completed
+    void finishSetup();
+public:
+    VLSR_Hop& getHop() { return hop; }
+};
+
+PSB* VLSR_SetupJob::leaveSetup(bool result, uint16 errorValue) {
+    VLSR_SetupJobList::Iterator jobIter = setup->jobs.begin();
+    for (; *jobIter != this; ++jobIter);
+    setup->jobs.erase(jobIter);
+    if (!result && !setup->failed) {
+        setup->failed = true;
+        setup->errorValue = errorValue;
+    }
+    return setup->psb;
+}
+
+void VLSR_SetupJob::finishSetup() {
+    if (!setup->jobs.empty())
+        return;
+    PSB* psb = setup->psb;
+    if (psb && setup->failed) {
+        //$$$$ DRAGON specific
+        if (setup->resv)
+            RSVP_Global::messageProcessor->sendResvErrMessage(0, ERROR_SPEC_Object::Notify, setup->errorValue, *setup->resv, *setup->resvLif);
+        psb->setVLSRError(ERROR_SPEC_Object::Notify, setup->errorValue);
+    } else if (psb && !setup->verifyingSNC && psb->getVLSRError() == ((0xff << 8) | 0xff)) {
+        // RESV refresh has been held back by bindInAndOut until now
+        psb->setVLSRError(0, 0);
+        RSVP_Global::messageProcessor->resurrectResvRefresh(&psb->getSession(), psb->getPHopSB());
+    }
+    removeVLSRSetup(setup);
+}
+
+static VLSR_Setup* startVLSRSetup(PSB& psb, VLSR_Setup* setup) {
+    if (!setup) {
+        setup = new VLSR_Setup(&psb);
+        vlsrSetupList.push_back(setup);
+    }
+    return setup;
+}
+
+static void queueVLSRSetupJob(VLSR_Setup* setup, VLSR_SetupJob* job) {
+    setup->jobs.push_back(job);
+    SwitchCtrl_Worker::enqueue(job);
+}
+
+class VLSR_EthernetSetupJob : public VLSR_SetupJob {
+    uint32 vlan;
+    uint32 taggedPorts;
+    bool vlanReady; // ports have been moved to 'vlan'
+    void movePorts(const PortList& portList, uint32 localId, const char* side);
+public:
+    VLSR_EthernetSetupJob(SwitchCtrl_Session* session, VLSR_Setup* setup) : VLSR_SetupJob(session, setup),
+            vlan(0), taggedPorts(0), vlanReady(false) {}
+    virtual bool run();
+    virtual void complete(bool result);
+};
+
+void VLSR_EthernetSetupJob::movePorts(const PortList& portList, uint32 localId, const char* side) {
+    PortList::ConstIterator iter = portList.begin();
+    for (; iter != portList.end(); ++iter) {
+        uint32 port = *iter;
+        LOG(9)(Log::MPLS, "LSP=", hop.lspName, ": ", "VLSR: Moving", side, "port#", GetSwitchPortString(port), " to VLAN #", vlan);
+        bool moved;
+        if (isVLSRTaggedPort(localId)) {
+            moved = getSession()->movePortToVLANAsTagged(port, vlan);
+            //Up to 32 ports supported. Only default RFC2674 switch switch (e.g. Dell, Intel) use this.
+            taggedPorts |= (1 << (32 - port));
+        } else
+            moved = getSession()->movePortToVLANAsUntagged(port, vlan);
+        // the cached VLAN may or may not have been updated, the next LSP reads the switch again
+        if (!moved)
+            getSession()->invalidateVLANCache();
+
+        LOG(7)(Log::MPLS, "LSP=", hop.lspName, ": ",
+                "VLSR: Perform bidirectional bandwidth policing and limitation on port#", GetSwitchPortString(port), "for VLAN #", vlan);
+        //Perform rate policing and limitation on the port, which is both input and output port as the VLAN is duplex.
+        if (isVLSREdgePort(localId)) {
+            getSession()->policeInputBandwidth(true, port, vlan, hop.route.bandwidth);
+            getSession()->limitOutputBandwidth(true, port, vlan, hop.route.bandwidth); //$$$$ To be moved into bindUpstreamInAndOut
+        }
+    }
+}
+
+bool VLSR_EthernetSetupJob::run() {
+    const VLSR_Route& route = hop.route;
+    if (!getSession()->startTransaction()) {
+        LOG(5)(Log::MPLS, "LSP=", hop.lspName, ": ", "VLSR: Cannot start a transaction on switch : ", route.switchID);
+        return false;
+    }
+
+    if ((route.inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL || (route.outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL) {
+        vlan = route.vlanTag;
+    } else if ((route.inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP) {
+        vlan = route.inPort & 0xffff;
+    } else if ((route.outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP) {
+        vlan = route.outPort & 0xffff;
+    }        //source-destination local-id collocated case
+    else if (route.vlanTag != 0 && route.vlanTag != ANY_VTAG //$$$$ Or simply with this condition?
+            && (route.inPort >> 16) != LOCAL_ID_TYPE_NONE && (route.outPort >> 16) != LOCAL_ID_TYPE_NONE
+            && (route.inPort >> 16) != LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL
+            && (route.outPort >> 16) != LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL) {
+        vlan = route.vlanTag;
+    }        //port-to-port provisioning
+    else {
+        vlan = getSession()->findEmptyVLAN();
+    }
+
+    bool noError = true;
+    if (!getSession()->verifyVLAN(vlan)) {
+        LOG(8)(Log::MPLS, "LSP=", hop.lspName, ": ",
+                "VLSR: Cannot verify VLAN ID", vlan, "on Switch:", route.switchID, ">>> Creating a new VLAN...");
+        if (!getSession()->createVLAN(vlan)) {
+            LOG(8)(Log::MPLS, "LSP=", hop.lspName, ": ",
+                    "VLSR: Creating a new VLAN ID:", vlan, "on Switch:", route.switchID, " has failed!");
+            getSession()->invalidateVLANCache();
+            noError = false;
+        }
+    }
+
+    if (noError) {
+        vlanReady = true;
+        movePorts(hop.inPorts, route.inPort, "ingress");
+        movePorts(hop.outPorts, route.outPort, "egress");
+        if (taggedPorts != 0) {
+            //Set vlan ports to be "tagged"
+            //Only default RFC2674 switch switch (e.g. Dell, Intel) does something; Others simply return true.
+            getSession()->setVLANPortsTagged(taggedPorts, vlan);
+            LOG(7)(Log::MPLS, "LSP=", hop.lspName, ": ", "VLSR: Set tagged ports:", taggedPorts, " in VLAN #", vlan);
+        }
+    } else {
+        LOG(5)(Log::MPLS, "LSP=", hop.lspName, ": ", "VLSR: Cannot find an empty VLAN on switch : ", route.switchID);
+    }
+
+    if (!getSession()->endTransaction()) {
+        getSession()->invalidateVLANCache();
+        noError = false;
+    }
+
+    return noError && hop.portsKnown;
+}
+
+void VLSR_EthernetSetupJob::complete(bool result) {
+    PSB* psb = leaveSetup(result, ERROR_SPEC_Object::SwitchSessionFailed);
+    if (!psb) {
+        // the PSB has been deleted while the switch was being set up
+        if (vlanReady) {
+            LOG(5)(Log::MPLS, "LSP=", hop.lspName, ": ", "VLSR: Removing VLAN of deleted LSP : ", vlan);
+            VLSR_EthernetTeardownJob* teardown = new VLSR_EthernetTeardownJob(getSession(), false);
+            teardown->getHop() = hop;
+            teardown->getHop().route.vlanTag = vlan;
+            SwitchCtrl_Worker::enqueue(teardown);
+        }
+    } else {
+        VLSRRoute::Iterator iter = psb->getVLSR_Route().begin();
+        for (; vlan != 0 && iter != psb->getVLSR_Route().end(); ++iter) {
+            if (isSameVLSRHop(*iter, hop.route)) (*iter).vlanTag = vlan;
+        }
+    }
+    if (psb && vlanReady) {
+        OspfHoldBatch holdBatch(RSVP_Global::rsvp->getRoutingService());
+        //deduct bandwidth from the link associated with the port (revserse link bandwidth for bidirectional LSP only)
+        //$$$$ To be moved into bindUpstreamInAndOut
+        PortList::ConstIterator portIter = hop.inPorts.begin();
+        for (; portIter != hop.inPorts.end(); ++portIter) {
+            RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF(*portIter, hop.route.bandwidth, true, hop.ucid, hop.seqnum); //true == deduct
+        }
+        for (portIter = hop.outPorts.begin(); portIter != hop.outPorts.end(); ++portIter) {
+            RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF(*portIter, hop.route.bandwidth, true, hop.ucid, hop.seqnum); //true == deduct
+        }
+        if (taggedPorts != 0) {
+            //remove the VTAG that is taken by the LSP
+            if ((hop.route.inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL) //$$$$ To be moved into bindUpstreamInAndOut
+                RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF(hop.route.inPort & 0xffff, vlan, true); //true == hold
+            if ((hop.route.outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL)
+                RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF(hop.route.outPort & 0xffff, vlan, true); //true == hold
+        }
+    }
+
+    finishSetup();
+}
+
+// a child process that talks to a switch itself: the pooled CLI channels belong
+// to the parent and the CLI reads are interrupted by SIGALRM
+static void initSwitchCtrlChild() {
+    SwitchCtrl_Global::forgetCLIConnections();
+    sigset_t alarmMask;
+    sigemptyset(&alarmMask);
+    sigaddset(&alarmMask, SIGALRM);
+    sigprocmask(SIG_UNBLOCK, &alarmMask, NULL);
+}
+
+static void holdEdgeVtags(uint32 port, int vlanLow, int vlanTrunk, bool hold) {
+    if (vlanLow >= 0 && vlanLow <= MAX_VLAN || vlanLow == ANY_VTAG)
+        RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF(port, vlanLow, hold);
+    if (vlanLow > 0 && vlanLow <= MAX_VLAN && vlanTrunk > 0 && vlanTrunk <= MAX_VLAN && vlanTrunk != vlanLow)
+        RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF(port, vlanTrunk, hold);
+}
+
+// the subnet UNI port whose resources are held in OSPFd: ingress at the source,
+// egress at the destination, 0 if the hop has none
+static uint32 getSubnetUNIPort(SwitchCtrl_Session_SubnetUNI* session, const VLSR_Route& route) {
+    if (session->isSourceClient() && (route.inPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_SRC)
+        return route.inPort;
+    if (!session->isSourceClient() && (route.outPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_DEST)
+        return route.outPort;
+    return 0;
+}
+
+static int getSubnetUNIVlanLow(PSB& psb, SwitchCtrl_Session_SubnetUNI* session, const VLSR_Route& route) {
+    int vlanLow = 0;
+    if (psb.getDRAGON_EXT_INFO_Object()) {
+        if (!psb.getDRAGON_EXT_INFO_Object()->HasSubobj(DRAGON_EXT_SUBOBJ_EDGE_VLAN_MAPPING))
+            vlanLow = route.vlanTag;
+        else if (session->isSourceClient() && (route.inPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_SRC)
+            vlanLow = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getEdgeVlanMapping().ingress_outer_vlantag;
+        else if (!session->isSourceClient() && (route.outPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_DEST)
+            vlanLow = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getEdgeVlanMapping().egress_outer_vlantag;
+    }
+    return vlanLow;
+}
+
+static void holdSubnetUNIResources(uint32 port, const VLSR_Hop& hop, SimpleList<uint8>& ts_list, int vlanLow, int vlanTrunk, bool hold) {
+    // Update link bandwidth
+    RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF(port, hop.route.bandwidth, hold, hop.ucid, hop.seqnum);
+    // Update time slots
+    if (ts_list.size() > 0)
+        RSVP_Global::rsvp->getRoutingService().holdTimeslotsbyOSPF(port, ts_list, hold);
+    // Update vlan tag if applicable
+    holdEdgeVtags(port, vlanLow, vlanTrunk, hold);
+}
+
+// creates the VCG, GTP and SNC or CRS of a subnet UNI hop over TL1
+class VLSR_SubnetSetupJob : public VLSR_SetupJob {
+    int vlanLow, vlanTrunk;
+    bool sncCreated;
+    SimpleList<uint8> ts_list;
+    SwitchCtrl_Session_SubnetUNI* getSubnetSession() const { return (SwitchCtrl_Session_SubnetUNI*) getSession(); }
+    bool createObjects();
+    void verifySNC(PSB& psb);
+public:
+    VLSR_SubnetSetupJob(SwitchCtrl_Session_SubnetUNI* session, VLSR_Setup* setup, int vlanLow, int vlanTrunk)
+            : VLSR_SetupJob(session, setup), vlanLow(vlanLow), vlanTrunk(vlanTrunk), sncCreated(false) {}
+    virtual bool run();
+    virtual void complete(bool result);
+};
+
+bool VLSR_SubnetSetupJob::createObjects() {
+    SwitchCtrl_Session_SubnetUNI* session = getSubnetSession();
+    const VLSR_Route& route = hop.route;
+    if ((route.inPort >> 16) != LOCAL_ID_TYPE_SUBNET_UNI_SRC && (route.outPort >> 16) != LOCAL_ID_TYPE_SUBNET_UNI_DEST)
+        return true;
+
+    // $$$$ verifying instead of sync'ing timeslots (for inconsistency, check error messages in log)
+    if ((route.inPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_SRC && (route.inPort & 0xff) == ANY_TIMESLOT
+            || (route.outPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_DEST && (route.outPort & 0xff) == ANY_TIMESLOT) {
+        if (!session->syncTimeslotsMap())
+            return false;
+    } else if (!session->verifyTimeslotsMap())
+        return false;
+
+    //create VCG for LOCAL_ID_TYPE_SUBNET_UNI_SRC OR LOCAL_ID_TYPE_SUBNET_UNI_DEST
+    if (!session->createVCG(vlanLow, 0, vlanTrunk))
+        return false;
+
+    if (session->isSourceClient() && (route.inPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_SRC) {
+        //create source GTP
+        if (!session->createGTP())
+            return false;
+        if (session->isSourceDestSame()) {
+            //create CRS for Source == Destination
+            return session->createCRS();
+        }
+        //create SNC
+        sncCreated = session->createSNC();
+        return sncCreated;
+    } else if (!session->isSourceClient() && (route.outPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_DEST && session->isSourceDestSame()) {
+        //create destination GTP (only needed for local XConn)
+        return session->createGTP();
+    }
+    return true;
+}
+
+bool VLSR_SubnetSetupJob::run() {
+    //connect
+    if (!getSession()->connectSwitch()) {
+        LOG(5)(Log::MPLS, "LSP=", hop.lspName, ": ", "VLSR-Subnet Connect: Cannot connect to switch via TL1_TELNET: ", getSession()->getSwitchInetAddr());
+        return false;
+    }
+    bool noError = createObjects();
+    //disconnect
+    getSession()->disconnectSwitch();
+    getSubnetSession()->getTimeslots(ts_list);
+    return noError;
+}
+
+// $$$$ verifying SNC(s) are in stable working state
+void VLSR_SubnetSetupJob::verifySNC(PSB& psb) {
+    signal(SIGCHLD, SIG_IGN);
+    int slot_psb_to_verify = alloc_snc_stable_psb_slot(&psb);
+    switch (pid_verifySNCStateWorkingState = fork()) {
+        case 0: // child process for delayed waiting-and-deleting procedure
+            initSwitchCtrlChild();
+            if (!getSession()->connectSwitch()) {
+                LOG(5)(Log::MPLS, "LSP=", hop.lspName, ": ", "Child-Process:: Cannot connect to switch via TL1_TELNET: ", getSession()->getSwitchInetAddr());
+                exit(0);
+            }
+            if (!getSubnetSession()->hasSNCInStableWorkingState()) {
+                getSession()->disconnectSwitch();
+                //$$$$ DRAGON specific
+                if (setup->resv)
+                    RSVP_Global::messageProcessor->sendResvErrMessage(0, ERROR_SPEC_Object::Notify, ERROR_SPEC_Object::SubnetUNISessionFailed, *setup->resv, *setup->resvLif);
+                exit(0);
+            }
+            getSession()->disconnectSwitch();
+            kill(getppid(), SIG_SNC_STABLE_BASE + slot_psb_to_verify);
+            exit(0); // signaled the parent process and exit
+            break;
+        case -1: // error
+            LOG(4)(Log::MPLS, "LSP=", hop.lspName, ": ", "VLSR-Subnet Fatal Error: cannot fork a child process for the verifiing SNCInStableWorkingState procedure!");
+            exit(-1);
+            break;
+        default: // parent (orininal) process back to main logic loop
+            setup->verifyingSNC = true; // keeps resvRefresh turned off (no call to markForResvRefresh) for this session
+            signal(SIG_SNC_STABLE_BASE + slot_psb_to_verify, sigfunc_snc_stable);
+            break;
+    }
+}
+
+void VLSR_SubnetSetupJob::complete(bool result) {
+    PSB* psb = leaveSetup(result, ERROR_SPEC_Object::SubnetUNISessionFailed);
+    if (!result) {
+        LOG(4)(Log::MPLS, "LSP=", hop.lspName, ": setup -", "finished subnet control session with error!");
+    } else {
+        LOG(5)(Log::MPLS, "LSP=", hop.lspName, ": setup -", "finished subnet control session successfully with switch", getSession()->getSwitchInetAddr());
+        uint32 port = getSubnetUNIPort(getSubnetSession(), hop.route);
+        if (psb && port != 0) {
+            OspfHoldBatch holdBatch(RSVP_Global::rsvp->getRoutingService());
+            holdSubnetUNIResources(port, hop, ts_list, vlanLow, vlanTrunk, true); //true == hold
+            getSubnetSession()->setResourceHeld(true);
+        }
+        if (psb && sncCreated)
+            verifySNC(*psb);
+    }
+    finishSetup();
+}
+
+// deletes the SNC or CRS, GTP and VCG of a subnet UNI hop over TL1
+class VLSR_SubnetTeardownJob : public SwitchCtrl_Job {
+    VLSR_Hop hop;
+    int vlanLow, vlanTrunk;
+    bool connected;
+    SimpleList<uint8> ts_list;
+    SwitchCtrl_Session_SubnetUNI* getSubnetSession() const { return (SwitchCtrl_Session_SubnetUNI*) getSession(); }
+    bool deleteObjects();
+public:
+    VLSR_SubnetTeardownJob(SwitchCtrl_Session_SubnetUNI* session, int vlanLow, int vlanTrunk)
+            : SwitchCtrl_Job(session), vlanLow(vlanLow), vlanTrunk(vlanTrunk), connected(false) {}
+    VLSR_Hop& getHop() { return hop; }
+    virtual bool run();
+    virtual void complete(bool result);
+};
+
+bool VLSR_SubnetTeardownJob::deleteObjects() {
+    SwitchCtrl_Session_SubnetUNI* session = getSubnetSession();
+    const VLSR_Route& route = hop.route;
+    bool noErr = true;
+    if (session->isSourceClient() && (route.inPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_SRC) {
+        if (session->isSourceDestSame()) {
+            //delete CRS for Source == Destination
+            if (session->hasCRS()) {
+                noErr = session->deleteCRS() && noErr;
+                sleep(2); // making sure locks on depending objects (GTP) are released
+            }
+        } else {
+            //delete SNC
+            if (session->hasSNC())
+                noErr = session->deleteSNC() && noErr;
+        }
+
+        //delete GTP (for SNC: source only; for CRS: both source and dest interfaces)
+        if (session->hasGTP())
+            noErr = session->deleteGTP() && noErr;
+
+        //delete VCG for LOCAL_ID_TYPE_SUBNET_UNI_SRC
+        if (session->hasVCG())
+            noErr = session->deleteVCG() && noErr;
+    } else if (!session->isSourceClient() && (route.outPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_DEST) {
+        //delete GTP (for SNC: source only; for CRS: both source and dest interfaces)
+        if (session->isSourceDestSame() && session->hasGTP())
+            noErr = session->deleteGTP() && noErr;
+        if (!session->hasVCG())
+            return noErr;
+        //$$$$ Special handling to adjust the sequence of SNC-VCG-deletion at destination node.
+        if (!session->hasSystemSNCHolindgCurrentVCG(noErr) || !noErr) {
+            if (noErr)
+                session->deleteVCG();
+            return noErr;
+        }
+        session->disconnectSwitch();
+        signal(SIGCHLD, SIG_IGN);
+        switch (fork()) {
+            case 0: // child process for delayed waiting-and-deleting procedure
+                initSwitchCtrlChild();
+                if (!session->connectSwitch()) {
+                    LOG(5)(Log::MPLS, "LSP=", hop.lspName, ": ", "Child-Process:: Cannot connect to switch via TL1_TELNET: ", session->getSwitchInetAddr());
+                    exit(0);
+                }
+                if (session->waitUntilSystemSNCDisapear()) {
+                    session->deleteVCG();
+                }
+                session->disconnectSwitch();
+                exit(0);
+                break;
+            case -1: // error
+                LOG(4)(Log::MPLS, "LSP=", hop.lspName, ": ", "VLSR-Subnet Fatal Error: cannot fork a child process for the waiting-and-deleting procedure!");
+                exit(-1);
+                break;
+            default: // parent (orininal) process back to the switch control worker
+                break;
+        }
+    }
+    return noErr;
+}
+
+bool VLSR_SubnetTeardownJob::run() {
+    //connect
+    if (!getSession()->connectSwitch())
+        return false;
+    connected = true;
+    bool noErr = deleteObjects();
+    //disconnect
+    getSession()->disconnectSwitch();
+    getSubnetSession()->getTimeslots(ts_list);
+    return noErr;
+}
+
+void VLSR_SubnetTeardownJob::complete(bool result) {
+    SwitchCtrl_Session_SubnetUNI* session = getSubnetSession();
+    if (!connected) {
+        LOG(5)(Log::MPLS, "LSP=", hop.lspName, ": ", "VLSR-Subnet Connect: Cannot connect to switch via TL1_TELNET: ", session->getSwitchInetAddr());
+        return;
+    }
+    if (session->isSourceClient() && (hop.route.inPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_SRC && session->getUniState() != Message::InitAPI)
+        session->releaseRsvpPath();
+    uint32 port = getSubnetUNIPort(session, hop.route);
+    if (port != 0 && session->isResourceHeld()) {
+        OspfHoldBatch holdBatch(RSVP_Global::rsvp->getRoutingService());
+        holdSubnetUNIResources(port, hop, ts_list, vlanLow, vlanTrunk, false); //false == release
+    }
+    if (result) {
+        LOG(5)(Log::MPLS, "LSP=", hop.lspName, ": teardown -", "finished subnet control session successfully with switch", session->getSwitchInetAddr());
+    } else {
+        LOG(5)(Log::MPLS, "LSP=", hop.lspName, ": teardown -", "finished subnet control session with error on switch", session->getSwitchInetAddr());
+    }
+}
+
+static int getCN4200VlanLow(PSB& psb, SwitchCtrl_Session_CienaCN4200* session) {
+    int vlanLow = -1;
+    if (psb.getDRAGON_EXT_INFO_Object()) {
+        if (session->isIngressNode()) //translation (if any) occurs at ingress
+            vlanLow = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getEdgeVlanMapping().ingress_outer_vlantag;
+        else if (session->isEgressNode()) //translation (if any) occurs at egress
+            vlanLow = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getEdgeVlanMapping().egress_outer_vlantag;
+    }
+    return vlanLow;
+}
+
+static void holdCN4200Resources(SwitchCtrl_Session_CienaCN4200* session, const VLSR_Hop& hop, int vlanLow, int vlanTrunk, bool hold) {
+    //update ingress interface
+    RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF(hop.route.inPort, hop.route.bandwidth, hold, hop.ucid, hop.seqnum);
+    RSVP_Global::rsvp->getRoutingService().holdOTNXChannelsByOSPF(hop.route.inPort, session->getOPVCX(true), hold); //ingress or source
+    if (session->isIngressNode())
+        holdEdgeVtags(hop.route.inPort, vlanLow, vlanTrunk, hold);
+    //update egress interface
+    RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF(hop.route.outPort, hop.route.bandwidth, hold, hop.ucid, hop.seqnum);
+    RSVP_Global::rsvp->getRoutingService().holdOTNXChannelsByOSPF(hop.route.outPort, session->getOPVCX(false), hold); //egress or destination
+    if (session->isEgressNode())
+        holdEdgeVtags(hop.route.outPort, vlanLow, vlanTrunk, hold);
+}
+
+// CN4200 OTNX hops only log in and out so far (see @@@@ TODO TL1)
+static bool connectCN4200(SwitchCtrl_Session* session, const String& lspName) {
+    //connect
+    if (CLI_SESSION_TYPE != CLI_TL1_TELNET || !session->connectSwitch()) {
+        LOG(5)(Log::MPLS, "LSP=", lspName, ": ", "VLSR-CN4200 Connect: Cannot connect to switch via TL1_TELNET: ", session->getSwitchInetAddr());
+        return false;
+    }
+    //@@@@ TODO TL1 ...
+
+    //disconnect
+    session->disconnectSwitch();
+    return true;
+}
+
+class VLSR_CN4200SetupJob : public VLSR_SetupJob {
+    int vlanLow, vlanTrunk;
+    SwitchCtrl_Session_CienaCN4200* getCN4200Session() const { return (SwitchCtrl_Session_CienaCN4200*) getSession(); }
+public:
+    VLSR_CN4200SetupJob(SwitchCtrl_Session_CienaCN4200* session, VLSR_Setup* setup, int vlanLow, int vlanTrunk)
+            : VLSR_SetupJob(session, setup), vlanLow(vlanLow), vlanTrunk(vlanTrunk) {}
+    virtual bool run() { return connectCN4200(getSession(), hop.lspName); }
+    virtual void complete(bool result);
+};
+
+void VLSR_CN4200SetupJob::complete(bool result) {
+    PSB* psb = leaveSetup(result, ERROR_SPEC_Object::CienaOTNXSessionFailed);
+    if (!result) {
+        LOG(4)(Log::MPLS, "LSP=", hop.lspName, ": setup -", "finished CN4200 control session with error!");
+    } else {
+        if (psb) {
+            OspfHoldBatch holdBatch(RSVP_Global::rsvp->getRoutingService());
+            holdCN4200Resources(getCN4200Session(), hop, vlanLow, vlanTrunk, true); //true == hold
+            getCN4200Session()->setResourceHeld(true);
+        }
+        LOG(5)(Log::MPLS, "LSP=", hop.lspName, ": setup -", "finished CN4200 control session successfully with switch", getSession()->getSwitchInetAddr());
+    }
+    finishSetup();
+}
+
+class VLSR_CN4200TeardownJob : public SwitchCtrl_Job {
+    VLSR_Hop hop;
+    int vlanLow, vlanTrunk;
+    SwitchCtrl_Session_CienaCN4200* getCN4200Session() const { return (SwitchCtrl_Session_CienaCN4200*) getSession(); }
+public:
+    VLSR_CN4200TeardownJob(SwitchCtrl_Session_CienaCN4200* session, int vlanLow, int vlanTrunk)
+            : SwitchCtrl_Job(session), vlanLow(vlanLow), vlanTrunk(vlanTrunk) {}
+    VLSR_Hop& getHop() { return hop; }
+    virtual bool run() { return connectCN4200(getSession(), hop.lspName); }
+    virtual void complete(bool result);
+};
+
+void VLSR_CN4200TeardownJob::complete(bool result) {
+    if (!result)
+        return;
+    if (getCN4200Session()->isResourceHeld()) {
+        OspfHoldBatch holdBatch(RSVP_Global::rsvp->getRoutingService());
+        holdCN4200Resources(getCN4200Session(), hop, vlanLow, vlanTrunk, false); //false == release
+        getCN4200Session()->setResourceHeld(false);
+    }
+    LOG(5)(Log::MPLS, "LSP=", hop.lspName, ": teardown -", "finished CN4200 control session successfully with switch", getSession()->getSwitchInetAddr());
+}
+
+// moves the trunk port of a local-id that has been refreshed into the VLAN of the LSP
+class VLSR_AdjustJob : public SwitchCtrl_Job {
+    uint32 vlan, lclid, trunkPort;
+public:
+    VLSR_AdjustJob(SwitchCtrl_Session* session, uint32 vlan, uint32 lclid, uint32 trunkPort)
+            : SwitchCtrl_Job(session), vlan(vlan), lclid(lclid), trunkPort(trunkPort) {}
+    virtual bool run() { return getSession()->adjustVLANbyLocalId(vlan, lclid, trunkPort); }
+    virtual void complete(bool result) {
+        if (!result) {
+            LOG(4)(Log::MPLS, "VLSR: Failed to adjust VLAN #", vlan, "to local ID", lclid);
+        }
+    }
+};
+//@@@@ switch control worker <<
+
 bool MPLS::bindInAndOut(PSB& psb, const MPLS_InLabel& il, const MPLS_OutLabel& ol, const MPLS* inLabelSpace) {
+    ProcessingTimer timer(STATS_PROBE_BIND_IN_AND_OUT);
     if (!inLabelSpace) inLabelSpace = this;
     LOG(6)(Log::MPLS, "MPLS: binding outgoing label", ol.getLabel(), "to input label", il.getLabel(), "from label space", inLabelSpace->labelSpaceNum);
+    // resources held along the VLSR route are reported to OSPFd in one batch
+    OspfHoldBatch holdBatch(RSVP_Global::rsvp->getRoutingService());
 #if defined(MPLS_WISCONSIN)
     static struct mpls_xconnect_req mx_req;
     initMemoryWithZero(&mx_req, sizeof (mx_req));
@@ -261,6 +1140,10 @@ bool MPLS::bindInAndOut(PSB& psb, const MPLS_InLabel& il, const MPLS_OutLabel& o
     CHECK(mpls_add_switch_mapping(&sm));
 #endif
     if (!psb.getVLSR_Route().empty()) {
+        // the switches are still being set up from an earlier call
+        if (findVLSRSetup(psb))
+            return true;
+        VLSR_Setup* setup = NULL;
         VLSRRoute::ConstIterator iter = psb.getVLSR_Route().begin();
         for (; iter != psb.getVLSR_Route().end(); ++iter) {
             NetAddress ethSw = (*iter).switchID; // ethSw is the physical switch address only for non-subnet sessions
@@ -273,170 +1156,47 @@ bool MPLS::bindInAndOut(PSB& psb, const MPLS_InLabel& il, const MPLS_OutLabel& o
                             || !((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceClient() && ((*iter).switchID.rawAddress() & 0xffff) == (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->getPseudoSwitchID()& 0xffff)) {
 
                         SimpleList<uint8> ts_list;
-                        int vlanLow = -1, vlanTrunk = -1;
+                        SwitchCtrl_Session_SubnetUNI* subnetSession = (SwitchCtrl_Session_SubnetUNI*) (*sessionIter);
+                        uint32 port;
                         //UNI session error will fail the RSVP session
-                        switch (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->getUniState()) {
+                        switch (subnetSession->getUniState()) {
                             case Message::PathErr:
                             case Message::PathTear:
                             case Message::ResvErr:
                             case Message::ResvTear:
-                                LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: SubnetUNI session failed with message state : ", ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->getUniState());
+                                LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: SubnetUNI session failed with message state : ", subnetSession->getUniState());
                                 goto _Exit_Error_Subnet;
                                 break;
                             case Message::InitAPI: // inital state for TL1_TELNET only
                                 if (CLI_SESSION_TYPE == CLI_TL1_TELNET) {
-                                    LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": setup -", "starting subnet control session with switch", (*sessionIter)->getSwitchInetAddr());
+                                    LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": setup -", "starting subnet control session with switch", subnetSession->getSwitchInetAddr());
 
                                     //verify
-                                    if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->hasSourceDestPortConflict()) {
-                                        LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR-Subnet Control: hasSourceDestPortConflict() == True: cannot crossconnect from to to the same ETTP on ", (*sessionIter)->getSwitchInetAddr());
+                                    if (subnetSession->hasSourceDestPortConflict()) {
+                                        LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR-Subnet Control: hasSourceDestPortConflict() == True: cannot crossconnect from to to the same ETTP on ", subnetSession->getSwitchInetAddr());
                                         goto _Exit_Error_Subnet;
                                     }
 
-                                    //connect
-                                    if (!(*sessionIter)->connectSwitch()) {
-                                        LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR-Subnet Connect: Cannot connect to switch via TL1_TELNET: ", (*sessionIter)->getSwitchInetAddr());
-                                        goto _Exit_Error_Subnet;
-                                    }
-
-                                    if (((*iter).inPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_SRC || ((*iter).outPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_DEST) {
-                                        // $$$$ verifying instead of sync'ing timeslots (for inconsistency, check error messages in log)
-                                        //if ( !((SwitchCtrl_Session_SubnetUNI*)(*sessionIter))->syncTimeslotsMap() ) {
-                                        if (((*iter).inPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_SRC && ((*iter).inPort & 0xff) == ANY_TIMESLOT
-                                                || ((*iter).outPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_DEST && ((*iter).outPort & 0xff) == ANY_TIMESLOT) {
-                                            if (!((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->syncTimeslotsMap()) {
-                                                (*sessionIter)->disconnectSwitch();
-                                                goto _Exit_Error_Subnet;
-                                            }
-                                        } else {
-                                            if (!((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->verifyTimeslotsMap()) {
-                                                (*sessionIter)->disconnectSwitch();
-                                                goto _Exit_Error_Subnet;
-                                            }
-                                        }
-
-                                        //create VCG for LOCAL_ID_TYPE_SUBNET_UNI_SRC OR LOCAL_ID_TYPE_SUBNET_UNI_DEST
-                                        vlanLow = 0;
-                                        if (psb.getDRAGON_EXT_INFO_Object()) {
-                                            if (!psb.getDRAGON_EXT_INFO_Object()->HasSubobj(DRAGON_EXT_SUBOBJ_EDGE_VLAN_MAPPING))
-                                                vlanLow = (*iter).vlanTag;
-                                            else if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceClient() && ((*iter).inPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_SRC)
-                                                vlanLow = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getEdgeVlanMapping().ingress_outer_vlantag;
-                                            else if (!((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceClient() && ((*iter).outPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_DEST)
-                                                vlanLow = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getEdgeVlanMapping().egress_outer_vlantag;
-                                        }
-                                        vlanTrunk = (*iter).vlanTag;
-                                        if (!((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->createVCG(vlanLow, 0, vlanTrunk)) {
-                                            (*sessionIter)->disconnectSwitch();
-                                            goto _Exit_Error_Subnet;
-                                        }
-
-                                        if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceClient()
-                                                && ((*iter).inPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_SRC) {
-                                            //create source GTP 
-                                            if (!((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->createGTP()) {
-                                                (*sessionIter)->disconnectSwitch();
-                                                goto _Exit_Error_Subnet;
-                                            }
-                                            if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceDestSame()) {
-                                                //create CRS for Source == Destination
-                                                if (!((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->createCRS()) {
-                                                    (*sessionIter)->disconnectSwitch();
-                                                    goto _Exit_Error_Subnet;
-                                                }
-                                            } else {
-                                                //create SNC
-                                                if (!((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->createSNC()) {
-                                                    (*sessionIter)->disconnectSwitch();
-                                                    goto _Exit_Error_Subnet;
-                                                }
-
-                                                //$$$$ verifying SNC(s) are in stable working state
-                                                (*sessionIter)->disconnectSwitch();
-                                                signal(SIGCHLD, SIG_IGN);
-                                                int slot_psb_to_verify = alloc_snc_stable_psb_slot(&psb);
-                                                switch (pid_verifySNCStateWorkingState = fork()) {
-                                                    case 0: // child process for delayed waiting-and-deleting procedure
-                                                        if (!(*sessionIter)->connectSwitch()) {
-                                                            LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "Child-Process:: Cannot connect to switch via TL1_TELNET: ", (*sessionIter)->getSwitchInetAddr());
-                                                            return false;
-                                                        }
-                                                        if (!((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->hasSNCInStableWorkingState()) {
-                                                            (*sessionIter)->disconnectSwitch();
-                                                            goto _Exit_Error_Subnet;
-                                                        }
-                                                        (*sessionIter)->disconnectSwitch();
-                                                        kill(getppid(), SIG_SNC_STABLE_BASE + slot_psb_to_verify);
-                                                        exit(0); // signaled the parent process and exit
-                                                        //return true; // exit(0) --> later after a resvRefresh is done
-                                                        break;
-                                                    case -1: // error
-                                                        LOG(4)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR-Subnet Fatal Error: cannot fork a child process for the verifiing SNCInStableWorkingState procedure!");
-                                                        exit(-1);
-                                                        break;
-                                                    default: // parent (orininal) process back to main logic loop
-                                                        psb.setVLSRError(0xff, 0xff); // this will turn off resvRefresh (no call to markForResvRefresh) upon this RESV message for this session
-                                                        signal(SIG_SNC_STABLE_BASE + slot_psb_to_verify, sigfunc_snc_stable);
-                                                        break;
-                                                }
-                                            }
-                                        } else if (!((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceClient()
-                                                && ((*iter).outPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_DEST
-                                                && ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceDestSame()) {
-                                            //create destination GTP (only needed for local XConn)
-                                            if (!((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->createGTP()) {
-                                                (*sessionIter)->disconnectSwitch();
-                                                goto _Exit_Error_Subnet;
-                                            }
-                                        }
-                                    }
-                                    //disconnect
-                                    (*sessionIter)->disconnectSwitch();
-
-                                    LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": setup -", "finished subnet control session successfully with switch", (*sessionIter)->getSwitchInetAddr());
+                                    // the resources are held once the switch has been set up
+                                    setup = startVLSRSetup(psb, setup);
+                                    VLSR_SubnetSetupJob* job = new VLSR_SubnetSetupJob(subnetSession, setup, getSubnetUNIVlanLow(psb, subnetSession, *iter), (*iter).vlanTag);
+                                    initVLSRHop(psb, *iter, job->getHop());
+                                    queueVLSRSetupJob(setup, job);
+                                    noError = true;
+                                    break;
                                 }
 
                                 // NO break; continue to next case clauses !
 
                             case Message::Resv:
                             case Message::ResvConf:
-                                if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceClient() && ((*iter).inPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_SRC) {
-                                    // Update ingress link bandwidth
-                                    u_int32_t ucid = 0, seqnum = 0;
-                                    if (psb.getDRAGON_EXT_INFO_Object() != NULL && ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->HasSubobj(DRAGON_EXT_SUBOBJ_SERVICE_CONF_ID)) {
-                                        ucid = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().ucid;
-                                        seqnum = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().seqnum;
-                                    }
-                                    RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF((*iter).inPort, (*iter).bandwidth, true, ucid, seqnum); //true == decrease
-                                    // Update time slots
-                                    ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->getTimeslots(ts_list);
-                                    if (ts_list.size() > 0)
-                                        RSVP_Global::rsvp->getRoutingService().holdTimeslotsbyOSPF((*iter).inPort, ts_list, true);
-                                    // Update vlan tag if applicable
-                                    if (vlanLow >= 0 && vlanLow <= MAX_VLAN || vlanLow == ANY_VTAG)
-                                        RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).inPort, vlanLow, true); //tue == hold
-                                    if (vlanLow > 0 && vlanLow <= MAX_VLAN && vlanTrunk > 0 && vlanTrunk <= MAX_VLAN && vlanTrunk != vlanLow)
-                                        RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).inPort, vlanTrunk, true); //tue == hold
-                                    ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->setResourceHeld(true);
-                                }
-                                if (!((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceClient() && ((*iter).outPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_DEST) {
-                                    // Update egress link bandwidth
-                                    u_int32_t ucid = 0, seqnum = 0;
-                                    if (psb.getDRAGON_EXT_INFO_Object() != NULL && ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->HasSubobj(DRAGON_EXT_SUBOBJ_SERVICE_CONF_ID)) {
-                                        ucid = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().ucid;
-                                        seqnum = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().seqnum;
-                                    }
-                                    RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF((*iter).outPort, (*iter).bandwidth, true, ucid, seqnum); //true == decrease
-                                    // Update time slots
-                                    ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->getTimeslots(ts_list);
-                                    if (ts_list.size() > 0)
-                                        RSVP_Global::rsvp->getRoutingService().holdTimeslotsbyOSPF((*iter).outPort, ts_list, true);
-                                    // Update vlan tag if applicable
-                                    if (vlanLow >= 0 && vlanLow <= MAX_VLAN || vlanLow == ANY_VTAG)
-                                        RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).outPort, vlanLow, true); //tue == hold
-                                    if (vlanLow > 0 && vlanLow <= MAX_VLAN && vlanTrunk > 0 && vlanTrunk <= MAX_VLAN && vlanTrunk != vlanLow)
-                                        RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).outPort, vlanTrunk, true); //tue == hold
-                                    ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->setResourceHeld(true);
+                                port = getSubnetUNIPort(subnetSession, *iter);
+                                if (port != 0) {
+                                    VLSR_Hop hop;
+                                    initVLSRHop(psb, *iter, hop);
+                                    subnetSession->getTimeslots(ts_list);
+                                    holdSubnetUNIResources(port, hop, ts_list, -1, -1, true); //true == hold
+                                    subnetSession->setResourceHeld(true);
                                 }
                                 noError = true;
                                 break;
@@ -450,222 +1210,29 @@ bool MPLS::bindInAndOut(PSB& psb, const MPLS_InLabel& il, const MPLS_OutLabel& o
                 }
                     //Ciena CN4200 OTNX Session
                 else if (((*iter).inPort >> 16) == LOCAL_ID_TYPE_CIENA_OTNX && ((*iter).outPort >> 16) == LOCAL_ID_TYPE_CIENA_OTNX) {
-                    int vlanLow = -1, vlanTrunk = (*iter).vlanTag;
-                    LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": setup -", "starting CN4200 control session with switch", (*sessionIter)->getSwitchInetAddr());
+                    SwitchCtrl_Session_CienaCN4200* cn4200Session = (SwitchCtrl_Session_CienaCN4200*) (*sessionIter);
+                    LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": setup -", "starting CN4200 control session with switch", cn4200Session->getSwitchInetAddr());
                     //verify
-                    if (((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->hasSourceDestPortConflict()) {
-                        LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR-CN4200 Control: hasSourceDestPortConflict() == True: cannot crossconnect from to to the same ETTP on ", (*sessionIter)->getSwitchInetAddr());
-                        goto _Exit_Error_CN4200;
-                    }
-                    //connect
-                    if (CLI_SESSION_TYPE != CLI_TL1_TELNET || !(*sessionIter)->connectSwitch()) {
-                        LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR-CN4200 Connect: Cannot connect to switch via TL1_TELNET: ", (*sessionIter)->getSwitchInetAddr());
+                    if (cn4200Session->hasSourceDestPortConflict()) {
+                        LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR-CN4200 Control: hasSourceDestPortConflict() == True: cannot crossconnect from to to the same ETTP on ", cn4200Session->getSwitchInetAddr());
                         goto _Exit_Error_CN4200;
                     }
-                    //prepare VLAN
-                    if (psb.getDRAGON_EXT_INFO_Object()) {
-                        if (((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->isIngressNode()) //translation (if any) occurs at ingress
-                            vlanLow = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getEdgeVlanMapping().ingress_outer_vlantag;
-                        else if (((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->isEgressNode()) //translation (if any) occurs at egress
-                            vlanLow = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getEdgeVlanMapping().egress_outer_vlantag;
-                    }
-
-                    //@@@@ TODO TL1 ...
-
-                    //disconnect
-                    (*sessionIter)->disconnectSwitch();
-
-                    u_int32_t ucid = 0, seqnum = 0;
-                    if (psb.getDRAGON_EXT_INFO_Object() != NULL && ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->HasSubobj(DRAGON_EXT_SUBOBJ_SERVICE_CONF_ID)) {
-                        ucid = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().ucid;
-                        seqnum = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().seqnum;
-                    }
-                    //update ingress interface
-                    RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF((*iter).inPort, (*iter).bandwidth, true, ucid, seqnum); //true == decrease
-                    uint32 opvcx_range = ((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->getOPVCX(true); //ingress or source
-                    RSVP_Global::rsvp->getRoutingService().holdOTNXChannelsByOSPF((*iter).inPort, opvcx_range, true);
-                    if (((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->isIngressNode()) {
-                        // Update vlan tag if applicable
-                        if (vlanLow >= 0 && vlanLow <= MAX_VLAN || vlanLow == ANY_VTAG)
-                            RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).inPort, vlanLow, true); //tue == hold
-                        if (vlanLow > 0 && vlanLow <= MAX_VLAN && vlanTrunk > 0 && vlanTrunk <= MAX_VLAN && vlanTrunk != vlanLow)
-                            RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).inPort, vlanTrunk, true); //tue == hold
-                    }
-                    //update egress interface
-                    RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF((*iter).outPort, (*iter).bandwidth, true, ucid, seqnum); //true == decrease
-                    opvcx_range = ((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->getOPVCX(false); //egress or destination
-                    RSVP_Global::rsvp->getRoutingService().holdOTNXChannelsByOSPF((*iter).outPort, opvcx_range, true);
-                    if (((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->isEgressNode()) {
-                        // Update vlan tag if applicable
-                        if (vlanLow >= 0 && vlanLow <= MAX_VLAN || vlanLow == ANY_VTAG)
-                            RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).outPort, vlanLow, true); //tue == hold
-                        if (vlanLow > 0 && vlanLow <= MAX_VLAN && vlanTrunk > 0 && vlanTrunk <= MAX_VLAN && vlanTrunk != vlanLow)
-                            RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).outPort, vlanTrunk, true); //tue == hold
-                    }
-                    ((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->setResourceHeld(true);
 
+                    // the resources are held once the switch has been set up
+                    setup = startVLSRSetup(psb, setup);
+                    VLSR_CN4200SetupJob* job = new VLSR_CN4200SetupJob(cn4200Session, setup, getCN4200VlanLow(psb, cn4200Session), (*iter).vlanTag);
+                    initVLSRHop(psb, *iter, job->getHop());
+                    queueVLSRSetupJob(setup, job);
                     noError = true;
-                    LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": setup -", "finished CN4200 control session successfully with switch", (*sessionIter)->getSwitchInetAddr());
 
                     continue;
                 }                    //Ethernet switchCtrl Session 
-                else if ((*sessionIter)->getSwitchInetAddr() == ethSw && (*sessionIter)->isValidSession() && (noError = (*sessionIter)->startTransaction())) {
+                else if ((*sessionIter)->getSwitchInetAddr() == ethSw && (*sessionIter)->isValidSession()) {
+                    setup = startVLSRSetup(psb, setup);
+                    VLSR_EthernetSetupJob* job = new VLSR_EthernetSetupJob(*sessionIter, setup);
+                    initEthernetHop(psb, *iter, job->getHop());
+                    queueVLSRSetupJob(setup, job);
                     noError = true;
-                    uint32 vlan;
-
-                    if (((*iter).inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL || ((*iter).outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL) {
-                        vlan = (*iter).vlanTag;
-                    } else if (((*iter).inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP) {
-                        vlan = (*iter).inPort & 0xffff;
-                        (const_cast<_vlsr_route_&> (*iter)).vlanTag = vlan;
-                    } else if (((*iter).outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP) {
-                        vlan = (*iter).outPort & 0xffff;
-                        (const_cast<_vlsr_route_&> (*iter)).vlanTag = vlan;
-                    }                        //source-destination local-id collocated case
-                    else if ((*iter).vlanTag != 0 && (*iter).vlanTag != ANY_VTAG //$$$$ Or simply with this condition?
-                            && ((*iter).inPort >> 16) != LOCAL_ID_TYPE_NONE && ((*iter).outPort >> 16) != LOCAL_ID_TYPE_NONE
-                            && ((*iter).inPort >> 16) != LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL
-                            && ((*iter).outPort >> 16) != LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL) {
-                        vlan = (*iter).vlanTag;
-                    }                        //port-to-port provisioning
-                    else {
-                        vlan = (*sessionIter)->findEmptyVLAN();
-                        (const_cast<_vlsr_route_&> (*iter)).vlanTag = vlan;
-                    }
-
-                    if (!(*sessionIter)->verifyVLAN(vlan)) {
-                        LOG(8)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
-                                "VLSR: Cannot verify VLAN ID", vlan, "on Switch:", ethSw, ">>> Creating a new VLAN...");
-                        if (!(*sessionIter)->createVLAN(vlan)) {
-                            LOG(8)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
-                                    "VLSR: Creating a new VLAN ID:", vlan, "on Switch:", ethSw, " has failed!");
-                            noError = false;
-                        }
-                    }
-
-                    //if (vlan){
-                    if (noError) {
-                        PortList portList;
-                        uint32 inPort = (*iter).inPort;
-                        uint32 taggedPorts = 0;
-                        if ((inPort >> 16) == LOCAL_ID_TYPE_NONE)
-                            portList.push_back(inPort);
-                        else if ((inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL)
-                            portList.push_back(inPort & 0xffff);
-                        else {
-                            DRAGON_UNI_Object* uni = (DRAGON_UNI_Object*) psb.getDRAGON_UNI_Object();
-                            if (uni && uni->getSrcTNA().local_id == UNI_AUTO_TAGGED_LCLID)
-                                inPort = RSVP_Global::rsvp->getLocalIdByIfName((char*) uni->getIngressCtrlChannel().name);
-                            SwitchCtrl_Global::getPortsByLocalId(portList, inPort);
-                        }
-                        if (inPort == ((LOCAL_ID_TYPE_TAGGED_GROUP << 16) | 0)) //NULL local-ID
-                        {
-                            portList.clear();
-                        } else if (portList.size() == 0) {
-                            LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: Unrecognized port/localID at ingress: ", inPort);
-                            noError = false;
-                        }
-                        while (portList.size()) {
-                            uint32 port = portList.front(); //reuse the variable port
-                            LOG(7)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: Moving ingress port#", GetSwitchPortString(port), " to VLAN #", vlan);
-                            if (((*iter).inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP || ((*iter).inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL) {
-                                (*sessionIter)->movePortToVLANAsTagged(port, vlan);
-                                //Up to 32 ports supported. Only default RFC2674 switch switch (e.g. Dell, Intel) use this.
-                                taggedPorts |= (1 << (32 - port));
-                            } else
-                                (*sessionIter)->movePortToVLANAsUntagged(port, vlan);
-
-                            LOG(7)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
-                                    "VLSR: Perform bidirectional bandwidth policing and limitation on port#", GetSwitchPortString(port), "for VLAN #", vlan);
-                            //Perform rate policing and limitation on the port, which is both input and output port as the VLAN is duplex.
-                            //This operation is only done for edge ports of port, group or tagged-group local-id types.
-                            if (((*iter).inPort >> 16) == LOCAL_ID_TYPE_PORT || ((*iter).inPort >> 16) == LOCAL_ID_TYPE_GROUP || ((*iter).inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP ) {
-                                (*sessionIter)->policeInputBandwidth(true, port, vlan, (*iter).bandwidth);
-                                (*sessionIter)->limitOutputBandwidth(true, port, vlan, (*iter).bandwidth); //$$$$ To be moved into bindUpstreamInAndOut
-                            }
-                            //deduct bandwidth from the link associated with the port (revserse link bandwidth for bidirectional LSP only)
-                            //$$$$ To be moved into bindUpstreamInAndOut
-                            u_int32_t ucid = 0, seqnum = 0;
-                            if (psb.getDRAGON_EXT_INFO_Object() != NULL && ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->HasSubobj(DRAGON_EXT_SUBOBJ_SERVICE_CONF_ID)) {
-                                ucid = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().ucid;
-                                seqnum = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().seqnum;
-                            }
-                            RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF(port, (*iter).bandwidth, true, ucid, seqnum); //true == deduct
-                            portList.pop_front();
-                        }
-
-                        if ((*iter).outPort != (*iter).inPort
-                                ||
-                                !((((*iter).inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL || ((*iter).inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP)
-                                && (((*iter).outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL || ((*iter).outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP)
-                                && ((*iter).inPort & 0xffff) == ((*iter).outPort & 0xffff))) {
-                            portList.clear();
-                            uint32 outPort = (*iter).outPort;
-                            if ((outPort >> 16) == LOCAL_ID_TYPE_NONE)
-                                portList.push_back(outPort);
-                            else if ((outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL)
-                                portList.push_back(outPort & 0xffff);
-                            else {
-                                DRAGON_UNI_Object* uni = (DRAGON_UNI_Object*) psb.getDRAGON_UNI_Object();
-                                if (uni && uni->getDestTNA().local_id == UNI_AUTO_TAGGED_LCLID)
-                                    outPort = RSVP_Global::rsvp->getLocalIdByIfName((char*) uni->getEgressCtrlChannel().name);
-                                SwitchCtrl_Global::getPortsByLocalId(portList, outPort);
-                            }
-                            if (outPort == ((LOCAL_ID_TYPE_TAGGED_GROUP << 16) | 0)) //NULL local-ID
-                            {
-                                portList.clear();
-                            } else if (portList.size() == 0) {
-                                LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: Unrecognized port/localID at egress: ", outPort);
-                                noError = false;
-                            }
-                            while (portList.size()) {
-                                uint32 port = portList.front();
-                                LOG(7)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: Moving egress port#", GetSwitchPortString(port), " to VLAN #", vlan);
-                                if (((*iter).outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP || ((*iter).outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL) {
-                                    (*sessionIter)->movePortToVLANAsTagged(port, vlan);
-                                    //Up to 32 ports supported. Only default RFC2674 switch switch (e.g. Dell, Intel) use this.
-                                    taggedPorts |= (1 << (32 - port));
-                                } else
-                                    (*sessionIter)->movePortToVLANAsUntagged(port, vlan);
-
-                                LOG(7)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
-                                        "VLSR: Perform bidirectional bandwidth policing and limitation on port#", GetSwitchPortString(port), "for VLAN #", vlan);
-
-                                //Perform rate policing and limitation on the port, which is both input and output port as the VLAN is duplex.
-                                //This operation is only done for edge ports of port, group or tagged-group local-id types.
-                                if (((*iter).outPort >> 16) == LOCAL_ID_TYPE_PORT || ((*iter).outPort >> 16) == LOCAL_ID_TYPE_GROUP || ((*iter).outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP ) {
-                                    (*sessionIter)->policeInputBandwidth(true, port, vlan, (*iter).bandwidth); //$$$$ To be moved into bindUpstreamInAndOut
-                                    (*sessionIter)->limitOutputBandwidth(true, port, vlan, (*iter).bandwidth);
-                                }
-                                //deduct bandwidth from the link associated with the port
-                                u_int32_t ucid = 0, seqnum = 0;
-                                if (psb.getDRAGON_EXT_INFO_Object() != NULL && ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->HasSubobj(DRAGON_EXT_SUBOBJ_SERVICE_CONF_ID)) {
-                                    ucid = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().ucid;
-                                    seqnum = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().seqnum;
-                                }
-                                RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF(port, (*iter).bandwidth, true, ucid, seqnum); //true == deduct
-                                portList.pop_front();
-                            }
-                        }
-                        if (taggedPorts != 0) {
-                            //Set vlan ports to be "tagged" 
-                            //Only default RFC2674 switch switch (e.g. Dell, Intel) does something; Others simply return true.
-                            (*sessionIter)->setVLANPortsTagged(taggedPorts, vlan);
-                            //remove the VTAG that is taken by the LSP
-                            LOG(7)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: Set tagged ports:", taggedPorts, " in VLAN #", vlan);
-                            if (((*iter).inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL) //$$$$ To be moved into bindUpstreamInAndOut
-                                RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).inPort & 0xffff, (*iter).vlanTag, true); //true == hold
-                            if (((*iter).outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL)
-                                RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).outPort & 0xffff, (*iter).vlanTag, true); //true == hold
-                        }
-                    } else {
-                        noError = false;
-                        LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: Cannot find an empty VLAN on switch : ", ethSw);
-                    }
-
-                    if (!(*sessionIter)->endTransaction())
-                        noError = false;
-
                     break; // allowing up to ONE session for Ethernet switchCtrl VLSR
                 }
             }
@@ -674,6 +1241,10 @@ bool MPLS::bindInAndOut(PSB& psb, const MPLS_InLabel& il, const MPLS_OutLabel& o
                 goto _Exit_Error_Switch;
             }
         }
+        if (setup) {
+            // this will turn off resvRefresh (no call to markForResvRefresh) until the switches have been set up
+            psb.setVLSRError(0xff, 0xff);
+        }
     }
 
     return true;
@@ -708,15 +1279,10 @@ bool MPLS::refreshVLSRbyLocalId(PSB& psb, uint32 lclid) {
             SwitchCtrlSessionList::Iterator sessionIter = RSVP_Global::switchController->getSessionList().begin();
             for (; sessionIter != RSVP_Global::switchController->getSessionList().end(); ++sessionIter) {
                 if ((*sessionIter)->getSwitchInetAddr() == ethSw && (*sessionIter)->isValidSession()) {
-                    uint32 vlan;
-                    if ((*iter).inPort == lclid) {
-                        vlan = (*iter).vlanTag;
-                        (*sessionIter)->adjustVLANbyLocalId(vlan, lclid, ((*iter).outPort & 0xffff));
-                    }
-                    if ((*iter).outPort == lclid) {
-                        vlan = (*iter).vlanTag;
-                        (*sessionIter)->adjustVLANbyLocalId(vlan, lclid, ((*iter).inPort & 0xffff));
-                    }
+                    if ((*iter).inPort == lclid)
+                        SwitchCtrl_Worker::enqueue(new VLSR_AdjustJob(*sessionIter, (*iter).vlanTag, lclid, ((*iter).outPort & 0xffff)));
+                    if ((*iter).outPort == lclid)
+                        SwitchCtrl_Worker::enqueue(new VLSR_AdjustJob(*sessionIter, (*iter).vlanTag, lclid, ((*iter).inPort & 0xffff)));
                 }
             }
         }
@@ -789,6 +1355,8 @@ bool MPLS::createUpstreamEgressBinding(PSB& psb, const LogicalInterface& lif) {
 
 void MPLS::deleteInLabel(PSB& psb, const MPLS_InLabel* il) {
     LOG(2)(Log::MPLS, "MPLS: deleting input label", il->getLabel());
+    // resources released along the VLSR route are reported to OSPFd in one batch
+    OspfHoldBatch holdBatch(RSVP_Global::rsvp->getRoutingService());
 #if defined(MPLS_WISCONSIN)
     static struct mpls_in_label_req mil_req;
     initMemoryWithZero(&mil_req, sizeof (mil_req));
@@ -807,10 +1375,30 @@ void MPLS::deleteInLabel(PSB& psb, const MPLS_InLabel* il) {
         CHECK(mpls_del_switch_mapping(&cid));
     }
 #endif
-    freeInLabel(il->getLabel());
+    if (il->allocated)
+        freeInLabel(il->getLabel());
     delete il;
 
     if (!psb.getVLSR_Route().empty()) {
+        // jobs that have not been started are dropped. Ethernet hops that are
+        // still being set up are not torn down here, their jobs remove the
+        // VLAN when they complete; subnet and CN4200 teardowns run behind them
+        VLSRRoute pendingHops;
+        VLSR_Setup* setup = findVLSRSetup(psb);
+        if (setup) {
+            VLSR_SetupJobList::Iterator jobIter = setup->jobs.begin();
+            while (jobIter != setup->jobs.end()) {
+                pendingHops.push_back((*jobIter)->getHop().route);
+                if (SwitchCtrl_Worker::cancel(*jobIter))
+                    jobIter = setup->jobs.erase(jobIter);
+                else
+                    ++jobIter;
+            }
+            if (setup->jobs.empty())
+                removeVLSRSetup(setup);
+            else
+                setup->psb = NULL;
+        }
         VLSRRoute::ConstIterator iter = psb.getVLSR_Route().begin();
         for (; iter != psb.getVLSR_Route().end(); ++iter) {
             NetAddress ethSw = (*iter).switchID;
@@ -818,340 +1406,49 @@ void MPLS::deleteInLabel(PSB& psb, const MPLS_InLabel* il) {
             for (; sessionIter != RSVP_Global::switchController->getSessionList().end(); --sessionIter) {
                 //Subnet SwitchCtrl Session
                 if ((*sessionIter)->getSessionName().leftequal("subnet-uni")) {
-                    SimpleList<uint8> ts_list;
-                    int vlanLow = -1, vlanTrunk = -1;
-                    if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceClient() && ((*iter).switchID.rawAddress() >> 16) == (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->getPseudoSwitchID()& 0xffff)
-                            || !((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceClient() && ((*iter).switchID.rawAddress() & 0xffff) == (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->getPseudoSwitchID()& 0xffff)) {
+                    SwitchCtrl_Session_SubnetUNI* subnetSession = (SwitchCtrl_Session_SubnetUNI*) (*sessionIter);
+                    if (subnetSession->isSourceClient() && ((*iter).switchID.rawAddress() >> 16) == (subnetSession->getPseudoSwitchID()& 0xffff)
+                            || !subnetSession->isSourceClient() && ((*iter).switchID.rawAddress() & 0xffff) == (subnetSession->getPseudoSwitchID()& 0xffff)) {
 
                         if (CLI_SESSION_TYPE == CLI_TL1_TELNET) {
-                            bool noErr = true;
-
-                            LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": teardown -", "starting subnet control session with switch", (*sessionIter)->getSwitchInetAddr());
+                            LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": teardown -", "starting subnet control session with switch", subnetSession->getSwitchInetAddr());
 
                             //verify
-                            if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->hasSourceDestPortConflict()) {
-                                LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR-Subnet Control: hasSourceDestPortConflict() == True: cannot crossconnect from to to the same ETTP on ", (*sessionIter)->getSwitchInetAddr());
-                                return;
-                            }
-
-                            //connect
-                            if (!(*sessionIter)->connectSwitch()) {
-                                LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR-Subnet Connect: Cannot connect to switch via TL1_TELNET: ", (*sessionIter)->getSwitchInetAddr());
+                            if (subnetSession->hasSourceDestPortConflict()) {
+                                LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR-Subnet Control: hasSourceDestPortConflict() == True: cannot crossconnect from to to the same ETTP on ", subnetSession->getSwitchInetAddr());
                                 return;
                             }
 
-                            vlanLow = 0;
-                            if (psb.getDRAGON_EXT_INFO_Object()) {
-                                if (!psb.getDRAGON_EXT_INFO_Object()->HasSubobj(DRAGON_EXT_SUBOBJ_EDGE_VLAN_MAPPING))
-                                    vlanLow = (*iter).vlanTag;
-                                else if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceClient() && ((*iter).inPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_SRC)
-                                    vlanLow = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getEdgeVlanMapping().ingress_outer_vlantag;
-                                else if (!((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceClient() && ((*iter).outPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_DEST)
-                                    vlanLow = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getEdgeVlanMapping().egress_outer_vlantag;
-                            }
-                            vlanTrunk = (*iter).vlanTag;
-
-                            if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceClient() && ((*iter).inPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_SRC) {
-                                if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceDestSame()) {
-                                    //delete CRS for Source == Destination
-                                    if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->hasCRS()) {
-                                        noErr = ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->deleteCRS() && noErr;
-                                        sleep(2); // making sure locks on depending objects (GTP) are released
-                                    }
-                                } else {
-                                    //delete SNC
-                                    if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->hasSNC())
-                                        noErr = ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->deleteSNC() && noErr;
-                                }
-
-                                //delete GTP (for SNC: source only; for CRS: both source and dest interfaces)
-                                if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->hasGTP())
-                                    noErr = ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->deleteGTP() && noErr;
-
-                                //delete VCG for LOCAL_ID_TYPE_SUBNET_UNI_SRC
-                                if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->hasVCG())
-                                    noErr == ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->deleteVCG() && noErr;
-
-                                if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->getUniState() != Message::InitAPI)
-                                    ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->releaseRsvpPath();
-
-                                if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isResourceHeld()) {
-                                    // Update ingress link bandwidth
-                                    u_int32_t ucid = 0, seqnum = 0;
-                                    if (psb.getDRAGON_EXT_INFO_Object() != NULL && ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->HasSubobj(DRAGON_EXT_SUBOBJ_SERVICE_CONF_ID)) {
-                                        ucid = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().ucid;
-                                        seqnum = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().seqnum;
-                                    }
-                                    RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF((*iter).inPort, (*iter).bandwidth, false, ucid, seqnum); //false == increase
-                                    // Update time slots
-                                    ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->getTimeslots(ts_list);
-                                    if (ts_list.size() > 0)
-                                        RSVP_Global::rsvp->getRoutingService().holdTimeslotsbyOSPF((*iter).inPort, ts_list, false);
-                                    // Update vlan tag if applicable
-                                    if (vlanLow >= 0 && vlanLow <= MAX_VLAN || vlanLow == ANY_VTAG)
-                                        RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).inPort, vlanLow, false); //false == release
-                                    if (vlanLow > 0 && vlanLow <= MAX_VLAN && vlanTrunk > 0 && vlanTrunk <= MAX_VLAN && vlanTrunk != vlanLow)
-                                        RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).inPort, vlanTrunk, false); //false == release
-                                }
-
-                                (*sessionIter)->disconnectSwitch();
-                            } else if (!((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceClient() && ((*iter).outPort >> 16) == LOCAL_ID_TYPE_SUBNET_UNI_DEST) {
-                                //delete GTP (for SNC: source only; for CRS: both source and dest interfaces)
-                                if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isSourceDestSame() && ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->hasGTP()) {
-                                    noErr = ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->deleteGTP() && noErr;
-                                }
-                                if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->hasVCG()) {
-                                    //$$$$ Special handling to adjust the sequence of SNC-VCG-deletion at destination node.
-                                    if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->hasSystemSNCHolindgCurrentVCG(noErr) && noErr) {
-                                        (*sessionIter)->disconnectSwitch();
-                                        signal(SIGCHLD, SIG_IGN);
-                                        pid_t pid;
-                                        switch (pid = fork()) {
-                                            case 0: // child process for delayed waiting-and-deleting procedure
-                                                if (!(*sessionIter)->connectSwitch()) {
-                                                    LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "Child-Process:: Cannot connect to switch via TL1_TELNET: ", (*sessionIter)->getSwitchInetAddr());
-                                                    return;
-                                                }
-                                                if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->waitUntilSystemSNCDisapear()) {
-                                                    ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->deleteVCG();
-                                                }
-                                                (*sessionIter)->disconnectSwitch();
-                                                exit(0);
-                                                break;
-                                            case -1: // error
-                                                LOG(4)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR-Subnet Fatal Error: cannot fork a child process for the waiting-and-deleting procedure!");
-                                                exit(-1);
-                                                break;
-                                            default: // parent (orininal) process back to main logic loop
-                                                break;
-                                        }
-                                    } else {
-                                        if (noErr) {
-                                            ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->deleteVCG();
-                                        }
-                                        (*sessionIter)->disconnectSwitch();
-                                    }
-
-                                }
-
-                                if (((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->isResourceHeld()) {
-                                    // Update egress link bandwidth
-                                    u_int32_t ucid = 0, seqnum = 0;
-                                    if (psb.getDRAGON_EXT_INFO_Object() != NULL && ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->HasSubobj(DRAGON_EXT_SUBOBJ_SERVICE_CONF_ID)) {
-                                        ucid = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().ucid;
-                                        seqnum = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().seqnum;
-                                    }
-                                    RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF((*iter).outPort, (*iter).bandwidth, false, ucid, seqnum); //false == increase
-                                    // Update time slots
-                                    ((SwitchCtrl_Session_SubnetUNI*) (*sessionIter))->getTimeslots(ts_list);
-                                    if (ts_list.size() > 0)
-                                        RSVP_Global::rsvp->getRoutingService().holdTimeslotsbyOSPF((*iter).outPort, ts_list, false);
-                                    // Update vlan tag if applicable
-                                    if (vlanLow >= 0 && vlanLow <= MAX_VLAN || vlanLow == ANY_VTAG)
-                                        RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).outPort, vlanLow, false); //false == release
-                                    if (vlanLow > 0 && vlanLow <= MAX_VLAN && vlanTrunk > 0 && vlanTrunk <= MAX_VLAN && vlanTrunk != vlanLow)
-                                        RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).outPort, vlanTrunk, false); //false == release
-                                }
-                            }
-
-                            LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": teardown -", "finished subnet control session successfully with switch", (*sessionIter)->getSwitchInetAddr());
-
-                            if (!noErr) return; // otherwise, continue to update bandwidth and timeslots.
+                            // queued behind a setup of the hop that is still running, the resources are released once the switch has been torn down
+                            VLSR_SubnetTeardownJob* job = new VLSR_SubnetTeardownJob(subnetSession, getSubnetUNIVlanLow(psb, subnetSession, *iter), (*iter).vlanTag);
+                            initVLSRHop(psb, *iter, job->getHop());
+                            SwitchCtrl_Worker::enqueue(job);
                         }
                     }
 
                     continue;
                 }                    //Ciena CN4200 OTNX Session
                 else if (((*iter).inPort >> 16) == LOCAL_ID_TYPE_CIENA_OTNX && ((*iter).outPort >> 16) == LOCAL_ID_TYPE_CIENA_OTNX) {
-                    int vlanLow = -1, vlanTrunk = (*iter).vlanTag;
-                    LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": teardown -", "starting CN4200 control session with switch", (*sessionIter)->getSwitchInetAddr());
+                    SwitchCtrl_Session_CienaCN4200* cn4200Session = (SwitchCtrl_Session_CienaCN4200*) (*sessionIter);
+                    LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": teardown -", "starting CN4200 control session with switch", cn4200Session->getSwitchInetAddr());
                     //verify
-                    if (((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->hasSourceDestPortConflict()) {
-                        LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR-CN4200 Control: hasSourceDestPortConflict() == True: cannot crossconnect from to to the same ETTP on ", (*sessionIter)->getSwitchInetAddr());
-                        return;
-                    }
-                    //connect
-                    if (CLI_SESSION_TYPE != CLI_TL1_TELNET || !(*sessionIter)->connectSwitch()) {
-                        LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR-CN4200 Connect: Cannot connect to switch via TL1_TELNET: ", (*sessionIter)->getSwitchInetAddr());
+                    if (cn4200Session->hasSourceDestPortConflict()) {
+                        LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR-CN4200 Control: hasSourceDestPortConflict() == True: cannot crossconnect from to to the same ETTP on ", cn4200Session->getSwitchInetAddr());
                         return;
                     }
-                    //prepare VLAN
-                    if (psb.getDRAGON_EXT_INFO_Object()) {
-                        if (((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->isIngressNode()) { //translation (if any) occurs at ingress
-                            vlanLow = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getEdgeVlanMapping().ingress_outer_vlantag;
-                        } else if (((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->isEgressNode()) { //translation (if any) occurs at egress
-                            vlanLow = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getEdgeVlanMapping().egress_outer_vlantag;
-                        }
-                    }
-                    //disconnect
-                    (*sessionIter)->disconnectSwitch();
-
-                    if (((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->isResourceHeld()) {
-                        u_int32_t ucid = 0, seqnum = 0;
-                        if (psb.getDRAGON_EXT_INFO_Object() != NULL && ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->HasSubobj(DRAGON_EXT_SUBOBJ_SERVICE_CONF_ID)) {
-                            ucid = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().ucid;
-                            seqnum = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().seqnum;
-                        }
-                        //update ingress interface
-                        RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF((*iter).inPort, (*iter).bandwidth, false, ucid, seqnum); //true == decrease
-                        uint32 opvcx_range = ((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->getOPVCX(true); //ingress or source
-                        RSVP_Global::rsvp->getRoutingService().holdOTNXChannelsByOSPF((*iter).inPort, opvcx_range, false);
-                        if (((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->isIngressNode()) {
-                            // Update vlan tag if applicable
-                            if (vlanLow >= 0 && vlanLow <= MAX_VLAN || vlanLow == ANY_VTAG)
-                                RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).inPort, vlanLow, false); //tue == hold
-                            if (vlanLow > 0 && vlanLow <= MAX_VLAN && vlanTrunk > 0 && vlanTrunk <= MAX_VLAN && vlanTrunk != vlanLow)
-                                RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).inPort, vlanTrunk, false); //tue == hold
-                        }
-                        //update egress interface
-                        RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF((*iter).outPort, (*iter).bandwidth, false, ucid, seqnum); //true == decrease
-                        opvcx_range = ((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->getOPVCX(false); //egress or destination
-                        RSVP_Global::rsvp->getRoutingService().holdOTNXChannelsByOSPF((*iter).outPort, opvcx_range, false);
-                        if (((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->isEgressNode()) {
-                            // Update vlan tag if applicable
-                            if (vlanLow >= 0 && vlanLow <= MAX_VLAN || vlanLow == ANY_VTAG)
-                                RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).outPort, vlanLow, false); //tue == hold
-                            if (vlanLow > 0 && vlanLow <= MAX_VLAN && vlanTrunk > 0 && vlanTrunk <= MAX_VLAN && vlanTrunk != vlanLow)
-                                RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).outPort, vlanTrunk, false); //tue == hold
-                        }
-                        ((SwitchCtrl_Session_CienaCN4200*) (*sessionIter))->setResourceHeld(false);
-                    }
 
-                    LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": teardown -", "finished CN4200 control session successfully with switch", (*sessionIter)->getSwitchInetAddr());
+                    VLSR_CN4200TeardownJob* job = new VLSR_CN4200TeardownJob(cn4200Session, getCN4200VlanLow(psb, cn4200Session), (*iter).vlanTag);
+                    initVLSRHop(psb, *iter, job->getHop());
+                    SwitchCtrl_Worker::enqueue(job);
 
                     continue;
                 }                    //Ethernet SwitchCtrl Session
-                else if ((*sessionIter)->getSwitchInetAddr() == ethSw && (*sessionIter)->isValidSession() && (*sessionIter)->startTransaction()) {
-                    PortList portList;
-                    uint32 vlanID;
-                    uint32 inPort = (*iter).inPort;
-
-                    if ((inPort >> 16) == LOCAL_ID_TYPE_NONE)
-                        portList.push_back(inPort);
-                    else if ((inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL)
-                        portList.push_back(inPort & 0xffff);
-                    else {
-                        DRAGON_UNI_Object* uni = (DRAGON_UNI_Object*) psb.getDRAGON_UNI_Object();
-                        if (uni && uni->getSrcTNA().local_id == UNI_AUTO_TAGGED_LCLID)
-                            inPort = RSVP_Global::rsvp->getLocalIdByIfName((char*) uni->getIngressCtrlChannel().name);
-                        SwitchCtrl_Global::getPortsByLocalId(portList, inPort);
-                    }
-                    if (inPort == ((LOCAL_ID_TYPE_TAGGED_GROUP << 16) | 0)) //NULL local-ID
-                    {
-                        portList.clear();
-                    } else if (portList.size() == 0) {
-                        LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: Unrecognized port/localID at ingress: ", inPort);
-                        //continue;
+                else if ((*sessionIter)->getSwitchInetAddr() == ethSw && (*sessionIter)->isValidSession()) {
+                    if (!hasVLSRHop(pendingHops, *iter)) {
+                        VLSR_EthernetTeardownJob* job = new VLSR_EthernetTeardownJob(*sessionIter, true);
+                        initEthernetHop(psb, *iter, job->getHop());
+                        SwitchCtrl_Worker::enqueue(job);
                     }
-                    while (portList.size()) {
-                        uint32 port = portList.front();
-                        vlanID = (*iter).vlanTag;
-                        if (vlanID == 0)
-                            vlanID = (*sessionIter)->getActiveVlanId(port);
-                        if (vlanID != 0) {
-                            (*sessionIter)->removePortFromVLAN(port, vlanID);
-                            LOG(7)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: Removing ingress port#", GetSwitchPortString(port), "from VLAN #", vlanID);
-                        } else {
-                            LOG(4)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: Cannot identify the VLAN (for ingress port) to be operated.");
-                        }
-
-                        if (vlanID != 0) {
-                            //increase the bandwidth by the amount taken by the removed LSP (on revserse link for bidirectional LSP only)
-                            //$$$$ To be moved into deleteUpstreamInLabel
-                            u_int32_t ucid = 0, seqnum = 0;
-                            if (psb.getDRAGON_EXT_INFO_Object() != NULL && ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->HasSubobj(DRAGON_EXT_SUBOBJ_SERVICE_CONF_ID)) {
-                                ucid = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().ucid;
-                                seqnum = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().seqnum;
-                            }
-                            RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF(port, (*iter).bandwidth, false, ucid, seqnum); //false == increase
-
-                            //Undo rate policing and limitation on the port, which is both input and output port as the VLAN is duplex.
-                            LOG(7)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ",
-                                    "VLSR: Undo bandwidth policing and limitation on port#", GetSwitchPortString(port), "for VLAN #", vlanID);
-                            //This operation is only done for edge ports of port, group or tagged-group local-id types.
-                            if (((*iter).inPort >> 16) == LOCAL_ID_TYPE_PORT || ((*iter).inPort >> 16) == LOCAL_ID_TYPE_GROUP || ((*iter).inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP ) {
-                                (*sessionIter)->policeInputBandwidth(false, port, (*iter).vlanTag, (*iter).bandwidth);
-                                (*sessionIter)->limitOutputBandwidth(false, port, (*iter).vlanTag, (*iter).bandwidth); //$$$$ To be moved into deleteUpstreamInLabel
-                            }
-                        }
-
-                        portList.pop_front();
-                    }
-
-                    if ((*iter).outPort != (*iter).inPort
-                            ||
-                            !((((*iter).inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL || ((*iter).inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP)
-                            && (((*iter).outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL || ((*iter).outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP)
-                            && ((*iter).inPort & 0xffff) == ((*iter).outPort & 0xffff))) {
-                        portList.clear();
-                        uint32 outPort = (*iter).outPort;
-                        if ((outPort >> 16) == LOCAL_ID_TYPE_NONE)
-                            portList.push_back(outPort);
-                        else if ((outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL)
-                            portList.push_back(outPort & 0xffff);
-                        else {
-                            DRAGON_UNI_Object* uni = (DRAGON_UNI_Object*) psb.getDRAGON_UNI_Object();
-                            if (uni && uni->getDestTNA().local_id == UNI_AUTO_TAGGED_LCLID)
-                                outPort = RSVP_Global::rsvp->getLocalIdByIfName((char*) uni->getEgressCtrlChannel().name);
-                            SwitchCtrl_Global::getPortsByLocalId(portList, outPort);
-                        }
-                        if (outPort == ((LOCAL_ID_TYPE_TAGGED_GROUP << 16) | 0)) //NULL local-ID
-                        {
-                            portList.clear();
-                        } else if (portList.size() == 0) {
-                            LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: Unrecognized port/localID at egress: ", outPort);
-                            //continue;
-                        }
-                        while (portList.size()) {
-                            uint32 port = portList.front();
-                            vlanID = (*iter).vlanTag;
-                            if (vlanID == 0)
-                                vlanID = (*sessionIter)->getActiveVlanId(port);
-                            if (vlanID != 0) {
-                                (*sessionIter)->removePortFromVLAN(port, vlanID);
-                                LOG(7)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: Removing egress port#", GetSwitchPortString(port), "from VLAN #", vlanID);
-                            } else {
-                                LOG(4)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: Cannot identify the VLAN  (for egress port) to be operated.");
-                            }
-
-                            if (vlanID != 0) {
-                                //increase the bandwidth by the amount taken by the removed LSP
-                                u_int32_t ucid = 0, seqnum = 0;
-                                if (psb.getDRAGON_EXT_INFO_Object() != NULL && ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->HasSubobj(DRAGON_EXT_SUBOBJ_SERVICE_CONF_ID)) {
-                                    ucid = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().ucid;
-                                    seqnum = ((DRAGON_EXT_INFO_Object*) psb.getDRAGON_EXT_INFO_Object())->getServiceConfirmationID().seqnum;
-                                }
-                                RSVP_Global::rsvp->getRoutingService().holdBandwidthbyOSPF(port, (*iter).bandwidth, false, ucid, seqnum); //false == increase
-
-                                //Undo rate policing and limitation on the port, which is both input and output port as the VLAN is duplex.
-                                LOG(7)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: Undo bandwidth policing and limitation on port#", GetSwitchPortString(port), "for VLAN #", vlanID);
-                                //This operation is only done for edge ports of port, group or tagged-group local-id types.
-                                if (((*iter).outPort >> 16) == LOCAL_ID_TYPE_PORT || ((*iter).outPort >> 16) == LOCAL_ID_TYPE_GROUP || ((*iter).outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP ) {
-                                    (*sessionIter)->policeInputBandwidth(false, port, (*iter).vlanTag, (*iter).bandwidth); //$$$$ To be moved into deleteUpstreamInLabel
-                                    (*sessionIter)->limitOutputBandwidth(false, port, (*iter).vlanTag, (*iter).bandwidth);
-                                }
-                            }
-                            portList.pop_front();
-                        }
-                    }
-
-                    if ((*iter).vlanTag != 0)// && !(*sessionIter)->VLANHasTaggedPort((*iter).vlanTag))
-                    {
-                        //restore the VTAG that has been released from removing the VLAN.
-                        if (((*iter).inPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL) //$$$$ To be moved into deleteUpstreamInLabel
-                            RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).inPort & 0xffff, (*iter).vlanTag, false); //false == release
-                        if (((*iter).outPort >> 16) == LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL)
-                            RSVP_Global::rsvp->getRoutingService().holdVtagbyOSPF((*iter).outPort & 0xffff, (*iter).vlanTag, false); //false == release
-                    }
-
-                    if (RSVP_Global::switchController->hasSwitchVlanOption(SW_VLAN_EMPTY_CHECK_BYPASS) || (*sessionIter)->isVLANEmpty(vlanID)) {
-                        if (!(*sessionIter)->removeVLAN(vlanID)) {
-                            LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: Failed to remove the empty VLAN: ", vlanID);
-                        }
-                        LOG(5)(Log::MPLS, "LSP=", psb.getSESSION_ATTRIBUTE_Object().getSessionName(), ": ", "VLSR: Removed the empty VLAN: ", vlanID);
-                    }
-
-                    (*sessionIter)->endTransaction();
                     break; // allowing up to ONE session for Ethernet switchCtrl VLSR
                 }
             }
@@ -1162,6 +1459,8 @@ void MPLS::deleteInLabel(PSB& psb, const MPLS_InLabel* il) {
 
 void MPLS::deleteUpstreamInLabel(PSB& psb) {
     LOG(2)(Log::MPLS, "MPLS: deleting upstream input label", psb.getUPSTREAM_IN_LABEL_Object().getLabel());
+    if (psb.isUpstreamInLabelAllocated())
+        freeInLabel(psb.getUPSTREAM_IN_LABEL_Object().getLabel());
 }
 
 void MPLS::deleteOutLabel(const MPLS_OutLabel* outLabel) {
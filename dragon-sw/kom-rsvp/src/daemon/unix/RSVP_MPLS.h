@@ -41,13 +41,46 @@ template <> struct GetHash<MPLS_Classifier*> {
 	}
 };
 
+// Free/used map of a label space with one bit per label and a summary bit
+// per word of 32 labels that is set while the word is full, so that a free
+// label is found by scanning words of the map rather than single labels.
+// Labels are handed out round-robin starting after the last allocated one.
+// The map first covers the initial size only and doubles whenever all its
+// labels are in use, up to the whole label space.
+class MPLS_LabelAllocator {
+	uint32 begin;			// first label of the space
+	uint32 size;			// number of labels in the space
+	uint32 mapSize;			// labels covered by the map, a multiple of 32
+	uint32* words;			// bit set: label in use
+	uint32* fullWords;		// bit set: word of 'words' is full
+	uint32 next;			// where the search for a free label starts
+	uint32 usedCount;
+	uint32 peakCount;
+	inline void setBit( uint32 x );
+	inline void clearBit( uint32 x );
+	uint32 findFree( uint32 from ) const;
+	bool resize( uint32 count );
+public:
+	MPLS_LabelAllocator();
+	~MPLS_LabelAllocator();
+	void init( uint32 firstLabel, uint32 lastLabel, uint32 initialSize );
+	// 0 if the label space is exhausted
+	uint32 allocate();
+	bool release( uint32 label );
+	uint32 getUsedCount() const { return usedCount; }
+	uint32 getPeakCount() const { return peakCount; }
+	uint32 getMapSize() const { return mapSize; }
+	uint32 getSpaceSize() const { return size; }
+};
+
 class MPLS_InLabel {
 	uint32 label;
 	uint8 labelCType;
 	uint32 handle;			// unused (Wisc) resp. port (Camb)
 	bool egressBinding;
+	bool allocated;			// taken from the label allocator
 	friend class MPLS;
-	MPLS_InLabel( uint32 label, uint8 C_Type = 2) : label(label), labelCType(C_Type), egressBinding(false) {}
+	MPLS_InLabel( uint32 label, uint8 C_Type = 2) : label(label), labelCType(C_Type), egressBinding(false), allocated(false) {}
 public:
 	uint32 getLabel() const { return label; }
 	uint8 getLabelCType() const { return labelCType; }
@@ -91,9 +124,7 @@ class MPLS {
 	uint32 labelSpaceNum;
 	uint32 labelSpaceBegin;
 	uint32 labelSpaceEnd;
-	uint32 currentLabel;
-	uint32 numberOfAllocatedLabels;
-	uint32* labelHash;
+	MPLS_LabelAllocator labelAllocator;
 	SortableHash<MPLS_Classifier*> ingressClassifiers;
 
 	ExplicitRouteList erList;
@@ -126,6 +157,7 @@ public:
 	void deleteUpstreamInLabel(PSB& psb);
 	void deleteUpstreamOutLabel(PSB& psb);
 	uint32 allocUpstreamInLabel() { return allocateInLabel();}
+	const MPLS_LabelAllocator& getLabelAllocator() const { return labelAllocator; }
 #if defined(MPLS_CAMBRIDGE)
 	uint32 createHopInfo( const LogicalInterface&, const NetAddress& );
 	void removeHopInfo( uint32 );
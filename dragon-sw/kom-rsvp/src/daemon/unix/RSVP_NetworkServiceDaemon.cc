@@ -92,6 +92,12 @@ InterfaceHandle NetworkServiceDaemon::rsrrSocket = -1;
 bool NetworkServiceDaemon::rsrrReady = false;
 InterfaceHandle NetworkServiceDaemon::routingSocket = -1;
 bool NetworkServiceDaemon::routingReady = false;
+InterfaceHandle NetworkServiceDaemon::ospfSocket = -1;
+bool NetworkServiceDaemon::ospfReady = false;
+InterfaceHandle NetworkServiceDaemon::narbSocket = -1;
+bool NetworkServiceDaemon::narbReady = false;
+InterfaceHandle NetworkServiceDaemon::switchCtrlSocket = -1;
+bool NetworkServiceDaemon::switchCtrlReady = false;
 const LogicalInterface* NetworkServiceDaemon::globalVirtualInterface = NULL;
 const LogicalInterface** NetworkServiceDaemon::indexToInterfaceTable = NULL;
 int NetworkServiceDaemon::numSystemIndices = 0;
@@ -115,6 +121,9 @@ public:
 
 static NetworkService_dummy dummy;
 
+// interfaces with a pending packet, returned one by one from queryInterfaces
+static SimpleList<const LogicalInterface*> readyList;
+
 inline void NetworkServiceDaemon::set_fdMask( InterfaceHandleMask& fdmask ) {
 	static const int count = sizeof(InterfaceHandleMask)/sizeof(int);
 	int i = 0;
@@ -123,6 +132,24 @@ inline void NetworkServiceDaemon::set_fdMask( InterfaceHandleMask& fdmask ) {
 	}
 }
 
+bool NetworkServiceDaemon::interfaceReady( InterfaceHandle, void* data ) {
+	const LogicalInterface* lif = (const LogicalInterface*)data;
+	if ( lif->isDisabled() ) return false;
+	readyList.push_back( lif );
+	return true;
+}
+
+// callback for the routing, RSRR, OSPFd and switch control handles: raise their ready flag
+bool NetworkServiceDaemon::handleReady( InterfaceHandle, void* data ) {
+	*(bool*)data = true;
+	return true;
+}
+
+// only handles that are registered for receiving are bound to the interface
+void NetworkServiceDaemon::registerInterface( const LogicalInterface* lif ) {
+	if ( lif->fd >= 0 ) NetworkService::bindHandle( lif->fd, interfaceReady, (void*)lif );
+}
+
 const LogicalInterface* NetworkServiceDaemon::getInterfaceBySystemIndex( uint16 index ) {
 	if (index > NetworkServiceDaemon::numSystemIndices)  {
 		LOG(4)( Log::Packet, "#### requested system interface index ", index, " greater than the maximum ",  NetworkServiceDaemon::numSystemIndices);
@@ -272,6 +299,7 @@ void NetworkServiceDaemon::buildInterfaceList( LogicalInterfaceList& lifList ) {
 	CHECK( setsockopt( globalVirtualInterface->fd, SOL_IP, IP_ROUTER_ALERT, (char *)&on, sizeof(on) ));
 #endif /* FreeBSD vs. Linux */
 	NetworkService::initReceiveInterface( globalVirtualInterface->fd, true );
+	registerInterface( globalVirtualInterface );
 #if defined(FreeBSD)  
   // store dropping stats
 	size_t len = sizeof(packetDropsAtStart);
@@ -294,7 +322,7 @@ void NetworkServiceDaemon::cleanup() {
 #if defined(FreeBSD)
 		CHECK( setsockopt( globalVirtualInterface->fd, IPPROTO_IP, IP_RSVP_OFF, (char*)NULL, 0 ));
 #endif
-		FD_CLR( globalVirtualInterface->fd, &NetworkService::fdmask );
+		NetworkService::deregisterHandle( globalVirtualInterface->fd );
 		close( globalVirtualInterface->fd );
 		delete globalVirtualInterface;
 		globalVirtualInterface = NULL;
@@ -306,14 +334,19 @@ void NetworkServiceDaemon::cleanup() {
 // the number for 'maxSelectFDs' is collected during various initialization
 // routines from 'NetworkService[Daemon]'.
 const LogicalInterface* NetworkServiceDaemon::queryInterfaces() {
-	static SimpleList<const LogicalInterface*> readyList;
-	while ( readyList.empty() && !(rsrrReady || routingReady ) ) {
-		static InterfaceHandleMask readfds;
+	while ( readyList.empty() && !(rsrrReady || routingReady || ospfReady || narbReady || switchCtrlReady ) ) {
 		static int fdCount;
 		TimeValue zeroTime(0,0);
+#if defined(USE_EPOLL)
+		// ready handles are delivered to their callbacks, which fill
+		// 'readyList' or raise the routing and OSPFd flags
+		fdCount = NetworkService::dispatchHandles( &zeroTime );
+#else
+		static InterfaceHandleMask readfds;
 		set_fdMask( readfds );
 		// first check for incoming packets, otherwise execute pending timers
 		fdCount = select( NetworkService::maxSelectFDs, &readfds, NULL, NULL, &zeroTime );
+#endif
 		if ( fdCount == 0 ) {
 			static TimeValue* waitTime;
 			static TimeValue remainingTime;
@@ -326,8 +359,12 @@ const LogicalInterface* NetworkServiceDaemon::queryInterfaces() {
 			if (!waitTime || *waitTime != TimeValue(0,0))
 				LOG(2)( Log::Select, "NetworkService calling blocking select, timeout is", (waitTime ? *waitTime : TimeValue(0)) );
 #endif
+#if defined(USE_EPOLL)
+			fdCount = NetworkService::dispatchHandles( waitTime );
+#else
 			set_fdMask( readfds );
 			fdCount = select( NetworkService::maxSelectFDs, &readfds, NULL, NULL, waitTime );
+#endif
 		}
 		if ( fdCount < 0 ) {
 			if ( errno == EINTR ) {
@@ -342,6 +379,7 @@ const LogicalInterface* NetworkServiceDaemon::queryInterfaces() {
 			}
 		}
 
+#if !defined(USE_EPOLL)
 		// search those interfaces that have a ready file descriptor
 #if defined(REAL_NETWORK)
 		// check dedicated listen socket
@@ -359,6 +397,21 @@ const LogicalInterface* NetworkServiceDaemon::queryInterfaces() {
 			fdCount -= 1;
 		}
 #endif
+		// check OSPFd socket
+		if ( ospfSocket != -1 && FD_ISSET( ospfSocket, &readfds ) ) {
+			ospfReady = true;
+			fdCount -= 1;
+		}
+		// check NARB socket
+		if ( narbSocket != -1 && FD_ISSET( narbSocket, &readfds ) ) {
+			narbReady = true;
+			fdCount -= 1;
+		}
+		// check switch control completions
+		if ( switchCtrlSocket != -1 && FD_ISSET( switchCtrlSocket, &readfds ) ) {
+			switchCtrlReady = true;
+			fdCount -= 1;
+		}
 		// check other interfaces, if necessary (vif or API or UDP interfaces)
 		static uint32 i;
 		for ( i = 0; fdCount > 0 && i < RSVP_Global::rsvp->getInterfaceCount(); ++i ) {
@@ -369,6 +422,7 @@ const LogicalInterface* NetworkServiceDaemon::queryInterfaces() {
 			}
 		}
                                                         assert( fdCount == 0 );
+#endif
 	}
 	if ( !readyList.empty() ) {
 		static const LogicalInterface* lif;
@@ -382,34 +436,65 @@ const LogicalInterface* NetworkServiceDaemon::queryInterfaces() {
 
 void NetworkServiceDaemon::registerRSRR_Handle( InterfaceHandle fd ) {
 	rsrrSocket = fd;
-	FD_SET( fd, &NetworkService::fdmask );
-	if ( fd >= NetworkService::maxSelectFDs ) NetworkService::maxSelectFDs = fd + 1;
+	NetworkService::registerHandle( fd, handleReady, &rsrrReady );
 }
 
 void NetworkServiceDaemon::deregisterRSRR_Handle( InterfaceHandle fd ) {
 	rsrrSocket = -1;
-	FD_CLR( fd, &NetworkService::fdmask );
+	NetworkService::deregisterHandle( fd );
 }
 
 void NetworkServiceDaemon::registerRouting_Handle( InterfaceHandle fd ) {
 	routingSocket = fd;
-	FD_SET( fd, &NetworkService::fdmask );
-	if ( fd >= NetworkService::maxSelectFDs ) NetworkService::maxSelectFDs = fd + 1;
+	NetworkService::registerHandle( fd, handleReady, &routingReady );
 }
 
 void NetworkServiceDaemon::deregisterRouting_Handle( InterfaceHandle fd ) {
 	routingSocket = -1;
-	FD_CLR( fd, &NetworkService::fdmask );
+	NetworkService::deregisterHandle( fd );
+}
+
+void NetworkServiceDaemon::registerOspf_Handle( InterfaceHandle fd ) {
+	ospfSocket = fd;
+	NetworkService::registerHandle( fd, handleReady, &ospfReady );
+}
+
+void NetworkServiceDaemon::deregisterOspf_Handle( InterfaceHandle fd ) {
+	ospfSocket = -1;
+	ospfReady = false;
+	NetworkService::deregisterHandle( fd );
+}
+
+void NetworkServiceDaemon::registerNarb_Handle( InterfaceHandle fd ) {
+	narbSocket = fd;
+	NetworkService::registerHandle( fd, handleReady, &narbReady );
+}
+
+void NetworkServiceDaemon::deregisterNarb_Handle( InterfaceHandle fd ) {
+	narbSocket = -1;
+	narbReady = false;
+	NetworkService::deregisterHandle( fd );
+}
+
+void NetworkServiceDaemon::registerSwitchCtrl_Handle( InterfaceHandle fd ) {
+	switchCtrlSocket = fd;
+	NetworkService::registerHandle( fd, handleReady, &switchCtrlReady );
 }
 
+// the API client socket belongs to an interface that has just been added
 void NetworkServiceDaemon::registerApiClient_Handle( InterfaceHandle fd ) {
-       if (FD_ISSET(fd, &NetworkService::fdmask))    return;
-	FD_SET( fd, &NetworkService::fdmask );
-	if ( fd >= NetworkService::maxSelectFDs ) NetworkService::maxSelectFDs = fd + 1;
+	NetworkService::registerHandle( fd );
+	for ( uint32 i = 0; i < RSVP_Global::rsvp->getInterfaceCount(); ++i ) {
+		const LogicalInterface* lif = RSVP_Global::rsvp->findInterfaceByLIH(i);
+		if ( lif && lif->fd == fd ) {
+			registerInterface( lif );
+	break;
+		}
+	}
 }
 
 void NetworkServiceDaemon::deregisterApiClient_Handle( InterfaceHandle fd ) {
-	FD_CLR( fd, &NetworkService::fdmask );
+	NetworkService::deregisterHandle( fd );
 }
 
 InterfaceHandle NetworkServiceDaemon::initRawInterfaceIP4( const NetAddress& addr ) {
@@ -43,6 +43,9 @@ class NetworkServiceDaemon {
 	static const LogicalInterface** indexToInterfaceTable;
 	static uint32 packetDropsAtStart;
 	static inline void set_fdMask( InterfaceHandleMask& fdmask );
+	static bool interfaceReady( InterfaceHandle, void* );
+	static bool handleReady( InterfaceHandle, void* );
+	static void registerInterface( const LogicalInterface* );
 	static void buildInterfaceList( LogicalInterfaceList& );
 	static const LogicalInterface* queryInterfaces();
 	static void cleanup();
@@ -67,9 +70,37 @@ class NetworkServiceDaemon {
 		bool retval = routingReady; routingReady = false; return retval;
 	}
 
-	friend class RSVP;                                  // access: buildInterfaceList,queryAndClearAsyncRouting,queryInterfaces,cleanup
+	// replies from OSPFd
+	static InterfaceHandle ospfSocket;
+	static bool ospfReady;
+	static void registerOspf_Handle( InterfaceHandle );
+	static void deregisterOspf_Handle( InterfaceHandle );
+	static bool queryAndClearOspfReply() {
+		bool retval = ospfReady; ospfReady = false; return retval;
+	}
+
+	// replies from NARB
+	static InterfaceHandle narbSocket;
+	static bool narbReady;
+	static void registerNarb_Handle( InterfaceHandle );
+	static void deregisterNarb_Handle( InterfaceHandle );
+	static bool queryAndClearNarbReply() {
+		bool retval = narbReady; narbReady = false; return retval;
+	}
+
+	// completions from the switch control worker
+	static InterfaceHandle switchCtrlSocket;
+	static bool switchCtrlReady;
+	static void registerSwitchCtrl_Handle( InterfaceHandle );
+	static bool queryAndClearSwitchCtrlCompletion() {
+		bool retval = switchCtrlReady; switchCtrlReady = false; return retval;
+	}
+
+	friend class RSVP;                                  // access: buildInterfaceList,registerInterface,queryAndClearAsyncRouting,queryAndClearOspfReply,queryAndClearNarbReply,queryAndClearSwitchCtrlCompletion,queryInterfaces,cleanup
 	friend class RSRR;                                  // access: registerRSRR_Handle, deregisterRSRR_Handle
-	friend class RoutingService;                        // access: registerRouting_Handle, deregisterRouting_Handle, getInterfaceBySystemIndex
+	friend class RoutingService;                        // access: registerRouting_Handle, deregisterRouting_Handle, registerOspf_Handle, deregisterOspf_Handle, getInterfaceBySystemIndex
+	friend class SwitchCtrl_Worker;                     // access: registerSwitchCtrl_Handle
+	friend class NARB_APIClient;                        // access: registerNarb_Handle, deregisterNarb_Handle
 public:
 	// interface configuration
 	static InterfaceHandle initRawInterfaceIP4( const NetAddress& );
@@ -36,6 +36,7 @@
 #include "RSVP_Log.h"
 #include "RSVP_NetworkService.h"
 #include "RSVP_NetworkServiceDaemon.h"
+#include "RSVP_ProcessingStats.h"
 #include "RSVP_RSRR.h"
 #if defined(NS2)
 #include "RSVP_Daemon_Wrapper.h"
@@ -89,7 +90,8 @@ void RoutingService::addRoute( const RoutingEntry& rte ) {
 }
 
 RoutingService::RoutingService() : rsrr(NULL), rtList(new RoutingEntryList),
-	mainPID(getpid()), queryCounter(0) {
+	mainPID(getpid()), ospfRequestID(0), resumedRequest(NULL), ospfReadLength(0),
+	ospfHoldBatchLength(0), ospfHoldBatchDepth(0), queryCounter(0) {
 #if defined(REAL_NETWORK)
 #if defined(Linux)
 	routingSocket = CHECK( socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE) );
@@ -117,9 +119,11 @@ RoutingService::~RoutingService() {
 	NetworkServiceDaemon::deregisterRouting_Handle( routingSocket );
 	CHECK( close( routingSocket ) );
 #endif
-	if (ospf_socket){
-		CHECK( close( ospf_socket ) );
-		ospf_socket = 0;
+	closeOspfSocket();
+	clearResumedOspfRequest();
+	OspfRequestList::Iterator reqIter = ospfRequests.begin();
+	for ( ; reqIter != ospfRequests.end(); ++reqIter ) {
+		delete *reqIter;
 	}
 }
 
@@ -212,10 +216,10 @@ bool RoutingService::ospf_socket_init (){
 	         return false;
 	 }
 
-	 if (fcntl(ospf_socket, F_SETFL, old_flags) == -1) 
+	 if (fcntl(ospf_socket, F_SETFL, old_flags | O_NONBLOCK) == -1) 
 	     return false;
-	 else
-	     return true;
+	 NetworkServiceDaemon::registerOspf_Handle(ospf_socket);
+	 return true;
 }
 #else
 bool RoutingService::ospf_socket_init (){
@@ -237,7 +241,13 @@ bool RoutingService::ospf_socket_init (){
 		  addr.sin_addr.s_addr = LogicalInterface::loopbackAddress.rawAddress();
 	
 		  ret = connect(ospf_socket, (struct sockaddr *) &addr, sizeof(addr));
-		  if (ret<0) return false;
+		  if (ret<0) {
+			  closeOspfSocket();
+			  return false;
+		  }
+		  // replies are read from the main loop, see readOspfReplies()
+		  fcntl(ospf_socket, F_SETFL, fcntl(ospf_socket, F_GETFL, 0) | O_NONBLOCK);
+		  NetworkServiceDaemon::registerOspf_Handle(ospf_socket);
   }
 	
   return true;
@@ -279,30 +289,239 @@ void RoutingService::getPeerIPAddr(const NetAddress& myAddr, NetAddress& peerAdd
 }
 
 
-//Get explicit route from OSPF
-//The explicit route starts from next hop (does not contains its own hop)
-EXPLICIT_ROUTE_Object* RoutingService::getExplicitRouteByOSPF(const NetAddress& src, 
-const NetAddress &dest, const SENDER_TSPEC_Object& sendTSpec, const LABEL_REQUEST_Object& labelReq)
-{	
+// Requests to OSPFd are framed as msglen(8) + msgtype(8) + request ID(32)
+// followed by the request data; OSPFd answers with the same framing and the
+// ID of the request. Notifications that OSPFd does not answer use ID 0.
+uint32 RoutingService::newOspfRequest() {
+	// OSPFd has to see pending holds before it answers
+	sendOspfHoldBatch();
+	if ( ++ospfRequestID == 0 ) ++ospfRequestID;
+	ospfRequests.push_back( new OspfRequest( ospfRequestID ) );
+	return ospfRequestID;
+}
+
+void RoutingService::closeOspfSocket() {
+	if (ospf_socket > 0) {
+		NetworkServiceDaemon::deregisterOspf_Handle( ospf_socket );
+		CHECK( close( ospf_socket ) );
+	}
+	ospf_socket = 0;
+	ospfReadLength = 0;
+	// outstanding requests are not going to be answered anymore
+	OspfRequestList::Iterator iter = ospfRequests.begin();
+	for ( ; iter != ospfRequests.end(); ++iter ) {
+		(*iter)->answered = true;
+	}
+}
+
+// length of the reply at 'start' in the read buffer, 0 if not known yet; a
+// reply too long for its length byte has a length byte of zero and its real
+// length(16) after the request ID
+uint32 RoutingService::ospfReplyLength( uint32 start ) const {
+	if ( ospfReadLength <= start )
+		return 0;
+	if ( ospfReadBuffer[start] != 0 )
+		return ospfReadBuffer[start];
+	if ( ospfReadLength - start < sizeof(uint8)*2 + sizeof(uint32) + sizeof(uint16) )
+		return 0;
+	const uint8* p = ospfReadBuffer + start + sizeof(uint8)*2 + sizeof(uint32);
+	uint32 length = ((uint32)p[0] << 8) | p[1];
+	// a zero length is malformed, let the caller find out
+	return length ? length : 1;
+}
+
+// read whatever OSPFd has sent and hand complete replies to their requests
+void RoutingService::readOspfReplies() {
+	if (ospf_socket <= 0)
+		return;
+	int n = read( ospf_socket, ospfReadBuffer + ospfReadLength, ospfReadBufferSize - ospfReadLength );
+	if ( n < 0 && (errno == EAGAIN || errno == EINTR) )
+		return;
+	if ( n <= 0 ) {
+		LOG(1)( Log::Routing, "OSPFd closed the connection" );
+		closeOspfSocket();
+		return;
+	}
+	ospfReadLength += n;
+
+	uint32 start = 0;
+	uint32 length;
+	while ( (length = ospfReplyLength( start )) != 0 && ospfReadLength - start >= length ) {
+		bool longReply = (ospfReadBuffer[start] == 0);
+		if ( length < sizeof(uint8)*2 + sizeof(uint32) + (longReply ? sizeof(uint16) : 0) ) {
+			ERROR(2)( Log::Error, "malformed reply from OSPFd, length", length );
+			closeOspfSocket();
+			return;
+		}
+		INetworkBuffer* ibuffer = new INetworkBuffer(length);
+		ibuffer->cloneFrom( ospfReadBuffer + start, length );
+		start += length;
+		uint8 msgLength, message;
+		uint32 requestID;
+		*ibuffer >> msgLength >> message >> requestID;
+		if ( longReply ) {
+			uint16 longLength;
+			*ibuffer >> longLength;
+		}
+
+		OspfRequestList::Iterator iter = ospfRequests.begin();
+		for ( ; iter != ospfRequests.end() && (*iter)->id != requestID; ++iter );
+		if ( iter == ospfRequests.end() || (*iter)->answered ) {
+			LOG(4)( Log::Routing, "ignoring OSPFd reply", (uint32)message, "to unknown request", requestID );
+			delete ibuffer;
+			continue;
+		}
+		(*iter)->answered = true;
+		(*iter)->reply = ibuffer;
+		TimeValue now = getCurrentSystemTime();
+		now -= (*iter)->sent;
+		ProcessingStats::record( STATS_PROBE_OSPF_QUERY, now.getUsec() );
+	}
+	if ( start > 0 ) {
+		ospfReadLength -= start;
+		memmove( ospfReadBuffer, ospfReadBuffer + start, ospfReadLength );
+	}
+}
+
+// block until the reply to 'requestID' has arrived, at most ospfReplyTimeout
+// seconds; replies to other requests that come in meanwhile are kept for them.
+// Returns the reply positioned after the request ID (to be deleted by the
+// caller), or NULL if OSPFd went away or did not answer in time. OSPFd
+// answers lookups between its queued path computations, so the wait is for
+// one computation at most, not for all of those requested so far.
+INetworkBuffer* RoutingService::waitOspfReply( uint32 requestID ) {
+	TimeValue deadline = getCurrentSystemTime();
+	deadline += TimeValue( ospfReplyTimeout, 0 );
+	for (;;) {
+		OspfRequestList::Iterator iter = ospfRequests.begin();
+		for ( ; iter != ospfRequests.end() && (*iter)->id != requestID; ++iter );
+		if ( iter == ospfRequests.end() )
+			return NULL;
+		if ( ospf_socket <= 0 )
+			(*iter)->answered = true;
+		if ( (*iter)->answered ) {
+			INetworkBuffer* reply = (*iter)->reply;
+			(*iter)->reply = NULL;
+			delete *iter;
+			ospfRequests.erase( iter );
+			return reply;
+		}
+		TimeValue wait = deadline;
+		wait -= getCurrentSystemTime();
+		if ( wait.getUsec() <= 0 ) {
+			// a late reply is ignored as one to an unknown request
+			ERROR(3)( Log::Error, "no reply from OSPFd to request", requestID, "in time" );
+			delete *iter;
+			ospfRequests.erase( iter );
+			return NULL;
+		}
+		fd_set readfds;
+		FD_ZERO( &readfds );
+		FD_SET( ospf_socket, &readfds );
+		struct timeval tv = wait;
+		if ( select( ospf_socket + 1, &readfds, NULL, NULL, &tv ) < 0 ) {
+			if ( errno != EINTR ) {
+				ERROR(3)( Log::Error, "select on OSPFd socket reports error", errno, strerror(errno) );
+				closeOspfSocket();
+			}
+			continue;
+		}
+		readOspfReplies();
+	}
+}
+
+bool RoutingService::ospfReplyArrived( uint32 requestID ) const {
+	OspfRequestList::ConstIterator iter = ospfRequests.begin();
+	for ( ; iter != ospfRequests.end(); ++iter ) {
+		if ( (*iter)->id == requestID )
+			return (*iter)->answered;
+	}
+	return true;
+}
+
+// make the reply to 'requestID' available to the message that is processed
+// again now, see takeResumedExplicitRoute()
+void RoutingService::resumeOspfRequest( uint32 requestID ) {
+	clearResumedOspfRequest();
+	OspfRequestList::Iterator iter = ospfRequests.begin();
+	for ( ; iter != ospfRequests.end(); ++iter ) {
+		if ( (*iter)->id == requestID ) {
+			resumedRequest = *iter;
+			ospfRequests.erase( iter );
+			return;
+		}
+	}
+	// the request was dropped, resume as if OSPFd had gone away
+	resumedRequest = new OspfRequest( requestID );
+	resumedRequest->answered = true;
+}
+
+void RoutingService::clearResumedOspfRequest() {
+	if ( resumedRequest ) {
+		delete resumedRequest;
+		resumedRequest = NULL;
+	}
+}
+
+static EXPLICIT_ROUTE_Object* explicitRouteFromReply( INetworkBuffer* ibuffer ) {
+	if ( !ibuffer )
+		return NULL;
+	if ( ibuffer->getRemainingSize() == 0 ) {
+		delete ibuffer;
+		return NULL;
+	}
+	//Process response messages which contains IP address lists (ERO)
+	NetAddress hop;
+	EXPLICIT_ROUTE_Object *ero = new EXPLICIT_ROUTE_Object();
+	while (ibuffer->getRemainingSize()){
+		*ibuffer >> hop;
+       	ero->pushBack(AbstractNode(false, hop, (uint8)32));
+	}
+	delete ibuffer;
+	return ero;
+}
+
+// explicit route computed for the PATH message that is processed again after
+// the reply to requestExplicitRouteByOSPF() has arrived
+bool RoutingService::takeResumedExplicitRoute( EXPLICIT_ROUTE_Object*& ero ) {
+	if ( !resumedRequest )
+		return false;
+	ero = explicitRouteFromReply( resumedRequest->reply );
+	resumedRequest->reply = NULL;
+	clearResumedOspfRequest();
+	return true;
+}
+
+//Request explicit route from OSPF without waiting for the reply
+//The path constraints (setup priority, admin groups, VLAN tag) are appended
+//after the T-Spec; older OSPF daemons simply ignore them.
+uint32 RoutingService::requestExplicitRouteByOSPF(const NetAddress& src,
+const NetAddress &dest, const SENDER_TSPEC_Object& sendTSpec, const LABEL_REQUEST_Object& labelReq,
+const SESSION_ATTRIBUTE_Object* sessionAttr, uint32 vtag)
+{
 	//Write packet to OSPF socket ask for my hop control IP address
 	uint8 message = GetExplicitRouteByOSPF;
 	uint8 msgLength;
 	if (sendTSpec.getService()==SENDER_TSPEC_Object::GMPLS_Sender_Tspec)
-		//msgtype(8) + msglen(8) + service(8) + src(32) + dest IP (32) + switching(8) + encoding(8) + gpid(16) + bandwidth (32)
-		msgLength = sizeof(uint8)*3 + src.size() + dest.size() + sizeof(uint32)*2;   
+		//msgtype(8) + msglen(8) + requestID(32) + service(8) + src(32) + dest IP (32) + switching(8) + encoding(8) + gpid(16) + bandwidth (32)
+		msgLength = sizeof(uint8)*3 + sizeof(uint32) + src.size() + dest.size() + sizeof(uint32)*2;
 	else
-		//msgtype(8) + msglen(8) + service(8) + src(32) + dest IP (32) + switching(8) + encoding(8) + gpid(16) + SonetTspec(4*32)
-		msgLength = sizeof(uint8)*3 + src.size() + dest.size() + sizeof(uint32) + sizeof(uint32)*4;   
+		//msgtype(8) + msglen(8) + requestID(32) + service(8) + src(32) + dest IP (32) + switching(8) + encoding(8) + gpid(16) + SonetTspec(4*32)
+		msgLength = sizeof(uint8)*3 + sizeof(uint32) + src.size() + dest.size() + sizeof(uint32) + sizeof(uint32)*4;
+	//setupPri(8) + includeAny(32) + includeAll(32) + excludeAny(32) + vtag(32) + number of SRLGs to exclude(8)
+	msgLength += sizeof(uint8)*2 + sizeof(uint32)*4;
+	if (labelReq.getRequestedLabelType() != LABEL_Object::LABEL_GENERALIZED &&
+		labelReq.getRequestedLabelType() != LABEL_Object::LABEL_MPLS) {
+		LOG(1)(Log::MPLS, "MPLS: Waveband label not supported");
+		return 0;
+	}
+	uint32 requestID = newOspfRequest();
 	ONetworkBuffer obuffer(msgLength);
-	obuffer << msgLength << message << sendTSpec.getService() << src << dest;
+	obuffer << msgLength << message << requestID << sendTSpec.getService() << src << dest;
 	if (labelReq.getRequestedLabelType() == LABEL_Object::LABEL_GENERALIZED)
 		obuffer << labelReq.getLspEncodingType() << labelReq.getSwitchingType() << labelReq.getGPid();
-	else if (labelReq.getRequestedLabelType() == LABEL_Object::LABEL_MPLS)
+	else
 		obuffer << labelReq.getL3Pid();
-	else{
-		LOG(1)(Log::MPLS, "MPLS: Waveband label not supported");
-		return NULL;
-	}
 	if (sendTSpec.getService()==SENDER_TSPEC_Object::GMPLS_Sender_Tspec){
 		obuffer << sendTSpec.get_p();
 	}
@@ -311,29 +530,25 @@ const NetAddress &dest, const SENDER_TSPEC_Object& sendTSpec, const LABEL_REQUES
 		obuffer << sendTSpec.getNCC() << sendTSpec.getNVC() << sendTSpec.getMT();
 		obuffer << sendTSpec.getTransparency() << sendTSpec.getProfile();
 	}
+	if (sessionAttr)
+		obuffer << sessionAttr->getSetupPri() << sessionAttr->getIncludeAny() << sessionAttr->getIncludeAll() << sessionAttr->getExcludeAny();
+	else
+		obuffer << (uint8)7 << (uint32)0 << (uint32)0 << (uint32)0;
+	obuffer << vtag << (uint8)0;
 	CheckOspfSocket(write(ospf_socket, obuffer.getContents(), obuffer.getUsedSize()));
+	return requestID;
+}
 
-	msgLength = 0;
-	//Read response from OSPF
-	read(ospf_socket, (void *)&msgLength, sizeof(uint8));
-	read(ospf_socket, (void *)&message, sizeof(uint8));
-
-	if (msgLength <= sizeof(uint8)*2)
+//Get explicit route from OSPF
+//The explicit route starts from next hop (does not contains its own hop)
+EXPLICIT_ROUTE_Object* RoutingService::getExplicitRouteByOSPF(const NetAddress& src,
+const NetAddress &dest, const SENDER_TSPEC_Object& sendTSpec, const LABEL_REQUEST_Object& labelReq,
+const SESSION_ATTRIBUTE_Object* sessionAttr, uint32 vtag)
+{
+	uint32 requestID = requestExplicitRouteByOSPF(src, dest, sendTSpec, labelReq, sessionAttr, vtag);
+	if (!requestID)
 		return NULL;
-
-	INetworkBuffer ibuffer(msgLength-sizeof(uint8));
-	msgLength = read(ospf_socket, ibuffer.getWriteBuffer(), ibuffer.getSize());
-	ibuffer.setWriteLength(msgLength);
-
-	//Process response messages which contains IP address lists (ERO)
-	NetAddress hop;
-	EXPLICIT_ROUTE_Object *ero = new EXPLICIT_ROUTE_Object();
-	while (ibuffer.getRemainingSize()){
-		ibuffer >> hop;
-       	ero->pushBack(AbstractNode(false, hop, (uint8)32));
-	}
-	return ero;
-
+	return explicitRouteFromReply(waitOspfReply(requestID));
 }
 
 
@@ -341,27 +556,24 @@ const NetAddress &dest, const SENDER_TSPEC_Object& sendTSpec, const LABEL_REQUES
 const LogicalInterface* RoutingService::findInterfaceByData( const NetAddress& ip, const uint32 ifID ) {
 	//Write packet to OSPF socket ask for my hop control IP address
 	uint8 message = FindInterfaceByData;
-	uint8 msgLength = sizeof(uint8)*2+ip.size()+sizeof(uint32);
+	uint8 msgLength = sizeof(uint8)*2+sizeof(uint32)+ip.size()+sizeof(uint32);
+	uint32 requestID = newOspfRequest();
 	ONetworkBuffer obuffer(msgLength);
-	obuffer << msgLength << message << ip << ifID;
+	obuffer << msgLength << message << requestID << ip << ifID;
 	CheckOspfSocket(write(ospf_socket, obuffer.getContents(), obuffer.getUsedSize()));
 
-	msgLength = 0;
 	//Read response from OSPF
-	read(ospf_socket, (void *)&msgLength, sizeof(uint8));
-	read(ospf_socket, (void *)&message, sizeof(uint8));
-
-	if (msgLength <= sizeof(uint8)*2)
+	INetworkBuffer* ibuffer = waitOspfReply(requestID);
+	if (!ibuffer || ibuffer->getRemainingSize() == 0) {
+		if (ibuffer) delete ibuffer;
 		return NULL;
-	
-	INetworkBuffer ibuffer(msgLength-sizeof(uint8));
-	msgLength = read(ospf_socket, ibuffer.getWriteBuffer(), ibuffer.getSize());
-	ibuffer.setWriteLength(msgLength);
+	}
 
 	//Process response messages
 	//Now myHop becomes my *control* IP address
 	NetAddress myHop;
-	ibuffer >> myHop;	
+	*ibuffer >> myHop;
+	delete ibuffer;
 
 	return RSVP_Global::rsvp->findInterfaceByAddress(myHop);
 }
@@ -369,24 +581,21 @@ const LogicalInterface* RoutingService::findInterfaceByData( const NetAddress& i
 //Find data plane IP / interface ID by control logical interface
 bool RoutingService::findDataByInterface(const LogicalInterface& lif, NetAddress& ip, uint32& ifID) {
 	uint8 message = FindDataByInterface;
-	uint8 msgLength = sizeof(uint8)*2+lif.getAddress().size();
+	uint8 msgLength = sizeof(uint8)*2+sizeof(uint32)+lif.getAddress().size();
+	uint32 requestID = newOspfRequest();
 	ONetworkBuffer obuffer(msgLength);
-	obuffer << msgLength << message << lif.getAddress();
+	obuffer << msgLength << message << requestID << lif.getAddress();
 	CheckOspfSocket(write(ospf_socket, obuffer.getContents(), obuffer.getUsedSize()));
 
-	msgLength = 0;
 	//Read response from OSPF
-	read(ospf_socket, (void *)&msgLength, sizeof(uint8));
-	read(ospf_socket, (void *)&message, sizeof(uint8));
-
-	if (msgLength <= sizeof(uint8)*2)
-			return false;
-
-	INetworkBuffer ibuffer(msgLength-sizeof(uint8));
-	msgLength = read(ospf_socket, ibuffer.getWriteBuffer(), ibuffer.getSize());
-	ibuffer.setWriteLength(msgLength);
+	INetworkBuffer* ibuffer = waitOspfReply(requestID);
+	if (!ibuffer || ibuffer->getRemainingSize() == 0) {
+		if (ibuffer) delete ibuffer;
+		return false;
+	}
 	uint32 aid;
-	ibuffer >> ip >> aid;
+	*ibuffer >> ip >> aid;
+	delete ibuffer;
 
 	if ((ifID >> 16) == 0)
 		ifID = aid;
@@ -397,21 +606,21 @@ bool RoutingService::findDataByInterface(const LogicalInterface& lif, NetAddress
 //Find outgoing control logical interface by next hop data plane IP / interface ID
 const LogicalInterface* RoutingService::findOutLifByOSPF( const NetAddress& nextHop, const uint32 ifID, NetAddress& gw   ) {
 	uint8 message = FindOutLifByOSPF;
-	uint8 msgLength = sizeof(uint8)*2+nextHop.size()+sizeof(uint32);
+	uint8 msgLength = sizeof(uint8)*2+sizeof(uint32)+nextHop.size()+sizeof(uint32);
+	uint32 requestID = newOspfRequest();
 	ONetworkBuffer obuffer(msgLength);
-	obuffer << msgLength << message << nextHop << ifID;
+	obuffer << msgLength << message << requestID << nextHop << ifID;
 	CheckOspfSocket(write(ospf_socket, obuffer.getContents(), obuffer.getUsedSize()));
 
-	msgLength = 0;
 	//Read response from OSPF
-	read(ospf_socket, (void *)&msgLength, sizeof(uint8));
-	read(ospf_socket, (void *)&message, sizeof(uint8));
+	INetworkBuffer* ibuffer = waitOspfReply(requestID);
 
 	//If OSPF is not able to resolve it, try looking up the static routing table, maybe there is one entry in it...
-	if (msgLength <= sizeof(uint8)*2)
+	if (!ibuffer || ibuffer->getRemainingSize() == 0)
 	{
+		if (ibuffer) delete ibuffer;
 	//@@@@ Static route resolution for interdomain links
-		const LogicalInterface* lif = getUnicastRoute(nextHop, gw); 
+		const LogicalInterface* lif = getUnicastRoute(nextHop, gw);
 		const NetAddress addr = NetAddress(gw.rawAddress());
 		if (lif && RSVP_Global::rsvp->findInterfaceByAddress(addr))
 		{
@@ -421,14 +630,11 @@ const LogicalInterface* RoutingService::findOutLifByOSPF( const NetAddress& next
 		return RSVP_Global::rsvp->findInterfaceByAddress(nextHop);
 	}
 
-	INetworkBuffer ibuffer(msgLength-sizeof(uint8));
-	msgLength = read(ospf_socket, ibuffer.getWriteBuffer(), ibuffer.getSize());
-	ibuffer.setWriteLength(msgLength);
-	
 	//Process response messages
 	//Now myHop becomes my *control* IP address
 	NetAddress myHop;
-	ibuffer >> myHop;	
+	*ibuffer >> myHop;
+	delete ibuffer;
 
 	//Get next hop control IP address
 	getPeerIPAddr(myHop, gw);
@@ -437,24 +643,24 @@ const LogicalInterface* RoutingService::findOutLifByOSPF( const NetAddress& next
 }
 
 //Get VLSR route
-const void RoutingService::getVLSRRoutebyOSPF(const NetAddress& inRtID, const NetAddress& outRtID, const uint32 inIfId, const uint32 outIfId, VLSR_Route& vlsr) {
+bool RoutingService::getVLSRRoutebyOSPF(const NetAddress& inRtID, const NetAddress& outRtID, const uint32 inIfId, const uint32 outIfId, VLSR_Route& vlsr) {
 	uint8 message = GetVLSRRoutebyOSPF;
-	uint8 msgLength = sizeof(uint8)*2+inRtID.size() + outRtID.size() + sizeof(uint32)*2;
+	uint8 msgLength = sizeof(uint8)*2+sizeof(uint32)+inRtID.size() + outRtID.size() + sizeof(uint32)*2;
+	uint32 requestID = newOspfRequest();
 	ONetworkBuffer obuffer(msgLength);
-	obuffer << msgLength << message << inRtID << outRtID << inIfId << outIfId;
+	obuffer << msgLength << message << requestID << inRtID << outRtID << inIfId << outIfId;
 	CheckOspfSocket(write(ospf_socket, obuffer.getContents(), obuffer.getUsedSize()));
 
-	msgLength = 0;
 	//Read response from OSPF
-	read(ospf_socket, (void *)&msgLength, sizeof(uint8));
-	INetworkBuffer ibuffer(msgLength-sizeof(uint8));
-	msgLength = read(ospf_socket, ibuffer.getWriteBuffer(), ibuffer.getSize());
-	ibuffer.setWriteLength(msgLength);
-	
+	INetworkBuffer* ibuffer = waitOspfReply(requestID);
+	if (!ibuffer)
+		return false;
+
 	//Process response messages
-	ibuffer >> message >> vlsr.switchID >> vlsr.inPort >> vlsr.outPort>>vlsr.vlanTag;
+	*ibuffer >> vlsr.switchID >> vlsr.inPort >> vlsr.outPort>>vlsr.vlanTag;
+	delete ibuffer;
 
-	return;
+	return true;
 
 }
 
@@ -463,110 +669,146 @@ const void RoutingService::notifyOSPF(uint8 msgType, const NetAddress& ctrlIfIP,
 	if ((msgType == OspfResv || msgType == OspfPathTear || msgType == OspfResvTear) &&
 		ospf_socket)
 	{
-		uint8 msgLength = sizeof(uint8)*2+ctrlIfIP.size()+sizeof(ieee32float);
+		uint8 msgLength = sizeof(uint8)*2+sizeof(uint32)+ctrlIfIP.size()+sizeof(ieee32float);
 		ONetworkBuffer obuffer(msgLength);
-		obuffer << msgLength << msgType << ctrlIfIP << bw;
+		obuffer << msgLength << msgType << (uint32)0 << ctrlIfIP << bw;
+		sendOspfHoldBatch();
 		CheckOspfSocket(write(ospf_socket, obuffer.getContents(), obuffer.getUsedSize()));
 	}
 }
 
+OspfHoldBatch::OspfHoldBatch( RoutingService& routing ) : routing(routing) {
+	routing.beginOspfHoldBatch();
+}
+
+OspfHoldBatch::~OspfHoldBatch() {
+	routing.endOspfHoldBatch();
+}
+
+void RoutingService::endOspfHoldBatch() {
+	if (ospfHoldBatchDepth > 0 && --ospfHoldBatchDepth == 0)
+		sendOspfHoldBatch();
+}
+
+// Holds and releases are sent as entries of a HoldResourcesbyOSPF message:
+// type(8) + hold(8) + port(32) + the data of the single message of that type.
+// Outside of a batch each entry is sent on its own right away.
+void RoutingService::queueOspfHold( const ONetworkBuffer& entry ) {
+	if (ospfHoldBatchLength + entry.getUsedSize() > ospfHoldBatchSize)
+		sendOspfHoldBatch();
+	memcpy(ospfHoldBatch + ospfHoldBatchLength, entry.getContents(), entry.getUsedSize());
+	ospfHoldBatchLength += entry.getUsedSize();
+	if (ospfHoldBatchDepth == 0)
+		sendOspfHoldBatch();
+}
+
+void RoutingService::sendOspfHoldBatch() {
+	if (ospfHoldBatchLength == 0)
+		return;
+	uint8 message = HoldResourcesbyOSPF;
+	uint8 msgLength = sizeof(uint8)*2 + sizeof(uint32) + ospfHoldBatchLength;
+	ONetworkBuffer obuffer(msgLength);
+	obuffer << msgLength << message << (uint32)0;
+	for (uint8 i = 0; i < ospfHoldBatchLength; i++)
+		obuffer << ospfHoldBatch[i];
+	ospfHoldBatchLength = 0;
+	CheckOspfSocket(write(ospf_socket, obuffer.getContents(), obuffer.getUsedSize()));
+}
+
 //Hold or release bandwidth
 const void RoutingService::holdBandwidthbyOSPF(u_int32_t port, float bw, bool hold, u_int32_t ucid, u_int32_t seqnum) {
-	uint8 message = HoldBandwidthbyOSPF;
-	uint8 msgLength = sizeof(uint8)*2 + sizeof(uint32)*2 + sizeof(uint8) + sizeof(uint32)*2;
+	uint8 type = HoldBandwidthbyOSPF;
 	uint8 c_hold = hold ? 1 : 0;
-	ONetworkBuffer obuffer(msgLength);
-	obuffer << msgLength << message << port << bw << c_hold << ucid << seqnum;
-	CheckOspfSocket(write(ospf_socket, obuffer.getContents(), obuffer.getUsedSize()));
+	ONetworkBuffer entry(sizeof(uint8)*2 + sizeof(uint32)*4);
+	entry << type << c_hold << port << bw << ucid << seqnum;
+	queueOspfHold(entry);
 }
 
 
 //Hold or release VLAN Tag
 const void RoutingService::holdVtagbyOSPF(u_int32_t port, u_int32_t vtag, bool hold) {
-	uint8 message = HoldVtagbyOSPF;
-	uint8 msgLength = sizeof(uint8)*2 + sizeof(uint32)*2 + sizeof(uint8);
+	uint8 type = HoldVtagbyOSPF;
 	uint8 c_hold = hold ? 1 : 0;
-	ONetworkBuffer obuffer(msgLength);
-	obuffer << msgLength << message <<port << vtag <<c_hold;
-	CheckOspfSocket(write(ospf_socket, obuffer.getContents(), obuffer.getUsedSize()));
+	ONetworkBuffer entry(sizeof(uint8)*2 + sizeof(uint32)*2);
+	entry << type << c_hold << port << vtag;
+	queueOspfHold(entry);
 }
 
 
 //Hold or release SONET/SDH TimeSlots
 const void RoutingService::holdTimeslotsbyOSPF(u_int32_t port, SimpleList<uint8>& timeslots, bool hold) {
-	uint8 message = HoldTimeslotsbyOSPF;
-	uint8 msgLength = sizeof(uint8)*2 + sizeof(uint32) + timeslots.size() + sizeof(uint8);
+	uint8 type = HoldTimeslotsbyOSPF;
 	uint8 c_hold = hold ? 1 : 0;
-	ONetworkBuffer obuffer(msgLength);
-	obuffer << msgLength << message <<port << c_hold;
+	uint8 count = timeslots.size();
+	ONetworkBuffer entry(sizeof(uint8)*3 + sizeof(uint32) + count);
+	entry << type << c_hold << port << count;
 	SimpleList<uint8>::Iterator it = timeslots.begin();
 	for (; it != timeslots.end(); ++it) {
-		obuffer << *it;
+		entry << *it;
 	}
-	CheckOspfSocket(write(ospf_socket, obuffer.getContents(), obuffer.getUsedSize()));
+	queueOspfHold(entry);
 }
 
 
 const void RoutingService::holdOTNXChannelsByOSPF(u_int32_t port, uint32 opvcx_range, bool hold) {
-	uint8 message = HoldOTNXChannelsbyOSPF;
-	uint8 msgLength = sizeof(uint8)*2 + sizeof(uint32)*2 + sizeof(uint8);
+	uint8 type = HoldOTNXChannelsbyOSPF;
 	uint8 c_hold = hold ? 1 : 0;
-	ONetworkBuffer obuffer(msgLength);
-	obuffer << msgLength << message <<port <<opvcx_range << c_hold;
-	CheckOspfSocket(write(ospf_socket, obuffer.getContents(), obuffer.getUsedSize()));
+	ONetworkBuffer entry(sizeof(uint8)*2 + sizeof(uint32)*2);
+	entry << type << c_hold << port << opvcx_range;
+	queueOspfHold(entry);
 }
 
 // we may use port number instead of uniID
 bool RoutingService::getSubnetUNIDatabyOSPF(const NetAddress& dataIf, const uint8 uniID, SubnetUNI_Data& uniData) {
 	uint8 message = GetSubnetUNIDataByOSPF;
-	uint8 msgLength = sizeof(uint8)*2 + sizeof(uint32) + sizeof(uint8);
+	uint8 msgLength = sizeof(uint8)*2 + sizeof(uint32) + sizeof(uint32) + sizeof(uint8);
+	uint32 requestID = newOspfRequest();
 	ONetworkBuffer obuffer(msgLength);
-	obuffer << msgLength << message <<dataIf << uniID;
+	obuffer << msgLength << message << requestID <<dataIf << uniID;
 	CheckOspfSocket(write(ospf_socket, obuffer.getContents(), obuffer.getUsedSize()));
 
 	//Read response from OSPF
-	read(ospf_socket, (void *)&msgLength, sizeof(uint8));
-	read(ospf_socket, (void *)&message, sizeof(uint8));
-	if (msgLength <= sizeof(uint8)*2)
+	INetworkBuffer* ibuffer = waitOspfReply(requestID);
+	if (!ibuffer || ibuffer->getRemainingSize() == 0) {
+		if (ibuffer) delete ibuffer;
 		return false;
-	INetworkBuffer ibuffer(msgLength-sizeof(uint8));
-	msgLength = read(ospf_socket, ibuffer.getWriteBuffer(), ibuffer.getSize());
-	ibuffer.setWriteLength(msgLength);
+	}
 	//Process response messages
 	uniData.subnet_id = uniID;
-	ibuffer >> uniData.tna_ipv4 >> uniData.uni_nid_ipv4 >> uniData.data_if_ipv4 >> uniData.logical_port >> uniData.egress_label >>uniData.upstream_label;
+	*ibuffer >> uniData.tna_ipv4 >> uniData.uni_nid_ipv4 >> uniData.data_if_ipv4 >> uniData.logical_port >> uniData.egress_label >>uniData.upstream_label;
 
 	int i = 0;
-	for ( ; i < 12; i++) ibuffer >> uniData.control_channel_name[i];
-	for (i = 0; i < 16; i++) ibuffer >> uniData.node_name[i];
-	ibuffer >> uniData.options;
-	for (i = 0; i < MAX_TIMESLOTS_NUM/8; i++) ibuffer >> uniData.timeslot_bitmask[i];
+	for ( ; i < 12; i++) *ibuffer >> uniData.control_channel_name[i];
+	for (i = 0; i < 16; i++) *ibuffer >> uniData.node_name[i];
+	*ibuffer >> uniData.options;
+	for (i = 0; i < MAX_TIMESLOTS_NUM/8; i++) *ibuffer >> uniData.timeslot_bitmask[i];
+	delete ibuffer;
 
 	return true;
 }
 
 bool RoutingService::getCienaOTNXDatabyOSPF(const NetAddress& dataIf, const uint8 otnxID, OTNX_Data& opvcxData) {
 	uint8 message = GetCienaOPVCXDataByOSPF;
-	uint8 msgLength = sizeof(uint8)*2 + sizeof(uint32) + sizeof(uint8);
+	uint8 msgLength = sizeof(uint8)*2 + sizeof(uint32) + sizeof(uint32) + sizeof(uint8);
+	uint32 requestID = newOspfRequest();
 	ONetworkBuffer obuffer(msgLength);
-	obuffer << msgLength << message <<dataIf << otnxID;
+	obuffer << msgLength << message << requestID <<dataIf << otnxID;
 	CheckOspfSocket(write(ospf_socket, obuffer.getContents(), obuffer.getUsedSize()));
 
 	//Read response from OSPF
-	read(ospf_socket, (void *)&msgLength, sizeof(uint8));
-	read(ospf_socket, (void *)&message, sizeof(uint8));
-	if (msgLength <= sizeof(uint8)*2)
+	INetworkBuffer* ibuffer = waitOspfReply(requestID);
+	if (!ibuffer || ibuffer->getRemainingSize() == 0) {
+		if (ibuffer) delete ibuffer;
 		return false;
-	INetworkBuffer ibuffer(msgLength-sizeof(uint8));
-	msgLength = read(ospf_socket, ibuffer.getWriteBuffer(), ibuffer.getSize());
-	ibuffer.setWriteLength(msgLength);
+	}
 	//Process response messages
-	ibuffer >> opvcxData.switch_ip >> opvcxData.tl1_port >> opvcxData.eth_edge >> opvcxData.otnx_if_id >> opvcxData.data_ipv4
+	*ibuffer >> opvcxData.switch_ip >> opvcxData.tl1_port >> opvcxData.eth_edge >> opvcxData.otnx_if_id >> opvcxData.data_ipv4
 		>> opvcxData.logical_port_number >>opvcxData.channel_type >> opvcxData.add_to_wdm >> opvcxData.num_chans;
 
 	int j;
 	for (j = 0; j < (int)opvcxData.num_chans/8; j++)
-		ibuffer >> opvcxData.wave_opvc_bitmask[j];
+		*ibuffer >> opvcxData.wave_opvc_bitmask[j];
+	delete ibuffer;
 
 	return true;
 }
@@ -587,32 +829,27 @@ NetAddress RoutingService::getLoopbackAddress() {
 
 	//Write packet to OSPF socket ask for my hop control IP address
 	uint8 message = GetLoopbackAddress;
-	uint8 msgLength = sizeof(uint8)*2;
+	uint8 msgLength = sizeof(uint8)*2 + sizeof(uint32);
+	uint32 requestID = newOspfRequest();
 	ONetworkBuffer obuffer(msgLength);
-	obuffer << msgLength << message;
+	obuffer << msgLength << message << requestID;
 	CheckOspfSocket(write(ospf_socket, obuffer.getContents(), obuffer.getUsedSize()));
 
-	msgLength = 0;
 	//Read response from OSPF
-	read(ospf_socket, (void *)&msgLength, sizeof(uint8));
-	read(ospf_socket, (void *)&message, sizeof(uint8));
-
-	if (msgLength <= sizeof(uint8)*2)
+	INetworkBuffer* ibuffer = waitOspfReply(requestID);
+	if (!ibuffer || ibuffer->getRemainingSize() == 0)
 	{
+		if (ibuffer) delete ibuffer;
 		return NetAddress(0);
 	}
 	else{
-		INetworkBuffer ibuffer(msgLength-sizeof(uint8));
-		msgLength = read(ospf_socket, ibuffer.getWriteBuffer(), ibuffer.getSize());
-		ibuffer.setWriteLength(msgLength);
-	
 		NetAddress LoopBackAddr;
-		ibuffer >> LoopBackAddr;	
+		*ibuffer >> LoopBackAddr;
+		delete ibuffer;
 		return LoopBackAddr;
 	}
 }
 
-
 const LogicalInterface* RoutingService::getUnicastRoute( const NetAddress& dest, NetAddress& gw ) {
 #if defined(REAL_NETWORK)
 	NetAddress readDest = 0;
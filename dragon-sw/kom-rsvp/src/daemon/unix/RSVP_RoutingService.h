@@ -34,6 +34,7 @@
 #include "RSVP_BasicTypes.h"
 #include "RSVP_Lists.h"
 #include "RSVP_LogicalInterfaceSet.h"
+#include "RSVP_TimeValue.h"
 #include "SwitchCtrl_Session_SubnetUNI.h"
 #include "SwitchCtrl_Session_CienaCN4200.h"
 
@@ -53,6 +54,7 @@ public:
 };
 
 class RSRR;
+class RoutingService;
 class RoutingEntryList;
 
 typedef struct _vlsr_route_{
@@ -67,12 +69,55 @@ typedef struct _vlsr_route_{
 }VLSR_Route;
 typedef SimpleList<VLSR_Route> VLSRRoute;
 
+// request to OSPFd that has been sent but whose reply has not been picked up
+// yet; 'reply' stays NULL if OSPFd went away before answering
+class OspfRequest {
+	uint32 id;
+	bool answered;
+	INetworkBuffer* reply;
+	TimeValue sent;
+	OspfRequest( uint32 id ) : id(id), answered(false), reply(NULL) { getCurrentSystemTime( sent ); }
+	~OspfRequest() { if (reply) delete reply; }
+	friend class RoutingService;
+};
+typedef SimpleList<OspfRequest*> OspfRequestList;
+
+// holds and releases made while an OspfHoldBatch is in scope are sent to
+// OSPFd together, so that it refreshes each TE link LSA only once
+class OspfHoldBatch {
+	RoutingService& routing;
+public:
+	OspfHoldBatch( RoutingService& routing );
+	~OspfHoldBatch();
+};
+
 class RoutingService {
 	RSRR* rsrr;
 	RoutingEntryList* rtList;
 	pid_t mainPID;
 	int ospf_socket;
 	bool ospf_operational;
+	// every request to OSPFd is tagged with an ID that OSPFd echoes in its
+	// reply, so that several requests can be outstanding at the same time
+	uint32 ospfRequestID;
+	OspfRequestList ospfRequests;
+	OspfRequest* resumedRequest;
+	// large enough for the longest reply, see ospfReplyLength()
+	static const uint32 ospfReadBufferSize = 65536;
+	uint8 ospfReadBuffer[ospfReadBufferSize];
+	uint32 ospfReadLength;
+	uint32 ospfReplyLength( uint32 start ) const;
+	static const uint8 ospfHoldBatchSize = 255 - 2*sizeof(uint8) - sizeof(uint32);
+	uint8 ospfHoldBatch[ospfHoldBatchSize];
+	uint8 ospfHoldBatchLength;
+	uint16 ospfHoldBatchDepth;
+	void queueOspfHold( const ONetworkBuffer& entry );
+	void sendOspfHoldBatch();
+	uint32 newOspfRequest();
+	// seconds to wait for a reply that is waited for in line
+	static const sint32 ospfReplyTimeout = 5;
+	INetworkBuffer* waitOspfReply( uint32 requestID );
+	void closeOspfSocket();
 #if defined(Linux)
 	mutable uint32 queryCounter;
 #else
@@ -104,27 +149,42 @@ public:
 		HoldTimeslotsbyOSPF = 137, 		// Hold or release timeslots
 		GetCienaOPVCXDataByOSPF = 138, /* Get Ciena OTN OPVCX data associated with an OSPF interface */
 		HoldOTNXChannelsbyOSPF = 139, 		// Hold or release Ciena OTN OPVC timeslots
+		GetExplicitRoutesByOSPF = 140,	// Get a disjoint pair or the k shortest explicit routes from OSPF
+		HoldResourcesbyOSPF = 141,		// Hold or release a batch of resources
 	};
 	RoutingService();
 	~RoutingService();
 	const int getOspfSocket() const { return ospf_socket; }
-	void disableOspfSocket() { ospf_socket = 0; ospf_operational = false; }
+	void disableOspfSocket() { closeOspfSocket(); ospf_operational = false; }
 	bool ospfOperational() { return ospf_operational; }
 	bool ospf_socket_init ();
+	// asynchronous requests: readOspfReplies() is called from the main loop
+	// when the socket is readable, a request whose reply has arrived is
+	// resumed by MessageProcessor::queryEnqueuedMessages()
+	void readOspfReplies();
+	bool ospfReplyArrived( uint32 requestID ) const;
+	void resumeOspfRequest( uint32 requestID );
+	void clearResumedOspfRequest();
+	uint32 requestExplicitRouteByOSPF(const NetAddress& src, const NetAddress& dest, const SENDER_TSPEC_Object& sendTSpec, const LABEL_REQUEST_Object& labelReq,
+		const SESSION_ATTRIBUTE_Object* sessionAttr = NULL, uint32 vtag = 0);
+	bool takeResumedExplicitRoute( EXPLICIT_ROUTE_Object*& ero );
 	void getPeerIPAddr(const NetAddress& myAddr, NetAddress& peerAddr) const;
 	void init( LogicalInterfaceList& tmpLifList );
 	void init2();
 	bool getRoute( const NetAddress&, LogicalInterface*& lif, NetAddress& gateway ) const;
-	EXPLICIT_ROUTE_Object* getExplicitRouteByOSPF(const NetAddress& src, const NetAddress& dest, const SENDER_TSPEC_Object& sendTSpec, const LABEL_REQUEST_Object& labelReq);
+	EXPLICIT_ROUTE_Object* getExplicitRouteByOSPF(const NetAddress& src, const NetAddress& dest, const SENDER_TSPEC_Object& sendTSpec, const LABEL_REQUEST_Object& labelReq,
+		const SESSION_ATTRIBUTE_Object* sessionAttr = NULL, uint32 vtag = 0);
 	const LogicalInterface* findInterfaceByData( const NetAddress& ip, const uint32 ifID = 0);
 	bool findDataByInterface(const LogicalInterface& lif, NetAddress& ip, uint32& ifID);
 	const void notifyOSPF(uint8 msgType, const NetAddress& ctrlIfIP, ieee32float bw  );
 	const LogicalInterface* findOutLifByOSPF( const NetAddress& , const uint32 , NetAddress& );
-	const void getVLSRRoutebyOSPF(const NetAddress& inRtID, const NetAddress& outRtID, const uint32 inIfId, const uint32 outIfId, VLSR_Route& vlsr);
+	bool getVLSRRoutebyOSPF(const NetAddress& inRtID, const NetAddress& outRtID, const uint32 inIfId, const uint32 outIfId, VLSR_Route& vlsr);
 	const void holdBandwidthbyOSPF(u_int32_t port, float bw, bool hold = true, u_int32_t ucid = 0, u_int32_t seqnum = 0);
 	const void holdVtagbyOSPF(u_int32_t port, u_int32_t vtag, bool hold = true);
 	const void holdTimeslotsbyOSPF(u_int32_t port, SimpleList<uint8>& timeslots, bool hold);
 	const void holdOTNXChannelsByOSPF(u_int32_t port, uint32 opvcx_range, bool hold);
+	void beginOspfHoldBatch() { ++ospfHoldBatchDepth; }
+	void endOspfHoldBatch();
 	NetAddress getLoopbackAddress();
 	bool getSubnetUNIDatabyOSPF(const NetAddress& dataIf, const uint8 uniID, SubnetUNI_Data& uniData);
 	bool getCienaOTNXDatabyOSPF(const NetAddress& dataIf, const uint8 otnxID, OTNX_Data& opvcxData);
@@ -151,8 +211,7 @@ public:
 	} \
 	CHECK(function); \
 	if (CHECK_result < 0) { \
-		CHECK(close(ospf_socket)); \
-		ospf_socket = 0; \
+		closeOspfSocket(); \
 	} \
 
 #endif /* _RSVP_RoutingService_h_ */
@@ -18,6 +18,7 @@ bool SNMP_Session::movePortToVLANAsUntagged(uint32 port, uint32 vlanID)
 
     if ((!active) || !rfc2674_compatible || port==SWITCH_CTRL_PORT || vlanID<MIN_VLAN || vlanID>MAX_VLAN) 
     	return false; //don't touch the control port!
+    beginSetBatch();
     int old_vlan = getVLANbyUntaggedPort(port);
     if (old_vlan) { //Remove untagged port from old VLAN
         //mask=(~(1<<(32-port))) & 0xFFFFFFFF;
@@ -55,7 +56,7 @@ bool SNMP_Session::movePortToVLANAsUntagged(uint32 port, uint32 vlanID)
         ret&=setVLANPVID(port, vlanID); //Set pvid
     }
 
-    return ret;
+    return commitSetBatch() && ret;
 }
 
 bool SNMP_Session::movePortToVLANAsTagged(uint32 port, uint32 vlanID)
@@ -70,13 +71,12 @@ bool SNMP_Session::movePortToVLANAsTagged(uint32 port, uint32 vlanID)
     //there is no need to remove a to-be-tagged-in-new-VLAN port from old VLAN
 	//mask = 1<<(32-port);
 	vpmAll = getVlanPortMapById(vlanPortMapListAll, vlanID);
-	if (vpmAll) {
-	    //vpmAll->ports |=mask;
-	    SetBit(vpmAll->portbits,port-1);
-	    ret&=setVLANPort(vpmAll->portbits, vlanID) ;
-    }
-    else
-        return false;
+	if (!vpmAll)
+	    return false;
+	beginSetBatch();
+	//vpmAll->ports |=mask;
+	SetBit(vpmAll->portbits,port-1);
+	ret&=setVLANPort(vpmAll->portbits, vlanID) ;
     //no need of setVLANPVID for PowerConnect 5224
 	if (vendor == RFC2674 && vendorSystemDescription !="PowerConnect 5224"){
 		ret&=setVLANPVID(port, vlanID); //Set pvid
@@ -90,7 +90,7 @@ bool SNMP_Session::movePortToVLANAsTagged(uint32 port, uint32 vlanID)
 	    ret&=setVLANPortTag(vpmUntagged->portbits, vlanID);
     }
 
-	return ret;
+	return commitSetBatch() && ret;
 }
 
 bool SNMP_Session::removePortFromVLAN(uint32 port, uint32 vlanID)
@@ -102,6 +102,7 @@ bool SNMP_Session::removePortFromVLAN(uint32 port, uint32 vlanID)
     	return false; //don't touch the control port!
 
     if (vlanID>=MIN_VLAN && vlanID<=MAX_VLAN) {
+        beginSetBatch();
       	 //uint32 mask=(~(1<<(32-port))) & 0xFFFFFFFF;
     	 vpmAll = getVlanPortMapById(vlanPortMapListAll, vlanID);
         if (vpmAll)
@@ -119,6 +120,7 @@ bool SNMP_Session::removePortFromVLAN(uint32 port, uint32 vlanID)
     	}
     	if (vpmAll)
     	    ret &= setVLANPort(vpmAll->portbits, vlanID); //remove
+        ret = commitSetBatch() && ret;
     } else {
         LOG(2) (Log::MPLS, "Trying to remove port from an invalid VLAN ", vlanID);
     }
@@ -140,43 +142,15 @@ bool SNMP_Session::setVLANPVID(uint32 port, uint32 vlanID)
 {
         LOG(4)( Log::MPLS, "VLSR: SNMP: setting PVID", vlanID, "on port", port);
 
-	struct snmp_pdu *pdu;
-	struct snmp_pdu *response;
-	oid anOID[MAX_OID_LEN];
-	size_t anOID_len = MAX_OID_LEN;
-	char type, value[128], oid_str[128];
-	int status;
+	char value[128], oid_str[128];
 	String tag_oid_str = ".1.3.6.1.2.1.17.7.1.4.5.1.1";
 
 	if (!active || !rfc2674_compatible) //not initialized or session has been disconnected
 		return false;
-	// Create the PDU for the data for our request. 
-	  pdu = snmp_pdu_create(SNMP_MSG_SET);
-
-	  // vlan port list 
-	  sprintf(oid_str, "%s.%d", tag_oid_str.chars(), port);
-	  status = read_objid(oid_str, anOID, &anOID_len);
-	  type='u'; 
-  	  sprintf(value, "%d", vlanID);
-	  
-	  status = snmp_add_var(pdu, anOID, anOID_len, type, value);
-
-	  // Send the Request out. 
-	  status = snmp_synch_response(snmpSessionHandle, pdu, &response);
-	    
-	  if (status == STAT_SUCCESS && response->errstat == SNMP_ERR_NOERROR) {
-	  	snmp_free_pdu(response);
-	  }
-	  else {
-	  	if (status == STAT_SUCCESS){
-			LOG(4)( Log::MPLS, "VLSR: SNMP: Setting VLAN PVID", switchInetAddr, "failed. Reason : ", snmp_errstring(response->errstat));
-	    	}
-	    	else
-	      		snmp_sess_perror("snmpset", snmpSessionHandle);
-		if(response) snmp_free_pdu(response);
-		return false;
-	  }
-	  return true;
+
+	sprintf(oid_str, "%s.%d", tag_oid_str.chars(), port);
+	sprintf(value, "%d", vlanID);
+	return SNMPSet(oid_str, 'u', value);
 }
 
 bool SNMP_Session::setVLANPortTag(uint8* portbits, uint32 vlanID)
@@ -190,46 +164,19 @@ bool SNMP_Session::setVLANPortTag(uint8* portbits, uint32 vlanID)
 //reset port bit  for untagged-only OID
 bool SNMP_Session::setVLANPortTag(uint8* portbits, int bitlen, uint32 vlanID)
 {
-	struct snmp_pdu *pdu;
-	struct snmp_pdu *response;
-	oid anOID[MAX_OID_LEN];
-	size_t anOID_len = MAX_OID_LEN;
-	char type, value[512], oid_str[128], oct[3];
-	int status, i;
+	char value[512], oid_str[128], oct[3];
+	int i;
 	String tag_oid_str = ".1.3.6.1.2.1.17.7.1.4.3.1.4";
 
 	if (!active || !rfc2674_compatible) //not initialized or session has been disconnected
 		return false;
-	// Create the PDU for the data for our request. 
-	  pdu = snmp_pdu_create(SNMP_MSG_SET);
-
-	  // vlan port list 
-	  sprintf(oid_str, "%s.%d", tag_oid_str.chars(), vlanID);
-	  status = read_objid(oid_str, anOID, &anOID_len);
-	  type='x';
-
-         for (i = 0, value[0] = 0; i < (bitlen+7)/8; i++) { 
-            snprintf(oct, 3, "%.2x", portbits[i]);
-            strcat(value,oct);
-         }
-	  status = snmp_add_var(pdu, anOID, anOID_len, type, value);
-
-	  // Send the Request out. 
-	  status = snmp_synch_response(snmpSessionHandle, pdu, &response);
-	    
-	  if (status == STAT_SUCCESS && response->errstat == SNMP_ERR_NOERROR) {
-	  	snmp_free_pdu(response);
-	  }
-	  else {
-	  	if (status == STAT_SUCCESS){
-			LOG(4)( Log::MPLS, "VLSR: SNMP: Setting VLAN Tag of Ethernet switch", switchInetAddr, "failed. Reason : ", snmp_errstring(response->errstat));
-	    	}
-	    	else
-	      		snmp_sess_perror("snmpset", snmpSessionHandle);
-		if(response) snmp_free_pdu(response);
-		return false;
-	  }
-	  return true;
+
+	sprintf(oid_str, "%s.%d", tag_oid_str.chars(), vlanID);
+	for (i = 0, value[0] = 0; i < (bitlen+7)/8; i++) { 
+		snprintf(oct, 3, "%.2x", portbits[i]);
+		strcat(value,oct);
+	}
+	return SNMPSet(oid_str, 'x', value);
 }
 
 bool SNMP_Session::setVLANPort(uint8* portbits, uint32 vlanID)
@@ -253,46 +200,18 @@ bool SNMP_Session::setVLANPort(uint8* portbits, uint32 vlanID)
 //set port bitmask for tagged/untagged (egress) OID
 bool SNMP_Session::setVLANPort(uint8* portbits, int bitlen, uint32 vlanID)
 {
-	struct snmp_pdu *pdu;
-	struct snmp_pdu *response;
-	oid anOID[MAX_OID_LEN];
-	size_t anOID_len = MAX_OID_LEN;
-	char type, value[512], oid_str[128], oct[3];
-	int status, i;
+	char value[512], oid_str[128], oct[3];
+	int i;
 
 	if (!active || !rfc2674_compatible) //not initialized or session has been disconnected
 		return false;
-	// Create the PDU for the data for our request. 
-	  pdu = snmp_pdu_create(SNMP_MSG_SET);
-
-	  // vlan port list 
-	  sprintf(oid_str, "%s.%d", supportedVendorOidString[vendor].chars(), vlanID);
-	  status = read_objid(oid_str, anOID, &anOID_len);
-	  type='x'; 
-
-         for (i = 0, value[0] = 0; i < (bitlen+7)/8; i++) { 
-            snprintf(oct, 3, "%.2x", portbits[i]);
-            strcat(value,oct);
-         }
-	  
-	  status = snmp_add_var(pdu, anOID, anOID_len, type, value);
-
-	  // Send the Request out. 
-	  status = snmp_synch_response(snmpSessionHandle, pdu, &response);
-	    
-	  if (status == STAT_SUCCESS && response->errstat == SNMP_ERR_NOERROR) {
-	  	snmp_free_pdu(response);
-	  }
-	  else {
-	  	if (status == STAT_SUCCESS){
-			LOG(4)( Log::MPLS, "VLSR: SNMP: Setting VLAN of Ethernet switch", switchInetAddr, "failed. Reason : ", snmp_errstring(response->errstat));
-	    	}
-	    	else
-	      		snmp_sess_perror("snmpset", snmpSessionHandle);
-		if(response) snmp_free_pdu(response);
-		return false;
-	  }
-	  return true;
+
+	sprintf(oid_str, "%s.%d", supportedVendorOidString[vendor].chars(), vlanID);
+	for (i = 0, value[0] = 0; i < (bitlen+7)/8; i++) { 
+		snprintf(oct, 3, "%.2x", portbits[i]);
+		strcat(value,oct);
+	}
+	return SNMPSet(oid_str, 'x', value);
 }
 
 /////////////----------///////////
@@ -510,6 +429,11 @@ bool SNMP_Session::SNMPSet(char* oid_str, char type, char* value)
     if (!active) //not initialized or session has been disconnected
         return false;
 
+    if (setBatching) {
+        addToSetBatch(oid_str, type, value);
+        return true;
+    }
+
     // Create the PDU for the data for our SNMP request. 
     pdu = snmp_pdu_create(SNMP_MSG_SET);
 
@@ -525,7 +449,7 @@ bool SNMP_Session::SNMPSet(char* oid_str, char type, char* value)
     }
     else {
         if (status == STAT_SUCCESS){
-           LOG(4)( Log::MPLS, "VLSR: SNMP: Setting SNMP at OID", oid_str, "failed. Reason : ", snmp_errstring(response->errstat));
+           LOG(6)( Log::MPLS, "VLSR: SNMP: Setting SNMP at OID", oid_str, "of Ethernet switch", switchInetAddr, "failed. Reason : ", snmp_errstring(response->errstat));
         }
         else
       	    snmp_sess_perror("snmpset", snmpSessionHandle);
@@ -536,3 +460,63 @@ bool SNMP_Session::SNMPSet(char* oid_str, char type, char* value)
     return true;
 }
 
+// a later SET of the same object replaces an earlier one and takes its place
+// at the end of the batch, as it would have when they were sent one by one
+void SNMP_Session::addToSetBatch(const char* oid_str, char type, const char* value)
+{
+    SimpleList<snmp_set_entry>::Iterator iter = setBatch.begin();
+    for ( ; iter != setBatch.end(); ++iter) {
+        if (strcmp((*iter).oid_str, oid_str) == 0) {
+            setBatch.erase(iter);
+            break;
+        }
+    }
+    snmp_set_entry entry;
+    iter = setBatch.push_back(entry);
+    strncpy((*iter).oid_str, oid_str, sizeof((*iter).oid_str)-1);
+    (*iter).oid_str[sizeof((*iter).oid_str)-1] = 0;
+    (*iter).type = type;
+    strncpy((*iter).value, value, sizeof((*iter).value)-1);
+    (*iter).value[sizeof((*iter).value)-1] = 0;
+}
+
+// send the collected SETs in one PDU; a switch that rejects the batch gets
+// them one by one, in the order they were made
+bool SNMP_Session::commitSetBatch()
+{
+    struct snmp_pdu *pdu;
+    struct snmp_pdu *response = NULL;
+    oid anOID[MAX_OID_LEN];
+    size_t anOID_len;
+    int status;
+    bool ret = true;
+    SimpleList<snmp_set_entry>::Iterator iter;
+
+    setBatching = false;
+    if (setBatch.size() > 1) {
+        pdu = snmp_pdu_create(SNMP_MSG_SET);
+        for (iter = setBatch.begin(); iter != setBatch.end(); ++iter) {
+            anOID_len = MAX_OID_LEN;
+            if (!read_objid((*iter).oid_str, anOID, &anOID_len) || snmp_add_var(pdu, anOID, anOID_len, (*iter).type, (*iter).value) != 0) {
+                snmp_free_pdu(pdu);
+                pdu = NULL;
+                break;
+            }
+        }
+        if (pdu) {
+            status = snmp_synch_response(snmpSessionHandle, pdu, &response);
+            if (status == STAT_SUCCESS && response->errstat == SNMP_ERR_NOERROR) {
+                snmp_free_pdu(response);
+                setBatch.clear();
+                return true;
+            }
+            LOG(4)( Log::MPLS, "VLSR: SNMP: batched SET of", setBatch.size(), "objects failed, retrying one by one on", switchInetAddr);
+            if(response) snmp_free_pdu(response);
+        }
+    }
+
+    for (iter = setBatch.begin(); iter != setBatch.end(); ++iter)
+        ret &= SNMPSet((*iter).oid_str, (*iter).type, (*iter).value);
+    setBatch.clear();
+    return ret;
+}
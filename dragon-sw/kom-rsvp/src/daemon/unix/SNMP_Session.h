@@ -12,12 +12,19 @@ To be incorporated into KOM-RSVP-TE package
 
 #include "SwitchCtrl_Global.h"
 
+//one object of a batched SNMP SET
+struct snmp_set_entry {
+	char oid_str[128];
+	char type;
+	char value[512];
+};
+
 class SNMP_Session: public SwitchCtrl_Session
 {
 	
 public:
-	SNMP_Session(): SwitchCtrl_Session() { untaggedPortBit_reverse = false; }
-	SNMP_Session(const RSVP_String& sName, const NetAddress& swAddr): SwitchCtrl_Session(sName, swAddr) { untaggedPortBit_reverse = false;  }
+	SNMP_Session(): SwitchCtrl_Session() { untaggedPortBit_reverse = false; setBatching = false; }
+	SNMP_Session(const RSVP_String& sName, const NetAddress& swAddr): SwitchCtrl_Session(sName, swAddr) { untaggedPortBit_reverse = false; setBatching = false; }
 	virtual ~SNMP_Session() { }
 
 	virtual bool SNMPSet(char*, char, char*);
@@ -52,8 +59,16 @@ public:
 	// when set true, bit=0 means *set* to indicate the port is untagged
 	void setUntaggedPortBitReverse(bool b) { untaggedPortBit_reverse = b; } 
 
+	// SNMPSet() calls between the two are sent in one SET PDU
+	void beginSetBatch() { setBatching = true; setBatch.clear(); }
+	bool commitSetBatch();
+
 protected:
 	bool untaggedPortBit_reverse;
+	bool setBatching;
+	SimpleList<snmp_set_entry> setBatch;
+
+	void addToSetBatch(const char* oid_str, char type, const char* value);
 };
 
 #endif //ifndef _SNMP_SESSION_H_
@@ -8,6 +8,7 @@ To be incorporated into KOM-RSVP-TE package
 ****************************************************************************/
 
 #include "SwitchCtrl_Global.h"
+#include "SwitchCtrl_Worker.h"
 #include "RSVP_Log.h"
 #include "RSVP_Message.h"
 #include "SNMP_Session.h"
@@ -35,10 +36,14 @@ To be incorporated into KOM-RSVP-TE package
 #endif
 
 #include <signal.h>
+#include <errno.h>
 
 ////////////////Global Definitions//////////////
 
 LocalIdList SwitchCtrl_Global::localIdList;
+CLIConnectionList SwitchCtrl_Global::cliConnPool;
+pthread_mutex_t SwitchCtrl_Global::cliConnPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+bool SwitchCtrl_Global::cliConnPoolDisabled = false;
 
 
 /////////////////////////////////////////////////////////////
@@ -225,16 +230,8 @@ const uint32 SwitchCtrl_Session::findEmptyVLAN()
 
 bool SwitchCtrl_Session::readVlanPortMapBranch(const char* oid_str, vlanPortMapList &vpmList)
 {
-    struct snmp_pdu *pdu;
-    struct snmp_pdu *response;
-    netsnmp_variable_list *vars;
-    oid anOID[MAX_OID_LEN];
-    oid root[MAX_OID_LEN];
-    size_t anOID_len = MAX_OID_LEN;
-    int status;
-    vlanPortMap portmap;
-    bool running = true;
-    size_t rootlen;
+    snmp_branch_walk walk;
+    SnmpBranchWalkList walks;
 
     //Since the function takes oid_str as argument, can be used even for switches 
     // that are not RFC2674 compatible such as Cisco Catalyst
@@ -242,88 +239,209 @@ bool SwitchCtrl_Session::readVlanPortMapBranch(const char* oid_str, vlanPortMapL
     if (!snmp_enabled)
         return false;
 
-    status = read_objid(oid_str, anOID, &anOID_len);
-    rootlen = anOID_len;
-    memcpy(root, anOID, rootlen*sizeof(oid));
+    if (startVlanPortMapWalk(walk, oid_str, vpmList))
+        walks.push_back(&walk);
+    if (walks.empty() || !walkVlanPortMapBranches(walks)) {
+        LOG(1)( Log::MPLS, "VLSR: Error while reading VLAN/port mapping from Switch!");
+        return false;
+    }
+    return true;
+}
+
+// both columns are read at the same time, each with its own GETBULK requests
+bool SwitchCtrl_Session::readVlanPortMapBranches(const char* oid_str1, vlanPortMapList &vpmList1, const char* oid_str2, vlanPortMapList &vpmList2)
+{
+    snmp_branch_walk walk1, walk2;
+    SnmpBranchWalkList walks;
+    bool ret = true;
+
+    if (!snmp_enabled)
+        return false;
+
+    if (startVlanPortMapWalk(walk1, oid_str1, vpmList1))
+        walks.push_back(&walk1);
+    else
+        ret = false;
+    if (startVlanPortMapWalk(walk2, oid_str2, vpmList2))
+        walks.push_back(&walk2);
+    else
+        ret = false;
+    if (!walkVlanPortMapBranches(walks) || !ret) {
+        LOG(1)( Log::MPLS, "VLSR: Error while reading VLAN/port mapping from Switch!");
+        return false;
+    }
+    return true;
+}
+
+bool SwitchCtrl_Session::startVlanPortMapWalk(snmp_branch_walk& walk, const char* oid_str, vlanPortMapList &vpmList)
+{
+    walk.session = this;
+    walk.vpmList = &vpmList;
+    walk.rootlen = MAX_OID_LEN;
+    walk.done = walk.failed = true;
     vpmList.clear();
-    while (running) {
-        // Create the PDU for the data for our request.
-        pdu = snmp_pdu_create(SNMP_MSG_GETBULK);
-        pdu->non_repeaters = 0;
-        pdu->max_repetitions = 100; 
-        snmp_add_null_var(pdu, anOID, anOID_len);
-        // Send the Request out.
-        status = snmp_synch_response(snmpSessionHandle, pdu, &response);
-        if (status == STAT_SUCCESS && response->errstat == SNMP_ERR_NOERROR) {
-            for (vars = response->variables; vars; vars = vars->next_variable) {
-                if ((vars->name_length < rootlen) || (memcmp(anOID, vars->name, rootlen * sizeof(oid)) != 0)) {
-                    running = false;
-                    continue;
-                }
+    if (!read_objid(oid_str, walk.root, &walk.rootlen))
+        return false;
+    memcpy(walk.next, walk.root, walk.rootlen*sizeof(oid));
+    walk.nextlen = walk.rootlen;
+    walk.done = walk.failed = false;
+    return sendVlanPortMapWalk(walk);
+}
 
-                hook_getPortMapFromSnmpVars(portmap, vars);
-                 
-                vpmList.push_back(portmap);
-                if ((vars->type != SNMP_ENDOFMIBVIEW) &&
-                    (vars->type != SNMP_NOSUCHOBJECT) &&
-                    (vars->type != SNMP_NOSUCHINSTANCE)) {
-                    memcpy((char *)anOID, (char *)vars->name, vars->name_length * sizeof(oid));
-                    anOID_len = vars->name_length;
-                }
-                else {
-                    running = false;
-                }
-            }
+bool SwitchCtrl_Session::sendVlanPortMapWalk(snmp_branch_walk& walk)
+{
+    // Create the PDU for the data for our request.
+    struct snmp_pdu *pdu = snmp_pdu_create(SNMP_MSG_GETBULK);
+    pdu->non_repeaters = 0;
+    pdu->max_repetitions = RSVP_Global::switchController->getSnmpBulkRepetitions();
+    snmp_add_null_var(pdu, walk.next, walk.nextlen);
+    // Send the Request out; the reply is handled by vlanPortMapWalkCallback
+    if (snmp_async_send(walk.session->snmpSessionHandle, pdu, vlanPortMapWalkCallback, &walk) == 0) {
+        snmp_sess_perror("snmpbulkwalk", walk.session->snmpSessionHandle);
+        snmp_free_pdu(pdu);
+        walk.done = walk.failed = true;
+        return false;
+    }
+    return true;
+}
+
+int SwitchCtrl_Session::vlanPortMapWalkCallback(int operation, struct snmp_session* sp, int reqid, struct snmp_pdu* response, void* magic)
+{
+    snmp_branch_walk& walk = *(snmp_branch_walk*)magic;
+    netsnmp_variable_list *vars;
+    vlanPortMap portmap;
+    bool running = true;
+
+    if (operation != NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE || response->errstat != SNMP_ERR_NOERROR) {
+        walk.done = walk.failed = true;
+        return 1;
+    }
+    for (vars = response->variables; vars && running; vars = vars->next_variable) {
+        if ((vars->name_length < walk.rootlen) || (memcmp(walk.root, vars->name, walk.rootlen * sizeof(oid)) != 0)) {
+            running = false;
+            continue;
+        }
+
+        walk.session->hook_getPortMapFromSnmpVars(portmap, vars);
+
+        walk.vpmList->push_back(portmap);
+        if ((vars->type != SNMP_ENDOFMIBVIEW) &&
+            (vars->type != SNMP_NOSUCHOBJECT) &&
+            (vars->type != SNMP_NOSUCHINSTANCE)) {
+            memcpy((char *)walk.next, (char *)vars->name, vars->name_length * sizeof(oid));
+            walk.nextlen = vars->name_length;
         }
         else {
-            LOG(1)( Log::MPLS, "VLSR: Error while reading VLAN/port mapping from Switch!");
-	        if(response) snmp_free_pdu(response);
-			return false;
+            running = false;
         }
-        if(response) snmp_free_pdu(response);
     }
-	return true;
+    if (running && response->variables)
+        sendVlanPortMapWalk(walk);
+    else
+        walk.done = true;
+    return 1;
 }
 
-bool SwitchCtrl_Session::readVLANFromSwitch()
+bool SwitchCtrl_Session::walkVlanPortMapBranches(SnmpBranchWalkList& walks)
 {
+    SnmpBranchWalkList::ConstIterator iter;
     bool ret = true;
 
-    if (!hook_createVlanInterfaceToIDRefTable(vlanRefIdConvList))
-        return false;
-
-    if (!hook_createPortToIDRefTable(portRefIdConvList))
-        return false;
+    for (;;) {
+        bool running = false;
+        for (iter = walks.begin(); iter != walks.end(); ++iter) {
+            if (!(*iter)->done)
+                running = true;
+        }
+        if (!running)
+            break;
 
-    // Read and record the list of ALL ports and their vlan associations
-    if (rfc2674_compatible) {
-    	if (!readVlanPortMapBranch(".1.3.6.1.2.1.17.7.1.4.3.1.2", vlanPortMapListAll))
-			return false;
-    }
-    else if (vendor == Catalyst3750 || vendor == Catalyst6500) {
-		if (!readVlanPortMapListAllBranch(vlanPortMapListAll))
-			return false;
+        int numfds = 0, block = 1, count;
+        fd_set fdset;
+        struct timeval timeout;
+        FD_ZERO(&fdset);
+        snmp_select_info(&numfds, &fdset, &timeout, &block);
+        count = select(numfds, &fdset, NULL, NULL, block ? NULL : &timeout);
+        if (count > 0) {
+            snmp_read(&fdset);
+        }
+        else if (count == 0) {
+            snmp_timeout();
+        }
+        else if (errno != EINTR) {
+            // the callbacks of outstanding requests refer to the walks, so
+            // they are left to time out
+            LOG(2)( Log::MPLS, "VLSR: select() failed while reading VLAN/port mapping, errno=", errno);
+            sleep(1);
+            snmp_timeout();
+        }
     }
-    else {
-    	if (!readVlanPortMapBranch(".1.3.6.1.2.1.17.7.1.4.3.1.2", vlanPortMapListAll))
-			return false;
+
+    for (iter = walks.begin(); iter != walks.end(); ++iter) {
+        if ((*iter)->failed)
+            ret = false;
     }
-    if (vlanPortMapListAll.size() == 0)
-        ret = false;
+    return ret;
+}
 
-    // Read and record the list of UNTAGGED/NON-TRUNK ports and their vlan associations
-    if (rfc2674_compatible) {
-    	if (!readVlanPortMapBranch(".1.3.6.1.2.1.17.7.1.4.3.1.4", vlanPortMapListUntagged))
+bool SwitchCtrl_Session::readVLANFromSwitch()
+{
+    // Read and record the lists of ALL and of UNTAGGED/NON-TRUNK ports and their vlan associations
+    if (!canBatchVLANRead()) {
+        vlanCacheValid = false;
+        if (!hook_createVlanInterfaceToIDRefTable(vlanRefIdConvList))
+            return false;
+        if (!hook_createPortToIDRefTable(portRefIdConvList))
+            return false;
+		if (!readVlanPortMapListAllBranch(vlanPortMapListAll))
 			return false;
-    }
-    else if (vendor == Catalyst3750 || vendor == Catalyst6500) {
     	if (!readVlanPortMapBranch(".1.3.6.1.4.1.9.9.68.1.2.1.1.3", vlanPortMapListUntagged))
 			return false;
+        return checkVLANsReadFromSwitch();
     }
-    else {
-    	if (!readVlanPortMapBranch(".1.3.6.1.2.1.17.7.1.4.3.1.4", vlanPortMapListUntagged))
-			return false;
+
+    SnmpBranchWalkList walks;
+    if (!startReadVLANFromSwitch(walks))
+        return false;
+    walkVlanPortMapBranches(walks);
+    return finishReadVLANFromSwitch();
+}
+
+// the RFC2674 columns are walked by the caller, possibly along with those of other switches
+bool SwitchCtrl_Session::startReadVLANFromSwitch(SnmpBranchWalkList& walks)
+{
+    vlanCacheValid = false;
+    if (!hook_createVlanInterfaceToIDRefTable(vlanRefIdConvList))
+        return false;
+
+    if (!hook_createPortToIDRefTable(portRefIdConvList))
+        return false;
+
+    if (!snmp_enabled)
+        return false;
+
+    if (startVlanPortMapWalk(vlanWalkAll, ".1.3.6.1.2.1.17.7.1.4.3.1.2", vlanPortMapListAll))
+        walks.push_back(&vlanWalkAll);
+    if (startVlanPortMapWalk(vlanWalkUntagged, ".1.3.6.1.2.1.17.7.1.4.3.1.4", vlanPortMapListUntagged))
+        walks.push_back(&vlanWalkUntagged);
+    return true;
+}
+
+bool SwitchCtrl_Session::finishReadVLANFromSwitch()
+{
+    if (vlanWalkAll.failed || vlanWalkUntagged.failed) {
+        LOG(1)( Log::MPLS, "VLSR: Error while reading VLAN/port mapping from Switch!");
+        return false;
     }
+    return checkVLANsReadFromSwitch();
+}
+
+bool SwitchCtrl_Session::checkVLANsReadFromSwitch()
+{
+    bool ret = true;
+
+    if (vlanPortMapListAll.size() == 0)
+        ret = false;
     if (vlanPortMapListUntagged.size() == 0)
         ret = false;
 
@@ -344,9 +462,87 @@ bool SwitchCtrl_Session::readVLANFromSwitch()
     LOG(4)( Log::MPLS, "VLSR: received VLAN/port mapping from Switch, total VLANs=", 
 	    vlanPortMapListAll.size(), ", untagged VLANs=", vlanPortMapListUntagged.size());
 
+    vlanCacheValid = ret;
     return ret;
 }
 
+// number of VLANs whose port map differs between the two lists
+static uint32 countVlanPortMapChanges(const vlanPortMapList& vpmListOld, const vlanPortMapList& vpmListNew)
+{
+    vlanPortMapList::ConstIterator iterOld, iterNew;
+    uint32 changes = 0;
+
+    for (iterNew = vpmListNew.begin(); iterNew != vpmListNew.end(); ++iterNew) {
+        for (iterOld = vpmListOld.begin(); iterOld != vpmListOld.end(); ++iterOld) {
+            if ((*iterOld).vid == (*iterNew).vid)
+                break;
+        }
+        if (iterOld == vpmListOld.end() || memcmp((*iterOld).portbits, (*iterNew).portbits, MAX_VLAN_PORT_BYTES) != 0)
+            changes++;
+    }
+    for (iterOld = vpmListOld.begin(); iterOld != vpmListOld.end(); ++iterOld) {
+        for (iterNew = vpmListNew.begin(); iterNew != vpmListNew.end(); ++iterNew) {
+            if ((*iterNew).vid == (*iterOld).vid)
+                break;
+        }
+        if (iterNew == vpmListNew.end())
+            changes++;
+    }
+    return changes;
+}
+
+// re-reads the VLANs in the background and adopts what the switch reports; changes that
+// were not made by us are logged
+bool SwitchCtrl_Session::reconcileVLANCache()
+{
+    if (!vlanCacheValid)
+        return true;
+
+    vlanPortMapList cachedAll = vlanPortMapListAll;
+    vlanPortMapList cachedUntagged = vlanPortMapListUntagged;
+    if (!readVLANFromSwitch()) {
+        LOG(2)( Log::MPLS, "VLSR: Failed to reconcile the VLAN cache with switch", switchInetAddr);
+        return false;
+    }
+    logVLANCacheChanges(cachedAll, cachedUntagged);
+    return true;
+}
+
+// false if there is nothing to walk, finishReconcileVLANCache() is only called after true
+bool SwitchCtrl_Session::startReconcileVLANCache(SnmpBranchWalkList& walks)
+{
+    if (!vlanCacheValid)
+        return false;
+
+    reconcileListAll = vlanPortMapListAll;
+    reconcileListUntagged = vlanPortMapListUntagged;
+    if (!startReadVLANFromSwitch(walks)) {
+        LOG(2)( Log::MPLS, "VLSR: Failed to reconcile the VLAN cache with switch", switchInetAddr);
+        return false;
+    }
+    return true;
+}
+
+bool SwitchCtrl_Session::finishReconcileVLANCache()
+{
+    bool ret = finishReadVLANFromSwitch();
+    if (ret)
+        logVLANCacheChanges(reconcileListAll, reconcileListUntagged);
+    else
+        LOG(2)( Log::MPLS, "VLSR: Failed to reconcile the VLAN cache with switch", switchInetAddr);
+    reconcileListAll.clear();
+    reconcileListUntagged.clear();
+    return ret;
+}
+
+void SwitchCtrl_Session::logVLANCacheChanges(const vlanPortMapList& cachedAll, const vlanPortMapList& cachedUntagged)
+{
+    uint32 changes = countVlanPortMapChanges(cachedAll, vlanPortMapListAll) + countVlanPortMapChanges(cachedUntagged, vlanPortMapListUntagged);
+    if (changes > 0) {
+        LOG(4)( Log::MPLS, "VLSR: VLAN cache of switch", switchInetAddr, "was out of date, changed VLAN port maps:", changes);
+    }
+}
+
 uint32 SwitchCtrl_Session::getVLANbyPort(uint32 port, bool countVlan1){
     vlanPortMapList::Iterator iter;
     for (iter = vlanPortMapListAll.begin(); iter != vlanPortMapListAll.end(); ++iter) {
@@ -393,6 +589,9 @@ bool SwitchCtrl_Session::verifyVLAN(uint32 vlanID)
     if (!active || !rfc2674_compatible || !snmp_enabled)
         return false;
 
+    if (vlanCacheValid)
+        return getVlanPortMapById(vlanPortMapListAll, vlanID) != NULL;
+
     vlanID = hook_convertVLANIDToInterface(vlanID);
 
     if (vlanID == 0)
@@ -436,6 +635,14 @@ bool SwitchCtrl_Session::VLANHasTaggedPort(uint32 vlanID)
     if (!active || !rfc2674_compatible || !snmp_enabled)
         return false;
 
+    if (vlanCacheValid) {
+        vlanPortMap* vpmAll = getVlanPortMapById(vlanPortMapListAll, vlanID);
+        vlanPortMap* vpmUntagged = getVlanPortMapById(vlanPortMapListUntagged, vlanID);
+        if (!vpmAll || !vpmUntagged)
+            return false;
+        return memcmp(vpmAll->portbits, vpmUntagged->portbits, MAX_VLAN_PORT_BYTES) != 0;
+    }
+
     memset(&portmap_all, 0, sizeof(vlanPortMap));
 
     portmap_all.vid = hook_convertVLANIDToInterface(vlanID);
@@ -717,11 +924,18 @@ SwitchCtrl_Global::SwitchCtrl_Global()
 
 	sessionsRefresher = NULL;
 	switchVlanOptions = 0;
+	snmpBulkRepetitions = SNMP_BULK_REPETITIONS;
+	resumedVLANSync.id = 0;
+	vlanSyncRequestID = 0;
 }
 
 SwitchCtrl_Global::~SwitchCtrl_Global() {
 	if (sessionsRefresher)
 		delete sessionsRefresher;
+	CLIConnectionList::Iterator connIter = cliConnPool.begin();
+	for ( ; connIter != cliConnPool.end(); ++connIter)
+		CLI_Session::closeConnection(*connIter);
+	cliConnPool.clear();
 	/* disconnectSwitch is called in ~SwitchCtrl_Session. No need to remove this list manually.
 	SwitchCtrlSessionList::Iterator sessionIter = sessionList.begin();
 	for ( ; sessionIter != sessionList.end(); ++sessionIter){
@@ -735,15 +949,287 @@ void SwitchCtrl_Global::startRefreshTimer() {
 	sessionsRefresher = new sessionsRefreshTimer(this, TimeValue(270));
 }
 
+// keeps the CLI connection of a switch alive, run on the switch control worker
+class SwitchCtrl_RefreshJob : public SwitchCtrl_Job {
+public:
+	SwitchCtrl_RefreshJob(SwitchCtrl_Session* session) : SwitchCtrl_Job(session) {}
+	virtual bool run() { return getSession()->refresh(); }
+	virtual void complete(bool result) {
+		if (!result) {
+			LOG(2)( Log::MPLS, "VLSR: Failed to refresh switch control session with", getSession()->getSwitchInetAddr());
+		}
+	}
+};
+
+// reconciles the VLAN caches of the SNMP switches, the walks of all of them are
+// outstanding at the same time; run on the switch control worker
+class SwitchCtrl_ReconcileJob : public SwitchCtrl_Job {
+public:
+	SwitchCtrl_ReconcileJob() : SwitchCtrl_Job(NULL) {}
+	void addSession(SwitchCtrl_Session* session) { holdSession(session); }
+	bool empty() const { return getHeldSessions().empty(); }
+	virtual bool run() {
+		SwitchCtrlSessionList started;
+		SnmpBranchWalkList walks;
+		bool ret = true;
+		SwitchCtrlSessionList::ConstIterator iter = getHeldSessions().begin();
+		for ( ; iter != getHeldSessions().end(); ++iter) {
+			if (!(*iter)->canBatchVLANRead()) {
+				if (!(*iter)->reconcileVLANCache())
+					ret = false;
+			}
+			else if ((*iter)->startReconcileVLANCache(walks))
+				started.push_back(*iter);
+		}
+		if (!walks.empty())
+			SwitchCtrl_Session::walkVlanPortMapBranches(walks);
+		for (iter = started.begin(); iter != started.end(); ++iter) {
+			if (!(*iter)->finishReconcileVLANCache())
+				ret = false;
+		}
+		return ret;
+	}
+	virtual void complete(bool result) {}
+};
+
+// keeps the pooled CLI channels alive, queued without a session
+class SwitchCtrl_KeepAliveJob : public SwitchCtrl_Job {
+public:
+	SwitchCtrl_KeepAliveJob() : SwitchCtrl_Job(NULL) {}
+	virtual bool run() { SwitchCtrl_Global::keepAliveCLIConnections(); return true; }
+	virtual void complete(bool result) {}
+};
+
+// creates the session of a switch if there is none and reads its VLANs for deferred PATH
+// messages, run on the switch control worker
+class SwitchCtrl_VLANSyncJob : public SwitchCtrl_Job {
+	SwitchCtrl_Global* controller;
+	NetAddress switchAddr;
+	uint32 requestID;
+	SwitchCtrl_Session* newSession;
+	uint32 errCode;
+public:
+	SwitchCtrl_VLANSyncJob(SwitchCtrl_Global* controller, const NetAddress& swAddr, SwitchCtrl_Session* session, uint32 requestID)
+		: SwitchCtrl_Job(session), controller(controller), switchAddr(swAddr), requestID(requestID), newSession(NULL), errCode(0) {}
+	virtual bool run() {
+		SwitchCtrl_Session* session = getSession();
+		if (!session) {
+			newSession = controller->createSession(switchAddr);
+			if (!newSession) {
+				errCode = (ERROR_SPEC_Object::Notify << 16 | ERROR_SPEC_Object::SwitchSessionFailed);
+				return false;
+			}
+			if (!newSession->connectSwitch()) {
+				delete newSession;
+				newSession = NULL;
+				errCode = (ERROR_SPEC_Object::Notify << 16 | ERROR_SPEC_Object::RSVPSwitchConnectFailure);
+				return false;
+			}
+			session = newSession;
+		}
+		if (!controller->hasSwitchVlanOption(SW_VLAN_REDUCE_SNMP_SYNC) && !session->syncVLANFromSwitch()) {
+			errCode = (ERROR_SPEC_Object::Notify << 16 | ERROR_SPEC_Object::RSVPSwitchSNMPFailure);
+			return false;
+		}
+		return true;
+	}
+	virtual void complete(bool result) {
+		if (newSession)
+			controller->addSession(newSession);
+		if (!result) {
+			LOG(2)( Log::MPLS, "VLSR: Failed to read VLANs from switch", switchAddr);
+		}
+		controller->completeVLANSync(requestID, errCode);
+	}
+};
+
+// PATH messages for the same switch share a request that has not completed yet
+uint32 SwitchCtrl_Global::requestVLANSync(const NetAddress& swAddr, SwitchCtrl_Session* session)
+{
+	VLANSyncRequestList::Iterator iter = vlanSyncRequests.begin();
+	for ( ; iter != vlanSyncRequests.end(); ++iter) {
+		if (!(*iter).done && (*iter).switchAddr == swAddr) {
+			(*iter).waiters += 1;
+			return (*iter).id;
+		}
+	}
+	vlan_sync_request request;
+	vlanSyncRequestID += 1;
+	if (vlanSyncRequestID == 0)
+		vlanSyncRequestID = 1;
+	request.id = vlanSyncRequestID;
+	request.switchAddr = swAddr;
+	request.done = false;
+	request.errCode = 0;
+	request.waiters = 1;
+	vlanSyncRequests.push_back(request);
+	SwitchCtrl_Worker::enqueue(new SwitchCtrl_VLANSyncJob(this, swAddr, session, request.id));
+	return request.id;
+}
+
+void SwitchCtrl_Global::completeVLANSync(uint32 requestID, uint32 errCode)
+{
+	VLANSyncRequestList::Iterator iter = vlanSyncRequests.begin();
+	for ( ; iter != vlanSyncRequests.end(); ++iter) {
+		if ((*iter).id == requestID) {
+			(*iter).done = true;
+			(*iter).errCode = errCode;
+			return;
+		}
+	}
+}
+
+bool SwitchCtrl_Global::vlanSyncDone(uint32 requestID) const
+{
+	VLANSyncRequestList::ConstIterator iter = vlanSyncRequests.begin();
+	for ( ; iter != vlanSyncRequests.end(); ++iter) {
+		if ((*iter).id == requestID)
+			return (*iter).done;
+	}
+	return true;
+}
+
+// make the result of 'requestID' available to the PATH message that is processed
+// again now, see takeResumedVLANSync()
+void SwitchCtrl_Global::resumeVLANSync(uint32 requestID)
+{
+	clearResumedVLANSync();
+	VLANSyncRequestList::Iterator iter = vlanSyncRequests.begin();
+	for ( ; iter != vlanSyncRequests.end(); ++iter) {
+		if ((*iter).id == requestID) {
+			resumedVLANSync = *iter;
+			(*iter).waiters -= 1;
+			if ((*iter).waiters == 0)
+				vlanSyncRequests.erase(iter);
+			return;
+		}
+	}
+}
+
+bool SwitchCtrl_Global::takeResumedVLANSync(const NetAddress& swAddr, uint32& errCode)
+{
+	if (resumedVLANSync.id == 0 || resumedVLANSync.switchAddr != swAddr)
+		return false;
+	errCode = resumedVLANSync.errCode;
+	clearResumedVLANSync();
+	return true;
+}
+
 bool SwitchCtrl_Global::refreshSessions()
 {
-	bool ret = true;
+	SwitchCtrl_ReconcileJob* reconcile = new SwitchCtrl_ReconcileJob();
 	SwitchCtrlSessionList::Iterator sessionIter = sessionList.begin();
 	for ( ; sessionIter != sessionList.end(); ++sessionIter){
-		ret &= (*sessionIter)->refresh();
+		// a busy session does not need to be kept alive
+		if (SwitchCtrl_Worker::isBusy(*sessionIter))
+			continue;
+		SwitchCtrl_Worker::enqueue(new SwitchCtrl_RefreshJob(*sessionIter));
+		if ((*sessionIter)->snmpEnabled())
+			reconcile->addSession(*sessionIter);
+	}
+	// checked before the reconcile job joins the queue without session
+	if (hasCLIConnections() && !SwitchCtrl_Worker::isBusy(NULL))
+		SwitchCtrl_Worker::enqueue(new SwitchCtrl_KeepAliveJob());
+	if (reconcile->empty())
+		delete reconcile;
+	else
+		SwitchCtrl_Worker::enqueue(reconcile);
+	return true;
+}
+
+bool SwitchCtrl_Global::takeCLIConnection(const NetAddress& swAddr, int port, cli_conn_entry& conn)
+{
+	bool found = false;
+	pthread_mutex_lock(&cliConnPoolMutex);
+	CLIConnectionList::Iterator iter = cliConnPool.begin();
+	for ( ; iter != cliConnPool.end(); ++iter) {
+		if ((*iter).switchAddr == swAddr && (*iter).port == port) {
+			conn = *iter;
+			cliConnPool.erase(iter);
+			found = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&cliConnPoolMutex);
+	return found;
+}
+
+// one idle channel per switch is enough, a second one is logged out; false if
+// the pool takes no channels, the caller then logs out itself
+bool SwitchCtrl_Global::returnCLIConnection(const cli_conn_entry& conn)
+{
+	bool found = false;
+	if (cliConnPoolDisabled)
+		return false;
+	pthread_mutex_lock(&cliConnPoolMutex);
+	CLIConnectionList::ConstIterator iter = cliConnPool.begin();
+	for ( ; iter != cliConnPool.end(); ++iter) {
+		if ((*iter).switchAddr == conn.switchAddr && (*iter).port == conn.port) {
+			found = true;
+			break;
+		}
 	}
+	if (!found)
+		cliConnPool.push_back(conn);
+	pthread_mutex_unlock(&cliConnPoolMutex);
+	if (found)
+		CLI_Session::closeConnection(conn);
+	return true;
+}
+
+bool SwitchCtrl_Global::hasCLIConnections()
+{
+	pthread_mutex_lock(&cliConnPoolMutex);
+	bool ret = !cliConnPool.empty();
+	pthread_mutex_unlock(&cliConnPoolMutex);
 	return ret;
 }
+
+// the channels are taken out of the pool while they are checked, so that no
+// session picks up one that is waiting for its keepalive reply
+void SwitchCtrl_Global::keepAliveCLIConnections()
+{
+	CLIConnectionList checkList;
+	time_t now = time(NULL);
+	pthread_mutex_lock(&cliConnPoolMutex);
+	checkList = cliConnPool;
+	cliConnPool.clear();
+	pthread_mutex_unlock(&cliConnPoolMutex);
+
+	CLIConnectionList::Iterator iter = checkList.begin();
+	while (iter != checkList.end()) {
+		if (now - (*iter).lastUsed > CLI_POOL_IDLE_TIMEOUT) {
+			LOG(2)( Log::MPLS, "VLSR: closing idle CLI connection to", (*iter).switchAddr);
+			CLI_Session::closeConnection(*iter);
+			iter = checkList.erase(iter);
+		} else if (!CLI_Session::keepAliveConnection(*iter)) {
+			LOG(2)( Log::MPLS, "VLSR: pooled CLI connection lost to", (*iter).switchAddr);
+			CLI_Session::closeConnection(*iter);
+			iter = checkList.erase(iter);
+		} else {
+			++iter;
+		}
+	}
+
+	iter = checkList.begin();
+	for ( ; iter != checkList.end(); ++iter)
+		returnCLIConnection(*iter);
+}
+
+// a forked child must not talk over the channels of its parent; it runs
+// no worker, so the pool mutex is simply set up again. Its own channels are
+// logged out rather than pooled, the child exits right after using them.
+void SwitchCtrl_Global::forgetCLIConnections()
+{
+	pthread_mutex_init(&cliConnPoolMutex, NULL);
+	cliConnPoolDisabled = true;
+	CLIConnectionList::Iterator iter = cliConnPool.begin();
+	for ( ; iter != cliConnPool.end(); ++iter) {
+		close((*iter).fdin);
+		close((*iter).fdout);
+	}
+	cliConnPool.clear();
+}
 bool SwitchCtrl_Global::static_connectSwitch(struct snmp_session* &sessionHandle, NetAddress& switchAddr)
 {
     LOG(2)( Log::MPLS, "VLSR: establishing SNMP session with switch", switchAddr);
@@ -774,9 +1260,13 @@ bool SwitchCtrl_Global::static_connectSwitch(struct snmp_session* &sessionHandle
     return true;
 }
 
+// a session disconnects once more when it is deleted
 void SwitchCtrl_Global::static_disconnectSwitch(struct snmp_session* &sessionHandle) 
 {
-    snmp_close(sessionHandle);
+    if (sessionHandle) {
+        snmp_close(sessionHandle);
+        sessionHandle = NULL;
+    }
 }
 
 bool SwitchCtrl_Global::static_getSwitchVendorInfo(struct snmp_session* &sessionHandle, uint32 &vendor, String &vendorSystemDescription) 
@@ -1121,7 +1611,7 @@ void SwitchCtrl_Global::removeSession(SwitchCtrl_Session* scSS)
 	SwitchCtrlSessionList::Iterator iter = sessionList.begin();
 	for (; iter != sessionList.end(); ++iter ) {
 		if ((*(*iter))==(*scSS)) {
-			delete (*iter);
+			SwitchCtrl_Worker::releaseSession(*iter);
 			sessionList.erase(iter);
 			return;
 		}
@@ -1319,11 +1809,162 @@ SONET_TSpec* SwitchCtrl_Global::getEosMapEntry(float bandwidth)
     return addEosMapEntry(bandwidth, sts1, (int)ceilf(bandwidth/49.536));
 }
 
-void SwitchCtrl_Global::getMonitoringInfo(MON_Query_Subobject& monQuery, MON_Reply_Subobject& monReply, uint32 destIp)
+static void setMonError(MON_Reply_Subobject& monReply, uint16 errCode)
+{
+    monReply.sub_type = MON_REPLY_SUBTYPE_ERROR;
+    monReply.length = MON_REPLY_BASE_SIZE;
+    monReply.switch_options = (MON_SWITCH_OPTION_ERROR|errCode);
+}
+
+static void setMonSubnetType(MON_Reply_Subobject& monReply)
+{
+    if ((monReply.switch_options & MON_SWITCH_OPTION_SUBNET)) {
+        if ((monReply.switch_options & MON_SWITCH_OPTION_SUBNET_SRC) && (monReply.switch_options & MON_SWITCH_OPTION_SUBNET_DEST))
+            monReply.sub_type = MON_REPLY_SUBTYPE_SUBNET_SRCDEST;
+        else if ((monReply.switch_options & MON_SWITCH_OPTION_SUBNET_SRC))
+            monReply.sub_type = MON_REPLY_SUBTYPE_SUBNET_SRC;
+        else if ((monReply.switch_options & MON_SWITCH_OPTION_SUBNET_DEST))
+            monReply.sub_type = MON_REPLY_SUBTYPE_SUBNET_DEST;
+    }
+}
+
+//ethernet switch vlsr --> get VLAN and ports from the vlsr route of the PSB
+static bool getMonEthernetInfo(PSB& psb, struct _Ethernet_Circuit_Info& vlanInfo)
+{
+    VLSRRoute& vlsrtList = psb.getVLSR_Route();
+    if (vlsrtList.size() != 1)
+        return false;
+    VLSR_Route& vlsrt = vlsrtList.front();
+    memset(&vlanInfo, 0, sizeof(struct _Ethernet_Circuit_Info));
+    SimpleList<uint32> portList;
+    SimpleList<uint32>::Iterator portIter;
+    int i;
+    switch (vlsrt.inPort >> 16) {
+        case LOCAL_ID_TYPE_PORT:
+            vlanInfo.vlan_ingress = 0;
+            vlanInfo.num_ports_ingress = 1;
+            vlanInfo.ports_ingress[0] = (vlsrt.inPort & 0xffff);
+            break;
+        case LOCAL_ID_TYPE_GROUP:
+            vlanInfo.vlan_ingress = 0;
+            SwitchCtrl_Global::getPortsByLocalId(portList, vlsrt.inPort);
+            vlanInfo.num_ports_ingress = portList.size();
+            for (portIter = portList.begin(), i = 0; portIter != portList.end(); ++portIter, ++i)
+                vlanInfo.ports_ingress[i] = ((*portIter) & 0xffff);
+            break;
+        case LOCAL_ID_TYPE_TAGGED_GROUP:
+            vlanInfo.vlan_ingress = (vlsrt.inPort & 0xffff);
+            SwitchCtrl_Global::getPortsByLocalId(portList, vlsrt.inPort);
+            vlanInfo.num_ports_ingress = portList.size();
+            for (portIter = portList.begin(), i = 0; portIter != portList.end(); ++portIter, ++i)
+                vlanInfo.ports_ingress[i] = ((*portIter) & 0xffff);
+            break;
+        case LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL:
+            vlanInfo.vlan_ingress = vlsrt.vlanTag;
+            vlanInfo.num_ports_ingress = 1;
+            vlanInfo.ports_ingress[0] = (vlsrt.inPort & 0xffff);
+            break;
+    }
+    switch (vlsrt.outPort >> 16) {
+        case LOCAL_ID_TYPE_PORT:
+            vlanInfo.vlan_egress = 0;
+            vlanInfo.num_ports_egress = 1;
+            vlanInfo.ports_egress[0] = (vlsrt.outPort & 0xffff);
+            break;
+        case LOCAL_ID_TYPE_GROUP:
+            vlanInfo.vlan_egress = 0;
+            SwitchCtrl_Global::getPortsByLocalId(portList, vlsrt.outPort);
+            vlanInfo.num_ports_egress = portList.size();
+            for (portIter = portList.begin(), i = 0; portIter != portList.end(); ++portIter, ++i)
+                vlanInfo.ports_egress[i] = ((*portIter) & 0xffff);
+            break;
+        case LOCAL_ID_TYPE_TAGGED_GROUP:
+            vlanInfo.vlan_egress = (vlsrt.outPort & 0xffff);
+            SwitchCtrl_Global::getPortsByLocalId(portList, vlsrt.outPort);
+            vlanInfo.num_ports_egress = portList.size();
+            for (portIter = portList.begin(), i = 0; portIter != portList.end(); ++portIter, ++i)
+                vlanInfo.ports_egress[i] = ((*portIter) & 0xffff);
+            break;
+        case LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL:
+            vlanInfo.vlan_egress = vlsrt.vlanTag;
+            vlanInfo.num_ports_egress = 1;
+            vlanInfo.ports_egress[0] = (vlsrt.outPort & 0xffff);
+            break;
+    }
+    return true;
+}
+
+// answers a monitoring query from the state of the switch control sessions, which the
+// switch control jobs change; run on the switch control worker
+class SwitchCtrl_MonitoringJob : public SwitchCtrl_Job {
+	SESSION_Object sessionObject;
+	MON_Reply_Subobject monReply;
+	bool switchOnly;
+	bool ethernetValid;
+	struct _Ethernet_Circuit_Info ethernetInfo;
+	uint32 circuitOptions;
+	uint16 errCode;
+	bool getInfo(SwitchCtrl_Session* session) {
+		if (!session->getMonSwitchInfo(monReply)) {
+			errCode = 3; //failed to retrieve switch info
+			return false;
+		}
+		if (switchOnly)
+			return true;
+		if ((monReply.switch_options & MON_SWITCH_OPTION_SUBNET) == 0) {
+			if (!ethernetValid) {
+				errCode = 5; // incorrect vlsr route information
+				return false;
+			}
+			monReply.sub_type = MON_REPLY_SUBTYPE_ETHERNET; //Ethernet
+			monReply.length = MON_REPLY_BASE_SIZE + sizeof(struct _Ethernet_Circuit_Info);
+			monReply.circuit_info.vlan_info = ethernetInfo;
+		} else if (!session->getMonCircuitInfo(monReply)) { //edge-control subnet vlsr
+			errCode = 4; //failed to retrieve circuit info (subnetSwitchCtrlSession)
+			return false;
+		}
+		return true;
+	}
+public:
+	SwitchCtrl_MonitoringJob(SwitchCtrl_Session* session, const SESSION_Object& sessionObject, const MON_Reply_Subobject& monReply, PSB* psb)
+		: SwitchCtrl_Job(session), sessionObject(sessionObject), monReply(monReply), switchOnly(psb == NULL), ethernetValid(false), circuitOptions(0), errCode(0) {
+		if (psb) {
+			ethernetValid = getMonEthernetInfo(*psb, ethernetInfo);
+			//flags whether the VLSR is source or/and destination node.
+			if (psb->getSession().getDestAddress() == Session::ospfRouterID)
+				circuitOptions |= MON_SWITCH_OPTION_CIRCUIT_SRC;
+			if (psb->getSrcAddress() == Session::ospfRouterID)
+				circuitOptions |= MON_SWITCH_OPTION_CIRCUIT_DEST;
+		}
+	}
+	void addSession(SwitchCtrl_Session* session) { holdSession(session); }
+	virtual bool run() {
+		if (!getInfo(getSession()))
+			return false;
+		SwitchCtrlSessionList::ConstIterator iter = getHeldSessions().begin();
+		for ( ; iter != getHeldSessions().end(); ++iter) {
+			if (!getInfo(*iter))
+				return false;
+		}
+		return true;
+	}
+	virtual void complete(bool result) {
+		if (!result) {
+			setMonError(monReply, errCode);
+		} else if (!switchOnly) {
+			monReply.switch_options |= circuitOptions;
+			setMonSubnetType(monReply);
+		}
+		RSVP_Global::messageProcessor->sendDragonMonReply(sessionObject, monReply);
+	}
+};
+
+// the reply is sent once the switch control worker has collected the information
+void SwitchCtrl_Global::getMonitoringInfo(const SESSION_Object& sessionObject, MON_Query_Subobject& monQuery, MON_Reply_Subobject& monReply)
 {
     uint16 errCode = 0;
     SwitchCtrlSessionList::Iterator it;
-    bool foundSession = false;
+    SwitchCtrl_MonitoringJob* job = NULL;
     PSB* psb = NULL;
 
     monReply.switch_options = 0;
@@ -1333,14 +1974,11 @@ void SwitchCtrl_Global::getMonitoringInfo(MON_Query_Subobject& monQuery, MON_Rep
              errCode = 1; //no switch control session
              goto _error;
         }
-        if (!sessionList.front()->getMonSwitchInfo(monReply)) {
-                  errCode = 3; //failed to retrieve switch info
-                  goto _error;
-        }				
+        SwitchCtrl_Worker::enqueue(new SwitchCtrl_MonitoringJob(sessionList.front(), sessionObject, monReply, NULL));
         return;
     }
 
-    psb = RSVP_Global::rsvp->getPSBbyLSPName((const char*)monQuery.gri, destIp);
+    psb = RSVP_Global::rsvp->getPSBbyLSPName((const char*)monQuery.gri, sessionObject.getDestAddress().rawAddress());
     if (psb == NULL) {
         errCode = 2; //no rsvp session
         goto _error;
@@ -1348,98 +1986,26 @@ void SwitchCtrl_Global::getMonitoringInfo(MON_Query_Subobject& monQuery, MON_Rep
 	
     for (it = sessionList.begin(); it != sessionList.end(); ++it) {
         if ((*it)->isMonSession(monQuery.gri)) {
-            if( (*it)->getMonSwitchInfo(monReply)) {
-                if ((monReply.switch_options & MON_SWITCH_OPTION_SUBNET) == 0) {
-                    //ethernet switch vlsr --> get vlsr route PSB
-                    if (psb != NULL) {
-                        VLSRRoute& vlsrtList = psb->getVLSR_Route();
-                        if (vlsrtList.size() != 1) {
-                            errCode = 5; // incorrect vlsr route information
-                            goto _error;
-                        }
-                        monReply.sub_type = MON_REPLY_SUBTYPE_ETHERNET; //Ethernet
-                        monReply.length = MON_REPLY_BASE_SIZE + sizeof(struct _Ethernet_Circuit_Info);
-                        //$$$ get VLAN and ports from
-                        VLSR_Route& vlsrt = vlsrtList.front();
-                        SimpleList<uint32> portList;
-                        SimpleList<uint32>::Iterator portIter;
-                        int i;
-                        switch (vlsrt.inPort >> 16) {
-                            case LOCAL_ID_TYPE_PORT:
-                                monReply.circuit_info.vlan_info.vlan_ingress = 0;
-                                monReply.circuit_info.vlan_info.num_ports_ingress = 1;
-                                monReply.circuit_info.vlan_info.ports_ingress[0] = (vlsrt.inPort & 0xffff);
-                                break;
-                            case LOCAL_ID_TYPE_GROUP:
-                                monReply.circuit_info.vlan_info.vlan_ingress = 0;
-                                getPortsByLocalId(portList, vlsrt.inPort);
-                                monReply.circuit_info.vlan_info.num_ports_ingress = portList.size();
-                                for (portIter = portList.begin(), i = 0; portIter != portList.end(); ++portIter, ++i)
-                                    monReply.circuit_info.vlan_info.ports_ingress[i] = ((*portIter) & 0xffff);
-                                break;
-                            case LOCAL_ID_TYPE_TAGGED_GROUP:
-                                monReply.circuit_info.vlan_info.vlan_ingress = (vlsrt.inPort & 0xffff);
-                                getPortsByLocalId(portList, vlsrt.inPort);
-                                monReply.circuit_info.vlan_info.num_ports_ingress = portList.size();
-                                for (portIter = portList.begin(), i = 0; portIter != portList.end(); ++portIter, ++i)
-                                    monReply.circuit_info.vlan_info.ports_ingress[i] = ((*portIter) & 0xffff);
-                                break;
-                            case LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL:
-                                monReply.circuit_info.vlan_info.vlan_ingress = vlsrt.vlanTag;
-                                monReply.circuit_info.vlan_info.num_ports_ingress = 1;
-                                monReply.circuit_info.vlan_info.ports_ingress[0] = (vlsrt.inPort & 0xffff);
-                                break;
-                        }
-                        switch (vlsrt.outPort >> 16) {
-                            case LOCAL_ID_TYPE_PORT:
-                                monReply.circuit_info.vlan_info.vlan_egress = 0;
-                                monReply.circuit_info.vlan_info.num_ports_egress = 1;
-                                monReply.circuit_info.vlan_info.ports_egress[0] = (vlsrt.outPort & 0xffff);
-                                break;
-                            case LOCAL_ID_TYPE_GROUP:
-                                monReply.circuit_info.vlan_info.vlan_egress = 0;
-                                getPortsByLocalId(portList, vlsrt.outPort);
-                                monReply.circuit_info.vlan_info.num_ports_egress = portList.size();
-                                for (portIter = portList.begin(), i = 0; portIter != portList.end(); ++portIter, ++i)
-                                    monReply.circuit_info.vlan_info.ports_egress[i] = ((*portIter) & 0xffff);
-                                break;
-                            case LOCAL_ID_TYPE_TAGGED_GROUP:
-                                monReply.circuit_info.vlan_info.vlan_egress = (vlsrt.outPort & 0xffff);
-                                getPortsByLocalId(portList, vlsrt.outPort);
-                                monReply.circuit_info.vlan_info.num_ports_egress = portList.size();
-                                for (portIter = portList.begin(), i = 0; portIter != portList.end(); ++portIter, ++i)
-                                    monReply.circuit_info.vlan_info.ports_egress[i] = ((*portIter) & 0xffff);
-                                break;
-                            case LOCAL_ID_TYPE_TAGGED_GROUP_GLOBAL:
-                                monReply.circuit_info.vlan_info.vlan_egress = vlsrt.vlanTag;
-                                monReply.circuit_info.vlan_info.num_ports_egress = 1;
-                                monReply.circuit_info.vlan_info.ports_egress[0] = (vlsrt.outPort & 0xffff);
-                                break;
-                        }
-                    }
-                } else if (!(*it)->getMonCircuitInfo(monReply)) { //edge-control subnet vlsr
-                    errCode = 4; //failed to retrieve circuit info (subnetSwitchCtrlSession)
-                    goto _error;
-                 }
-            } else {
-                errCode = 3; //failed to retrieve switch info
-                goto _error;
-            }
-            foundSession = true;
+            if (job == NULL)
+                job = new SwitchCtrl_MonitoringJob(*it, sessionObject, monReply, psb);
+            else
+                job->addSession(*it);
         }        
     }
-    if (!foundSession) {
-        //first judging whether this is a Subnet transit vlsr
-        VLSRRoute& vlsrtList = psb->getVLSR_Route();
-        if (vlsrtList.size() == 0 && SwitchCtrl_Session_SubnetUNI::IsSubnetTransitERO(psb->getEXPLICIT_ROUTE_Object())) {
-             monReply.switch_options |= (MON_SWITCH_OPTION_SUBNET|MON_SWITCH_OPTION_SUBNET_TRANSIT);
-             monReply.sub_type = MON_REPLY_SUBTYPE_SUBNET_TRANSIT;
-             monReply.length = MON_REPLY_BASE_SIZE;
-        }
-        else {// otherwise error!
-            errCode = 1; //no switch control session matching the GRI
-            goto _error;
-        }
+    if (job != NULL) {
+        SwitchCtrl_Worker::enqueue(job);
+        return;
+    }
+
+    //first judging whether this is a Subnet transit vlsr
+    if (psb->getVLSR_Route().size() == 0 && SwitchCtrl_Session_SubnetUNI::IsSubnetTransitERO(psb->getEXPLICIT_ROUTE_Object())) {
+         monReply.switch_options |= (MON_SWITCH_OPTION_SUBNET|MON_SWITCH_OPTION_SUBNET_TRANSIT);
+         monReply.sub_type = MON_REPLY_SUBTYPE_SUBNET_TRANSIT;
+         monReply.length = MON_REPLY_BASE_SIZE;
+    }
+    else {// otherwise error!
+        errCode = 1; //no switch control session matching the GRI
+        goto _error;
     }
 
     //flags whether the VLSR is source or/and destination node.
@@ -1447,23 +2013,13 @@ void SwitchCtrl_Global::getMonitoringInfo(MON_Query_Subobject& monQuery, MON_Rep
          monReply.switch_options |= MON_SWITCH_OPTION_CIRCUIT_SRC;
     if (psb->getSrcAddress() == Session::ospfRouterID)
          monReply.switch_options |= MON_SWITCH_OPTION_CIRCUIT_DEST;
-	
-    if ((monReply.switch_options & MON_SWITCH_OPTION_SUBNET)) {
-        if ((monReply.switch_options & MON_SWITCH_OPTION_SUBNET_SRC) && (monReply.switch_options & MON_SWITCH_OPTION_SUBNET_DEST))
-            monReply.sub_type = MON_REPLY_SUBTYPE_SUBNET_SRCDEST;
-        else if ((monReply.switch_options & MON_SWITCH_OPTION_SUBNET_SRC))
-            monReply.sub_type = MON_REPLY_SUBTYPE_SUBNET_SRC;
-        else if ((monReply.switch_options & MON_SWITCH_OPTION_SUBNET_DEST))
-            monReply.sub_type = MON_REPLY_SUBTYPE_SUBNET_DEST;
-    }
-
+    setMonSubnetType(monReply);
+    RSVP_Global::messageProcessor->sendDragonMonReply(sessionObject, monReply);
     return; // normal return
 
   _error:
-    monReply.sub_type = MON_REPLY_SUBTYPE_ERROR;
-    monReply.length = MON_REPLY_BASE_SIZE;
-    monReply.switch_options = (MON_SWITCH_OPTION_ERROR|errCode);
-    return;
+    setMonError(monReply, errCode);
+    RSVP_Global::messageProcessor->sendDragonMonReply(sessionObject, monReply);
 }
 
 //End of file : SwitchCtrl_Global.cc
@@ -19,6 +19,7 @@ To be incorporated into KOM-RSVP-TE package
 #include <net-snmp/net-snmp-includes.h>
 #include <net-snmp/session_api.h>
 #include "NARB_APIClient.h"
+#include <pthread.h>
 
 /****************************************************************************
 
@@ -30,6 +31,15 @@ Notes:
     time in addition to the switch vendor/model type defined by compilation option.
 3. Vendor == Vendor + Model
 4. By default SwitchCtrl_Session support all RFC2674 functions using SNMP GET.
+5. CLI sessions hand their logged in channel to the CLI connection pool when they disconnect,
+    the next session to the same switch takes it over instead of logging in again. Idle channels
+    are kept alive from the sessions refresh timer and logged out after CLI_POOL_IDLE_TIMEOUT.
+6. The VLAN/port maps read by readVLANFromSwitch() serve as a cache: the VLAN functions update it
+    along with the switch, syncVLANFromSwitch() only reads the switch again after a failed operation
+    has invalidated it, and the sessions refresh timer reconciles it with the switch in the background.
+7. PATH processing does not talk to Ethernet switches itself: requestVLANSync() creates the session
+    and reads its VLANs on the switch control worker, the PATH message is processed again once the
+    request has completed (see MessageProcessor::queryEnqueuedMessages).
 
 ****************************************************************************/
 
@@ -39,6 +49,7 @@ Notes:
 #define MAX_VENDOR			20
 #define MAX_VLAN_BYTES			512
 #define MAX_VENDOR_NAME			128
+#define SNMP_BULK_REPETITIONS		100 // default max-repetitions of the GETBULK walks
 
 #ifdef FORCE10_SOFTWARE_V6
     #define MAX_VLAN_PORT_BYTES 96  // FTOS-ED-6.2.1
@@ -115,6 +126,20 @@ struct LocalId {
 };
 typedef SimpleList<LocalId> LocalIdList;
 
+class SwitchCtrl_Session;
+//one GETBULK walk of a VLAN/port map column, driven by SwitchCtrl_Session::walkVlanPortMapBranches
+struct snmp_branch_walk {
+	SwitchCtrl_Session* session;
+	vlanPortMapList* vpmList;
+	oid root[MAX_OID_LEN];
+	size_t rootlen;
+	oid next[MAX_OID_LEN];
+	size_t nextlen;
+	bool done;
+	bool failed;
+};
+typedef SimpleList<snmp_branch_walk*> SnmpBranchWalkList;
+
 #define LOCAL_ID_TYPE_NONE (uint16)0x0
 #define LOCAL_ID_TYPE_PORT (uint16)0x1
 #define LOCAL_ID_TYPE_GROUP (uint16)0x2
@@ -136,6 +161,7 @@ public:
 		rfc2674_compatible = true;
 		snmp_enabled = true;
 		vlanCreation_enabled = true;
+		vlanCacheValid = false;
 		vendor = Illegal;
 		setSupportedVendorOidString();
 	}
@@ -145,6 +171,7 @@ public:
 		rfc2674_compatible = true;
 		snmp_enabled = true;
 		vlanCreation_enabled = true;
+		vlanCacheValid = false;
 		vendor = Illegal;
 		setSupportedVendorOidString();
 	}
@@ -194,7 +221,22 @@ public:
 	virtual uint32 getVLANListbyPort(uint32 port, SimpleList<uint32> &vlan_list); // RFC2674
 	virtual uint32 getVLANbyUntaggedPort(uint32 port); // RFC2674
 	virtual bool readVlanPortMapBranch(const char* oid_str, vlanPortMapList &vpmList); // RFC2674
+	virtual bool readVlanPortMapBranches(const char* oid_str1, vlanPortMapList &vpmList1, const char* oid_str2, vlanPortMapList &vpmList2); // RFC2674
+	bool startVlanPortMapWalk(snmp_branch_walk& walk, const char* oid_str, vlanPortMapList &vpmList);
+	// the walks may belong to different switches, whose requests are then outstanding at the same time
+	static bool walkVlanPortMapBranches(SnmpBranchWalkList& walks);
 	virtual bool readVLANFromSwitch(); // RFC2674
+	// readVLANFromSwitch() in two halves, the caller walks the columns in between
+	bool startReadVLANFromSwitch(SnmpBranchWalkList& walks);
+	bool finishReadVLANFromSwitch();
+	bool canBatchVLANRead() const { return rfc2674_compatible || (vendor != Catalyst3750 && vendor != Catalyst6500); }
+	bool syncVLANFromSwitch() { return vlanCacheValid || readVLANFromSwitch(); }
+	void invalidateVLANCache() { vlanCacheValid = false; }
+	bool isVLANCacheValid() const { return vlanCacheValid; }
+	bool reconcileVLANCache(); // RFC2674
+	// reconcileVLANCache() in two halves, the walks of several switches run in between
+	bool startReconcileVLANCache(SnmpBranchWalkList& walks);
+	bool finishReconcileVLANCache();
 	virtual bool verifyVLAN(uint32 vlanID);// RFC2674
 	virtual bool VLANHasTaggedPort(uint32 vlanID);// RFC2674
 	virtual bool setVLANPortsTagged(uint32 taggedPorts, uint32 vlanID);// RFC2674
@@ -256,8 +298,16 @@ protected:
 	String vendorSystemDescription;
 	String supportedVendorOidString[MAX_VENDOR+1];
 
+	static bool sendVlanPortMapWalk(snmp_branch_walk& walk);
+	static int vlanPortMapWalkCallback(int operation, struct snmp_session* sp, int reqid, struct snmp_pdu* response, void* magic);
+
 	vlanPortMapList vlanPortMapListAll;	// List of VLANs with a map of contained untagged and tagged ports
 	vlanPortMapList vlanPortMapListUntagged; 	// List of VLANs with a map of contained untagged ports
+	bool vlanCacheValid;	// the two lists above match the switch, they are kept up to date by our own SETs
+	snmp_branch_walk vlanWalkAll, vlanWalkUntagged;	// see startReadVLANFromSwitch
+	vlanPortMapList reconcileListAll, reconcileListUntagged;	// the cache before a reconcile started
+	bool checkVLANsReadFromSwitch();
+	void logVLANCacheChanges(const vlanPortMapList& cachedAll, const vlanPortMapList& cachedUntagged);
 	vlanRefIDList vlanRefIdConvList;	// Mapping table btwn vendor's private VLAN interface ID and regular VLAN ID.
 	portRefIDList portRefIdConvList;		// Mapping table btwn vendor's private Port interface ID and regular Port ID.
 
@@ -319,6 +369,30 @@ struct eos_map_entry {
 	SONET_TSpec* sonet_tspec; 
 };
 
+//logged in CLI channels that no session uses at the moment (see CLI_Session::engage)
+#define CLI_POOL_IDLE_TIMEOUT 1800 // seconds before an unused channel is logged out
+#define CLI_EXIT_STRING_LEN 64
+struct cli_conn_entry {
+	NetAddress switchAddr;
+	int port;
+	int fdin;
+	int fdout;
+	pid_t pid;
+	time_t lastUsed;
+	char exitString[CLI_EXIT_STRING_LEN];	// what disengage() was called with, sent when the channel is closed
+};
+typedef SimpleList<cli_conn_entry> CLIConnectionList;
+
+//VLAN sync that a deferred PATH message waits for (see SwitchCtrl_Global::requestVLANSync)
+struct vlan_sync_request {
+	uint32 id;
+	NetAddress switchAddr;
+	bool done;
+	uint32 errCode;	// ERROR_SPEC class << 16 | value, 0 on success
+	uint32 waiters;	// deferred PATH messages that have not been resumed yet
+};
+typedef SimpleList<vlan_sync_request> VLANSyncRequestList;
+
 class sessionsRefreshTimer;
 class SwitchCtrl_Global{
 public:
@@ -337,11 +411,26 @@ public:
 	void startRefreshTimer();
 	void removeRsvpSessionReference(Session* session);
 
+	/*VLAN sync on the switch control worker, 'session' is NULL for a switch without session*/
+	uint32 requestVLANSync(const NetAddress& swAddr, SwitchCtrl_Session* session);
+	void completeVLANSync(uint32 requestID, uint32 errCode);
+	bool vlanSyncDone(uint32 requestID) const;
+	void resumeVLANSync(uint32 requestID);
+	void clearResumedVLANSync() { resumedVLANSync.id = 0; }
+	bool takeResumedVLANSync(const NetAddress& swAddr, uint32& errCode);
+
 	/*called by object functions  in SwitchCtrl_Session*/
 	static bool static_connectSwitch(struct snmp_session* &session, NetAddress &switchAddress);
 	static void static_disconnectSwitch(struct snmp_session* &session);
 	static bool static_getSwitchVendorInfo(struct snmp_session* &session, uint32 &vendor_id, String &vendorDesc);
 
+	/*CLI connection pool, shared by all CLI based sessions*/
+	static bool takeCLIConnection(const NetAddress& swAddr, int port, cli_conn_entry& conn);
+	static bool returnCLIConnection(const cli_conn_entry& conn);
+	static bool hasCLIConnections();
+	static void keepAliveCLIConnections();
+	static void forgetCLIConnections();
+
 	/*interact with dragond*/
         static LocalIdList localIdList;
         static void addLocalId(uint16 type, uint16 value, uint16  tag = ANY_VTAG);
@@ -363,9 +452,11 @@ public:
 	SONET_TSpec* getEosMapEntry(float bandwidth);
 	void setSwitchVlanOption(uint32 option) { switchVlanOptions |= option; }
 	bool hasSwitchVlanOption(uint32 option) { return ((switchVlanOptions&option) != 0); }
+	void setSnmpBulkRepetitions(uint32 n) { snmpBulkRepetitions = n; }
+	uint32 getSnmpBulkRepetitions() { return snmpBulkRepetitions; }
 
 	/*monitoring*/
-	void getMonitoringInfo(MON_Query_Subobject& monQuery, MON_Reply_Subobject& monReplym, uint32 destIp = 0);
+	void getMonitoringInfo(const SESSION_Object& sessionObject, MON_Query_Subobject& monQuery, MON_Reply_Subobject& monReply);
 
 protected:
 	SwitchCtrl_Global();
@@ -378,6 +469,13 @@ private:
 	SimpleList<sw_layer_excl_name_entry> exclList;
 	SimpleList<eos_map_entry> eosMapList;
 	uint32 switchVlanOptions;
+	uint32 snmpBulkRepetitions;
+	VLANSyncRequestList vlanSyncRequests;
+	vlan_sync_request resumedVLANSync;
+	uint32 vlanSyncRequestID;
+	static CLIConnectionList cliConnPool;
+	static pthread_mutex_t cliConnPoolMutex;
+	static bool cliConnPoolDisabled;
 };
 
 class sessionsRefreshTimer: public BaseTimer {
@@ -463,7 +561,7 @@ inline void RevertWordBytes(uint32& x)
 
 inline char* GetSwitchPortString(u_int32_t switch_port)
 {
-	static char port_string[20];
+	static __thread char port_string[20];
 
 	sprintf(port_string, "%d/%d/%d", (switch_port>>12)&0xf, (switch_port>>8)&0xf, switch_port&0xff);
 	return port_string;
@@ -14,7 +14,7 @@ To be incorporated into KOM-RSVP-TE package
 
 bool SwitchCtrl_Session_Catalyst3750_CLI::preAction()
 {
-    if (!active || vendor!=Catalyst3750|| !pipeAlive())
+    if (!active || vendor!=Catalyst3750|| !reengage())
         return false;
     int n;
     DIE_IF_NEGATIVE(n= writeShell( "\n", 5)) ;
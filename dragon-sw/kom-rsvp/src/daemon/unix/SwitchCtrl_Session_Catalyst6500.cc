@@ -13,7 +13,7 @@ To be incorporated into KOM-RSVP-TE package
 
 bool SwitchCtrl_Session_Catalyst6500_CLI::preAction()
 {
-    if (!active || vendor!=Catalyst6500|| !pipeAlive())
+    if (!active || vendor!=Catalyst6500|| !reengage())
         return false;
     int n;
     DIE_IF_NEGATIVE(n= writeShell( "\n", 5)) ;
@@ -13,7 +13,7 @@ To be incorporated into KOM-RSVP-TE package
 
 bool SwitchCtrl_Session_Force10E600::preAction()
 {
-    if (!active || !pipeAlive())
+    if (!active || !reengage())
         return false;
     int n;
     DIE_IF_NEGATIVE(n= writeShell( "\n", 5)) ;
@@ -42,6 +42,7 @@ void SwitchCtrl_Session_Linux::disconnectSwitch()
 {
   for(PortToIfMap::iterator i = _ports.begin(); i != _ports.end(); i++)
     free(i->second);
+  _ports.clear();
   
   disengage();
 }
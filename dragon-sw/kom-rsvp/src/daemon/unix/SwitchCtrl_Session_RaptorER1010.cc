@@ -11,7 +11,7 @@ To be incorporated into KOM-RSVP-TE package
 
 bool SwitchCtrl_Session_RaptorER1010_CLI::preAction()
 {
-    if (!active || vendor!=RaptorER1010 || !pipeAlive())
+    if (!active || vendor!=RaptorER1010 || !reengage())
         return false;
     int n;
     DIE_IF_NEGATIVE(n= writeShell( "\n", 5)) ;
@@ -483,6 +483,180 @@ void SwitchCtrl_Session_SubnetUNI::getTimeslots(SimpleList<uint8>& timeslots)
 /////// TL1 related commands  //////
 /////////////////////////////////
 
+//the new command gets its own ctag, which the caller puts into the command text
+TL1_Command& SwitchCtrl_Session_SubnetUNI::addTL1Command(TL1_Pipeline& plan, int dependsOn)
+{
+    assert(plan.count < TL1_PIPELINE_MAX && dependsOn < plan.count);
+    TL1_Command& command = plan.commands[plan.count++];
+    command.cmd[0] = 0;
+    command.ctag = getNewCtag();
+    command.dependsOn = dependsOn;
+    command.state = TL1_CMD_WAITING;
+    command.response = "";
+    return command;
+}
+
+//Write every command whose prerequisite has completed without waiting for the responses in
+//between, then take the responses in whatever order the switch sends them and match them to
+//their commands by ctag. A command depending on one that was denied is skipped, so the plan
+//costs one round trip per level of its longest dependency chain rather than one per command.
+//Returns false if the session failed or a response did not come in 'timeout' seconds.
+bool SwitchCtrl_Session_SubnetUNI::runTL1Pipeline(TL1_Pipeline& plan, int timeout)
+{
+    char line[LINELEN+1];
+    int i, n, outstanding = 0;
+    int current = -1; //the command whose response is being read
+    bool compld = false;
+    fd_set fds;
+    struct timeval tv;
+
+    for (;;)
+    {
+        //dependencies always point backwards, so one pass settles all commands that can be settled
+        for (i = 0; i < plan.count; i++)
+        {
+            TL1_Command& command = plan.commands[i];
+            if (command.state != TL1_CMD_WAITING)
+                continue;
+            if (command.dependsOn >= 0)
+            {
+                uint8 state = plan.commands[command.dependsOn].state;
+                if (state == TL1_CMD_DENY || state == TL1_CMD_SKIPPED)
+                {
+                    command.state = TL1_CMD_SKIPPED;
+                    continue;
+                }
+                if (state != TL1_CMD_COMPLD)
+                    continue;
+            }
+            if (writeShell(command.cmd, timeout) < 0)
+            {
+                LOG(5)(Log::MPLS, "LSP=", currentLspName, ": ", "TL1 pipeline failed to write...\n", command.cmd);
+                return false;
+            }
+            command.state = TL1_CMD_SENT;
+            outstanding++;
+        }
+        if (outstanding == 0)
+            return true;
+
+        //next line of output; inside a response, a ';' opening a line terminates it
+        for (n = 0; ; )
+        {
+            if (readStart == readEnd && fdin >= 0)
+            {
+                FD_ZERO(&fds);
+                FD_SET(fdin, &fds);
+                tv.tv_sec = timeout;
+                tv.tv_usec = 0;
+                int ready = select(fdin+1, &fds, NULL, NULL, &tv);
+                if (ready < 0 && errno == EINTR)
+                    continue;
+                if (ready <= 0)
+                {
+                    //late responses would be taken for those of the next command, so drop the session
+                    LOG(5)(Log::MPLS, "LSP=", currentLspName, ": ", "TL1 pipeline timed out with responses outstanding: ", outstanding);
+                    closePipe();
+                    return false;
+                }
+            }
+            if (readShellChar(&line[n]) != 1)
+            {
+                closePipe();
+                return false;
+            }
+            if (line[n] == '\r')
+                continue;
+            line[n+1] = 0;
+            if (line[n] == '\n' || n == LINELEN-1)
+                break;
+            if (line[n] == ';' && current >= 0 && strspn(line, " \t") == (size_t)n)
+                break;
+            n++;
+        }
+
+        if (current < 0)
+        {
+            uint32 ctag;
+            char status[8];
+            if (sscanf(line, " M %u %7s", &ctag, status) != 2)
+                continue; //echo, response header or autonomous message
+            for (i = 0; i < plan.count; i++)
+            {
+                if (plan.commands[i].state == TL1_CMD_SENT && plan.commands[i].ctag == ctag)
+                {
+                    current = i;
+                    compld = (strcmp(status, "COMPLD") == 0);
+                    break;
+                }
+            }
+            if (current < 0)
+                continue;
+        }
+        plan.commands[current].response += line;
+        if (line[n] == ';' && strspn(line, " \t") == (size_t)n)
+        {
+            plan.commands[current].state = (compld ? TL1_CMD_COMPLD : TL1_CMD_DENY);
+            current = -1;
+            outstanding--;
+        }
+    }
+}
+
+//When some groups of a creation plan were denied, the name of the connection is dropped and the
+//normal teardown can no longer find the groups that completed, so they are deleted here.
+//The formats take the name, the group number and the ctag; a group with an oosFormat is taken
+//OOS first and given 'settle' seconds before the deletion.
+void SwitchCtrl_Session_SubnetUNI::deleteCreatedGroups_TL1(TL1_Pipeline& created, int first, String& name, const char* oosFormat, int settle, const char* dltFormat)
+{
+    TL1_Pipeline oosPlan, dltPlan;
+    int group;
+
+    if (oosFormat != NULL)
+    {
+        for (group = 0; group < numGroups; group++)
+        {
+            if (created.commands[first+group].state != TL1_CMD_COMPLD)
+                continue;
+            TL1_Command& command = addTL1Command(oosPlan);
+            sprintf( command.cmd, oosFormat, name.chars(), group+1, command.ctag );
+        }
+        if (oosPlan.count == 0)
+            return;
+        if (!runTL1Pipeline(oosPlan, 5))
+            goto _out;
+        sleep(settle);
+    }
+
+    for (group = 0; group < numGroups; group++)
+    {
+        if (created.commands[first+group].state != TL1_CMD_COMPLD)
+            continue;
+        TL1_Command& command = addTL1Command(dltPlan);
+        sprintf( command.cmd, dltFormat, name.chars(), group+1, command.ctag );
+    }
+    if (dltPlan.count == 0)
+        return;
+    if (!runTL1Pipeline(dltPlan, 5))
+        goto _out;
+
+    for (group = 0; group < dltPlan.count; group++)
+    {
+        if (dltPlan.commands[group].state == TL1_CMD_COMPLD) 
+        {
+            LOG(5)(Log::MPLS, "LSP=", currentLspName, ": ", "partly created group has been deleted.\n", dltPlan.commands[group].cmd);
+        }
+        else
+        {
+            LOG(5)(Log::MPLS, "LSP=", currentLspName, ": ", "partly created group could not be deleted.\n", dltPlan.commands[group].cmd);
+        }
+    }
+    return;
+
+_out:
+    LOG(5)(Log::MPLS, "LSP=", currentLspName, ": ", name, " cleanup via TL1_TELNET failed...\n");
+}
+
 String& SwitchCtrl_Session_SubnetUNI::getCienaSoftwareVersion()
 {
     if (swVersion.empty())
@@ -1393,7 +1567,6 @@ _out:
 //;ENT-GTP::gtp1:123::lbl=label,,ctp=vcg01-CTP-1&vcg01-CTP-2&vcg01-CTP-3&vcg01-CTP-4;
 bool SwitchCtrl_Session_SubnetUNI::createGTP_TL1(String& gtpName, String& vcgName)
 {
-    int ret = 0;
     char ctag[10];
     sprintf(ctag, "%d", getNewCtag());
     gtpName = "dcs_gtp_";
@@ -1409,38 +1582,42 @@ bool SwitchCtrl_Session_SubnetUNI::createGTP_TL1(String& gtpName, String& vcgNam
         return false;
     }
 
+    //the GTPs of the groups do not depend on each other
+    TL1_Pipeline plan;
     int group;
+    bool denied = false;
     for (group = 0; group < numGroups; group++)
     {
         assert(!ctpGroupStringArray[group].empty());
 
-        sprintf( bufCmd, "ent-gtp::%s-%d:%s::lbl=gtp-%s,,ctp=%s;", gtpName.chars(), group+1, ctag, vcgName.chars(), ctpGroupStringArray[group].chars() );
-
-        if ( (ret = writeShell(bufCmd, 5)) < 0 ) goto _out;
+        TL1_Command& command = addTL1Command(plan);
+        sprintf( command.cmd, "ent-gtp::%s-%d:%d::lbl=gtp-%s,,ctp=%s;", gtpName.chars(), group+1, command.ctag, vcgName.chars(), ctpGroupStringArray[group].chars() );
+    }
+    if (!runTL1Pipeline(plan, 5))
+        goto _out;
 
-        sprintf(strCOMPLD, "M  %d COMPLD", getCurrentCtag());
-        sprintf(strDENY, "M  %d DENY", getCurrentCtag());
-        ret = readShell(strCOMPLD, strDENY, 1, 5);
-        if (ret == 1) 
+    for (group = 0; group < numGroups; group++)
+    {
+        if (plan.commands[group].state == TL1_CMD_COMPLD) 
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", gtpName, "-", group+1, " has been created successfully.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", gtpName, "-", group+1, " has been created successfully.\n", plan.commands[group].cmd);
         }
-        else if (ret == 2)
+        else
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", gtpName, "-", group+1, " creation has been denied.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
-            gtpName = "";
-            return false;
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", gtpName, "-", group+1, " creation has been denied.\n", plan.commands[group].cmd);
+            denied = true;
         }
-        else 
-            goto _out;
+    }
+    if (denied)
+    {
+        deleteCreatedGroups_TL1(plan, 0, gtpName, NULL, 0, "dlt-gtp::%s-%d:%d;");
+        gtpName = "";
     }
 
-    return true;
+    return (!gtpName.empty());
     
 _out:
-    LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", gtpName, "-", group+1, " creation via TL1_TELNET failed...\n", bufCmd);
+    LOG(5)(Log::MPLS, "LSP=", currentLspName, ": ", gtpName, " creation via TL1_TELNET failed...\n");
     gtpName = "";
     return false;    
 }
@@ -1448,35 +1625,34 @@ _out:
 //;DLT-GTP::gtp1:123;
 bool SwitchCtrl_Session_SubnetUNI::deleteGTP_TL1(String& gtpName)
 {
-    int ret = 0;
+    bool deleted = true;
+    TL1_Pipeline plan;
     int group;
     for (group = 0; group < numGroups; group++)
     {
-        sprintf( bufCmd, "dlt-gtp::%s-%d:%d;", gtpName.chars(), group+1, getNewCtag() );
-        if ( (ret = writeShell(bufCmd, 5)) < 0 ) goto _out;
+        TL1_Command& command = addTL1Command(plan);
+        sprintf( command.cmd, "dlt-gtp::%s-%d:%d;", gtpName.chars(), group+1, command.ctag );
+    }
+    if (!runTL1Pipeline(plan, 5))
+        goto _out;
 
-        sprintf(strCOMPLD, "M  %d COMPLD", getCurrentCtag());
-        sprintf(strDENY, "M  %d DENY", getCurrentCtag());
-        ret = readShell(strCOMPLD, strDENY, 1, 5);
-        if (ret == 1) 
+    for (group = 0; group < numGroups; group++)
+    {
+        if (plan.commands[group].state == TL1_CMD_COMPLD) 
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", gtpName, "-", group+1, " has been deleted successfully.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", gtpName, "-", group+1, " has been deleted successfully.\n", plan.commands[group].cmd);
         }
-        else if (ret == 2)
+        else
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", gtpName, "-", group+1, " deletion has been denied.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
-            return false;
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", gtpName, "-", group+1, " deletion has been denied.\n", plan.commands[group].cmd);
+            deleted = false;
         }
-        else 
-            goto _out;
     }
 
-    return true;
+    return deleted;
 
 _out:
-    LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", gtpName, "-", group+1, " deletion via TL1_TELNET failed...\n", bufCmd);
+    LOG(5)(Log::MPLS, "LSP=", currentLspName, ": ", gtpName, " deletion via TL1_TELNET failed...\n");
     return false;    
 }
 
@@ -1514,7 +1690,6 @@ _out:
 //;ent-snc-stspc:SEAT:gtp_x,1-a-5-1-1&&21:myctag::name=sncname,type=dynamic,rmnode=GRNOC,lep=gtp_nametype,conndir=bi_direction,prtt=aps_vlsr_unprotected,pst=is;
 bool SwitchCtrl_Session_SubnetUNI::createSNC_TL1(String& sncName, String& gtpName)
 {
-    int ret = 0;
     char ctag[10];
 
     sprintf(ctag, "%d", getNewCtag());
@@ -1533,6 +1708,10 @@ bool SwitchCtrl_Session_SubnetUNI::createSNC_TL1(String& sncName, String& gtpNam
         return false;
     }
 
+    //the SNCs of the groups only depend on the DTL-SET, which depends on the DTL
+    TL1_Pipeline plan;
+    int dtlSet = -1;
+
     //creatign DTL and DTL-SET
     String dtlString;
     if (DTL.count > 0)
@@ -1547,59 +1726,19 @@ bool SwitchCtrl_Session_SubnetUNI::createSNC_TL1(String& sncName, String& gtpNam
 
         //ent-dtl::dtl1:123::NODENAME1=SEAT,OSRPLTPID1=1,TERMNODENAME=GRNOC;
         //DTL named 'sncname-dtl'
-        sprintf( bufCmd, "ent-dtl::%s-dtl:%d::%s;", sncName.chars(), getNewCtag(), dtlString.chars());
-        if ( (ret = writeShell(bufCmd, 5)) < 0 ) goto _out;
-        sprintf(strCOMPLD, "M  %d COMPLD", getCurrentCtag());
-        sprintf(strDENY, "M  %d DENY", getCurrentCtag());
-        ret = readShell(strCOMPLD, strDENY, 1, 5);
-        if (ret == 1) 
-        {
-            LOG(7)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-dtl", " has been created successfully.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
-        }
-        else if (ret == 2)
-        {
-            LOG(7)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-dtl", " creation has been denied.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
-            sncName = "";
-            return false;
-            // OR continue to SNC creation with 'dtlexcl=no' option ?'
-        }
-        else 
-        {
-            LOG(7)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-dtl", " creation via TL1_TELNET failed...\n", bufCmd);
-            return false;
-        }
+        TL1_Command& dtl = addTL1Command(plan);
+        sprintf( dtl.cmd, "ent-dtl::%s-dtl:%d::%s;", sncName.chars(), dtl.ctag, dtlString.chars());
 
         //ent-dtl-set::dtlset1:123::WRKNM=dtl1,;
         //DTL-SET named 'sncname-dtl_set'
-        sprintf( bufCmd, "ent-dtl-set::%s-dtl_set:%d::wrknm=%s-dtl,;", sncName.chars(), getNewCtag(), sncName.chars());
-        if ( (ret = writeShell(bufCmd, 5)) < 0 ) goto _out;
-        sprintf(strCOMPLD, "M  %d COMPLD", getCurrentCtag());
-        sprintf(strDENY, "M  %d DENY", getCurrentCtag());
-        ret = readShell(strCOMPLD, strDENY, 1, 5);
-        if (ret == 1) 
-        {
-            LOG(7)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-dtl_set", " has been created successfully.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
-        }
-        else if (ret == 2)
-        {
-            LOG(7)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-dtl_set", " creation has been denied.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
-            sncName = "";
-            // ? Delete the created DTL ?
-            return false;
-            // OR continue to SNC creation with 'dtlexcl=no' option ?'
-        }
-        else 
-        {
-            LOG(7)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-dtl_set", " deletion via TL1_TELNET failed...\n", bufCmd);
-            return false;
-        }
+        TL1_Command& set = addTL1Command(plan, 0);
+        sprintf( set.cmd, "ent-dtl-set::%s-dtl_set:%d::wrknm=%s-dtl,;", sncName.chars(), set.ctag, sncName.chars());
+        dtlSet = 1;
     }
 
+    int firstSNC = plan.count;
     int group;
+    bool denied = false;
     for (group = 0; group < numGroups; group++)
     {
         char dtl_cstr[40];
@@ -1615,38 +1754,79 @@ bool SwitchCtrl_Session_SubnetUNI::createSNC_TL1(String& sncName, String& gtpNam
         {
             sprintf(supptptype_cstr,"supptptype=sttp,");
         }
-        sprintf( bufCmd, "ent-snc-stspc:%s:%s-%d,%s:%s::name=%s-%d,type=dynamic,rmnode=%s,%slep=gtp_nametype,alias=%s,%sconndir=bi_direction,meshrst=no,prtt=aps_vlsr_unprotected,pst=is;",
-            (const char*)subnetUniSrc.node_name, gtpName.chars(), group+1, destTimeslotsStringArray[group].chars(), ctag, sncName.chars(), group+1, 
+        TL1_Command& command = addTL1Command(plan, dtlSet);
+        sprintf( command.cmd, "ent-snc-stspc:%s:%s-%d,%s:%d::name=%s-%d,type=dynamic,rmnode=%s,%slep=gtp_nametype,alias=%s,%sconndir=bi_direction,meshrst=no,prtt=aps_vlsr_unprotected,pst=is;",
+            (const char*)subnetUniSrc.node_name, gtpName.chars(), group+1, destTimeslotsStringArray[group].chars(), command.ctag, sncName.chars(), group+1, 
                 (const char*)subnetUniDest.node_name, supptptype_cstr, currentLspName.chars(), dtl_cstr);
+    }
 
-        if ( (ret = writeShell(bufCmd, 5)) < 0 ) goto _out;
+    if (!runTL1Pipeline(plan, 5))
+        goto _out;
 
-        sprintf(strCOMPLD, "M  %s COMPLD", ctag);
-        sprintf(strDENY, "M  %s DENY", ctag);
-        ret = readShell(strCOMPLD, strDENY, 1, 5);
-        if (ret == 1) 
+    if (dtlSet >= 0)
+    {
+        if (plan.commands[0].state == TL1_CMD_COMPLD) 
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-", group+1, " has been created successfully.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
+            LOG(7)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-dtl", " has been created successfully.\n", plan.commands[0].cmd);
         }
-        else if (ret == 2)
+        else
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-", group+1, " creation has been denied.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
-
-            // TODO: dlt-snc for other groups; dlt-dlt-set:: ; dlt-dlt::
+            LOG(7)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-dtl", " creation has been denied.\n", plan.commands[0].cmd);
+            sncName = "";
+            return false;
+            // OR continue to SNC creation with 'dtlexcl=no' option ?'
+        }
 
+        if (plan.commands[dtlSet].state == TL1_CMD_COMPLD) 
+        {
+            LOG(7)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-dtl_set", " has been created successfully.\n", plan.commands[dtlSet].cmd);
+        }
+        else
+        {
+            LOG(7)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-dtl_set", " creation has been denied.\n", plan.commands[dtlSet].cmd);
             sncName = "";
+            // ? Delete the created DTL ?
             return false;
+            // OR continue to SNC creation with 'dtlexcl=no' option ?'
         }
-        else 
-            goto _out;
     }
 
-    return true;
+    for (group = 0; group < numGroups; group++)
+    {
+        TL1_Command& command = plan.commands[firstSNC+group];
+        if (command.state == TL1_CMD_COMPLD) 
+        {
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-", group+1, " has been created successfully.\n", command.cmd);
+        }
+        else
+        {
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-", group+1, " creation has been denied.\n", command.cmd);
+            denied = true;
+        }
+    }
+    if (denied)
+    {
+        // sleep 7 second to let finish status change into OOS, as deleteSNC_TL1 does
+        deleteCreatedGroups_TL1(plan, firstSNC, sncName, "ed-snc-stspc::%s-%d:%d::,pst=oos;", 7, "dlt-snc-stspc::%s-%d:%d;");
+        if (dtlSet >= 0)
+        {
+            TL1_Pipeline dtlPlan;
+            TL1_Command& set = addTL1Command(dtlPlan);
+            sprintf( set.cmd, "dlt-dtl-set::%s-dtl_set:%d;", sncName.chars(), set.ctag );
+            TL1_Command& dtl = addTL1Command(dtlPlan, 0);
+            sprintf( dtl.cmd, "dlt-dtl::%s-dtl:%d;", sncName.chars(), dtl.ctag );
+            if (!runTL1Pipeline(dtlPlan, 5) || dtlPlan.commands[1].state != TL1_CMD_COMPLD)
+            {
+                LOG(5)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-dtl_set and -dtl could not be deleted.\n");
+            }
+        }
+        sncName = "";
+    }
+
+    return (!sncName.empty());
 
 _out:
-    LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-", group+1, " creation via TL1_TELNET failed...\n", bufCmd);
+    LOG(5)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, " creation via TL1_TELNET failed...\n");
     sncName = "";
     return false;    
 }
@@ -1658,52 +1838,53 @@ bool SwitchCtrl_Session_SubnetUNI::deleteSNC_TL1(String& sncName)
     int ret = 0;
     String dtlString;
 
+    //the groups are taken OOS and then deleted together, so the wait for the status change is paid once
+    TL1_Pipeline oosPlan, dltPlan;
+    bool oos = true;
     int group;
     for (group = 0; group < numGroups; group++)
     {
-        sprintf( bufCmd, "ed-snc-stspc::%s-%d:%d::,pst=oos;", sncName.chars(), group+1, getNewCtag() );
-        if ( (ret = writeShell(bufCmd, 5)) < 0 ) goto _out;
-
-        sprintf(strCOMPLD, "M  %d COMPLD", getCurrentCtag());
-        sprintf(strDENY, "M  %d DENY", getCurrentCtag());
-        ret = readShell(strCOMPLD, strDENY, 1, 5);
-        if (ret == 1) 
+        TL1_Command& command = addTL1Command(oosPlan);
+        sprintf( command.cmd, "ed-snc-stspc::%s-%d:%d::,pst=oos;", sncName.chars(), group+1, command.ctag );
+    }
+    if (!runTL1Pipeline(oosPlan, 5))
+        goto _out;
+    for (group = 0; group < numGroups; group++)
+    {
+        if (oosPlan.commands[group].state == TL1_CMD_COMPLD) 
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-", group+1, " state has been changed into OOS.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
-            //continue to next command ...
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-", group+1, " state has been changed into OOS.\n", oosPlan.commands[group].cmd);
         }
-        else if (ret == 2)
+        else
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-", group+1, " state change to OOS has been denied.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
-            return false;
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-", group+1, " state change to OOS has been denied.\n", oosPlan.commands[group].cmd);
+            oos = false;
         }
-        else 
-            goto _out;
+    }
+    if (!oos)
+        return false;
 
-        // sleep 7 second to let finish status change into OOS  
-        sleep(7);
+    // sleep 7 second to let finish status change into OOS  
+    sleep(7);
 
-        sprintf( bufCmd, "dlt-snc-stspc::%s-%d:%d;", sncName.chars(), group+1, getNewCtag() );
-        if ( (ret = writeShell(bufCmd, 5)) < 0 ) goto _out;
-
-        sprintf(strCOMPLD, "M  %d COMPLD", getCurrentCtag());
-        sprintf(strDENY, "M  %d DENY", getCurrentCtag());
-        ret = readShell(strCOMPLD, strDENY, 1, 5);
-        if (ret == 1) 
+    for (group = 0; group < numGroups; group++)
+    {
+        TL1_Command& command = addTL1Command(dltPlan);
+        sprintf( command.cmd, "dlt-snc-stspc::%s-%d:%d;", sncName.chars(), group+1, command.ctag );
+    }
+    if (!runTL1Pipeline(dltPlan, 5))
+        goto _out;
+    for (group = 0; group < numGroups; group++)
+    {
+        if (dltPlan.commands[group].state == TL1_CMD_COMPLD) 
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-", group+1, " has been deleted successfully.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-", group+1, " has been deleted successfully.\n", dltPlan.commands[group].cmd);
         }
-        else if (ret == 2)
+        else
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-", group+1, " deletion has been denied.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-", group+1, " deletion has been denied.\n", dltPlan.commands[group].cmd);
             //continue to delete dtl-set
         }
-        else 
-            goto _out;
     }
 
     getDTLString(dtlString);
@@ -1759,7 +1940,7 @@ bool SwitchCtrl_Session_SubnetUNI::deleteSNC_TL1(String& sncName)
     return true;
 
 _out:
-    LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, "-", group+1, " change/deletion via TL1_TELNET failed...\n", bufCmd);
+    LOG(5)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, " change/deletion via TL1_TELNET failed...\n");
     return false;    
 }
 
@@ -1800,26 +1981,29 @@ _out:
 int SwitchCtrl_Session_SubnetUNI::verifySNCInStableWorkingState_TL1(String& sncName)
 {
     int funcRet = 0;
+    TL1_Pipeline plan;
     int group;
     for (group = 0; group < numGroups; group++)
     {
-        int ret = 0;
-        sprintf( bufCmd, "rtrv-snc-diag::%s-%d:%d;", sncName.chars(), group+1, getNewCtag() );
-        if ( (ret = writeShell(bufCmd, 5)) < 0 ) goto _out;
-        sprintf(strCOMPLD, "M  %d COMPLD", getCurrentCtag());
-        sprintf(strDENY, "M  %d DENY", getCurrentCtag());
-        ret = readShell(strCOMPLD, strDENY, 1, 5);
-        if (ret == 1) 
+        TL1_Command& command = addTL1Command(plan);
+        sprintf( command.cmd, "rtrv-snc-diag::%s-%d:%d;", sncName.chars(), group+1, command.ctag );
+    }
+    if (!runTL1Pipeline(plan, 5))
+        goto _out;
+
+    for (group = 0; group < numGroups; group++)
+    {
+        TL1_Command& command = plan.commands[group];
+        if (command.state == TL1_CMD_COMPLD) 
         {
-            ret = ReadShellPattern(bufCmd, (char*)"Snc IC Path Defect Clear", NULL, (char*)";", NULL, 5);
-            if (ret == 1)
+            const char* pMoreRecords = strstr(command.response.chars(), "Snc IC Path Defect Clear");
+            if (pMoreRecords != NULL)
             {
                 //making sure there is no 'Backoff Expiry' and 'STARTING' status after 'Snc IC Path Defect Clear'
-                char* pMoreRecords = strstr(bufCmd, "Snc IC Path Defect Clear");
                 if (strstr(pMoreRecords, "Backoff Expiry") != NULL || strstr(pMoreRecords, "STARTING") != NULL)
                     return -(group+1); //this SNC is in unstable/error state
             }
-            else if (strstr(bufCmd, "Backoff Expiry") != NULL)
+            else if (strstr(command.response.chars(), "Backoff Expiry") != NULL)
             {
                 return -(group+1); //this SNC is not in unstatble/error state
             }
@@ -1829,21 +2013,18 @@ int SwitchCtrl_Session_SubnetUNI::verifySNCInStableWorkingState_TL1(String& sncN
                 continue;
             }
         }
-        else if (ret == 2)
+        else
         {
             LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", "verifySNCWorkingStatus_TL1 found no such SNC:", sncName, '-', group,  "\n");
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
             return -(group+1);
         }
-        else 
-            goto _out;
     }
 
    //all snc's are in stable working state -> funcRet == 0; or one of the snc's not ready (neither working or error) -> funcRet > 0
    return funcRet;
    
 _out:
-    LOG(6)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, " SNC existence checking via TL1_TELNET failed...\n", bufCmd);
+    LOG(5)(Log::MPLS, "LSP=", currentLspName, ": ", sncName, " SNC existence checking via TL1_TELNET failed...\n");
     return -(numGroups+1);    
 }
 
@@ -1851,7 +2032,6 @@ _out:
 //;ent-crs-stspc::fromendpoint=gtp01,toendpoint=gtp02:myctag::name=crs01,fromtype=gtp,totype=gtp,;
 bool SwitchCtrl_Session_SubnetUNI::createCRS_TL1(String& crsName, String& gtpName)
 {
-    int ret = 0;
     char ctag[10];
 
     sprintf(ctag, "%d", getNewCtag());
@@ -1868,89 +2048,89 @@ bool SwitchCtrl_Session_SubnetUNI::createCRS_TL1(String& crsName, String& gtpNam
         return false;
     }
 
+    //the cross-connects of the groups do not depend on each other
+    TL1_Pipeline plan;
     int group;
+    bool denied = false;
     for (group = 0; group < numGroups; group++)
     {
-        sprintf( bufCmd, "ent-crs-stspc::fromendpoint=%s-%d,toendpoint=%s-%d:%s::name=%s-%d,fromtype=gtp,totype=gtp, alias=%s;",
-            gtpName.chars(), group+1, destGtpName.chars(), group+1, ctag, crsName.chars(), group+1, currentLspName.chars());
-
-        if ( (ret = writeShell(bufCmd, 5)) < 0 ) goto _out;
+        TL1_Command& command = addTL1Command(plan);
+        sprintf( command.cmd, "ent-crs-stspc::fromendpoint=%s-%d,toendpoint=%s-%d:%d::name=%s-%d,fromtype=gtp,totype=gtp, alias=%s;",
+            gtpName.chars(), group+1, destGtpName.chars(), group+1, command.ctag, crsName.chars(), group+1, currentLspName.chars());
+    }
+    if (!runTL1Pipeline(plan, 5))
+        goto _out;
 
-        sprintf(strCOMPLD, "M  %d COMPLD", getCurrentCtag());
-        sprintf(strDENY, "M  %d DENY", getCurrentCtag());
-        ret = readShell(strCOMPLD, strDENY, 1, 5);
-        if (ret == 1) 
+    for (group = 0; group < numGroups; group++)
+    {
+        if (plan.commands[group].state == TL1_CMD_COMPLD) 
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, "-", group+1, " has been created successfully.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, "-", group+1, " has been created successfully.\n", plan.commands[group].cmd);
         }
-        else if (ret == 2)
+        else
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, "-", group+1, " creation has been denied.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
-            crsName = "";
-            return false;
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, "-", group+1, " creation has been denied.\n", plan.commands[group].cmd);
+            denied = true;
         }
-        else 
-            goto _out;
+    }
+    if (denied)
+    {
+        //sleep one second to let finish status change for cross-connect, as deleteCRS_TL1 does
+        deleteCreatedGroups_TL1(plan, 0, crsName, "ed-crs-stspc::name=%s-%d:%d::,pst=oos;", 1, "dlt-crs-stspc::name=%s-%d:%d;");
+        crsName = "";
     }
 
-    return true;
+    return (!crsName.empty());
 
 _out:
-    LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, "-", group+1, " creation via TL1_TELNET failed...\n", bufCmd);
+    LOG(5)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, " creation via TL1_TELNET failed...\n");
     crsName = "";
     return false;
 }
 
 bool SwitchCtrl_Session_SubnetUNI::deleteCRS_TL1(String& crsName)
 {
-    int ret = 0;
+    bool deleted = true;
 
+    //each group is deleted as soon as it is OOS, independently of the other groups
+    TL1_Pipeline plan;
     int group;
     for (group = 0; group < numGroups; group++)
     {
-        sprintf( bufCmd, "ed-crs-stspc::name=%s-%d:%d::,pst=oos;", crsName.chars(), group+1, getNewCtag() );
-        if ( (ret = writeShell(bufCmd, 5)) < 0 ) goto _out;
+        TL1_Command& oos = addTL1Command(plan);
+        sprintf( oos.cmd, "ed-crs-stspc::name=%s-%d:%d::,pst=oos;", crsName.chars(), group+1, oos.ctag );
+        TL1_Command& dlt = addTL1Command(plan, plan.count-1);
+        sprintf( dlt.cmd, "dlt-crs-stspc::name=%s-%d:%d;", crsName.chars(), group+1, dlt.ctag );
+    }
+    if (!runTL1Pipeline(plan, 5))
+        goto _out;
 
-        sprintf(strCOMPLD, "M  %d COMPLD", getCurrentCtag());
-        sprintf(strDENY, "M  %d DENY", getCurrentCtag());
-        ret = readShell(strCOMPLD, strDENY, 1, 5);
-        if (ret == 1) 
+    for (group = 0; group < numGroups; group++)
+    {
+        TL1_Command& oos = plan.commands[group*2];
+        TL1_Command& dlt = plan.commands[group*2+1];
+        if (oos.state == TL1_CMD_COMPLD) 
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, "-", group+1, " state has been changed into OOS.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
-            //continue to next command ...
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, "-", group+1, " state has been changed into OOS.\n", oos.cmd);
         }
-        else if (ret == 2)
+        else
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, "-", group+1, " state change to OOS has been denied.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
-            return false;
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, "-", group+1, " state change to OOS has been denied.\n", oos.cmd);
+            deleted = false;
+            continue;
         }
-        else 
-            goto _out;
-
-        sprintf( bufCmd, "dlt-crs-stspc::name=%s-%d:%d;", crsName.chars(), group+1, getNewCtag() );
-        if ( (ret = writeShell(bufCmd, 5)) < 0 ) goto _out;
-
-        sprintf(strCOMPLD, "M  %d COMPLD", getCurrentCtag());
-        sprintf(strDENY, "M  %d DENY", getCurrentCtag());
-        ret = readShell(strCOMPLD, strDENY, 1, 5);
-        if (ret == 1) 
+        if (dlt.state == TL1_CMD_COMPLD) 
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, "-", group+1, " has been deleted successfully.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, "-", group+1, " has been deleted successfully.\n", dlt.cmd);
         }
-        else if (ret == 2)
+        else
         {
-            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, "-", group+1, " deletion has been denied.\n", bufCmd);
-            readShell(SWITCH_PROMPT, NULL, 1, 5);
-            return false;
+            LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, "-", group+1, " deletion has been denied.\n", dlt.cmd);
+            deleted = false;
         }
-        else 
-            goto _out;
     }
+    if (!deleted)
+        return false;
 
     //sleep one second to let finish status change for cross-connect 
     sleep(1);
@@ -1958,7 +2138,7 @@ bool SwitchCtrl_Session_SubnetUNI::deleteCRS_TL1(String& crsName)
     return true;
 
 _out:
-    LOG(8)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, "-", group+1, " change/deletion via TL1_TELNET failed...\n", bufCmd);
+    LOG(5)(Log::MPLS, "LSP=", currentLspName, ": ", crsName, " change/deletion via TL1_TELNET failed...\n");
     return false;
 }
 
@@ -53,6 +53,32 @@ typedef enum SONET_ConcatenationUnit {
 	CATUNIT_150MBPS,
 } SONET_CATUNIT;
 
+//A TL1 pipeline is a small plan of commands that are written back to back, each as soon as the
+//command it depends on has completed, and matched to their responses by ctag.
+#define TL1_PIPELINE_MAX 8
+#define TL1_CMD_LEN 1024
+enum TL1_CommandState {
+	TL1_CMD_WAITING,	// not written yet
+	TL1_CMD_SENT,
+	TL1_CMD_COMPLD,
+	TL1_CMD_DENY,
+	TL1_CMD_SKIPPED,	// never written as the command it depends on did not complete
+};
+
+typedef struct TL1_Command_struct {
+	char cmd[TL1_CMD_LEN];
+	uint32 ctag;
+	int dependsOn; // index of an earlier command in the plan; -1 if none
+	uint8 state; // TL1_CommandState
+	String response; // from the 'M  ctag' line up to the terminating ';'
+} TL1_Command;
+
+typedef struct TL1_Pipeline_struct {
+	int count;
+	TL1_Command commands[TL1_PIPELINE_MAX];
+	TL1_Pipeline_struct(): count(0) {}
+} TL1_Pipeline;
+
 class SwitchCtrl_Session_SubnetUNI;
 typedef SimpleList<SwitchCtrl_Session_SubnetUNI*> SwitchCtrl_Session_SubnetUNI_List;
 class SONET_SDH_SENDER_TSPEC_Object;
@@ -124,6 +150,9 @@ public:
 
 	uint32 getNewCtag() { ++ctagNum; return (getPseudoSwitchID()+ctagNum+(isSource?0:500000))%999999+1; }
 	uint32 getCurrentCtag() { return (getPseudoSwitchID()+ctagNum+(isSource?0:500000))%999999+1; }
+	TL1_Command& addTL1Command(TL1_Pipeline& plan, int dependsOn = -1);
+	bool runTL1Pipeline(TL1_Pipeline& plan, int timeout);
+	void deleteCreatedGroups_TL1(TL1_Pipeline& created, int first, String& name, const char* oosFormat, int settle, const char* dltFormat);
 	String& getCienaSoftwareVersion();
 	void getCienaTimeslotsString(String& groupMemString);
 	void getCienaLogicalPortString(String& OMPortString, String& ETTPString, uint32 logicalPort=0);
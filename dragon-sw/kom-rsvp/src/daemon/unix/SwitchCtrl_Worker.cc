@@ -0,0 +1,235 @@
+/****************************************************************************
+
+Switch Control Module source file SwitchCtrl_Worker.cc
+Worker thread that keeps switch provisioning off the RSVP main loop
+To be incorporated into KOM-RSVP-TE package
+
+****************************************************************************/
+
+#include "SwitchCtrl_Worker.h"
+#include "SwitchCtrl_Global.h"
+#include "RSVP_Log.h"
+#include "RSVP_NetworkServiceDaemon.h"
+#include "RSVP_ProcessingStats.h"
+#include "SystemCallCheck.h"
+#include <fcntl.h>
+
+bool SwitchCtrl_Worker::started = false;
+pthread_t SwitchCtrl_Worker::thread;
+pthread_mutex_t SwitchCtrl_Worker::mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t SwitchCtrl_Worker::workCond = PTHREAD_COND_INITIALIZER;
+int SwitchCtrl_Worker::completionPipe[2] = { -1, -1 };
+sigset_t SwitchCtrl_Worker::alarmMask;
+SwitchCtrl_JobQueueList SwitchCtrl_Worker::queueList;
+SwitchCtrl_JobList SwitchCtrl_Worker::doneList;
+
+// logs out of the switch of a removed session, which is then deleted on the
+// main loop; a session disconnects again when it is deleted, which does not
+// talk to the switch any more
+class SwitchCtrl_DisconnectJob : public SwitchCtrl_Job {
+public:
+	SwitchCtrl_DisconnectJob( SwitchCtrl_Session* session ) : SwitchCtrl_Job(session) {}
+	virtual bool run() { getSession()->disconnectSwitch(); return true; }
+	virtual void complete( bool ) {}
+};
+
+// the thread is created on the first job, so that a VLSR without Ethernet
+// switches never runs one
+void SwitchCtrl_Worker::start() {
+	CHECK( pipe( completionPipe ) );
+	CHECK( fcntl( completionPipe[0], F_SETFL, O_NONBLOCK ) );
+	CHECK( fcntl( completionPipe[1], F_SETFL, O_NONBLOCK ) );
+	sigemptyset( &alarmMask );
+	sigaddset( &alarmMask, SIGALRM );
+
+	// the worker inherits a mask with all asynchronous signals blocked,
+	// they stay with the main loop
+	sigset_t workerMask, mainMask;
+	sigfillset( &workerMask );
+	sigdelset( &workerMask, SIGSEGV );
+	sigdelset( &workerMask, SIGBUS );
+	sigdelset( &workerMask, SIGFPE );
+	sigdelset( &workerMask, SIGILL );
+	pthread_sigmask( SIG_SETMASK, &workerMask, &mainMask );
+	CHECK0( pthread_create( &thread, NULL, workerMain, NULL ) );
+	CHECK0( pthread_detach( thread ) );
+	sigaddset( &mainMask, SIGALRM );
+	pthread_sigmask( SIG_SETMASK, &mainMask, NULL );
+
+	NetworkServiceDaemon::registerSwitchCtrl_Handle( completionPipe[0] );
+	started = true;
+	LOG(2)( Log::MPLS, "VLSR: started switch control worker, completion pipe", completionPipe[0] );
+}
+
+void* SwitchCtrl_Worker::workerMain( void* ) {
+	static const char completion = 0;
+#if defined(RSVP_MEMORY_MACHINE)
+	memoryMachineBypass = true;
+#endif
+	pthread_mutex_lock( &mutex );
+	for (;;) {
+		SwitchCtrl_Job* job = nextJob();
+		if ( !job ) {
+			pthread_cond_wait( &workCond, &mutex );
+	continue;
+		}
+		pthread_mutex_unlock( &mutex );
+
+		pthread_sigmask( SIG_UNBLOCK, &alarmMask, NULL );
+		bool result;
+		{
+			ProcessingTimer timer( STATS_PROBE_SWITCH_JOB );
+			result = job->run();
+		}
+		pthread_sigmask( SIG_BLOCK, &alarmMask, NULL );
+
+		pthread_mutex_lock( &mutex );
+		job->result = result;
+		doneList.push_back( job );
+		// a full pipe already has the main loop's attention
+		write( completionPipe[1], &completion, 1 );
+	}
+	return NULL;
+}
+
+// called with the mutex held: take the first job of the first busy queue and
+// move that queue behind the others
+SwitchCtrl_Job* SwitchCtrl_Worker::nextJob() {
+	SwitchCtrl_JobQueueList::Iterator iter = queueList.begin();
+	for ( ; iter != queueList.end(); ++iter ) {
+		SwitchCtrl_JobQueue* queue = *iter;
+		if ( !queue->jobs.empty() ) {
+			SwitchCtrl_Job* job = queue->jobs.front();
+			queue->jobs.pop_front();
+			queueList.erase( iter );
+			queueList.push_back( queue );
+			return job;
+		}
+	}
+	return NULL;
+}
+
+SwitchCtrl_JobQueue* SwitchCtrl_Worker::findQueue( const SwitchCtrl_Session* session ) {
+	SwitchCtrl_JobQueueList::ConstIterator iter = queueList.begin();
+	for ( ; iter != queueList.end(); ++iter ) {
+		if ( (*iter)->session == session ) return *iter;
+	}
+	return NULL;
+}
+
+// called with the mutex held
+SwitchCtrl_JobQueue* SwitchCtrl_Worker::getQueue( SwitchCtrl_Session* session ) {
+	SwitchCtrl_JobQueue* queue = findQueue( session );
+	if ( !queue ) {
+		queue = new SwitchCtrl_JobQueue( session );
+		queueList.push_back( queue );
+	}
+	return queue;
+}
+
+void SwitchCtrl_Worker::enqueue( SwitchCtrl_Job* job ) {
+	if ( !started ) start();
+	pthread_mutex_lock( &mutex );
+	SwitchCtrl_JobQueue* queue = getQueue( job->session );
+	job->queue = queue;
+	queue->outstanding += 1;
+	SimpleList<SwitchCtrl_Session*>::ConstIterator iter = job->heldSessions.begin();
+	for ( ; iter != job->heldSessions.end(); ++iter ) {
+		SwitchCtrl_JobQueue* heldQueue = getQueue( *iter );
+		heldQueue->outstanding += 1;
+		job->heldQueues.push_back( heldQueue );
+	}
+	queue->jobs.push_back( job );
+	pthread_cond_signal( &workCond );
+	pthread_mutex_unlock( &mutex );
+}
+
+bool SwitchCtrl_Worker::cancel( SwitchCtrl_Job* job ) {
+	bool found = false;
+	pthread_mutex_lock( &mutex );
+	SwitchCtrl_JobList::Iterator iter = job->queue->jobs.begin();
+	for ( ; iter != job->queue->jobs.end(); ++iter ) {
+		if ( *iter == job ) {
+			job->queue->jobs.erase( iter );
+			found = true;
+	break;
+		}
+	}
+	pthread_mutex_unlock( &mutex );
+	if ( found ) finishJob( job );
+	return found;
+}
+
+// main loop: the job has completed or was cancelled
+void SwitchCtrl_Worker::finishJob( SwitchCtrl_Job* job ) {
+	SwitchCtrl_JobQueue* queue = job->queue;
+	SimpleList<SwitchCtrl_JobQueue*> heldQueues = job->heldQueues;
+	delete job;
+	releaseQueue( queue );
+	SimpleList<SwitchCtrl_JobQueue*>::ConstIterator iter = heldQueues.begin();
+	for ( ; iter != heldQueues.end(); ++iter ) {
+		releaseQueue( *iter );
+	}
+}
+
+// main loop: one job of the queue is done with its session
+void SwitchCtrl_Worker::releaseQueue( SwitchCtrl_JobQueue* queue ) {
+	queue->outstanding -= 1;
+	if ( queue->outstanding > 0 || !queue->deleteSession ) return;
+	if ( !queue->disconnecting ) {
+		disconnectSession( queue );
+		return;
+	}
+	pthread_mutex_lock( &mutex );
+	SwitchCtrl_JobQueueList::Iterator iter = queueList.begin();
+	for ( ; *iter != queue; ++iter );
+	queueList.erase( iter );
+	pthread_mutex_unlock( &mutex );
+	delete queue->session;
+	delete queue;
+}
+
+// main loop: the last job of a removed session
+void SwitchCtrl_Worker::disconnectSession( SwitchCtrl_JobQueue* queue ) {
+	queue->disconnecting = true;
+	enqueue( new SwitchCtrl_DisconnectJob( queue->session ) );
+}
+
+void SwitchCtrl_Worker::processCompletions() {
+	static char buffer[64];
+	while ( read( completionPipe[0], buffer, sizeof(buffer) ) > 0 );
+	for (;;) {
+		pthread_mutex_lock( &mutex );
+		SwitchCtrl_Job* job = NULL;
+		if ( !doneList.empty() ) {
+			job = doneList.front();
+			doneList.pop_front();
+		}
+		pthread_mutex_unlock( &mutex );
+		if ( !job ) break;
+		// complete() may queue follow-up jobs for the same switch
+		job->complete( job->result );
+		finishJob( job );
+	}
+}
+
+bool SwitchCtrl_Worker::isBusy( const SwitchCtrl_Session* session ) {
+	if ( !started ) return false;
+	pthread_mutex_lock( &mutex );
+	SwitchCtrl_JobQueue* queue = findQueue( session );
+	pthread_mutex_unlock( &mutex );
+	return queue && queue->outstanding > 0;
+}
+
+void SwitchCtrl_Worker::releaseSession( SwitchCtrl_Session* session ) {
+	if ( !started ) start();
+	pthread_mutex_lock( &mutex );
+	SwitchCtrl_JobQueue* queue = getQueue( session );
+	pthread_mutex_unlock( &mutex );
+	queue->deleteSession = true;
+	if ( queue->outstanding > 0 ) {
+		LOG(2)( Log::MPLS, "VLSR: deleting switch control session after its jobs completed:", session->getSwitchInetAddr() );
+	} else {
+		disconnectSession( queue );
+	}
+}
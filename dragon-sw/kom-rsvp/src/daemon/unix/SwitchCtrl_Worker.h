@@ -0,0 +1,102 @@
+/****************************************************************************
+
+Switch Control Module header file SwitchCtrl_Worker.h
+Worker thread that keeps switch provisioning off the RSVP main loop
+To be incorporated into KOM-RSVP-TE package
+
+****************************************************************************/
+
+#ifndef _SWITCHCTRL_WORKER_H_
+#define _SWITCHCTRL_WORKER_H_
+
+#include "RSVP_Lists.h"
+#include <pthread.h>
+#include <signal.h>
+
+/****************************************************************************
+
+Notes:
+1. All jobs run on one worker thread. net-snmp's session list and the alarm,
+    signal and buffer state of CLI_Session are process-global, so talking to
+    several switches at the same time is not safe; the worker only takes the
+    waiting for the switches off the main loop.
+2. Each switch control session has its own job queue. Jobs of one switch run
+    in order, the queues of different switches are served round-robin.
+3. SwitchCtrl_Job::run() is called on the worker and may only use its
+    SwitchCtrl_Session. SwitchCtrl_Job::complete() is called on the main loop
+    once the worker is done and applies the result to RSVP and OSPFd state.
+4. A job without session may hold further sessions (see SwitchCtrl_Job::holdSession),
+    which then count as busy and are not deleted until the job has completed.
+5. The main loop never talks to a switch itself, not even to disconnect from a
+    removed session (see SwitchCtrl_Worker::releaseSession). SIGALRM, which
+    interrupts the CLI reads, is only unblocked on the worker.
+
+****************************************************************************/
+
+class SwitchCtrl_Session;
+class SwitchCtrl_JobQueue;
+
+class SwitchCtrl_Job {
+	friend class SwitchCtrl_Worker;
+	SwitchCtrl_Session* session;
+	SwitchCtrl_JobQueue* queue;
+	SimpleList<SwitchCtrl_Session*> heldSessions;
+	SimpleList<SwitchCtrl_JobQueue*> heldQueues;
+	bool result;
+protected:
+	SwitchCtrl_Job( SwitchCtrl_Session* session ) : session(session), queue(NULL), result(false) {}
+	SwitchCtrl_Session* getSession() const { return session; }
+	// before the job is queued: run() works on this session as well
+	void holdSession( SwitchCtrl_Session* s ) { heldSessions.push_back( s ); }
+	const SimpleList<SwitchCtrl_Session*>& getHeldSessions() const { return heldSessions; }
+public:
+	virtual ~SwitchCtrl_Job() {}
+	// worker thread: switch I/O only
+	virtual bool run() = 0;
+	// main loop: apply the result of run()
+	virtual void complete( bool result ) = 0;
+};
+
+typedef SimpleList<SwitchCtrl_Job*> SwitchCtrl_JobList;
+
+class SwitchCtrl_JobQueue {
+	friend class SwitchCtrl_Worker;
+	SwitchCtrl_Session* session;
+	SwitchCtrl_JobList jobs;
+	uint32 outstanding;                 // main loop only: jobs not yet completed
+	bool deleteSession;                 // main loop only: session has been removed
+	bool disconnecting;                 // main loop only: disconnect job queued
+	SwitchCtrl_JobQueue( SwitchCtrl_Session* session ) : session(session), outstanding(0), deleteSession(false), disconnecting(false) {}
+};
+
+typedef SimpleList<SwitchCtrl_JobQueue*> SwitchCtrl_JobQueueList;
+
+class SwitchCtrl_Worker {
+	static bool started;
+	static pthread_t thread;
+	static pthread_mutex_t mutex;
+	static pthread_cond_t workCond;     // job queued
+	static int completionPipe[2];
+	static sigset_t alarmMask;
+	static SwitchCtrl_JobQueueList queueList;
+	static SwitchCtrl_JobList doneList;
+
+	static void start();
+	static void* workerMain( void* );
+	static SwitchCtrl_Job* nextJob();
+	static SwitchCtrl_JobQueue* findQueue( const SwitchCtrl_Session* );
+	static SwitchCtrl_JobQueue* getQueue( SwitchCtrl_Session* );
+	static void releaseQueue( SwitchCtrl_JobQueue* );
+	static void finishJob( SwitchCtrl_Job* );
+	static void disconnectSession( SwitchCtrl_JobQueue* );
+public:
+	static void enqueue( SwitchCtrl_Job* );
+	// true, if the job had not been started yet and is deleted
+	static bool cancel( SwitchCtrl_Job* );
+	static void processCompletions();
+	static bool isBusy( const SwitchCtrl_Session* );
+	// disconnect and delete the session once its outstanding jobs have completed
+	static void releaseSession( SwitchCtrl_Session* );
+};
+
+#endif /* _SWITCHCTRL_WORKER_H_ */
@@ -105,7 +105,7 @@ daemon (int nochdir, int noclose)
 }
 
 int main( int argc, char** argv ) {
-	const char* logstring_enable = "all";
+	const char* logstring_enable = "all,async";
 	const char* logstring_disable = "ref,packet,select";
 	const char* logfile = "";
 	const char* configfile = "/usr/local/etc/RSVPD.conf";
@@ -124,7 +124,7 @@ int main( int argc, char** argv ) {
 			logstring_disable = "";
 			break;
 		case 'L':
-			logstring_enable = "all";
+			logstring_enable = "all,async";
 			logstring_disable = optarg;
 			break;
 		case 'o':
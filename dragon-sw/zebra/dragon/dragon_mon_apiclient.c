@@ -783,6 +783,7 @@ void zAddLocalId(void* api, u_int16_t type, u_int16_t value, u_int16_t tag) {}
 void zDeleteLocalId(void* api, u_int16_t type, u_int16_t value, u_int16_t tag) {}
 void zRefreshLocalId(void* api, u_int16_t type, u_int16_t value, u_int16_t tag) {}
 void zMonitoringQuery(void* api, u_int32_t ucid, u_int32_t seqnum, char* gri, u_int32_t destAddrIp, u_int16_t tunnelId, u_int32_t extTunnelId) {}
+void zStatisticsQuery(void* api) {}
 
 /************* Compile without libRSVP *************/
 
@@ -1297,6 +1297,13 @@ void  rsvpUpcall(void* para)
 		return;
 	}
 
+	if (p->code == StatsReply) /* answer to "show rsvp-statistics" */
+	{
+		if (dmaster.rsvp_stats && p->statsReplyPara)
+			memcpy(dmaster.rsvp_stats, p->statsReplyPara, sizeof(struct _STATS_Reply_Para));
+		return;
+	}
+
 	lsp = dragon_find_lsp_by_rsvpupcallparam(p);
 	if (!lsp) {
 		zlog_warn("Unable to find LSP for this RSVP upcall.");
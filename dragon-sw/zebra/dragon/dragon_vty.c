@@ -2302,6 +2302,7 @@ dragon_master_init()
 
   dmaster.t_mon_accept = NULL;
   dmaster.mon_apiserver_list = NULL;
+  dmaster.rsvp_stats = NULL;
 
   default_session.Session_Para.destAddr.s_addr = 0x100007f; /* "127.0.0.1" */
   default_session.Session_Para.destPort = 0; 
@@ -2836,6 +2837,93 @@ DEFUN (dragon_show_mon_apiserver,
   return CMD_SUCCESS;
 }
 
+static const char *rsvp_stats_probe_names[STATS_NUM_PROBES] = {
+  "PATH", "RESV", "PATHERR", "RESVERR", "PATHTEAR", "RESVTEAR", "RESVCONF",
+  "SREFRESH/ACK", "API", "processPATH", "processRESV", "bindInAndOut",
+  "switch control job", "OSPF query", "NARB query"
+};
+
+/* upper bound (usec) of the histogram bucket that holds the percentile */
+static u_int32_t
+rsvp_stats_percentile (struct _STATS_Probe_Info *probe, u_int32_t percent)
+{
+  u_int32_t i, sum = 0;
+  u_int32_t rank = (probe->count * percent + 99) / 100;
+
+  for (i = 0; i < STATS_HISTOGRAM_BUCKETS - 1; i++)
+    {
+      sum += probe->buckets[i];
+      if (sum >= rank)
+        break;
+    }
+  if (i == STATS_HISTOGRAM_BUCKETS - 1 || ((u_int32_t)2 << i) > probe->max_usec)
+    return probe->max_usec;
+  return (u_int32_t)2 << i;
+}
+
+DEFUN (dragon_show_rsvp_statistics,
+       dragon_show_rsvp_statistics_cmd,
+       "show rsvp-statistics",
+       SHOW_STR
+       "Processing counts and latencies of the RSVP daemon\n")
+{
+  struct _STATS_Reply_Para stats;
+  struct _STATS_Probe_Info *probe;
+  struct timeval deadline, now, timeout;
+  fd_set readfds;
+  u_int32_t i;
+
+  if (!dmaster.api || dmaster.rsvp_fd <= 0)
+    {
+      vty_out (vty, "RSVPD is not connected.%s", VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+
+  /* The reply is picked up by rsvpUpcall(); other upcalls that arrive
+     meanwhile are processed as usual. */
+  memset (&stats, 0, sizeof (stats));
+  dmaster.rsvp_stats = &stats;
+  zStatisticsQuery (dmaster.api);
+  gettimeofday (&deadline, NULL);
+  deadline.tv_sec += 2;
+  while (stats.length == 0)
+    {
+      gettimeofday (&now, NULL);
+      if (timercmp (&now, &deadline, >=))
+        break;
+      timersub (&deadline, &now, &timeout);
+      FD_ZERO (&readfds);
+      FD_SET (dmaster.rsvp_fd, &readfds);
+      if (select (dmaster.rsvp_fd + 1, &readfds, NULL, NULL, &timeout) > 0)
+        zApiReceiveAndProcess (dmaster.api, rsvpUpcall);
+    }
+  dmaster.rsvp_stats = NULL;
+  if (stats.length == 0)
+    {
+      vty_out (vty, "No statistics reply from RSVPD.%s", VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+
+  vty_out (vty, "RSVPD statistics over %u seconds, latencies in usec%s", stats.interval, VTY_NEWLINE);
+  vty_out (vty, "(percentiles are upper bounds of power-of-two buckets)%s", VTY_NEWLINE);
+  vty_out (vty, "PATH messages: %u fast refreshes, %u full processing%s",
+           stats.path_fast_count, stats.path_full_count, VTY_NEWLINE);
+  vty_out (vty, "%-20s %10s %10s %10s %10s %10s %10s%s",
+           "Probe", "Count", "Mean", "p50", "p90", "p99", "Max", VTY_NEWLINE);
+  for (i = 0; i < stats.num_probes && i < STATS_NUM_PROBES; i++)
+    {
+      probe = &stats.probes[i];
+      if (probe->count == 0)
+        continue;
+      vty_out (vty, "%-20s %10u %10u %10u %10u %10u %10u%s",
+               rsvp_stats_probe_names[i], probe->count, probe->mean_usec,
+               rsvp_stats_percentile (probe, 50), rsvp_stats_percentile (probe, 90),
+               rsvp_stats_percentile (probe, 99), probe->max_usec, VTY_NEWLINE);
+    }
+
+  return CMD_SUCCESS;
+}
+
 
 void
 dragon_supp_vty_init ()
@@ -2859,6 +2947,7 @@ dragon_supp_vty_init ()
   install_element(VIEW_NODE, &dragon_delete_lsp_cmd);
   install_element(VIEW_NODE, &dragon_show_narb_extra_options_cmd);
   install_element(VIEW_NODE, &dragon_show_mon_apiserver_cmd);
+  install_element(VIEW_NODE, &dragon_show_rsvp_statistics_cmd);
 
   registered_local_ids = list_new();
   install_element(VIEW_NODE, &dragon_show_local_id_cmd);
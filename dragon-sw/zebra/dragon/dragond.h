@@ -372,6 +372,7 @@ enum _RSVP_MsgType {
 	ResvConf, Ack = 13, Srefresh = 15, Load = 126, 
 	PathResv = 127, 
 	MonQuery = 204, MonReply = 205,  /*DRAGON extension*/
+	StatsQuery = 206, StatsReply = 207,  /*DRAGON extension*/
 	RemoveAPI = 255,
 };
 
@@ -570,6 +571,41 @@ struct _MON_Reply_Para {
 #define MON_REPLY_SUBTYPE_SUBNET_TRANSIT	0x0005
 #define MON_REPLY_SUBTYPE_ERROR 				0x000f
 
+/* RSVPD processing statistics, mirrors STATS_Reply_Subobject in kom-rsvp */
+#define STATS_PROBE_MSG_PATH			0
+#define STATS_PROBE_MSG_RESV			1
+#define STATS_PROBE_MSG_PATH_ERR		2
+#define STATS_PROBE_MSG_RESV_ERR		3
+#define STATS_PROBE_MSG_PATH_TEAR		4
+#define STATS_PROBE_MSG_RESV_TEAR		5
+#define STATS_PROBE_MSG_RESV_CONF		6
+#define STATS_PROBE_MSG_SREFRESH		7
+#define STATS_PROBE_MSG_API			8
+#define STATS_PROBE_PROCESS_PATH		9
+#define STATS_PROBE_PROCESS_RESV		10
+#define STATS_PROBE_BIND_IN_AND_OUT	11
+#define STATS_PROBE_SWITCH_JOB		12
+#define STATS_PROBE_OSPF_QUERY		13
+#define STATS_PROBE_NARB_QUERY		14
+#define STATS_NUM_PROBES			15
+#define STATS_HISTOGRAM_BUCKETS 24
+struct _STATS_Probe_Info {
+	u_int32_t count;
+	u_int32_t mean_usec;
+	u_int32_t max_usec;
+	u_int32_t buckets[STATS_HISTOGRAM_BUCKETS]; /* bucket i: [2^i, 2^(i+1)) usec */
+};
+struct _STATS_Reply_Para {
+	u_int16_t length;
+	u_int8_t type;
+	u_int8_t sub_type;
+	u_int32_t interval;
+	u_int32_t num_probes;
+	u_int32_t path_fast_count;
+	u_int32_t path_full_count;
+	struct _STATS_Probe_Info probes[STATS_NUM_PROBES];
+};
+
 
 struct _sessionParameters {
 	/*Mandatory parameters*/
@@ -616,6 +652,7 @@ struct _rsvp_upcall_parameter {
 	struct _Dragon_ExtInfo_Para* dragonExtInfoPara;
 	struct _Error_Spec_Para* errorSpecPara;
 	struct _MON_Reply_Para* monReplyPara;
+	struct _STATS_Reply_Para* statsReplyPara; /*only valid during the upcall*/
 	void* sendTSpec;  /*Sender TSpec*/
 	void* adSpec;
 	void* session;	/*RSVP_API::SessionId*/
@@ -742,6 +779,9 @@ struct dragon_master {
 	struct thread *t_mon_accept;
 	/* Monitoring apiserver list */
 	list mon_apiserver_list;
+
+	/* RSVPD statistics requested by "show rsvp-statistics", NULL otherwise */
+	struct _STATS_Reply_Para *rsvp_stats;
 };
 
 /* Structure for localID */
@@ -813,6 +853,7 @@ extern int dragon_write (struct thread *thread);
 extern u_int32_t dragon_assign_seqno (void);
 extern int dragon_narb_socket_init(void);
 extern int dragon_rsvp_read(struct thread *thread);
+extern void rsvpUpcall(void* para);
 extern void dragon_show_lsp_detail(struct lsp *lsp, struct vty* vty);
 extern void lsp_del(struct lsp *lsp);
 extern int dragon_config_write(struct vty *vty);
@@ -833,6 +874,7 @@ extern void zAddLocalId(void* api, u_int16_t type, u_int16_t value, u_int16_t ta
 extern void zDeleteLocalId(void* api, u_int16_t type, u_int16_t value, u_int16_t tag);
 extern void zRefreshLocalId(void* api, u_int16_t type, u_int16_t value, u_int16_t tag);
 extern void zMonitoringQuery(void* api, u_int32_t ucid, u_int32_t seqnum, char* gri, u_int32_t destAddrIp, u_int16_t tunnelId, u_int32_t extTunnelId);
+extern void zStatisticsQuery(void* api);
 	
 #endif /* _ZEBRA_DRAGOND_H */
 
@@ -350,6 +350,8 @@ struct memory_list memory_list_ospf[] =
   { MTYPE_OSPF_DISTANCE,      "OSPF distance   " },
   { MTYPE_OSPF_IF_INFO,       "OSPF if info    " },
   { MTYPE_OSPF_IF_PARAMS,     "OSPF if params  " },
+  { MTYPE_OSPF_CSPF,         "OSPF CSPF graph " },
+  { MTYPE_OSPF_TE_LSA_PARA,  "OSPF TE-LSA para" },
   { -1, NULL },
 };
 
@@ -114,6 +114,8 @@ enum
   MTYPE_OSPF_IF_INFO,
   MTYPE_OSPF_IF_PARAMS,
   MTYPE_OSPF_DRAGON,
+  MTYPE_OSPF_CSPF,
+  MTYPE_OSPF_TE_LSA_PARA,
 
   MTYPE_OSPF6_TOP,
   MTYPE_OSPF6_AREA,
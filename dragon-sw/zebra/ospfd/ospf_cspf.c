@@ -21,6 +21,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 
 
 #include <zebra.h>
+#include <zlib.h>
 
 #include "thread.h"
 #include "memory.h"
@@ -41,6 +42,7 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 #include "ospfd/ospf_asbr.h"
 #include "ospfd/ospf_lsa.h"
 #include "ospfd/ospf_lsdb.h"
+#include "ospfd/ospf_opaque.h"
 #include "ospfd/ospf_neighbor.h"
 #include "ospfd/ospf_nsm.h"
 #include "ospfd/ospf_spf.h"
@@ -52,400 +54,1489 @@ Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
 
 #ifdef HAVE_OPAQUE_LSA
 
-#define DEBUG
+/* CSPF part.
+ *
+ * The TE topology of each area is kept as a persistent adjacency-list
+ * graph: one vertex per advertising router in the TE-LSDB and one directed
+ * link per TE link LSA.  The graph is updated from the TE-LSDB add/delete
+ * hooks, so a path query only costs the Dijkstra search over a binary heap,
+ * O((V + E) log V), with no limit on the domain size.
+ *
+ * Links are pruned at query time against the request constraints
+ * (switching capability, unreserved bandwidth at the setup priority,
+ * administrative groups and SRLGs).  VLAN tag continuity is enforced by
+ * carrying the set of tags still free along the best path to each vertex
+ * and dropping links whose tag set does not intersect it.
+ *
+ * For protected LSPs the same graph serves a Suurballe search for a pair
+ * of link- (or SRLG-) disjoint paths and Yen's k-shortest paths.
+ *
+ * Single path results are kept in a bounded LRU cache tagged with the
+ * graph generation, which the TE-LSDB hooks bump on every change; a stale
+ * entry is simply recomputed.
+ */
+
+#define CSPF_INFINITY	0xffffffff
+
+struct cspf_link
+{
+  struct cspf_vertex *from;	/* Advertising router */
+  struct cspf_vertex *to;	/* Vertex identified by the link ID sub-TLV */
+  struct ospf_lsa *lsa;		/* TE link LSA describing this link */
+  u_int32_t metric;
+  struct in_addr lclif;		/* Local interface address */
+  struct in_addr rmtif;		/* Remote interface address */
+  u_char *vtag_mask;		/* Available VLAN tags, NULL if not advertised */
+  u_char flags;			/* Per-calculation marks, CSPF_LINK_* */
+};
+
+#define CSPF_LINK_EXCLUDED	0x01	/* Not to be used by this search */
+#define CSPF_LINK_PRIMARY	0x02	/* On the first path of a disjoint pair */
+#define CSPF_LINK_SELECTED	0x04	/* In the union of a disjoint pair */
+
+struct cspf_vertex
+{
+  struct in_addr router_id;
+  list links;			/* Outgoing struct cspf_link */
+  listnode node;		/* Position in graph->vertex_list */
+  u_int32_t lsa_count;		/* TE-LSAs advertised by this router */
+  u_int32_t in_count;		/* Links pointing to this vertex */
+
+  /* Per-calculation state. */
+  u_int32_t cost;
+  int heap_index;		/* -1 when not on the candidate heap */
+  struct cspf_link *parent_link;
+  struct cspf_vertex *parent;
+  u_char *vtag_mask;		/* Tags reachable with, in cspf_vtag_choose only */
+  u_int32_t potential;		/* Distance from the first Suurballe search */
+  struct cspf_link *primary_in;	/* Primary path link entering this vertex */
+  u_char excluded;		/* Not to be visited by this search */
+};
+
+/* A path as the sequence of its links, source to destination. */
+struct cspf_path
+{
+  list links;
+  u_int32_t cost;
+};
+
+struct cspf_graph
+{
+  struct hash *vertex_hash;	/* router_id -> struct cspf_vertex */
+  list vertex_list;
+  u_int32_t generation;		/* Bumped on every TE-LSDB change */
+  struct cspf_cache *cache;
+};
+
+#define CSPF_CACHE_SIZE		256
+
+/* Cached result of ospf_cspf_calculate_constrained (); no path is cached
+   as well, with hop_num 0. */
+struct cspf_cache_entry
+{
+  /* Key */
+  struct in_addr source;
+  struct in_addr dest;
+  struct cspf_constraint cons;	/* srlg_exclude owned by the entry */
+
+  u_int32_t generation;
+  u_int32_t vtag;		/* Tag chosen for a CSPF_ANY_VTAG request */
+  int hop_num;
+  struct in_addr *hops;
+
+  /* LRU list, most recently used at the head. */
+  struct cspf_cache_entry *prev;
+  struct cspf_cache_entry *next;
+};
+
+struct cspf_cache
+{
+  struct hash *entry_hash;
+  struct cspf_cache_entry *head;
+  struct cspf_cache_entry *tail;
+  unsigned long hits;
+  unsigned long misses;
+};
+
+/* Binary min-heap of candidate vertices ordered by cost. */
+struct cspf_heap
+{
+  struct cspf_vertex **array;
+  int size;
+  int max;
+};
+
+/* Only routers advertising TE-LSAs take part in path computation; the
+   others are merely referenced by the link ID of some link. */
+#define CSPF_VERTEX_ACTIVE(V)	((V)->lsa_count > 0)
+
+#define CSPF_VTAG_MASK_SIZE	(MAX_VLAN_NUM/8)
+
+static unsigned int
+cspf_vertex_hash_key (struct cspf_vertex *v)
+{
+  return ntohl (v->router_id.s_addr);
+}
+
+static int
+cspf_vertex_hash_cmp (struct cspf_vertex *v1, struct cspf_vertex *v2)
+{
+  return v1->router_id.s_addr == v2->router_id.s_addr;
+}
+
+static void *
+cspf_vertex_alloc (struct cspf_vertex *key)
+{
+  struct cspf_vertex *v;
+
+  v = XCALLOC (MTYPE_OSPF_CSPF, sizeof (struct cspf_vertex));
+  v->router_id = key->router_id;
+  v->links = list_new ();
+  v->heap_index = -1;
+  return v;
+}
+
+static unsigned int
+cspf_cache_hash_key (struct cspf_cache_entry *entry)
+{
+  struct cspf_constraint *cons = &entry->cons;
+  u_int32_t bw;
+  unsigned int key;
+
+  memcpy (&bw, &cons->bandwidth, sizeof (u_int32_t));
+  key = ntohl (entry->source.s_addr) * 31 + ntohl (entry->dest.s_addr);
+  key = key * 31 + (cons->switching_cap << 8 | cons->setup_priority);
+  key = key * 31 + bw;
+  key = key * 31 + cons->vtag;
+  return key;
+}
+
+static int
+cspf_cache_hash_cmp (struct cspf_cache_entry *entry1, struct cspf_cache_entry *entry2)
+{
+  struct cspf_constraint *cons1 = &entry1->cons;
+  struct cspf_constraint *cons2 = &entry2->cons;
+
+  if (entry1->source.s_addr != entry2->source.s_addr
+      || entry1->dest.s_addr != entry2->dest.s_addr)
+    return 0;
+  if (cons1->switching_cap != cons2->switching_cap
+      || cons1->setup_priority != cons2->setup_priority
+      || cons1->bandwidth != cons2->bandwidth
+      || cons1->include_any != cons2->include_any
+      || cons1->include_all != cons2->include_all
+      || cons1->exclude_any != cons2->exclude_any
+      || cons1->vtag != cons2->vtag
+      || cons1->srlg_num != cons2->srlg_num)
+    return 0;
+  if (cons1->srlg_num > 0 &&
+      memcmp (cons1->srlg_exclude, cons2->srlg_exclude,
+	      sizeof (u_int32_t) * cons1->srlg_num) != 0)
+    return 0;
+  return 1;
+}
+
+static void
+cspf_cache_entry_free (struct cspf_cache_entry *entry)
+{
+  if (entry->cons.srlg_exclude)
+    XFREE (MTYPE_OSPF_CSPF, entry->cons.srlg_exclude);
+  if (entry->hops)
+    XFREE (MTYPE_OSPF_CSPF, entry->hops);
+  XFREE (MTYPE_OSPF_CSPF, entry);
+}
+
+static void
+cspf_cache_unlink (struct cspf_cache *cache, struct cspf_cache_entry *entry)
+{
+  if (entry->prev)
+    entry->prev->next = entry->next;
+  else
+    cache->head = entry->next;
+  if (entry->next)
+    entry->next->prev = entry->prev;
+  else
+    cache->tail = entry->prev;
+  entry->prev = entry->next = NULL;
+}
+
+static void
+cspf_cache_push (struct cspf_cache *cache, struct cspf_cache_entry *entry)
+{
+  entry->prev = NULL;
+  entry->next = cache->head;
+  if (cache->head)
+    cache->head->prev = entry;
+  else
+    cache->tail = entry;
+  cache->head = entry;
+}
+
+static struct cspf_cache *
+cspf_cache_new ()
+{
+  struct cspf_cache *cache;
+
+  cache = XCALLOC (MTYPE_OSPF_CSPF, sizeof (struct cspf_cache));
+  cache->entry_hash = hash_create (cspf_cache_hash_key, cspf_cache_hash_cmp);
+  return cache;
+}
+
+static void
+cspf_cache_free (struct cspf_cache *cache)
+{
+  struct cspf_cache_entry *entry, *next;
+
+  for (entry = cache->head; entry; entry = next)
+    {
+      next = entry->next;
+      cspf_cache_entry_free (entry);
+    }
+  hash_clean (cache->entry_hash, NULL);
+  hash_free (cache->entry_hash);
+  XFREE (MTYPE_OSPF_CSPF, cache);
+}
+
+/* Return a copy of the cached path for this request, or NULL on a miss.
+   *found tells a cached "no path" apart from a miss. */
+static list
+cspf_cache_lookup (struct cspf_graph *graph, struct in_addr source_ip,
+		   struct in_addr dest_ip, struct cspf_constraint *cons, int *found)
+{
+  struct cspf_cache *cache = graph->cache;
+  struct cspf_cache_entry key, *entry;
+  struct in_addr *addr;
+  list explicit_path;
+  int i;
+
+  *found = 0;
+  key.source = source_ip;
+  key.dest = dest_ip;
+  key.cons = *cons;
+  entry = hash_lookup (cache->entry_hash, &key);
+  if (entry == NULL || entry->generation != graph->generation)
+    {
+      cache->misses++;
+      return NULL;
+    }
 
-/* My CSPF part */
+  cache->hits++;
+  *found = 1;
+  cspf_cache_unlink (cache, entry);
+  cspf_cache_push (cache, entry);
+
+  if (entry->hop_num == 0)
+    return NULL;
+  if (cons->vtag == CSPF_ANY_VTAG)
+    cons->vtag = entry->vtag;
+  explicit_path = list_new ();
+  for (i = 0; i < entry->hop_num; i++)
+    {
+      addr = XMALLOC (MTYPE_TMP, sizeof (struct in_addr));
+      *addr = entry->hops[i];
+      listnode_add (explicit_path, addr);
+    }
+  return explicit_path;
+}
 
+/* Remember the result of a calculation; cons holds the request as it was
+   before the calculation and vtag the tag chosen, if any. */
+static void
+cspf_cache_update (struct cspf_graph *graph, struct in_addr source_ip,
+		   struct in_addr dest_ip, struct cspf_constraint *cons,
+		   u_int32_t vtag, list explicit_path)
+{
+  struct cspf_cache *cache = graph->cache;
+  struct cspf_cache_entry key, *entry;
+  struct in_addr *addr;
+  listnode node;
+  int i;
+
+  key.source = source_ip;
+  key.dest = dest_ip;
+  key.cons = *cons;
+  entry = hash_lookup (cache->entry_hash, &key);
+  if (entry)
+    {
+      cspf_cache_unlink (cache, entry);
+      if (entry->hops)
+	XFREE (MTYPE_OSPF_CSPF, entry->hops);
+      entry->hops = NULL;
+    }
+  else
+    {
+      if (cache->entry_hash->count >= CSPF_CACHE_SIZE && cache->tail)
+	{
+	  struct cspf_cache_entry *lru = cache->tail;
+
+	  cspf_cache_unlink (cache, lru);
+	  hash_release (cache->entry_hash, lru);
+	  cspf_cache_entry_free (lru);
+	}
+      entry = XCALLOC (MTYPE_OSPF_CSPF, sizeof (struct cspf_cache_entry));
+      entry->source = source_ip;
+      entry->dest = dest_ip;
+      entry->cons = *cons;
+      if (cons->srlg_num > 0)
+	{
+	  entry->cons.srlg_exclude = XMALLOC (MTYPE_OSPF_CSPF,
+					      sizeof (u_int32_t) * cons->srlg_num);
+	  memcpy (entry->cons.srlg_exclude, cons->srlg_exclude,
+		  sizeof (u_int32_t) * cons->srlg_num);
+	}
+      else
+	entry->cons.srlg_exclude = NULL;
+      hash_get (cache->entry_hash, entry, hash_alloc_intern);
+    }
+
+  entry->generation = graph->generation;
+  entry->vtag = vtag;
+  entry->hop_num = explicit_path ? listcount (explicit_path) : 0;
+  if (entry->hop_num > 0)
+    {
+      entry->hops = XMALLOC (MTYPE_OSPF_CSPF, sizeof (struct in_addr) * entry->hop_num);
+      i = 0;
+      LIST_LOOP (explicit_path, addr, node)
+	entry->hops[i++] = *addr;
+    }
+  cspf_cache_push (cache, entry);
+}
+
+void
+ospf_cspf_cache_stats (struct cspf_graph *graph, unsigned long *hits,
+		       unsigned long *misses, unsigned long *entries)
+{
+  *hits = graph->cache->hits;
+  *misses = graph->cache->misses;
+  *entries = graph->cache->entry_hash->count;
+}
+
+struct cspf_graph *
+ospf_cspf_graph_new ()
+{
+  struct cspf_graph *graph;
+
+  graph = XCALLOC (MTYPE_OSPF_CSPF, sizeof (struct cspf_graph));
+  graph->vertex_hash = hash_create (cspf_vertex_hash_key, cspf_vertex_hash_cmp);
+  graph->vertex_list = list_new ();
+  graph->cache = cspf_cache_new ();
+  return graph;
+}
+
+static void
+cspf_link_free (struct cspf_link *link)
+{
+  if (link->vtag_mask)
+    XFREE (MTYPE_OSPF_CSPF, link->vtag_mask);
+  XFREE (MTYPE_OSPF_CSPF, link);
+}
+
+void
+ospf_cspf_graph_free (struct cspf_graph *graph)
+{
+  struct cspf_vertex *v;
+  struct cspf_link *link;
+  listnode node1, node2;
 
-/*This function is to test if the router_id exists in the list of routers*/
+  LIST_LOOP (graph->vertex_list, v, node1)
+    {
+      LIST_LOOP (v->links, link, node2)
+	cspf_link_free (link);
+      list_delete (v->links);
+      XFREE (MTYPE_OSPF_CSPF, v);
+    }
+  list_delete (graph->vertex_list);
+  hash_clean (graph->vertex_hash, NULL);
+  hash_free (graph->vertex_hash);
+  cspf_cache_free (graph->cache);
+  XFREE (MTYPE_OSPF_CSPF, graph);
+}
+
+static struct cspf_vertex *
+cspf_vertex_lookup (struct cspf_graph *graph, struct in_addr router_id)
+{
+  struct cspf_vertex key;
+
+  key.router_id = router_id;
+  return hash_lookup (graph->vertex_hash, &key);
+}
+
+static struct cspf_vertex *
+cspf_vertex_get (struct cspf_graph *graph, struct in_addr router_id)
+{
+  struct cspf_vertex key;
+  struct cspf_vertex *v;
+  unsigned long count = graph->vertex_hash->count;
+
+  key.router_id = router_id;
+  v = hash_get (graph->vertex_hash, &key, cspf_vertex_alloc);
+  if (graph->vertex_hash->count != count)
+    {
+      listnode_add (graph->vertex_list, v);
+      v->node = graph->vertex_list->tail;
+    }
+  return v;
+}
+
+/* Release a vertex once no LSA and no link refers to it any more. */
+static void
+cspf_vertex_release (struct cspf_graph *graph, struct cspf_vertex *v)
+{
+  if (v->lsa_count > 0 || v->in_count > 0)
+    return;
+
+  assert (listcount (v->links) == 0);
+  hash_release (graph->vertex_hash, v);
+  list_delete_node (graph->vertex_list, v->node);
+  list_delete (v->links);
+  XFREE (MTYPE_OSPF_CSPF, v);
+}
+
+/* Copy the available VLAN tag set of an L2SC link, uncompressing it if
+   needed, so that path queries never have to inflate it again. */
+static u_char *
+cspf_link_vtag_mask (struct te_lsa_para_ptr *para)
+{
+  struct te_link_subtlv_link_ifswcap *ifswcap;
+  struct link_ifswcap_specific_vlan *vlan;
+  u_char *mask;
+  uLongf z_len;
+  int i;
+
+  for (i = 0; i < para->link_ifswcap_num; i++)
+    {
+      ifswcap = para->p_link_ifswcap[i];
+      vlan = &ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan;
+      if (ifswcap->link_ifswcap_data.switching_cap != LINK_IFSWCAP_SUBTLV_SWCAP_L2SC
+	  || ntohs (ifswcap->header.length) <= STD_ISCD_LENGTH
+	  || (ntohs (vlan->version) & IFSWCAP_SPECIFIC_VLAN_BASIC) == 0)
+	continue;
+
+      mask = XMALLOC (MTYPE_OSPF_CSPF, CSPF_VTAG_MASK_SIZE);
+      if (ntohs (vlan->version) & IFSWCAP_SPECIFIC_VLAN_COMPRESS_Z)
+	{
+	  z_len = ZBUFSIZE;
+	  if (uncompress (z_buffer, &z_len, vlan->bitmask, (uLongf) ntohs (vlan->length) - 4) != Z_OK
+	      || z_len < CSPF_VTAG_MASK_SIZE)
+	    {
+	      XFREE (MTYPE_OSPF_CSPF, mask);
+	      continue;
+	    }
+	  memcpy (mask, z_buffer, CSPF_VTAG_MASK_SIZE);
+	}
+      else
+	memcpy (mask, vlan->bitmask, CSPF_VTAG_MASK_SIZE);
+      return mask;
+    }
+  return NULL;
+}
+
+/* TE-LSDB new_lsa_hook: add the link described by a TE link LSA. */
 int
-lookup_router_by_router_id (list router_list, struct in_addr router_id)
-{
-   listnode node;
-   struct in_addr *existing_router_id;
-  for (node = router_list->head; node; nextnode (node)) {
-  	existing_router_id =  (struct in_addr*) (node->data);
-  	if (ntohl(router_id.s_addr) == ntohl(existing_router_id->s_addr))
-	      return 1;
-  }
+ospf_cspf_graph_add_lsa (struct ospf_lsa *lsa)
+{
+  struct cspf_graph *graph;
+  struct te_lsa_para_ptr *para = lsa->tepara_ptr;
+  struct cspf_vertex *from;
+  struct cspf_link *link;
+
+  if (lsa->area == NULL || (graph = lsa->area->te_graph) == NULL)
+    return 0;
+
+  graph->generation++;
+  from = cspf_vertex_get (graph, lsa->data->adv_router);
+  from->lsa_count++;
+
+  if (lsa->te_lsa_type != LINK_TE_LSA || para == NULL)
+    return 0;
+  /* The ERO is expressed in interface addresses; a link without them
+     cannot be part of the result. */
+  if (para->p_lclif_ipaddr == NULL || para->p_rmtif_ipaddr == NULL)
+    return 0;
+
+  link = XCALLOC (MTYPE_OSPF_CSPF, sizeof (struct cspf_link));
+  link->from = from;
+  link->to = cspf_vertex_get (graph, para->p_link_id->value);
+  link->to->in_count++;
+  link->lsa = lsa;
+  link->metric = para->te_metric;
+  link->lclif = para->p_lclif_ipaddr->value;
+  link->rmtif = para->p_rmtif_ipaddr->value;
+  if (para->link_ifswcap_num)
+    link->vtag_mask = cspf_link_vtag_mask (para);
+  listnode_add (from->links, link);
+
   return 0;
+}
+
+/* TE-LSDB del_lsa_hook: remove the link added for this LSA, if any. */
+int
+ospf_cspf_graph_del_lsa (struct ospf_lsa *lsa)
+{
+  struct cspf_graph *graph;
+  struct cspf_vertex *from, *to;
+  struct cspf_link *link;
+  listnode node;
 
+  if (lsa->area == NULL || (graph = lsa->area->te_graph) == NULL)
+    return 0;
+
+  graph->generation++;
+  from = cspf_vertex_lookup (graph, lsa->data->adv_router);
+  if (from == NULL)
+    return 0;
+
+  LIST_LOOP (from->links, link, node)
+    if (link->lsa == lsa)
+      {
+	list_delete_node (from->links, node);
+	to = link->to;
+	cspf_link_free (link);
+	to->in_count--;
+	if (to != from)
+	  cspf_vertex_release (graph, to);
+	break;
+      }
+
+  if (from->lsa_count > 0)
+    from->lsa_count--;
+  cspf_vertex_release (graph, from);
+
+  return 0;
 }
 
-/* This function is to find all the routers in this area by looking through LSDB.
-     Those routers are put into a list. */
-list
-ospf_build_routers_from_te_lsdb(struct ospf_te_lsdb *lsdb)
-{
-  struct route_node *rn;
-  struct ospf_lsa *lsa;
-  list router_list = NULL;
-  struct in_addr *router_id;
-  
-  LSDB_LOOP (lsdb->db, rn, lsa)
-  {
-  	if (!router_list) 
-  		router_list = list_new();
-/*	if (!lookup_router_by_router_id(router_list, lsa->tepara_ptr->p_link_id->value)) {*/
-	if (!lookup_router_by_router_id(router_list, lsa->data->adv_router)) {
-		router_id=(struct in_addr *) malloc(sizeof (struct in_addr ));
-		router_id->s_addr=lsa->data->adv_router.s_addr;
-	  	listnode_add(router_list, router_id);
-		}
-  }
-  return router_list;
-}
-
-/* This function is to build up the graph. Vertexes are routers and edges are TE-links */
-struct in_addr *
-build_CSPF_vertex(list router_list) {
-
-  u_int8_t graphsize=router_list->count;
-  struct in_addr *CSPFvertex=(struct in_addr*) malloc(graphsize*sizeof(struct in_addr));
-  struct in_addr *nodedata;
+static int
+cspf_link_srlg_excluded (struct te_tlv_header *tlvh, struct cspf_constraint *cons)
+{
+  u_int32_t *v;
+  int i, j, n;
+
+  n = ntohs (tlvh->length) / sizeof (u_int32_t);
+  v = (u_int32_t *)((char *) tlvh + TLV_HDR_SIZE);
+  for (i = 0; i < n; i++)
+    for (j = 0; j < cons->srlg_num; j++)
+      if (ntohl (v[i]) == cons->srlg_exclude[j])
+	return 1;
+  return 0;
+}
+
+/* Check at query time whether a link satisfies the request constraints.
+   A CSPF_ANY_VTAG request is narrowed to one tag by cspf_vtag_choose ()
+   first, so VLAN tag continuity becomes a property of each link. */
+static int
+cspf_link_usable (struct cspf_link *link, struct cspf_constraint *cons)
+{
+  struct te_lsa_para_ptr *para = link->lsa->tepara_ptr;
+  u_int32_t color;
+
+  if (!CSPF_VERTEX_ACTIVE (link->to) || link->to->excluded)
+    return 0;
+  if (CHECK_FLAG (link->flags, CSPF_LINK_EXCLUDED))
+    return 0;
+  if (para == NULL || !TE_LSA_HAS_SWCAP (para, cons->switching_cap))
+    return 0;
+  if (IS_LSA_MAXAGE (link->lsa))
+    return 0;
+
+  if (cons->bandwidth > 0 && para->unrsv_bw[cons->setup_priority] < cons->bandwidth)
+    return 0;
+
+  if (cons->include_any || cons->include_all || cons->exclude_any)
+    {
+      color = para->rsc_clsclr;
+      if ((color & cons->exclude_any) != 0)
+	return 0;
+      if (cons->include_any && (color & cons->include_any) == 0)
+	return 0;
+      if ((color & cons->include_all) != cons->include_all)
+	return 0;
+    }
+
+  if (cons->srlg_num > 0 && para->p_link_srlg &&
+      cspf_link_srlg_excluded (para->p_link_srlg, cons))
+    return 0;
+
+  if (cons->vtag != 0 && cons->vtag != CSPF_ANY_VTAG && link->vtag_mask &&
+      !HAS_VLAN (link->vtag_mask, cons->vtag))
+    return 0;
+
+  return 1;
+}
+
+/* AND the tags free on the path so far with those of the link into
+   result; returns 0 if no common tag is left. */
+static int
+cspf_vtag_mask_and (u_char *result, u_char *path_mask, u_char *link_mask)
+{
+  u_char any = 0;
+  int i;
+
+  for (i = 0; i < CSPF_VTAG_MASK_SIZE; i++)
+    any |= (result[i] = path_mask[i] & link_mask[i]);
+  return (any != 0);
+}
+
+/* OR mask into result; returns 0 if result has not gained any tag. */
+static int
+cspf_vtag_mask_or (u_char *result, u_char *mask)
+{
+  u_char gained = 0;
+  int i;
+
+  for (i = 0; i < CSPF_VTAG_MASK_SIZE; i++)
+    {
+      gained |= mask[i] & ~result[i];
+      result[i] |= mask[i];
+    }
+  return (gained != 0);
+}
+
+/* Narrow a CSPF_ANY_VTAG request to the lowest tag that is free on every
+   link of some usable path from source to dest; returns 0 if there is none.
+   Keeping only the tags of the cheapest path at each vertex would lose
+   those of a costlier path that is the only one to carry them on to dest,
+   so the tags of all paths are collected instead: a vertex is expanded
+   again whenever one of its incoming links brings a tag it did not have. */
+static int
+cspf_vtag_choose (struct cspf_graph *graph, struct cspf_vertex *source,
+		  struct cspf_vertex *dest, struct cspf_constraint *cons)
+{
+  struct cspf_vertex **queue;
+  struct cspf_vertex *v;
+  struct cspf_link *link;
   listnode node;
-  u_int8_t i=0;
+  u_char *vtag_masks;
+  u_char *mask;
+  int count, head = 0, size = 0, i = 1;
+
+  /* One tag set per vertex plus scratch space for the candidate set; a
+     vertex is on the queue at most once, heap_index >= 0 while it is. */
+  count = listcount (graph->vertex_list);
+  vtag_masks = XCALLOC (MTYPE_OSPF_CSPF, CSPF_VTAG_MASK_SIZE * (count + 1));
+  queue = XMALLOC (MTYPE_OSPF_CSPF, sizeof (struct cspf_vertex *) * count);
+  mask = vtag_masks;
+  LIST_LOOP (graph->vertex_list, v, node)
+    {
+      v->heap_index = -1;
+      v->vtag_mask = vtag_masks + CSPF_VTAG_MASK_SIZE * i++;
+    }
+
+  memset (source->vtag_mask, 0xff, CSPF_VTAG_MASK_SIZE);
+  source->heap_index = 0;
+  queue[size++] = source;
+
+  while (size > 0)
+    {
+      v = queue[head];
+      head = (head + 1) % count;
+      size--;
+      v->heap_index = -1;
+      /* A walk through dest and back cannot bring it new tags. */
+      if (v == dest)
+	continue;
+      LIST_LOOP (v->links, link, node)
+	{
+	  if (!cspf_link_usable (link, cons))
+	    continue;
+	  if (link->vtag_mask == NULL)
+	    memcpy (mask, v->vtag_mask, CSPF_VTAG_MASK_SIZE);
+	  else if (!cspf_vtag_mask_and (mask, v->vtag_mask, link->vtag_mask))
+	    continue;
+	  if (!cspf_vtag_mask_or (link->to->vtag_mask, mask))
+	    continue;
+	  if (link->to->heap_index < 0)
+	    {
+	      link->to->heap_index = 0;
+	      queue[(head + size++) % count] = link->to;
+	    }
+	}
+    }
 
-  for (node = router_list->head; node; nextnode (node)) {
-  	nodedata=(struct in_addr*) node->data;
-  	CSPFvertex[i].s_addr=nodedata->s_addr;
-	i++;
-  }
-  if (router_list) list_free(router_list);
-  return CSPFvertex;
+  for (i = 1; i < MAX_VLAN_NUM; i++)
+    if (HAS_VLAN (dest->vtag_mask, i))
+      {
+	cons->vtag = i;
+	break;
+      }
+
+  LIST_LOOP (graph->vertex_list, v, node)
+    v->vtag_mask = NULL;
+  XFREE (MTYPE_OSPF_CSPF, queue);
+  XFREE (MTYPE_OSPF_CSPF, vtag_masks);
+
+  return (cons->vtag != CSPF_ANY_VTAG);
 }
 
-/* This function is to build up the graph. Vertexes are routers and edges are TE-links */
-struct in_addr *
-init_CSPF_TE_Link_list(list router_list) {
+static void
+cspf_heap_init (struct cspf_heap *heap, int max)
+{
+  heap->array = XMALLOC (MTYPE_OSPF_CSPF, sizeof (struct cspf_vertex *) * max);
+  heap->size = 0;
+  heap->max = max;
+}
 
-  u_int8_t graphsize=router_list->count;
-  u_int16_t linksize=graphsize*graphsize;
-  struct in_addr *CSPFlinks=(struct in_addr*) malloc(linksize*sizeof(struct in_addr));
-  return CSPFlinks;
+static void
+cspf_heap_finish (struct cspf_heap *heap)
+{
+  XFREE (MTYPE_OSPF_CSPF, heap->array);
 }
 
+static void
+cspf_heap_set (struct cspf_heap *heap, int i, struct cspf_vertex *v)
+{
+  heap->array[i] = v;
+  v->heap_index = i;
+}
 
-/* This function is to get index of an in_addr*/
-int
-get_vertex_index(u_int8_t graphsize, struct in_addr *CSPFvertex, struct in_addr router_ip) {
+static void
+cspf_heap_up (struct cspf_heap *heap, int i)
+{
+  struct cspf_vertex *v = heap->array[i];
+  int parent;
+
+  while (i > 0)
+    {
+      parent = (i - 1) / 2;
+      if (heap->array[parent]->cost <= v->cost)
+	break;
+      cspf_heap_set (heap, i, heap->array[parent]);
+      i = parent;
+    }
+  cspf_heap_set (heap, i, v);
+}
+
+static void
+cspf_heap_down (struct cspf_heap *heap, int i)
+{
+  struct cspf_vertex *v = heap->array[i];
+  int child;
+
+  while ((child = 2 * i + 1) < heap->size)
+    {
+      if (child + 1 < heap->size &&
+	  heap->array[child + 1]->cost < heap->array[child]->cost)
+	child++;
+      if (v->cost <= heap->array[child]->cost)
+	break;
+      cspf_heap_set (heap, i, heap->array[child]);
+      i = child;
+    }
+  cspf_heap_set (heap, i, v);
+}
 
-  int i=0;
-  for (i = 0; i<graphsize; i++) {
-  	if (ntohl(CSPFvertex[i].s_addr) == ntohl(router_ip.s_addr))
-		return i;
-  }
-  return -1;
+/* Insert a vertex, or move it up after its cost has been decreased. */
+static void
+cspf_heap_update (struct cspf_heap *heap, struct cspf_vertex *v)
+{
+  if (v->heap_index < 0)
+    {
+      assert (heap->size < heap->max);
+      cspf_heap_set (heap, heap->size++, v);
+    }
+  cspf_heap_up (heap, v->heap_index);
 }
 
+static struct cspf_vertex *
+cspf_heap_pop (struct cspf_heap *heap)
+{
+  struct cspf_vertex *v;
+
+  if (heap->size == 0)
+    return NULL;
 
-/*This function is to test if the te-link has the required switching capability*/
-int 
-ospf_te_lsa_swcap_lookup (list swcap_list, u_int8_t swcap)
+  v = heap->array[0];
+  v->heap_index = -1;
+  if (--heap->size > 0)
+    {
+      cspf_heap_set (heap, 0, heap->array[heap->size]);
+      cspf_heap_down (heap, 0);
+    }
+  return v;
+}
+
+/* Clear the marks set on vertices and links by the disjoint and k-shortest
+   searches; they clear them again when done, so a plain search finds
+   none. */
+static void
+cspf_graph_clear_marks (struct cspf_graph *graph)
 {
-  listnode node=NULL;
-  struct te_link_subtlv_link_ifswcap *nodedata;
+  struct cspf_vertex *v;
+  struct cspf_link *link;
+  listnode node1, node2;
 
-  node=listhead(swcap_list);
-  while (node) {
- 	nodedata=node->data;
-	if (nodedata->link_ifswcap_data.switching_cap ==swcap) return 1;
-	nextnode(node);
- 	}
-return 0;
+  LIST_LOOP (graph->vertex_list, v, node1)
+    {
+      v->excluded = 0;
+      v->primary_in = NULL;
+      LIST_LOOP (v->links, link, node2)
+	link->flags = 0;
+    }
 }
 
-/* This function is to build up the graph. Vertexes are routers and edges are TE-links */
-void
-build_CSPF_graph(struct ospf_area *area, list router_list, struct in_addr *CSPFvertex, 
-		struct in_addr *CSPFlinks, u_int32_t graph[100][100], u_int8_t SwitchingCapability) {
-
-  list te_link_lsa_list=NULL;
-  struct ospf_lsa* te_lsa=NULL;
-  listnode te_lsa_node;
-  /* u_int32_t bandwidth=1000; */ /*Suppose one wavelength capacity is 2.5G*/
-  
-  u_int8_t graphsize;
-  int i, j, m;
-  int linkindex;
-  int linksize; /*the number of links*/
-  graphsize=router_list->count;
-  linksize=graphsize*graphsize;
-
-
-  /*initialize the graph array */
-  for (i = 0; i<graphsize; i++) {
-  	 for (j = 0; j<graphsize; j++) {
-	  	graph[i][j]=1000000; /*infinity*/
-  	  }
-  }
-
-  /*the value in graph array is metric*/
-  for (i = 0; i<graphsize; i++) {
-  	te_link_lsa_list=ospf_te_lsdb_lookup_by_adv_router (area->te_lsdb, CSPFvertex[i]);
-  	te_lsa_node=listhead(te_link_lsa_list);
-
-	while (te_lsa_node) {
-		te_lsa=te_lsa_node->data;
-
-		if (!te_lsa) {
-			nextnode(te_lsa_node);
-			continue;
-		}
-		
-		/* Check the switching capability of current te_link. */
-		if ( te_lsa->te_lsa_type == ROUTER_ID_TE_LSA) {
-			nextnode(te_lsa_node);
-			continue;
-		}
-
-		if (!te_lsa->tepara_ptr) {
-			nextnode(te_lsa_node);
-			continue;
-		} 
-		if (!te_lsa->tepara_ptr->p_link_ifswcap_list) {
-			nextnode(te_lsa_node);
-			continue;
-		}
-		if (!te_lsa->tepara_ptr->p_link_ifswcap_list) {
-			nextnode(te_lsa_node);
-			continue;
-		}
-		if (!ospf_te_lsa_swcap_lookup(te_lsa->tepara_ptr->p_link_ifswcap_list, SwitchingCapability)) {
-			nextnode(te_lsa_node);
-			continue;
-		}
-		/*no enough bandwidth*/
-		/*
-		if (te_lsa->tepara_ptr->p_unrsv_bw->value[0]==0)  {
-			nextnode(te_lsa_node);
-			continue;
-		}
-		*/
-		if (IS_LSA_MAXAGE (te_lsa)) {
-			nextnode(te_lsa_node);
-			continue;
-		}
-		/* Now we can add this link to graph*/
-		m=get_vertex_index(graphsize, CSPFvertex,te_lsa->tepara_ptr->p_link_id->value);
-		if (m==-1) {
-			nextnode(te_lsa_node);
-			continue;
-		}
-
-       if (te_lsa->tepara_ptr->p_te_metric)
-      	  graph[i][m] = ntohl (te_lsa->tepara_ptr->p_te_metric->value);
-       else
-         graph[i][m] = 1;
-		linkindex=i*graphsize+m;
-		if (!te_lsa->tepara_ptr->p_lclif_ipaddr || 
-				!te_lsa->tepara_ptr->p_rmtif_ipaddr){
-			nextnode(te_lsa_node);
-			continue;
-		}
-		CSPFlinks[linkindex].s_addr=te_lsa->tepara_ptr->p_lclif_ipaddr->value.s_addr;
-		linkindex=m*graphsize+i;
-		CSPFlinks[linkindex].s_addr=te_lsa->tepara_ptr->p_rmtif_ipaddr->value.s_addr;
-		
-		/*add link local id and remote id to TE-link list*/
-				
-		nextnode(te_lsa_node);
-	 }
-  }
-  if (te_link_lsa_list) 
-  	list_free(te_link_lsa_list);
-}
-
-
-void DJhop(u_int32_t node[100][100], u_int8_t node_number, int Source, 
-	int path[100][100], int hop[100], int cost[100])
+/* Dijkstra from source; stops as soon as dest is settled, or computes
+   the whole shortest path tree if dest is NULL, in which case a VLAN tag
+   must have been chosen already. */
+static int
+cspf_dijkstra (struct cspf_graph *graph, struct cspf_vertex *source,
+	       struct cspf_vertex *dest, struct cspf_constraint *cons)
+{
+  struct cspf_heap heap;
+  struct cspf_vertex *v;
+  struct cspf_link *link;
+  listnode node;
+  u_int32_t cost;
+
+  assert (dest != NULL || cons->vtag != CSPF_ANY_VTAG);
+  if (cons->vtag == CSPF_ANY_VTAG &&
+      !cspf_vtag_choose (graph, source, dest, cons))
+    {
+      dest->cost = CSPF_INFINITY;
+      return 0;
+    }
+
+  LIST_LOOP (graph->vertex_list, v, node)
+    {
+      v->cost = CSPF_INFINITY;
+      v->heap_index = -1;
+      v->parent = NULL;
+      v->parent_link = NULL;
+    }
+
+  cspf_heap_init (&heap, listcount (graph->vertex_list));
+  source->cost = 0;
+  cspf_heap_update (&heap, source);
+
+  while ((v = cspf_heap_pop (&heap)) != NULL)
+    {
+      if (v == dest)
+	break;
+      LIST_LOOP (v->links, link, node)
+	{
+	  if (!cspf_link_usable (link, cons))
+	    continue;
+	  cost = v->cost + link->metric;
+	  if (cost < v->cost)	/* overflow */
+	    continue;
+	  if (cost >= link->to->cost)
+	    continue;
+	  link->to->cost = cost;
+	  link->to->parent = v;
+	  link->to->parent_link = link;
+	  cspf_heap_update (&heap, link->to);
+	}
+    }
+
+  cspf_heap_finish (&heap);
+
+  if (dest == NULL)
+    return 1;
+  return (dest->cost != CSPF_INFINITY);
+}
+
+static void
+cspf_path_prepend (list path, void *data)
+{
+  if (path->head == NULL)
+    listnode_add (path, data);
+  else
+    list_add_node_prev (path, path->head, data);
+}
+
+/* Convert the parent links from dest back to source into the explicit
+   path list: local and remote interface address of every hop. */
+static list
+cspf_explicit_path (struct cspf_vertex *source, struct cspf_vertex *dest)
+{
+  list explicit_path;
+  struct cspf_vertex *v;
+  struct in_addr *local_if_ip;
+  struct in_addr *remote_if_ip;
+
+  explicit_path = list_new ();
+  for (v = dest; v != source; v = v->parent)
+    {
+      remote_if_ip = XMALLOC (MTYPE_TMP, sizeof (struct in_addr));
+      remote_if_ip->s_addr = v->parent_link->rmtif.s_addr;
+      cspf_path_prepend (explicit_path, remote_if_ip);
+      local_if_ip = XMALLOC (MTYPE_TMP, sizeof (struct in_addr));
+      local_if_ip->s_addr = v->parent_link->lclif.s_addr;
+      cspf_path_prepend (explicit_path, local_if_ip);
+    }
+  return explicit_path;
+}
+
+/* Same as cspf_explicit_path for a path given by its links. */
+static list
+cspf_path_explicit (struct cspf_path *path)
+{
+  list explicit_path;
+  struct cspf_link *link;
+  struct in_addr *local_if_ip;
+  struct in_addr *remote_if_ip;
+  listnode node;
+
+  explicit_path = list_new ();
+  LIST_LOOP (path->links, link, node)
+    {
+      local_if_ip = XMALLOC (MTYPE_TMP, sizeof (struct in_addr));
+      local_if_ip->s_addr = link->lclif.s_addr;
+      listnode_add (explicit_path, local_if_ip);
+      remote_if_ip = XMALLOC (MTYPE_TMP, sizeof (struct in_addr));
+      remote_if_ip->s_addr = link->rmtif.s_addr;
+      listnode_add (explicit_path, remote_if_ip);
+    }
+  return explicit_path;
+}
+
+static struct cspf_path *
+cspf_path_new ()
+{
+  struct cspf_path *path;
+
+  path = XCALLOC (MTYPE_OSPF_CSPF, sizeof (struct cspf_path));
+  path->links = list_new ();
+  return path;
+}
+
+static void
+cspf_path_free (struct cspf_path *path)
+{
+  list_delete (path->links);
+  XFREE (MTYPE_OSPF_CSPF, path);
+}
+
+static void
+cspf_path_add_link (struct cspf_path *path, struct cspf_link *link)
+{
+  listnode_add (path->links, link);
+  path->cost += link->metric;
+}
+
+/* Build the path from the parent links left by the last search. */
+static struct cspf_path *
+cspf_path_from_tree (struct cspf_vertex *source, struct cspf_vertex *dest)
+{
+  struct cspf_path *path;
+  struct cspf_vertex *v;
+
+  path = cspf_path_new ();
+  for (v = dest; v != source; v = v->parent)
+    {
+      cspf_path_prepend (path->links, v->parent_link);
+      path->cost += v->parent_link->metric;
+    }
+  return path;
+}
+
+static int
+cspf_path_same (struct cspf_path *path1, struct cspf_path *path2)
+{
+  listnode node1, node2;
+
+  if (path1->cost != path2->cost ||
+      listcount (path1->links) != listcount (path2->links))
+    return 0;
+  for (node1 = listhead (path1->links), node2 = listhead (path2->links);
+       node1 && node2; nextnode (node1), nextnode (node2))
+    if (getdata (node1) != getdata (node2))
+      return 0;
+  return 1;
+}
+
+/* Does link share an SRLG with any link in path? */
+static int
+cspf_link_srlg_shared (struct cspf_link *link, struct cspf_path *path)
+{
+  struct te_tlv_header *tlvh;
+  struct cspf_constraint cons;
+  struct cspf_link *plink;
+  u_int32_t srlg[64];
+  u_int32_t *v;
+  listnode node;
+  int i, n;
+
+  if (link->lsa->tepara_ptr == NULL ||
+      (tlvh = link->lsa->tepara_ptr->p_link_srlg) == NULL)
+    return 0;
+
+  n = ntohs (tlvh->length) / sizeof (u_int32_t);
+  if (n > 64)
+    n = 64;
+  v = (u_int32_t *)((char *) tlvh + TLV_HDR_SIZE);
+  for (i = 0; i < n; i++)
+    srlg[i] = ntohl (v[i]);
+  memset (&cons, 0, sizeof (struct cspf_constraint));
+  cons.srlg_exclude = srlg;
+  cons.srlg_num = n;
+
+  LIST_LOOP (path->links, plink, node)
+    if (plink->lsa->tepara_ptr && plink->lsa->tepara_ptr->p_link_srlg &&
+	cspf_link_srlg_excluded (plink->lsa->tepara_ptr->p_link_srlg, &cons))
+      return 1;
+  return 0;
+}
+
+/* Is link the opposite direction of the same TE link as plink? */
+#define CSPF_LINK_REVERSE(link, plink)					\
+  ((link)->from == (plink)->to && (link)->to == (plink)->from &&	\
+   (link)->lclif.s_addr == (plink)->rmtif.s_addr)
+
+/* Exclude the links of path, both directions, and for SRLG-disjoint
+   requests every link sharing an SRLG with it. */
+static void
+cspf_path_exclude (struct cspf_graph *graph, struct cspf_path *path,
+		   int srlg_disjoint)
+{
+  struct cspf_vertex *v;
+  struct cspf_link *link, *plink;
+  listnode node1, node2, node3;
+
+  LIST_LOOP (path->links, plink, node1)
+    {
+      SET_FLAG (plink->flags, CSPF_LINK_EXCLUDED);
+      LIST_LOOP (plink->to->links, link, node2)
+	if (CSPF_LINK_REVERSE (link, plink))
+	  SET_FLAG (link->flags, CSPF_LINK_EXCLUDED);
+    }
+
+  if (srlg_disjoint)
+    LIST_LOOP (graph->vertex_list, v, node1)
+      LIST_LOOP (v->links, link, node3)
+	if (cspf_link_srlg_shared (link, path))
+	  SET_FLAG (link->flags, CSPF_LINK_EXCLUDED);
+}
+
+/* Second Suurballe search, over the residual graph: links of the primary
+   path are replaced by their reverse with cost zero and the other links
+   carry the reduced cost metric + d(from) - d(to), so that Dijkstra
+   remains applicable. */
+static int
+cspf_residual_dijkstra (struct cspf_graph *graph, struct cspf_vertex *source,
+			struct cspf_vertex *dest, struct cspf_constraint *cons)
+{
+  struct cspf_heap heap;
+  struct cspf_vertex *v, *to;
+  struct cspf_link *link;
+  listnode node;
+  u_int32_t cost;
+
+  LIST_LOOP (graph->vertex_list, v, node)
+    {
+      v->cost = CSPF_INFINITY;
+      v->heap_index = -1;
+      v->parent = NULL;
+      v->parent_link = NULL;
+    }
+
+  cspf_heap_init (&heap, listcount (graph->vertex_list));
+  source->cost = 0;
+  cspf_heap_update (&heap, source);
+
+  while ((v = cspf_heap_pop (&heap)) != NULL)
+    {
+      if (v == dest)
+	break;
+
+      /* Reverse of the primary link entering v. */
+      if ((link = v->primary_in) != NULL && link->from != source)
 	{
-		int node_inset[100];
-			// array to record if a node has been selected by the shortest path
-		int graphhop[100][100];
-			// array to ignore the cost of a connection and focus on
-			// if there is connection only
-		
-		int i,j,k,m;
-		int infcost=1000000;
-		int shortcost;
-
-		for (i=0; i<node_number; i++)
-			for (j=0; j<node_number; j++)
-				path[i][j]=-1;
-		
-		path[Source][0]=Source;
-		
-		for (i=0; i<node_number; i++) {
-			for (j=0; j<node_number; j++) {
-        /*
-				graphhop[i][j]=(int) infcost;
-				if (node[i][j]!=infcost)
-					graphhop[i][j]=1;
-    	*/
-    	      graphhop[i][j]=node[i][j];
-			}
-		}
-		
-		for (i=0; i<node_number; i++) {
-			node_inset[i]=0;
-			hop[i]=node_number+1;
-			cost[i]=infcost;
-			if (node[Source][i]!=infcost) {
-				hop[i]=2;
-				cost[i]=graphhop[Source][i];
-			} 
-			if (hop[i]<node_number+1) {
-				path[i][0]=Source;
-				path[i][1]=i;
-			} else {
-				path[i][0]=-1;
-			}
-		}
-		
-		node_inset[Source]=1;
-		
-		for (i=0; i<node_number; i++) {
-			shortcost=infcost;
-			k=-1;
-			for (j=0; j<node_number; j++) {
-				if ((!node_inset[j]) && (cost[j]<shortcost)) {
-					shortcost=cost[j];
-					k=j;
-				}
-			}
-			if (k!=-1) {
-				node_inset[k]=1;
-				for (j=0; j<node_number; j++) {
-					if ((!node_inset[j]) && (node[k][j]!=infcost)) {
-						if (cost[j]>cost[k]+graphhop[k][j]) {
-							cost[j]=cost[k]+graphhop[k][j];
-							for (m=0; m<node_number; m++)
-								path[j][m]=path[k][m];
-							hop[j]=hop[k]+1;
-							path[j][hop[j]-1]=j;
-						}
-							
-					}
-				}
-			}
-		}
+	  to = link->from;
+	  if (v->cost < to->cost)
+	    {
+	      to->cost = v->cost;
+	      to->parent = v;
+	      to->parent_link = link;
+	      cspf_heap_update (&heap, to);
+	    }
+	}
 
+      LIST_LOOP (v->links, link, node)
+	{
+	  if (!cspf_link_usable (link, cons))
+	    continue;
+	  if (link->to->potential == CSPF_INFINITY)
+	    continue;
+	  cost = v->cost + link->metric + v->potential - link->to->potential;
+	  if (cost < v->cost)	/* overflow */
+	    continue;
+	  if (cost < link->to->cost)
+	    {
+	      link->to->cost = cost;
+	      link->to->parent = v;
+	      link->to->parent_link = link;
+	      cspf_heap_update (&heap, link->to);
+	    }
 	}
+    }
+
+  cspf_heap_finish (&heap);
+  return (dest->cost != CSPF_INFINITY);
+}
 
+/* Follow the selected links from source to dest, consuming them. */
+static struct cspf_path *
+cspf_path_walk_selected (struct cspf_vertex *source, struct cspf_vertex *dest)
+{
+  struct cspf_path *path;
+  struct cspf_vertex *v;
+  struct cspf_link *link;
+  listnode node;
 
-/* Calculating the shortest-path tree for an area. */
+  path = cspf_path_new ();
+  for (v = source; v != dest; v = link->to)
+    {
+      LIST_LOOP (v->links, link, node)
+	if (CHECK_FLAG (link->flags, CSPF_LINK_SELECTED))
+	  break;
+      if (node == NULL)
+	{
+	  cspf_path_free (path);
+	  return NULL;
+	}
+      UNSET_FLAG (link->flags, CSPF_LINK_SELECTED);
+      cspf_path_add_link (path, link);
+    }
+  return path;
+}
+
+/* Suurballe's algorithm for the shortest pair of link-disjoint paths. */
+static int
+cspf_suurballe (struct cspf_graph *graph, struct cspf_vertex *source,
+		struct cspf_vertex *dest, struct cspf_constraint *cons,
+		struct cspf_path **primary, struct cspf_path **secondary)
+{
+  struct cspf_path *path1;
+  struct cspf_vertex *v;
+  struct cspf_link *link;
+  listnode node;
+
+  /* Both paths use the same tag, so it is chosen up front. */
+  if (cons->vtag == CSPF_ANY_VTAG &&
+      !cspf_vtag_choose (graph, source, dest, cons))
+    return 0;
+
+  /* Shortest path tree, whose distances become the vertex potentials. */
+  cspf_dijkstra (graph, source, NULL, cons);
+  if (dest->cost == CSPF_INFINITY)
+    return 0;
+  LIST_LOOP (graph->vertex_list, v, node)
+    v->potential = v->cost;
+
+  path1 = cspf_path_from_tree (source, dest);
+  LIST_LOOP (path1->links, link, node)
+    {
+      SET_FLAG (link->flags, CSPF_LINK_PRIMARY | CSPF_LINK_SELECTED);
+      link->to->primary_in = link;
+    }
+  /* The primary links may only be cancelled, never used again, and the
+     same holds for the opposite direction of the same TE links. */
+  cspf_path_exclude (graph, path1, 0);
+  cspf_path_free (path1);
+
+  if (!cspf_residual_dijkstra (graph, source, dest, cons))
+    return 0;
+
+  /* Union of both paths minus the primary links the second one cancels. */
+  for (v = dest; v != source; v = v->parent)
+    {
+      link = v->parent_link;
+      if (CHECK_FLAG (link->flags, CSPF_LINK_PRIMARY) && link->from == v)
+	UNSET_FLAG (link->flags, CSPF_LINK_SELECTED);
+      else
+	SET_FLAG (link->flags, CSPF_LINK_SELECTED);
+    }
+
+  *primary = cspf_path_walk_selected (source, dest);
+  *secondary = cspf_path_walk_selected (source, dest);
+  if (*primary == NULL || *secondary == NULL)
+    {
+      if (*primary)
+	cspf_path_free (*primary);
+      if (*secondary)
+	cspf_path_free (*secondary);
+      return 0;
+    }
+  if ((*secondary)->cost < (*primary)->cost)
+    {
+      path1 = *primary;
+      *primary = *secondary;
+      *secondary = path1;
+    }
+  return 1;
+}
+
+static int
+cspf_path_srlg_disjoint (struct cspf_path *path1, struct cspf_path *path2)
+{
+  struct cspf_link *link;
+  listnode node;
+
+  LIST_LOOP (path1->links, link, node)
+    if (cspf_link_srlg_shared (link, path2))
+      return 0;
+  return 1;
+}
+
+/* Shortest path avoiding the links, and optionally the SRLGs, of path. */
+static struct cspf_path *
+cspf_path_avoiding (struct cspf_graph *graph, struct cspf_vertex *source,
+		    struct cspf_vertex *dest, struct cspf_constraint *cons,
+		    struct cspf_path *path, int srlg_disjoint)
+{
+  cspf_graph_clear_marks (graph);
+  cspf_path_exclude (graph, path, srlg_disjoint);
+  if (!cspf_dijkstra (graph, source, dest, cons))
+    return NULL;
+  return cspf_path_from_tree (source, dest);
+}
+
+/* Look up and check the end points of a path request. */
+static int
+cspf_request_vertices (struct ospf_area *area, struct in_addr source_ip,
+		       struct in_addr dest_ip, struct cspf_vertex **source,
+		       struct cspf_vertex **dest)
+{
+  struct cspf_graph *graph = area->te_graph;
+
+  if (graph == NULL)
+    return 0;
+  *source = cspf_vertex_lookup (graph, source_ip);
+  *dest = cspf_vertex_lookup (graph, dest_ip);
+  if (*source == NULL || *dest == NULL || *source == *dest ||
+      !CSPF_VERTEX_ACTIVE (*source) || !CSPF_VERTEX_ACTIVE (*dest))
+    return 0;
+  return 1;
+}
+
+/* Calculating the constrained shortest path between two TE routers.
+   On success with cons->vtag set to CSPF_ANY_VTAG, cons->vtag is replaced
+   by the lowest VLAN tag free on every link of some path to dest, and the
+   path is the shortest one on which that tag is free. */
 list
-ospf_cspf_calculate (struct ospf_area *area, struct in_addr source_ip, struct in_addr dest_ip, 
-                    u_int8_t SwitchingCapability)
+ospf_cspf_calculate_constrained (struct ospf_area *area, struct in_addr source_ip,
+				 struct in_addr dest_ip, struct cspf_constraint *cons)
 {
-  struct vertex *v;
-  list router_list=NULL;
-  list explicit_path=NULL;
-  struct in_addr *CSPFvertex;
-  struct in_addr *CSPFlinks;
-  u_int32_t graph[100][100];
-  int path[100][100]; /*store the path*/
-  int hop[100]; /*store the number of hops to each destination*/
-  int cost[100]; /*store the cost to each destination*/
-  int source, dest;
-  int i;
-  /* struct in_addr* router_ip; */
-  struct in_addr* local_if_ip;
-  struct in_addr* remote_if_ip;
-  u_int8_t graphsize;
-  int j;
-  int k;
-  int linkindex;
-  
+  struct cspf_graph *graph = area->te_graph;
+  struct cspf_vertex *source, *dest;
+  struct cspf_constraint request;
+  list explicit_path = NULL;
+  int cached;
+
   if (IS_DEBUG_OSPF_EVENT)
+    zlog_info ("ospf_cspf_calculate: Start");
+
+  if (cons->setup_priority > 7 || (cons->vtag >= MAX_VLAN_NUM && cons->vtag != CSPF_ANY_VTAG))
+    goto out;
+
+  if (!cspf_request_vertices (area, source_ip, dest_ip, &source, &dest))
+    goto out;
+
+  explicit_path = cspf_cache_lookup (graph, source_ip, dest_ip, cons, &cached);
+  if (cached)
+    goto out;
+
+  request = *cons;
+  if (cspf_dijkstra (graph, source, dest, cons))
     {
-      zlog_info ("ospf_cspf_calculate: Start");
+      /* explicit path list is to store the E-LSP to dest_ip */
+      explicit_path = cspf_explicit_path (source, dest);
+
+      /* Increment SPF Calculation Counter. */
+      area->spf_calculation++;
+
+      area->ospf->ts_spf = time (NULL);
     }
+  cspf_cache_update (graph, source_ip, dest_ip, &request, cons->vtag, explicit_path);
 
- 
-  /* Initialize the shortest-path tree to only the root (which is the
-     router doing the calculation). */
-  ospf_spf_init (area);
-  v = area->spf;
-
- /*build router list from te_lsdb*/
-  router_list=ospf_build_routers_from_te_lsdb(area->te_lsdb);
-  if (!router_list) return explicit_path;
-  graphsize=router_list->count;
-  
-  /* build router array from router list*/
-  CSPFvertex=build_CSPF_vertex(router_list);
-  /* build link list*/
-  CSPFlinks=init_CSPF_TE_Link_list(router_list);
-
- /*Due to the limitation of array, we cannot process SPF with more than 100 routers*/
-  if (router_list->count>100) return explicit_path;
- /* Only one vertex. Not necessary to build graph */ 
-  if (router_list->count<=1) return explicit_path;
- /* Build the graph with all the links without required swcap pruned.*/ 
- build_CSPF_graph(area, router_list, CSPFvertex, CSPFlinks, graph, SwitchingCapability);
- /*Find the shortest path*/
- /*source=get_vertex_index(graphsize, CSPFvertex, v->id);*/
- source=get_vertex_index(graphsize, CSPFvertex, source_ip);
- if (source==-1) return explicit_path;
- dest=get_vertex_index(graphsize, CSPFvertex, dest_ip);
- if (dest==-1) return explicit_path;  
- DJhop(graph, graphsize, source, path, hop, cost);
-
- if (path[dest][0]==-1) return explicit_path; /*Path not found*/
- 
- /*path found. Add path to explicit path list*/
- /*
- for (i=0; i<hop[dest]; i++)  {
- 	j=path[dest][i];
- 	router_ip=( struct in_addr*) malloc(sizeof(struct in_addr));
- 	router_ip->s_addr=CSPFvertex[j].s_addr;
-	listnode_add(explicit_path, router_ip);
- } 
- 
+out:
+  if (IS_DEBUG_OSPF_EVENT)
+    zlog_info ("ospf_cspf_calculate: Stop");
 
- router_ip=( struct in_addr*) malloc(sizeof(struct in_addr));
- j=path[dest][0];
- router_ip->s_addr=CSPFvertex[j].s_addr;
- listnode_add(explicit_path, router_ip);
-*/
+  return explicit_path;
+}
 
-/* explicit path list is to store the E-LSP to dest_ip */
-explicit_path=list_new();
- 
-for (i=0; i<hop[dest]-1; i++)  {
- 	j=path[dest][i];
-	k=path[dest][i+1];
-	linkindex=j*graphsize+k;
- 	local_if_ip=( struct in_addr*) malloc(sizeof(struct in_addr));
- 	local_if_ip->s_addr=CSPFlinks[linkindex].s_addr;
-	listnode_add(explicit_path, local_if_ip);
-	linkindex=k*graphsize+j;
-	remote_if_ip=( struct in_addr*) malloc(sizeof(struct in_addr));
- 	remote_if_ip->s_addr=CSPFlinks[linkindex].s_addr;
-	listnode_add(explicit_path, remote_if_ip);
- }
-/*
- router_ip=( struct in_addr*) malloc(sizeof(struct in_addr));
- j=path[dest][i+1];
- router_ip->s_addr=CSPFvertex[j].s_addr;
- listnode_add(explicit_path, router_ip);
- */
- if (CSPFvertex) 
- 	free(CSPFvertex);
- if (CSPFlinks) 
- 	free(CSPFlinks);
- 
-  /* Increment SPF Calculation Counter. */
+/* Shortest path constrained by switching capability only. */
+list
+ospf_cspf_calculate (struct ospf_area *area, struct in_addr source_ip, struct in_addr dest_ip, 
+                    u_int8_t SwitchingCapability)
+{
+  struct cspf_constraint cons;
+
+  memset (&cons, 0, sizeof (struct cspf_constraint));
+  cons.switching_cap = SwitchingCapability;
+  return ospf_cspf_calculate_constrained (area, source_ip, dest_ip, &cons);
+}
+
+/* Calculating a pair of link-disjoint, or with srlg_disjoint set
+   SRLG-disjoint, paths of minimal total cost.  SRLG-disjoint pairs are
+   found on a best-effort basis: the Suurballe pair is used if it happens
+   to be SRLG-disjoint, else the shortest path avoiding the SRLGs of the
+   primary.  The VLAN tag constraint is not applied. */
+int
+ospf_cspf_calculate_disjoint (struct ospf_area *area, struct in_addr source_ip,
+			      struct in_addr dest_ip, struct cspf_constraint *constraint,
+			      int srlg_disjoint, list *primary, list *secondary)
+{
+  struct cspf_graph *graph = area->te_graph;
+  struct cspf_vertex *source, *dest;
+  struct cspf_constraint cons = *constraint;
+  struct cspf_path *path1 = NULL, *path2 = NULL;
+  int ret = -1;
+
+  cons.vtag = 0;
+  if (cons.setup_priority > 7)
+    return -1;
+  if (!cspf_request_vertices (area, source_ip, dest_ip, &source, &dest))
+    return -1;
+
+  cspf_graph_clear_marks (graph);
+  if (!cspf_suurballe (graph, source, dest, &cons, &path1, &path2))
+    goto out;
+
+  if (srlg_disjoint && !cspf_path_srlg_disjoint (path1, path2))
+    {
+      cspf_path_free (path2);
+      path2 = cspf_path_avoiding (graph, source, dest, &cons, path1, 1);
+      if (path2 == NULL)
+	goto out;
+    }
+
+  *primary = cspf_path_explicit (path1);
+  *secondary = cspf_path_explicit (path2);
   area->spf_calculation++;
+  area->ospf->ts_spf = time (NULL);
+  ret = 0;
+
+out:
+  if (path1)
+    cspf_path_free (path1);
+  if (path2)
+    cspf_path_free (path2);
+  cspf_graph_clear_marks (graph);
+  return ret;
+}
+
+/* Yen's algorithm: up to k loopless paths in order of increasing cost.
+   Returns a list of explicit path lists, or NULL if there is no path.
+   The VLAN tag constraint is not applied. */
+list
+ospf_cspf_calculate_kshortest (struct ospf_area *area, struct in_addr source_ip,
+			       struct in_addr dest_ip, struct cspf_constraint *constraint,
+			       int k)
+{
+  struct cspf_graph *graph = area->te_graph;
+  struct cspf_vertex *source, *dest, *spur;
+  struct cspf_constraint cons = *constraint;
+  struct cspf_path *path, *prev, *best, *spur_path;
+  struct cspf_link *link;
+  list found, candidates, explicit_paths = NULL;
+  listnode node, node1, node2, pnode;
+  int i, root_len, duplicate;
+
+  cons.vtag = 0;
+  if (k <= 0 || cons.setup_priority > 7)
+    return NULL;
+  if (!cspf_request_vertices (area, source_ip, dest_ip, &source, &dest))
+    return NULL;
 
+  cspf_graph_clear_marks (graph);
+  if (!cspf_dijkstra (graph, source, dest, &cons))
+    return NULL;
+
+  found = list_new ();
+  candidates = list_new ();
+  listnode_add (found, cspf_path_from_tree (source, dest));
+
+  while (listcount (found) < k)
+    {
+      prev = getdata (found->tail);
+
+      /* Every vertex of the previous path but dest is a spur vertex. */
+      root_len = 0;
+      spur = source;
+      for (pnode = listhead (prev->links); pnode; nextnode (pnode), root_len++)
+	{
+	  cspf_graph_clear_marks (graph);
+
+	  /* Links leaving the spur vertex on paths sharing this root. */
+	  LIST_LOOP (found, path, node)
+	    {
+	      for (i = 0, node1 = listhead (path->links), node2 = listhead (prev->links);
+		   i < root_len && node1 && node2 && getdata (node1) == getdata (node2);
+		   i++, nextnode (node1), nextnode (node2))
+		;
+	      if (i == root_len && node1)
+		SET_FLAG (((struct cspf_link *) getdata (node1))->flags, CSPF_LINK_EXCLUDED);
+	    }
+	  /* Root path vertices, to keep the result loopless. */
+	  for (i = 0, node1 = listhead (prev->links); i < root_len; i++, nextnode (node1))
+	    ((struct cspf_link *) getdata (node1))->from->excluded = 1;
+
+	  if (cspf_dijkstra (graph, spur, dest, &cons))
+	    {
+	      spur_path = cspf_path_from_tree (spur, dest);
+	      path = cspf_path_new ();
+	      for (i = 0, node1 = listhead (prev->links); i < root_len; i++, nextnode (node1))
+		cspf_path_add_link (path, getdata (node1));
+	      LIST_LOOP (spur_path->links, link, node1)
+		cspf_path_add_link (path, link);
+	      cspf_path_free (spur_path);
+
+	      duplicate = 0;
+	      LIST_LOOP (candidates, best, node1)
+		if (cspf_path_same (best, path))
+		  duplicate = 1;
+	      LIST_LOOP (found, best, node1)
+		if (cspf_path_same (best, path))
+		  duplicate = 1;
+	      if (duplicate)
+		cspf_path_free (path);
+	      else
+		listnode_add (candidates, path);
+	    }
+
+	  spur = ((struct cspf_link *) getdata (pnode))->to;
+	}
+
+      if (listcount (candidates) == 0)
+	break;
+
+      best = NULL;
+      LIST_LOOP (candidates, path, node)
+	if (best == NULL || path->cost < best->cost)
+	  best = path;
+      listnode_delete (candidates, best);
+      listnode_add (found, best);
+    }
+
+  explicit_paths = list_new ();
+  LIST_LOOP (found, path, node)
+    {
+      listnode_add (explicit_paths, cspf_path_explicit (path));
+      cspf_path_free (path);
+    }
+  LIST_LOOP (candidates, path, node)
+    cspf_path_free (path);
+  list_delete (found);
+  list_delete (candidates);
+  cspf_graph_clear_marks (graph);
+
+  area->spf_calculation++;
   area->ospf->ts_spf = time (NULL);
 
-  if (IS_DEBUG_OSPF_EVENT)
-    zlog_info ("ospf_spf_calculate: Stop");
+  return explicit_paths;
+}
 
-  return explicit_path;
+/* Free an explicit path returned by the calculations above. */
+void
+ospf_cspf_path_free (list explicit_path)
+{
+  struct in_addr *addr;
+  listnode node;
+
+  LIST_LOOP (explicit_path, addr, node)
+    XFREE (MTYPE_TMP, addr);
+  list_delete (explicit_path);
 }
  
 #endif
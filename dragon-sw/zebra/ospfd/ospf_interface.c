@@ -205,6 +205,7 @@ ospf_if_new (struct ospf *ospf, struct interface *ifp, struct prefix *p)
 #ifdef HAVE_OPAQUE_LSA
   ospf_opaque_type9_lsa_init (oi);
   SET_FLAG (oi->nbr_self->options, OSPF_OPTION_O);
+  ospf_rsvp_port_index_invalidate ();
 #endif /* HAVE_OPAQUE_LSA */
 
   oi->ospf = ospf;
@@ -306,6 +307,7 @@ ospf_if_free (struct ospf_interface *oi)
 
 #ifdef HAVE_OPAQUE_LSA
   ospf_opaque_type9_lsa_term (oi);
+  ospf_rsvp_port_index_invalidate ();
 #endif /* HAVE_OPAQUE_LSA */
 
   /* Free Pseudo Neighbour */
@@ -217,6 +217,13 @@ list dragon_gri;
 /* Self-originated TE-LSAs */
 struct ospf_lsa *te_area_lsa_link_self;		/* Type-10 link LSA */
 struct ospf_lsa *te_linklocal_lsa_self;		/* Type-9 LSA  */
+
+/* Damping of the Type-10 link LSA, see ospf_te_lsa.c */
+struct timeval te_lsa_link_originated;	/* Last (re)origination */
+u_int32_t te_lsa_link_damp;		/* Current hold-down in seconds */
+u_int32_t te_lsa_link_orig_count;
+u_int32_t te_lsa_link_suppressed;
+u_int32_t te_lsa_link_deferred;
 };
 
 /* Prototypes. */
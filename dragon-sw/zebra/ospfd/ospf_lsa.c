@@ -312,11 +312,7 @@ ospf_lsa_free (struct ospf_lsa *lsa)
 
 #ifdef HAVE_OPAQUE_LSA
   if (lsa->tepara_ptr)
-  {
-    if (lsa->tepara_ptr->p_link_ifswcap_list)
-    	list_delete (lsa->tepara_ptr->p_link_ifswcap_list);
-    XFREE (MTYPE_OSPF_IF_PARAMS, lsa->tepara_ptr);
-  }
+    ospf_te_lsa_para_free (lsa->tepara_ptr);
 #endif
 	
   assert (lsa->refresh_list < 0);
@@ -34,6 +34,7 @@
 #include "zclient.h"
 #include "filter.h"
 #include "log.h"
+#include "hash.h"
 #include "sockunion.h"
 
 #include "ospfd/ospfd.h"
@@ -79,8 +80,82 @@ enum OspfRsvpMessage {
 	HoldTimeslotsbyOSPF = 137,		/* Hold or release timeslots*/
 	GetCienaOTNXDataByOSPF = 138, /* Get Ciena OTN OPVCX data associated with an OSPF interface */
 	HoldOTNXChennelsByOSPF = 139, /* Hold or release Ciena OTN OPVC timeslots */
+	GetExplicitRoutesByOSPF = 140, /* Get a disjoint pair or the k shortest explicit routes */
+	HoldResourcesbyOSPF = 141, /* Hold or release a batch of resources */
 };
 
+/* Modes of GetExplicitRoutesByOSPF */
+#define OSPF_RSVP_ROUTES_LINK_DISJOINT	1
+#define OSPF_RSVP_ROUTES_SRLG_DISJOINT	2
+#define OSPF_RSVP_ROUTES_K_SHORTEST	3
+
+#define OSPF_RSVP_MAX_SRLG_EXCLUDE	32
+
+/* Every request from RSVPD carries a 32-bit request ID right after the
+   length and command bytes, and the reply to it carries the same ID, so that
+   RSVPD can keep several requests outstanding and match the replies whatever
+   order they come back in. */
+#define OSPF_RSVP_REQUEST_ID_SIZE	sizeof(u_int32_t)
+#define OSPF_RSVP_MAX_REPLY		(255 - OSPF_RSVP_REQUEST_ID_SIZE)
+
+/* A reply that does not fit the length byte is sent with a length byte of
+   zero and its real length(16) after the ID: 0(8) + command(8) + ID(32) +
+   length(16) + data. */
+#define OSPF_RSVP_LONG_REPLY_SIZE	sizeof(u_int16_t)
+#define OSPF_RSVP_MAX_LONG_REPLY	(65535 - OSPF_RSVP_REQUEST_ID_SIZE - OSPF_RSVP_LONG_REPLY_SIZE)
+
+/* ID of the request being answered. */
+static u_int32_t ospf_rsvp_request_id = 0;
+
+/* Path computations are not answered in line: they are queued while the
+   other requests already waiting on the socket are answered, and run from
+   an event afterwards, one per event with the requests that arrived during
+   it answered in between. */
+struct ospf_rsvp_request
+{
+  int sock;
+  u_int32_t id;
+  u_char command;
+  struct stream *s;
+};
+
+static list ospf_rsvp_cspf_queue = NULL;
+static struct thread *ospf_rsvp_cspf_thread = NULL;
+
+/* Send a reply built as length(8) + command(8) + data, with the ID of the
+   request being answered inserted after the command.  The length byte of
+   the reply built is ignored, 'length' is its real length. */
+static void
+ospf_rsvp_write (int fd, u_char *buf, int length)
+{
+  struct stream *s;
+
+  if (length > OSPF_RSVP_MAX_LONG_REPLY)
+    {
+      zlog_warn ("ospf_rsvp_write: reply to request %u too long (%d)",
+                 ospf_rsvp_request_id, length);
+      return;
+    }
+  if (length + OSPF_RSVP_REQUEST_ID_SIZE > 255)
+    {
+      s = stream_new (length + OSPF_RSVP_REQUEST_ID_SIZE + OSPF_RSVP_LONG_REPLY_SIZE);
+      stream_putc (s, 0);
+      stream_putc (s, buf[1]);
+      stream_putl (s, ospf_rsvp_request_id);
+      stream_putw (s, length + OSPF_RSVP_REQUEST_ID_SIZE + OSPF_RSVP_LONG_REPLY_SIZE);
+    }
+  else
+    {
+      s = stream_new (length + OSPF_RSVP_REQUEST_ID_SIZE);
+      stream_putc (s, length + OSPF_RSVP_REQUEST_ID_SIZE);
+      stream_putc (s, buf[1]);
+      stream_putl (s, ospf_rsvp_request_id);
+    }
+  stream_put (s, buf + 2, length - 2);
+  write (fd, STREAM_DATA (s), stream_get_endp (s));
+  stream_free (s);
+}
+
 static u_int32_t get_slash30_peer_address(u_int32_t addr)
 {
 	u_int32_t peer_addr = addr & 0xfcffffff;
@@ -125,7 +200,7 @@ ospf_find_interface_by_data(struct in_addr *addr, u_int32_t if_id, int fd)
 					stream_putc(s, FindInterfaceByData);
 					stream_put_ipv4(s, oi->address->u.prefix4.s_addr);
 					/* Send message.  */
-					write (fd, STREAM_DATA(s), length);
+					ospf_rsvp_write (fd, STREAM_DATA(s), length);
 					goto out;
 					
 				}
@@ -148,7 +223,7 @@ ospf_find_interface_by_data(struct in_addr *addr, u_int32_t if_id, int fd)
 					stream_putc(s, FindInterfaceByData);
 					stream_put_ipv4(s, oi->address->u.prefix4.s_addr);
 					/* Send message.  */
-					write (fd, STREAM_DATA(s), length);
+					ospf_rsvp_write (fd, STREAM_DATA(s), length);
 					goto out;
 					
 				}
@@ -160,7 +235,7 @@ ospf_find_interface_by_data(struct in_addr *addr, u_int32_t if_id, int fd)
 	stream_putc(s, length);
 	stream_putc(s, FindInterfaceByData);
 	/* Send message.  */
-	write (fd, STREAM_DATA(s), length);
+	ospf_rsvp_write (fd, STREAM_DATA(s), length);
 	
 out:
 	stream_free(s);
@@ -221,7 +296,7 @@ out:
 		stream_putc(s, FindDataByInterface);
 	}
 	/* Send message.  */
-	write (fd, STREAM_DATA(s), length);
+	ospf_rsvp_write (fd, STREAM_DATA(s), length);
 	stream_free(s);
 	return;
 }
@@ -252,7 +327,7 @@ ospf_find_out_lif(struct in_addr *addr,  u_int32_t if_id, int fd)
 				stream_putc(s, FindOutLifByOSPF);
 				stream_put_ipv4(s, oi->address->u.prefix4.s_addr);
 				/* Send message.  */
-				write (fd, STREAM_DATA(s), length);
+				ospf_rsvp_write (fd, STREAM_DATA(s), length);
 				goto out;
 			}
 			else if ( (if_id && INTERFACE_GMPLS_ENABLED(oi) &&
@@ -269,7 +344,7 @@ ospf_find_out_lif(struct in_addr *addr,  u_int32_t if_id, int fd)
 					stream_putc(s, FindOutLifByOSPF);
 					stream_put_ipv4(s, oi->address->u.prefix4.s_addr);
 					/* Send message.  */
-					write (fd, STREAM_DATA(s), length);
+					ospf_rsvp_write (fd, STREAM_DATA(s), length);
 					goto out;
 					
 				}
@@ -281,25 +356,25 @@ ospf_find_out_lif(struct in_addr *addr,  u_int32_t if_id, int fd)
 	stream_putc(s, length);
 	stream_putc(s, FindOutLifByOSPF);
 	/* Send message.  */
-	write (fd, STREAM_DATA(s), length);
+	ospf_rsvp_write (fd, STREAM_DATA(s), length);
 
 out:
 	stream_free(s);
 	return;
 }
 
-/* Calculate an explicit route to the specified destination */
-void
-ospf_get_explicit_route(struct stream * sin, int fd)
+/* Parse the T-Spec and optional constraints of a path request and resolve
+   its end points to TE router IDs.  Returns the area to compute in, or NULL
+   if the request cannot be served. */
+static struct ospf_area *
+ospf_rsvp_route_request(struct stream * sin, struct in_addr *src, struct in_addr *dest,
+			struct cspf_constraint *constraint, u_int32_t *srlg_exclude)
 {
 	struct ospf_interface *oi;
 	struct listnode *node1, *node2;
 	struct ospf *ospf;
 	struct ospf_area *area;
-	struct stream *s = NULL;
-	u_int8_t length;
 	u_int8_t service;
-	struct in_addr src, dest;
 	u_int8_t switching, encoding;
 	u_int16_t gpid;
 	float bandwidth;
@@ -310,21 +385,24 @@ ospf_get_explicit_route(struct stream * sin, int fd)
 	u_int16_t sonet_mt;			/* Multiplier */
 	u_int32_t sonet_t;				/* Transparency */
 	u_int32_t sonet_p;			/*  Profile */
-	list explicit_path = NULL;
-	listnode node;
 	struct route_node *rn;
 	struct ospf_lsa *lsa;
 	struct in_addr area_id;
 	int find;
+	u_int32_t bw_uint32;
+	int i;
 	
 	service = stream_getc(sin);
-	src.s_addr = stream_get_ipv4(sin);
-	dest.s_addr = stream_get_ipv4(sin);
+	src->s_addr = stream_get_ipv4(sin);
+	dest->s_addr = stream_get_ipv4(sin);
 	encoding = stream_getc(sin);
 	switching = stream_getc(sin);
 	gpid = stream_getw(sin);
 	if (service==2) /* GMPLS Generic T-Spec */
-		bandwidth = (float)stream_getl(sin);
+	{
+		bw_uint32 = stream_getl(sin); /* IEEE float in network byte order */
+		bandwidth = *(float*)&bw_uint32;
+	}
 	else /* Sonet T-Spec */
 	{
 		bandwidth = 1000; /* temporary hack */
@@ -337,10 +415,33 @@ ospf_get_explicit_route(struct stream * sin, int fd)
 		sonet_p = stream_getl(sin);
 	}
 
+	memset(constraint, 0, sizeof(struct cspf_constraint));
+	constraint->switching_cap = switching;
+	constraint->setup_priority = 7;
+	if (service==2)
+		constraint->bandwidth = bandwidth;
+	/* Optional constraints: setup priority, include-any, include-all, exclude-any,
+	   VLAN tag and a list of SRLGs to avoid. */
+	if (stream_get_endp(sin) - stream_get_getp(sin) >= 18)
+	{
+		constraint->setup_priority = stream_getc(sin);
+		constraint->include_any = stream_getl(sin);
+		constraint->include_all = stream_getl(sin);
+		constraint->exclude_any = stream_getl(sin);
+		constraint->vtag = stream_getl(sin);
+		constraint->srlg_num = stream_getc(sin);
+		if (constraint->srlg_num > OSPF_RSVP_MAX_SRLG_EXCLUDE)
+			constraint->srlg_num = OSPF_RSVP_MAX_SRLG_EXCLUDE;
+		for (i = 0; i < constraint->srlg_num && stream_get_endp(sin) - stream_get_getp(sin) >= 4; i++)
+			srlg_exclude[i] = stream_getl(sin);
+		constraint->srlg_num = i;
+		constraint->srlg_exclude = srlg_exclude;
+	}
+
 	/* find area id */
 	area = NULL;
 	if (om->ospf){
-		if (src.s_addr==0 || ntohl(src.s_addr)==INADDR_LOOPBACK)
+		if (src->s_addr==0 || ntohl(src->s_addr)==INADDR_LOOPBACK)
 		{
 			area_id.s_addr = OSPF_AREA_BACKBONE;
 			area = ospf_area_lookup_by_area_id(getdata(listhead(om->ospf)), area_id);
@@ -350,7 +451,7 @@ ospf_get_explicit_route(struct stream * sin, int fd)
 			{
 				if (ospf->oiflist)
 				LIST_LOOP(ospf->oiflist, oi, node2){
-					if (ntohl(oi->address->u.prefix4.s_addr) == ntohl(src.s_addr))
+					if (ntohl(oi->address->u.prefix4.s_addr) == ntohl(src->s_addr))
 					{
 						area = oi->area;
 						break;
@@ -362,7 +463,7 @@ ospf_get_explicit_route(struct stream * sin, int fd)
 	if (area)
 	  {
 	  	/* set src to its lookback address */
-		src.s_addr = OspfTeRouterAddr.value.s_addr;
+		src->s_addr = OspfTeRouterAddr.value.s_addr;
 
 		find = 0;
 		/* find dest's lookback address */
@@ -371,7 +472,7 @@ ospf_get_explicit_route(struct stream * sin, int fd)
 		  /* If dest is the *router ID * of the remote node */
 		  if (lsa->tepara_ptr && lsa->tepara_ptr->p_router_addr && 
 			   ntohs(lsa->tepara_ptr->p_router_addr->header.type)!=0 &&
-			   ntohl(lsa->tepara_ptr->p_router_addr->value.s_addr) == ntohl(dest.s_addr))
+			   ntohl(lsa->tepara_ptr->p_router_addr->value.s_addr) == ntohl(dest->s_addr))
 		   {
 		   	   find = 1;
 			   break;
@@ -383,20 +484,49 @@ ospf_get_explicit_route(struct stream * sin, int fd)
 			{
 				if (lsa->tepara_ptr && lsa->tepara_ptr->p_lclif_ipaddr && 
 				     ntohs(lsa->tepara_ptr->p_lclif_ipaddr->header.type)!=0 &&
-				     ntohl(lsa->tepara_ptr->p_lclif_ipaddr->value.s_addr) == ntohl(dest.s_addr))
+				     ntohl(lsa->tepara_ptr->p_lclif_ipaddr->value.s_addr) == ntohl(dest->s_addr))
 				{
 					find  = 1;
-					dest.s_addr = lsa->data->adv_router.s_addr;
+					dest->s_addr = lsa->data->adv_router.s_addr;
 					break;
 				}
 			}
 		}
-		/*cspf routing calculation on demand*/
-		if (find)
-			explicit_path=ospf_cspf_calculate (area, src, dest, switching);
+		if (!find)
+			area = NULL;
 	  }
+	return area;
+}
+
+/* Calculate an explicit route to the specified destination */
+void
+ospf_get_explicit_route(struct stream * sin, int fd)
+{
+	struct ospf_area *area;
+	struct stream *s = NULL;
+	u_int8_t length;
+	struct in_addr src, dest;
+	list explicit_path = NULL;
+	listnode node;
+	struct cspf_constraint constraint;
+	u_int32_t srlg_exclude[OSPF_RSVP_MAX_SRLG_EXCLUDE];
+
+	area = ospf_rsvp_route_request(sin, &src, &dest, &constraint, srlg_exclude);
+	/*cspf routing calculation on demand*/
+	if (area)
+		explicit_path=ospf_cspf_calculate_constrained (area, src, dest, &constraint);
 	if (explicit_path){
 		listnode_delete(explicit_path, listnode_head(explicit_path)); /* we don't need  the first hop which is itself */
+		if (sizeof(u_int8_t)*2 + sizeof(struct in_addr)*listcount(explicit_path) > OSPF_RSVP_MAX_REPLY)
+		{
+			zlog_warn("ospf_get_explicit_route: route of %d hops does not fit in a reply", listcount(explicit_path));
+			for (node = explicit_path->head; node; nextnode (node))
+				XFREE(MTYPE_TMP, node->data);
+			list_delete(explicit_path);
+			explicit_path = NULL;
+		}
+	}
+	if (explicit_path){
 		length = sizeof(u_int8_t)*2 + sizeof(struct in_addr)*listcount(explicit_path);
 		s = stream_new(length);
 		stream_putc(s, length);
@@ -407,7 +537,7 @@ ospf_get_explicit_route(struct stream * sin, int fd)
 			 XFREE(MTYPE_TMP, node->data);
 		   }
 		/* Send message.  */
-		write (fd, STREAM_DATA(s), length);
+		ospf_rsvp_write (fd, STREAM_DATA(s), length);
 		list_delete(explicit_path);
 		goto out;
 	}
@@ -419,7 +549,7 @@ ospf_get_explicit_route(struct stream * sin, int fd)
 	stream_putc(s, length);
 	stream_putc(s, GetExplicitRouteByOSPF);
 	/* Send message.  */
-	write (fd, STREAM_DATA(s), length);
+	ospf_rsvp_write (fd, STREAM_DATA(s), length);
 
 out:
 	if (s)
@@ -427,94 +557,355 @@ out:
 	return;
 }
 
+/* Calculate several explicit routes to the specified destination: a pair of
+   link- or SRLG-disjoint routes for 1+1 protection, or the k shortest routes.
+   The request is mode(8) + k(8) followed by a GetExplicitRouteByOSPF request.
+   Each route in the reply is its hop count(8) followed by the hops, without
+   the first hop which is itself.  Replies longer than the length byte allows
+   are sent as long replies; routes that do not fit even in those are
+   dropped (both for a disjoint pair). */
 void
-ospf_hold_vtag(u_int32_t port, u_int32_t vtag, u_int8_t hold_flag)
+ospf_get_explicit_routes(struct stream * sin, int fd)
 {
-	struct ospf_interface *oi;
-	struct listnode *node1, *node2, *node3;
-	struct ospf *ospf;
-	struct te_link_subtlv_link_ifswcap *ifswcap0, *ifswcap=NULL;
-	int updated = 0, found_iscd_x = 0;
-	int i;
-	
-	if (om->ospf)
-	LIST_LOOP(om->ospf, ospf, node1)
+	struct ospf_area *area;
+	struct stream *s = NULL;
+	int length;
+	u_int8_t mode, k;
+	struct in_addr src, dest;
+	list explicit_paths = NULL;
+	list primary, secondary;
+	list explicit_path;
+	listnode node1, node2;
+	struct cspf_constraint constraint;
+	u_int32_t srlg_exclude[OSPF_RSVP_MAX_SRLG_EXCLUDE];
+	int size, n;
+
+	mode = stream_getc(sin);
+	k = stream_getc(sin);
+	area = ospf_rsvp_route_request(sin, &src, &dest, &constraint, srlg_exclude);
+	if (area)
 	{
-		if (ospf->oiflist)
-		LIST_LOOP(ospf->oiflist, oi, node2){
-			if (!oi || !INTERFACE_MPLS_ENABLED(oi) || oi->te_para.link_ifswcap_list == NULL)
-				continue;
-			if (oi->vlsr_if.switch_port == port) {
-				LIST_LOOP(oi->te_para.link_ifswcap_list, ifswcap0, node3)
-				{
-					if (ifswcap0->link_ifswcap_data.switching_cap == LINK_IFSWCAP_SUBTLV_SWCAP_L2SC 
-						&& (ntohs(ifswcap0->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.version) & IFSWCAP_SPECIFIC_VLAN_BASIC) != 0) {
-						ifswcap = ifswcap0;
-						break;
-					}						
-				}
-				if (ifswcap != NULL)
-					break;
-			}
-			else if ( (port>>16) == 0x10 || (port>>16) == 0x11 || (port>>16) == 0x12) {
-				LIST_LOOP(oi->te_para.link_ifswcap_list, ifswcap0, node3)
-				{
-					if (ifswcap0->link_ifswcap_data.switching_cap == LINK_IFSWCAP_SUBTLV_SWCAP_L2SC 
-						&& (ntohs(ifswcap0->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.version) & IFSWCAP_SPECIFIC_VLAN_BASIC) != 0) {
-						ifswcap = ifswcap0;
-					}						
-					if ( (ifswcap0->link_ifswcap_data.switching_cap == LINK_IFSWCAP_SUBTLV_SWCAP_TDM 
-							&& (ntohs(ifswcap0->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni.version) & IFSWCAP_SPECIFIC_SUBNET_UNI) != 0)
-						|| (ifswcap0->link_ifswcap_data.switching_cap == LINK_IFSWCAP_SUBTLV_SWCAP_TDM 
-							&& ifswcap0->link_ifswcap_data.encoding == LINK_IFSWCAP_SUBTLV_ENC_G709OTUK
-							&& (ntohs(ifswcap0->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx.version) & IFSWCAP_SPECIFIC_CIENA_OTNX) != 0) ) {
-						found_iscd_x = 1;
-					}						
-				}
-				if (found_iscd_x == 1 && ifswcap != NULL)
-					break;
-				else {
-					ifswcap = NULL;
-					found_iscd_x = 0;
-				}
-			}
-		}
-		if (ifswcap != NULL) {
-			updated = 0;
-			if (found_iscd_x == 1 && (vtag == 0 || vtag == 0xffff) ) //oxffff == ANY_VTAG
-			{
-				if (hold_flag == 1) /*holding all allocable vtags for the subnetUNI interface*/
-				{
-					for (i = 0; i < MAX_VLAN_NUM/8; i++)
-						ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask_alloc[i] |=ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask[i];
-					memset(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask, 0, MAX_VLAN_NUM/8);
-				}
-				else /*release all available vtags for the subnetUNI interface*/
-				{
-					for (i = 0; i < MAX_VLAN_NUM/8; i++)
-						ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask[i] |=ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask_alloc[i];
-					memset(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask_alloc, 0, MAX_VLAN_NUM/8);
-				}
-			}
-			else if (hold_flag == 1 && HAS_VLAN(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask, vtag))
+		switch (mode)
+		{
+		case OSPF_RSVP_ROUTES_LINK_DISJOINT:
+		case OSPF_RSVP_ROUTES_SRLG_DISJOINT:
+			if (ospf_cspf_calculate_disjoint (area, src, dest, &constraint,
+			    mode == OSPF_RSVP_ROUTES_SRLG_DISJOINT, &primary, &secondary) == 0)
 			{
-				RESET_VLAN(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask, vtag);
-				SET_VLAN(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask_alloc, vtag);
-				updated = 1;
+				explicit_paths = list_new();
+				listnode_add(explicit_paths, primary);
+				listnode_add(explicit_paths, secondary);
 			}
-			else if (hold_flag == 0 && !HAS_VLAN(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask, vtag))
+			break;
+		case OSPF_RSVP_ROUTES_K_SHORTEST:
+			explicit_paths = ospf_cspf_calculate_kshortest (area, src, dest, &constraint, k);
+			break;
+		default:
+			zlog_warn("ospf_get_explicit_routes: unknown mode %d", mode);
+			break;
+		}
+	}
+
+	/* Size the reply, dropping the routes that do not fit. */
+	size = sizeof(u_int8_t)*2;
+	n = 0;
+	if (explicit_paths)
+		LIST_LOOP(explicit_paths, explicit_path, node1)
+		{
+			if (size + sizeof(u_int8_t) + sizeof(struct in_addr)*(listcount(explicit_path)-1) > OSPF_RSVP_MAX_LONG_REPLY)
 			{
-				SET_VLAN(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask, vtag);
-				RESET_VLAN(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask_alloc, vtag);
-				updated = 1;
+				zlog_warn("ospf_get_explicit_routes: dropping %d routes that do not fit in the reply",
+					  listcount(explicit_paths) - n);
+				break;
 			}
-			if (updated && oi->t_te_area_lsa_link_self)
+			size += sizeof(u_int8_t) + sizeof(struct in_addr)*(listcount(explicit_path)-1);
+			n++;
+		}
+	if (mode != OSPF_RSVP_ROUTES_K_SHORTEST && n < 2)
+	{
+		size = sizeof(u_int8_t)*2;
+		n = 0;
+	}
+
+	length = size;
+	s = stream_new(length);
+	stream_putc(s, length);
+	stream_putc(s, GetExplicitRoutesByOSPF);
+	if (explicit_paths)
+	{
+		LIST_LOOP(explicit_paths, explicit_path, node1)
+		{
+			if (n-- > 0)
 			{
-				OSPF_TIMER_OFF (oi->t_te_area_lsa_link_self);
-				OSPF_INTERFACE_TIMER_ON (oi->t_te_area_lsa_link_self, ospf_te_area_lsa_link_timer, OSPF_MIN_LS_INTERVAL);
+				stream_putc(s, listcount(explicit_path)-1);
+				for (node2 = explicit_path->head->next; node2; nextnode (node2))
+					stream_put_ipv4(s, *(u_int32_t*) (node2->data));
 			}
+			ospf_cspf_path_free(explicit_path);
+		}
+		list_delete(explicit_paths);
+	}
+	/* Send message.  */
+	ospf_rsvp_write (fd, STREAM_DATA(s), length);
+	stream_free(s);
+}
+
+/* Local TE links indexed by the port RSVPD refers to them with, so that a
+   hold or release does not walk every interface of every OSPF instance.
+   The index is dropped whenever an interface or its TE configuration changes
+   and is rebuilt on the next lookup. */
+#define OSPF_RSVP_PORT_SWITCH		0	/* vlsr_if.switch_port */
+#define OSPF_RSVP_PORT_SUBNET_UNI	1	/* ID of a Subnet-UNI ISCD */
+#define OSPF_RSVP_PORT_OTNX		2	/* ID of a Ciena OTNX ISCD */
+
+struct ospf_rsvp_port
+{
+  u_char kind;
+  u_int32_t id;
+  list oi_list;
+};
+
+static struct hash *ospf_rsvp_port_index = NULL;
+static int ospf_rsvp_port_index_valid = 0;
+
+/* First interface with both a VLAN ISCD and a Subnet-UNI or OTNX ISCD; the
+   VLAN tags of tagged Subnet-UNI and OTNX ports are held on it. */
+static struct ospf_interface *ospf_rsvp_port_vlan_x_oi = NULL;
+
+/* Interfaces changed by the batch being applied, NULL outside a batch. */
+static list ospf_rsvp_changed_links = NULL;
+
+static struct te_link_subtlv_link_ifswcap *
+ospf_rsvp_iscd_vlan (struct ospf_interface *oi)
+{
+  struct listnode *node;
+  struct te_link_subtlv_link_ifswcap *ifswcap;
+
+  LIST_LOOP (oi->te_para.link_ifswcap_list, ifswcap, node)
+    if (ifswcap->link_ifswcap_data.switching_cap == LINK_IFSWCAP_SUBTLV_SWCAP_L2SC
+	&& (ntohs(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.version) & IFSWCAP_SPECIFIC_VLAN_BASIC) != 0)
+      return ifswcap;
+  return NULL;
+}
+
+static struct te_link_subtlv_link_ifswcap *
+ospf_rsvp_iscd_subnet_uni (struct ospf_interface *oi)
+{
+  struct listnode *node;
+  struct te_link_subtlv_link_ifswcap *ifswcap;
+
+  LIST_LOOP (oi->te_para.link_ifswcap_list, ifswcap, node)
+    if (ifswcap->link_ifswcap_data.switching_cap == LINK_IFSWCAP_SUBTLV_SWCAP_TDM
+	&& (ntohs(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni.version) & IFSWCAP_SPECIFIC_SUBNET_UNI) != 0)
+      return ifswcap;
+  return NULL;
+}
+
+static struct te_link_subtlv_link_ifswcap *
+ospf_rsvp_iscd_otnx (struct ospf_interface *oi)
+{
+  struct listnode *node;
+  struct te_link_subtlv_link_ifswcap *ifswcap;
+
+  LIST_LOOP (oi->te_para.link_ifswcap_list, ifswcap, node)
+    if (ifswcap->link_ifswcap_data.switching_cap == LINK_IFSWCAP_SUBTLV_SWCAP_TDM
+	&& ifswcap->link_ifswcap_data.encoding == LINK_IFSWCAP_SUBTLV_ENC_G709OTUK
+	&& (ntohs(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx.version) & IFSWCAP_SPECIFIC_CIENA_OTNX) != 0)
+      return ifswcap;
+  return NULL;
+}
+
+static unsigned int
+ospf_rsvp_port_hash_key (struct ospf_rsvp_port *port)
+{
+  return (port->kind << 24) ^ port->id;
+}
+
+static int
+ospf_rsvp_port_hash_cmp (struct ospf_rsvp_port *port1,
+			 struct ospf_rsvp_port *port2)
+{
+  return port1->kind == port2->kind && port1->id == port2->id;
+}
+
+static void *
+ospf_rsvp_port_alloc (struct ospf_rsvp_port *key)
+{
+  struct ospf_rsvp_port *port;
+
+  port = XCALLOC (MTYPE_TMP, sizeof (struct ospf_rsvp_port));
+  port->kind = key->kind;
+  port->id = key->id;
+  port->oi_list = list_new ();
+  return port;
+}
+
+static void
+ospf_rsvp_port_free (struct ospf_rsvp_port *port)
+{
+  list_delete (port->oi_list);
+  XFREE (MTYPE_TMP, port);
+}
+
+static void
+ospf_rsvp_port_index_add (u_char kind, u_int32_t id, struct ospf_interface *oi)
+{
+  struct ospf_rsvp_port key;
+  struct ospf_rsvp_port *port;
+
+  key.kind = kind;
+  key.id = id;
+  port = hash_get (ospf_rsvp_port_index, &key, ospf_rsvp_port_alloc);
+  listnode_add (port->oi_list, oi);
+}
+
+static void
+ospf_rsvp_port_index_build ()
+{
+  struct ospf *ospf;
+  struct ospf_interface *oi;
+  struct listnode *node1, *node2;
+  struct te_link_subtlv_link_ifswcap *subnet_uni, *otnx;
+
+  if (ospf_rsvp_port_index == NULL)
+    ospf_rsvp_port_index = hash_create (ospf_rsvp_port_hash_key,
+					ospf_rsvp_port_hash_cmp);
+  else
+    hash_clean (ospf_rsvp_port_index, (void (*) (void *)) ospf_rsvp_port_free);
+  ospf_rsvp_port_vlan_x_oi = NULL;
+
+  if (om->ospf)
+  LIST_LOOP (om->ospf, ospf, node1)
+    {
+      if (ospf->oiflist)
+      LIST_LOOP (ospf->oiflist, oi, node2)
+	{
+	  if (!INTERFACE_MPLS_ENABLED(oi) || oi->te_para.link_ifswcap_list == NULL)
+	    continue;
+	  ospf_rsvp_port_index_add (OSPF_RSVP_PORT_SWITCH, oi->vlsr_if.switch_port, oi);
+	  subnet_uni = ospf_rsvp_iscd_subnet_uni (oi);
+	  if (subnet_uni)
+	    ospf_rsvp_port_index_add (OSPF_RSVP_PORT_SUBNET_UNI,
+		subnet_uni->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni.subnet_uni_id, oi);
+	  otnx = ospf_rsvp_iscd_otnx (oi);
+	  if (otnx)
+	    ospf_rsvp_port_index_add (OSPF_RSVP_PORT_OTNX,
+		otnx->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx.otnx_if_id, oi);
+	  if (ospf_rsvp_port_vlan_x_oi == NULL && (subnet_uni || otnx)
+	      && ospf_rsvp_iscd_vlan (oi))
+	    ospf_rsvp_port_vlan_x_oi = oi;
+	}
+    }
+  ospf_rsvp_port_index_valid = 1;
+}
+
+/* Called whenever an interface comes or goes or its TE parameters are
+   (re)configured. */
+void
+ospf_rsvp_port_index_invalidate ()
+{
+  ospf_rsvp_port_index_valid = 0;
+  ospf_rsvp_port_vlan_x_oi = NULL;
+}
+
+static list
+ospf_rsvp_port_lookup (u_char kind, u_int32_t id)
+{
+  struct ospf_rsvp_port key;
+  struct ospf_rsvp_port *port;
+
+  if (!ospf_rsvp_port_index_valid)
+    ospf_rsvp_port_index_build ();
+  key.kind = kind;
+  key.id = id;
+  port = hash_lookup (ospf_rsvp_port_index, &key);
+  return port ? port->oi_list : NULL;
+}
+
+/* Bring forward the refresh of the TE link LSA of an interface whose
+   resources changed.  A refresh already due within OSPF_MIN_LS_INTERVAL is
+   left alone, so that a burst of changes ends in one refresh instead of
+   pushing it back on every change. */
+static void
+ospf_rsvp_refresh_link (struct ospf_interface *oi)
+{
+  if (oi->t_te_area_lsa_link_self == NULL)
+    {
+      /* Not originated yet: leave it to ospf_te_new_if(). */
+      if (oi->te_area_lsa_link_self == NULL)
+	return;
+    }
+  else if (thread_timer_remain_second (oi->t_te_area_lsa_link_self) <= OSPF_MIN_LS_INTERVAL)
+    return;
+
+  OSPF_TIMER_OFF (oi->t_te_area_lsa_link_self);
+  OSPF_INTERFACE_TIMER_ON (oi->t_te_area_lsa_link_self, ospf_te_area_lsa_link_timer, OSPF_MIN_LS_INTERVAL);
+}
+
+/* Within a batch the refresh is deferred until the whole batch is applied. */
+static void
+ospf_rsvp_link_changed (struct ospf_interface *oi)
+{
+  if (ospf_rsvp_changed_links == NULL)
+    ospf_rsvp_refresh_link (oi);
+  else if (listnode_lookup (ospf_rsvp_changed_links, oi) == NULL)
+    listnode_add (ospf_rsvp_changed_links, oi);
+}
+
+void
+ospf_hold_vtag(u_int32_t port, u_int32_t vtag, u_int8_t hold_flag)
+{
+	struct ospf_interface *oi = NULL;
+	struct listnode *node;
+	struct te_link_subtlv_link_ifswcap *ifswcap = NULL;
+	list oi_list;
+	int updated = 0, found_iscd_x = 0;
+	int i;
+	
+	oi_list = ospf_rsvp_port_lookup(OSPF_RSVP_PORT_SWITCH, port);
+	if (oi_list)
+	LIST_LOOP(oi_list, oi, node)
+	{
+		if ((ifswcap = ospf_rsvp_iscd_vlan(oi)) != NULL)
+			break;
+	}
+	if (ifswcap == NULL && ((port>>16) == 0x10 || (port>>16) == 0x11 || (port>>16) == 0x12)
+		&& (oi = ospf_rsvp_port_vlan_x_oi) != NULL) {
+		ifswcap = ospf_rsvp_iscd_vlan(oi);
+		found_iscd_x = 1;
+	}
+	if (ifswcap == NULL)
+		return;
+
+	if (found_iscd_x == 1 && (vtag == 0 || vtag == 0xffff) ) //oxffff == ANY_VTAG
+	{
+		if (hold_flag == 1) /*holding all allocable vtags for the subnetUNI interface*/
+		{
+			for (i = 0; i < MAX_VLAN_NUM/8; i++)
+				ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask_alloc[i] |=ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask[i];
+			memset(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask, 0, MAX_VLAN_NUM/8);
 		}
+		else /*release all available vtags for the subnetUNI interface*/
+		{
+			for (i = 0; i < MAX_VLAN_NUM/8; i++)
+				ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask[i] |=ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask_alloc[i];
+			memset(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask_alloc, 0, MAX_VLAN_NUM/8);
+		}
+	}
+	else if (hold_flag == 1 && HAS_VLAN(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask, vtag))
+	{
+		RESET_VLAN(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask, vtag);
+		SET_VLAN(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask_alloc, vtag);
+		updated = 1;
+	}
+	else if (hold_flag == 0 && !HAS_VLAN(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask, vtag))
+	{
+		SET_VLAN(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask, vtag);
+		RESET_VLAN(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask_alloc, vtag);
+		updated = 1;
 	}
+	if (updated)
+		ospf_rsvp_link_changed(oi);
 }
 
 static int hold_bandwidth(struct ospf_interface *oi, float bandwidth, u_int32_t ucid, u_int32_t seqnum)
@@ -573,107 +964,86 @@ void
 ospf_hold_bandwidth(u_int32_t port, float bw, u_int8_t hold_flag, u_int32_t ucid, u_int32_t seqnum)
 {
 	struct ospf_interface *oi;
-	struct listnode *node1, *node2, *node3;
-	struct ospf *ospf;
-	struct te_link_subtlv_link_ifswcap *ifswcap;
-	int updated = 0;
+	struct listnode *node;
+	list oi_list;
+	u_char kind;
+	int pass, updated = 0;
 
 	if (bw == 0)
 		return;
 
 	bw = (bw *1000000) / 8;
 
-	if (om->ospf)
-	LIST_LOOP(om->ospf, ospf, node1)
+	/* the port is either the switch port of the interface or the ID of its subnet_uni or ciena_opvcx ISCD */
+	if ((port>>16) == 0x10 || (port>>16) == 0x11)
+		kind = OSPF_RSVP_PORT_SUBNET_UNI;
+	else if ((port>>16) == 0x12)
+		kind = OSPF_RSVP_PORT_OTNX;
+	else
+		kind = OSPF_RSVP_PORT_SWITCH;
+
+	for (pass = 0; pass < 2; pass++)
 	{
-		if (ospf->oiflist)
-		LIST_LOOP(ospf->oiflist, oi, node2){
-			if (!INTERFACE_MPLS_ENABLED(oi) || oi->te_para.link_ifswcap_list == NULL)
+		if (pass == 0)
+			oi_list = ospf_rsvp_port_lookup(OSPF_RSVP_PORT_SWITCH, port);
+		else if (kind != OSPF_RSVP_PORT_SWITCH)
+			oi_list = ospf_rsvp_port_lookup(kind, (u_int8_t)(port>>8));
+		else
+			break;
+		if (oi_list == NULL)
+			continue;
+		LIST_LOOP(oi_list, oi, node)
+		{
+			if (pass == 1 && oi->vlsr_if.switch_port == port)
 				continue;
-
-			ifswcap = NULL;
-			LIST_LOOP(oi->te_para.link_ifswcap_list, ifswcap, node3)
+			if (hold_flag == 1)
 			{
-				if ( (ifswcap->link_ifswcap_data.switching_cap == LINK_IFSWCAP_SUBTLV_SWCAP_TDM && (ntohs(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni.version) & IFSWCAP_SPECIFIC_SUBNET_UNI) != 0)
-					|| (ifswcap->link_ifswcap_data.switching_cap == LINK_IFSWCAP_SUBTLV_SWCAP_TDM && ifswcap->link_ifswcap_data.encoding == LINK_IFSWCAP_SUBTLV_ENC_G709OTUK
-						&& (ntohs(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx.version) & IFSWCAP_SPECIFIC_CIENA_OTNX) != 0) )
-					break;
-				ifswcap = NULL;
+				updated = hold_bandwidth(oi, bw, ucid, seqnum);
 			}
-			/* the interface contains a subnet_uni or ciena_opvcx ISCD if ifswcap != NULL*/
-
-			if (oi && INTERFACE_MPLS_ENABLED(oi) && (oi->vlsr_if.switch_port == port
-				|| ( ( (port>>16) == 0x10 || (port>>16) == 0x11 ) && ifswcap != NULL 
-					&& ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni.subnet_uni_id == (u_int8_t)(port>>8) )
-				|| ( (port>>16) == 0x12 && ifswcap != NULL 
-					&& ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx.otnx_if_id == (u_int8_t)(port>>8) ) ) ){
-				if (hold_flag == 1)
-				{
-					updated = hold_bandwidth(oi, bw, ucid, seqnum);
-				}
-				else 
-				{
-					updated = release_bandwidth(oi, bw, ucid, seqnum);
-				}
-				if (updated && oi->t_te_area_lsa_link_self)
-				{
-					OSPF_TIMER_OFF (oi->t_te_area_lsa_link_self);
-					OSPF_INTERFACE_TIMER_ON (oi->t_te_area_lsa_link_self, ospf_te_area_lsa_link_timer, OSPF_MIN_LS_INTERVAL);
-				}
+			else 
+			{
+				updated = release_bandwidth(oi, bw, ucid, seqnum);
 			}
+			if (updated)
+				ospf_rsvp_link_changed(oi);
 		}
 	}
 }
 
 void
-ospf_hold_timeslots(u_int32_t port, list ts_list, u_int8_t hold_flag)
+ospf_hold_timeslots(u_int32_t port, u_int8_t *ts, int ts_num, u_int8_t hold_flag)
 {
 	struct ospf_interface *oi;
-	struct listnode *node1, *node2, *node3;
-	struct ospf *ospf;
+	struct listnode *node;
 	struct te_link_subtlv_link_ifswcap *ifswcap_subnet;
-	int updated = 0;
-	u_int8_t* ts;
-
-	if (om->ospf)
-	LIST_LOOP(om->ospf, ospf, node1)
-	{
-		if (ospf->oiflist)
-		LIST_LOOP(ospf->oiflist, oi, node2){
-			if (!INTERFACE_MPLS_ENABLED(oi) || oi->te_para.link_ifswcap_list == NULL)
-				continue;
+	list oi_list;
+	int i;
 
-			ifswcap_subnet = NULL;
-			LIST_LOOP(oi->te_para.link_ifswcap_list, ifswcap_subnet, node3)
-			{
-				if (ifswcap_subnet->link_ifswcap_data.switching_cap == LINK_IFSWCAP_SUBTLV_SWCAP_TDM && (ntohs(ifswcap_subnet->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni.version) & IFSWCAP_SPECIFIC_SUBNET_UNI) != 0)
-					break;
-				ifswcap_subnet = NULL;
-			}
-			/* the interface contains a subnet_uni ISCD if ifswcap_subne != NULL*/
+	if ((port>>16) != 0x10 && (port>>16) != 0x11)
+		return;
 
-			if ( ( (port>>16) == 0x10 || (port>>16) == 0x11 )
-					&& ifswcap_subnet != NULL
-					&& ( ifswcap_subnet->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni.subnet_uni_id == (u_int8_t)(port>>8) ) ) {
-				if (hold_flag == 1)
-				{
-					LIST_LOOP(ts_list, ts, node3)
-						RESET_VLAN(ifswcap_subnet->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni.timeslot_bitmask, *ts);						
-					updated = 1;
-				}
-				else 
-				{
-					LIST_LOOP(ts_list, ts, node3)
-						SET_VLAN(ifswcap_subnet->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni.timeslot_bitmask, *ts);						
-					updated = 1;
-				}
-				if (updated && oi->t_te_area_lsa_link_self)
-				{
-					OSPF_TIMER_OFF (oi->t_te_area_lsa_link_self);
-					OSPF_INTERFACE_TIMER_ON (oi->t_te_area_lsa_link_self, ospf_te_area_lsa_link_timer, OSPF_MIN_LS_INTERVAL);
-				}
-			}
+	oi_list = ospf_rsvp_port_lookup(OSPF_RSVP_PORT_SUBNET_UNI, (u_int8_t)(port>>8));
+	if (oi_list)
+	LIST_LOOP(oi_list, oi, node)
+	{
+		/* the interface contains a subnet_uni ISCD with this ID */
+		ifswcap_subnet = ospf_rsvp_iscd_subnet_uni(oi);
+		if (ifswcap_subnet == NULL)
+		{
+			zlog_warn("ospf_hold_timeslots: no subnet_uni ISCD on interface %s for port 0x%x", IF_NAME (oi), port);
+			return;
 		}
+		if (hold_flag == 1)
+		{
+			for (i = 0; i < ts_num; i++)
+				RESET_VLAN(ifswcap_subnet->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni.timeslot_bitmask, ts[i]);
+		}
+		else 
+		{
+			for (i = 0; i < ts_num; i++)
+				SET_VLAN(ifswcap_subnet->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni.timeslot_bitmask, ts[i]);
+		}
+		ospf_rsvp_link_changed(oi);
 	}
 }
 
@@ -682,52 +1052,100 @@ void
 ospf_hold_otnx_channels(u_int32_t port, u_int32_t opvcx_range, u_int8_t hold_flag)
 {
 	struct ospf_interface *oi;
-	struct listnode *node1, *node2, *node3;
-	struct ospf *ospf;
+	struct listnode *node;
 	struct te_link_subtlv_link_ifswcap *ifswcap_otnx;
-	int updated = 0;
+	list oi_list;
 	u_int8_t ts, ts1= (opvcx_range & 0xff), ts2 = ((opvcx_range >> 16) & 0xff);
 
-	if (om->ospf)
-	LIST_LOOP(om->ospf, ospf, node1)
+	if ((port>>16) != 0x12)
+		return;
+
+	oi_list = ospf_rsvp_port_lookup(OSPF_RSVP_PORT_OTNX, (u_int8_t)(port>>8));
+	if (oi_list)
+	LIST_LOOP(oi_list, oi, node)
 	{
-		if (ospf->oiflist)
-		LIST_LOOP(ospf->oiflist, oi, node2){
-			if (!INTERFACE_MPLS_ENABLED(oi) || oi->te_para.link_ifswcap_list == NULL)
-				continue;
+		/* the interface contains a ciena_opvcx ISCD with this ID */
+		ifswcap_otnx = ospf_rsvp_iscd_otnx(oi);
+		if (ifswcap_otnx == NULL)
+		{
+			zlog_warn("ospf_hold_otnx_channels: no ciena_opvcx ISCD on interface %s for port 0x%x", IF_NAME (oi), port);
+			return;
+		}
+		if (hold_flag == 1)
+		{
+			for (ts = ts1; ts <= ts2; ts++)
+				RESET_CHANNEL(ifswcap_otnx->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx.wave_opvc_bitmask, ts);
+		}
+		else 
+		{
+			for (ts = ts1; ts <= ts2; ts++)
+				SET_CHANNEL(ifswcap_otnx->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx.wave_opvc_bitmask, ts);
+		}
+		ospf_rsvp_link_changed(oi);
+	}
+}
 
-			ifswcap_otnx = NULL;
-			LIST_LOOP(oi->te_para.link_ifswcap_list, ifswcap_otnx, node3)
-			{
-				if (ifswcap_otnx->link_ifswcap_data.switching_cap == LINK_IFSWCAP_SUBTLV_SWCAP_TDM &&ifswcap_otnx->link_ifswcap_data.encoding == LINK_IFSWCAP_SUBTLV_ENC_G709OTUK
-					&& (ntohs(ifswcap_otnx->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx.version) & IFSWCAP_SPECIFIC_CIENA_OTNX) != 0)
-					break;
-				ifswcap_otnx = NULL;
-			}
-			/* the interface contains a ciena_opvcx ISCD if ifswcap_opvcx != NULL*/
+/* Apply a batch of holds and releases sent as one HoldResourcesbyOSPF
+   message, then refresh each changed TE link LSA once.  Every entry is
+   type(8) + hold(8) + port(32), followed by
+     HoldBandwidthbyOSPF:    bandwidth(32) + ucid(32) + seqnum(32)
+     HoldVtagbyOSPF:         vtag(32)
+     HoldTimeslotsbyOSPF:    count(8) + count timeslots(8)
+     HoldOTNXChennelsByOSPF: opvcx_range(32) */
+static void
+ospf_rsvp_hold_resources (struct stream *s, int length)
+{
+	struct ospf_interface *oi;
+	struct listnode *node;
+	u_char type;
+	u_int8_t hold_flag, ts_num;
+	u_int8_t ts[255];
+	u_int32_t port, bw_uint32, ucid, seqnum, value;
+	int i;
 
-			if ( (port>>16) == 0x12 && ifswcap_otnx != NULL
-					&& ifswcap_otnx->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx.otnx_if_id == (u_int8_t)(port>>8) ) {
-				if (hold_flag == 1)
-				{
-					for (ts = ts1; ts <= ts2; ts++)
-						RESET_CHANNEL(ifswcap_otnx->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx.wave_opvc_bitmask, ts);
-					updated = 1;
-				}
-				else 
-				{
-					for (ts = ts1; ts <= ts2; ts++)
-						SET_CHANNEL(ifswcap_otnx->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx.wave_opvc_bitmask, ts);
-					updated = 1;
-				}
-				if (updated && oi->t_te_area_lsa_link_self)
-				{
-					OSPF_TIMER_OFF (oi->t_te_area_lsa_link_self);
-					OSPF_INTERFACE_TIMER_ON (oi->t_te_area_lsa_link_self, ospf_te_area_lsa_link_timer, OSPF_MIN_LS_INTERVAL);
-				}
-			}
+	ospf_rsvp_changed_links = list_new();
+	while (length >= 6)
+	{
+		type = stream_getc(s);
+		hold_flag = stream_getc(s);
+		port = stream_getl(s);
+		length -= 6;
+		if (type == HoldBandwidthbyOSPF && length >= 12)
+		{
+			bw_uint32 = stream_getl(s);
+			ucid = stream_getl(s);
+			seqnum = stream_getl(s);
+			length -= 12;
+			ospf_hold_bandwidth(port, *(float*)&bw_uint32, hold_flag, ucid, seqnum);
+		}
+		else if ((type == HoldVtagbyOSPF || type == HoldOTNXChennelsByOSPF) && length >= 4)
+		{
+			value = stream_getl(s);
+			length -= 4;
+			if (type == HoldVtagbyOSPF)
+				ospf_hold_vtag(port, value, hold_flag);
+			else
+				ospf_hold_otnx_channels(port, value, hold_flag);
+		}
+		else if (type == HoldTimeslotsbyOSPF && length >= 1
+			 && (ts_num = stream_getc(s)) < length)
+		{
+			for (i = 0; i < ts_num; i++)
+				ts[i] = stream_getc(s);
+			length -= 1 + ts_num;
+			ospf_hold_timeslots(port, ts, ts_num, hold_flag);
+		}
+		else
+		{
+			zlog_warn ("ospf_rsvp_hold_resources: bad entry of type %d", type);
+			break;
 		}
 	}
+
+	LIST_LOOP(ospf_rsvp_changed_links, oi, node)
+		ospf_rsvp_refresh_link(oi);
+	list_delete(ospf_rsvp_changed_links);
+	ospf_rsvp_changed_links = NULL;
 }
 
 void
@@ -858,7 +1276,7 @@ ospf_get_vlsr_route(struct in_addr * inRtId, struct in_addr * outRtId, u_int32_t
 		stream_putl(s, outPort);
 		stream_putl(s, vlan);
 		/* Send message.  */
-		write (fd, STREAM_DATA(s), length);
+		ospf_rsvp_write (fd, STREAM_DATA(s), length);
         }
 	else if (in_oi && out_oi && in_oi->vlsr_if.switch_ip.s_addr!=0 && out_oi->vlsr_if.switch_ip.s_addr!=0 &&
 		in_oi->vlsr_if.switch_ip.s_addr == out_oi->vlsr_if.switch_ip.s_addr &&
@@ -874,7 +1292,7 @@ ospf_get_vlsr_route(struct in_addr * inRtId, struct in_addr * outRtId, u_int32_t
 		stream_putl(s, out_oi->vlsr_if.switch_port);
 		stream_putl(s, 0);
 		/* Send message.  */
-		write (fd, STREAM_DATA(s), length);
+		ospf_rsvp_write (fd, STREAM_DATA(s), length);
 	}
 	else if (outPort != 0 && in_oi && in_oi->vlsr_if.switch_ip.s_addr!=0 
 		/*&& in_oi->vlsr_if.switch_port != 0*/
@@ -897,7 +1315,7 @@ ospf_get_vlsr_route(struct in_addr * inRtId, struct in_addr * outRtId, u_int32_t
 		stream_putl(s, outPort);
 		stream_putl(s, vlan);
 		/* Send message.  */
-		write (fd, STREAM_DATA(s), length);             
+		ospf_rsvp_write (fd, STREAM_DATA(s), length);             
        }
 	else if (inPort != 0 && out_oi && out_oi->vlsr_if.switch_ip.s_addr!=0 
 		/*&& out_oi->vlsr_if.switch_port != 0*/
@@ -921,7 +1339,7 @@ ospf_get_vlsr_route(struct in_addr * inRtId, struct in_addr * outRtId, u_int32_t
 		stream_putl(s, vlan);
 
 		/* Send message.  */
-		write (fd, STREAM_DATA(s), length);             
+		ospf_rsvp_write (fd, STREAM_DATA(s), length);             
        }
        else if ( (inPort >> 16) == 0x10 || (outPort >> 16) == 0x11)
         {
@@ -934,7 +1352,7 @@ ospf_get_vlsr_route(struct in_addr * inRtId, struct in_addr * outRtId, u_int32_t
 		stream_putl(s, outPort);
 		stream_putl(s, 0);
 		/* Send message.  */
-		write (fd, STREAM_DATA(s), length);
+		ospf_rsvp_write (fd, STREAM_DATA(s), length);
         }
 	else if (inRtId->s_addr == outRtId->s_addr && OspfTeRouterAddr.value.s_addr == inRtId->s_addr
 		&& (inPort >> 16) != 0x0 && (inPort>>16) != 0x4 && (outPort >> 16) != 0x0 && (outPort>>16) != 0x4) {
@@ -962,7 +1380,7 @@ ospf_get_vlsr_route(struct in_addr * inRtId, struct in_addr * outRtId, u_int32_t
 		stream_putl(s, outPort);
 		stream_putl(s, 0);
 		/* Send message.  */
-		write (fd, STREAM_DATA(s), length);		
+		ospf_rsvp_write (fd, STREAM_DATA(s), length);		
 	}
        else
 	{
@@ -975,7 +1393,7 @@ ospf_get_vlsr_route(struct in_addr * inRtId, struct in_addr * outRtId, u_int32_t
 		stream_putl(s, 0);
 		stream_putl(s, 0);
 		/* Send message.  */
-		write (fd, STREAM_DATA(s), length);
+		ospf_rsvp_write (fd, STREAM_DATA(s), length);
 	}
 	stream_free(s);
 	return;
@@ -1065,22 +1483,38 @@ ospf_rsvp_get_loopback_addr(int fd)
 	stream_putc(s, GetLoopbackAddress);
 	stream_put_ipv4(s, OspfTeRouterAddr.value.s_addr);
 	/* Send message.  */
-	write (fd, STREAM_DATA(s), length);
+	ospf_rsvp_write (fd, STREAM_DATA(s), length);
 
 	stream_free(s);
 	return;
 }
 
 
+static struct link_ifswcap_specific_subnet_uni*
+ospf_rsvp_lsa_subnet_uni_data(struct ospf_lsa *lsa, u_int8_t uni_id)
+{
+	struct te_link_subtlv_link_ifswcap* ifswcap;
+	int i;
+
+	for (i = 0; i < lsa->tepara_ptr->link_ifswcap_num; i++)
+	{
+		ifswcap = lsa->tepara_ptr->p_link_ifswcap[i];
+		if (ifswcap && ifswcap->link_ifswcap_data.switching_cap == LINK_IFSWCAP_SUBTLV_SWCAP_TDM
+		    && (ntohs(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni.version) & IFSWCAP_SPECIFIC_SUBNET_UNI) != 0
+		    && ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni.subnet_uni_id == uni_id)
+			return &ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni;
+	}
+	return NULL;
+}
+
 void
 ospf_rsvp_get_subnet_uni_data(struct in_addr* data_if, u_int8_t uni_id, int fd)
 {
 	struct ospf_area *area;
-	listnode node;
+	listnode lnode;
 	struct route_node *rn;
 	struct ospf_lsa *lsa;
 	struct in_addr area_id;
-	struct te_link_subtlv_link_ifswcap* ifswcap;
 	struct link_ifswcap_specific_subnet_uni* uni_data = NULL;
 	struct stream *s = NULL;
 	u_int8_t length;
@@ -1093,26 +1527,21 @@ ospf_rsvp_get_subnet_uni_data(struct in_addr* data_if, u_int8_t uni_id, int fd)
 	}
 	if (area)
 	  {
-		LSDB_LOOP (area->te_lsdb->db, rn, lsa)
-		{ /*matching the data_if with either a te link local if addr or a link's originating end's loopback*/
-		  if (lsa->tepara_ptr && lsa->tepara_ptr->p_lclif_ipaddr && 
-		  	(lsa->tepara_ptr->p_lclif_ipaddr->value.s_addr == data_if->s_addr ||lsa->data->adv_router.s_addr == data_if->s_addr))
-		   {
-		   	LIST_LOOP(lsa->tepara_ptr->p_link_ifswcap_list, ifswcap, node)
-	   		{
-	   			if (ifswcap && ifswcap->link_ifswcap_data.switching_cap == LINK_IFSWCAP_SUBTLV_SWCAP_TDM
-				    && (ntohs(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni.version) & IFSWCAP_SPECIFIC_SUBNET_UNI) != 0
-				    && ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni.subnet_uni_id == uni_id)
-   				{
-					uni_data = &ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_subnet_uni;
-					break;
-   				}
-			
-	   		}
-			if (uni_data != NULL)
-				break;
-		   }
+		/*matching the data_if with a link's originating end's loopback first (indexed), then a te link local if addr*/
+		TE_LSDB_ADV_ROUTER_LOOP (area->te_lsdb, *data_if, lnode, lsa)
+		{
+		  if (lsa->tepara_ptr && lsa->tepara_ptr->p_lclif_ipaddr &&
+		  	(uni_data = ospf_rsvp_lsa_subnet_uni_data(lsa, uni_id)) != NULL)
+			break;
 		}
+		if (uni_data == NULL)
+		  LSDB_LOOP (area->te_lsdb->db, rn, lsa)
+		  {
+		    if (lsa->tepara_ptr && lsa->tepara_ptr->p_lclif_ipaddr && 
+		  	lsa->tepara_ptr->p_lclif_ipaddr->value.s_addr == data_if->s_addr &&
+		  	(uni_data = ospf_rsvp_lsa_subnet_uni_data(lsa, uni_id)) != NULL)
+			break;
+		  }
 	}
 
 	length = sizeof(u_int8_t)*2 + (uni_data == NULL ? 0 : sizeof(u_int32_t)*7+12+16+MAX_TIMESLOTS_NUM/8);
@@ -1135,22 +1564,39 @@ ospf_rsvp_get_subnet_uni_data(struct in_addr* data_if, u_int8_t uni_id, int fd)
 		for (i = 0; i < MAX_TIMESLOTS_NUM/8; i++)
 			stream_putc(s, uni_data->timeslot_bitmask[i]);
 	}
-	write (fd, STREAM_DATA(s), length);
+	ospf_rsvp_write (fd, STREAM_DATA(s), length);
 	stream_free(s);
 	return;
 }
 
 
 
+static struct link_ifswcap_specific_ciena_otnx*
+ospf_rsvp_lsa_ciena_otnx_data(struct ospf_lsa *lsa, u_int8_t otnx_if_id)
+{
+	struct te_link_subtlv_link_ifswcap* ifswcap;
+	int i;
+
+	for (i = 0; i < lsa->tepara_ptr->link_ifswcap_num; i++)
+	{
+		ifswcap = lsa->tepara_ptr->p_link_ifswcap[i];
+		if (ifswcap && ifswcap->link_ifswcap_data.switching_cap == LINK_IFSWCAP_SUBTLV_SWCAP_TDM 
+		    && ifswcap->link_ifswcap_data.encoding == LINK_IFSWCAP_SUBTLV_ENC_G709OTUK
+		    && (ntohs(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx.version) & IFSWCAP_SPECIFIC_CIENA_OTNX) != 0
+		    && ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx.otnx_if_id == otnx_if_id)
+			return &ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx;
+	}
+	return NULL;
+}
+
 void
 ospf_rsvp_get_ciena_otnx_data(struct in_addr* data_if, u_int8_t otnx_if_id, int fd)
 {
 	struct ospf_area *area;
-	listnode node;
+	listnode lnode;
 	struct route_node *rn;
 	struct ospf_lsa *lsa;
 	struct in_addr area_id;
-	struct te_link_subtlv_link_ifswcap* ifswcap;
 	struct link_ifswcap_specific_ciena_otnx* otnx_data = NULL;
 	struct stream *s = NULL;
 	u_int8_t length;
@@ -1163,26 +1609,21 @@ ospf_rsvp_get_ciena_otnx_data(struct in_addr* data_if, u_int8_t otnx_if_id, int
 	}
 	if (area)
 	{
-		LSDB_LOOP (area->te_lsdb->db, rn, lsa)
-		{ /*matching the data_if with either a te link local if addr or a link's originating end's loopback*/
-		  if (lsa->tepara_ptr && lsa->tepara_ptr->p_lclif_ipaddr && lsa->tepara_ptr->p_lclif_ipaddr->value.s_addr == data_if->s_addr || lsa->data->adv_router.s_addr == data_if->s_addr)
-		   {
-		   	LIST_LOOP(lsa->tepara_ptr->p_link_ifswcap_list, ifswcap, node)
-	   		{
-	   			if (ifswcap && ifswcap->link_ifswcap_data.switching_cap == LINK_IFSWCAP_SUBTLV_SWCAP_TDM 
-				    && ifswcap->link_ifswcap_data.encoding == LINK_IFSWCAP_SUBTLV_ENC_G709OTUK
-				    && (ntohs(ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx.version) & IFSWCAP_SPECIFIC_CIENA_OTNX) != 0
-				    && ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx.otnx_if_id == otnx_if_id)
-   				{
-					otnx_data = &ifswcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_ciena_otnx;
-					break;
-   				}
-			
-	   		}
-			if (otnx_data != NULL)
-				break;
-		   }
+		/*matching the data_if with a link's originating end's loopback first (indexed), then a te link local if addr*/
+		TE_LSDB_ADV_ROUTER_LOOP (area->te_lsdb, *data_if, lnode, lsa)
+		{
+		  if (lsa->tepara_ptr &&
+		  	(otnx_data = ospf_rsvp_lsa_ciena_otnx_data(lsa, otnx_if_id)) != NULL)
+			break;
 		}
+		if (otnx_data == NULL)
+		  LSDB_LOOP (area->te_lsdb->db, rn, lsa)
+		  {
+		    if (lsa->tepara_ptr && lsa->tepara_ptr->p_lclif_ipaddr &&
+		  	lsa->tepara_ptr->p_lclif_ipaddr->value.s_addr == data_if->s_addr &&
+		  	(otnx_data = ospf_rsvp_lsa_ciena_otnx_data(lsa, otnx_if_id)) != NULL)
+			break;
+		  }
 	}
 
 	length = sizeof(u_int8_t)*2 + (otnx_data == NULL ? 0 : sizeof(u_int32_t)*5+MAX_OTNX_CHAN_NUM/8);
@@ -1203,16 +1644,102 @@ ospf_rsvp_get_ciena_otnx_data(struct in_addr* data_if, u_int8_t otnx_if_id, int
 		for (j = 0; j < MAX_OTNX_CHAN_NUM/8; j++)
 			stream_putc(s, otnx_data->wave_opvc_bitmask[j]);
 	}
-	write (fd, STREAM_DATA(s), length);
+	ospf_rsvp_write (fd, STREAM_DATA(s), length);
 	stream_free(s);
 	return;
 }
 
 /* Handler of RSVP request. */
-int
-ospf_rsvp_read (struct thread *thread)
+/* Queue a path computation request, taking over its stream. */
+static void
+ospf_rsvp_cspf_defer (int sock, u_char command, struct stream *s)
+{
+  struct ospf_rsvp_request *req;
+
+  req = XCALLOC (MTYPE_TMP, sizeof (struct ospf_rsvp_request));
+  req->sock = sock;
+  req->id = ospf_rsvp_request_id;
+  req->command = command;
+  req->s = s;
+  if (ospf_rsvp_cspf_queue == NULL)
+    ospf_rsvp_cspf_queue = list_new ();
+  listnode_add (ospf_rsvp_cspf_queue, req);
+}
+
+/* Drop the queued requests of a connection that has gone away. */
+static void
+ospf_rsvp_cspf_purge (int sock)
+{
+  struct ospf_rsvp_request *req;
+  listnode node, next;
+
+  if (ospf_rsvp_cspf_queue == NULL)
+    return;
+  for (node = listhead (ospf_rsvp_cspf_queue); node; node = next)
+    {
+      next = node->next;
+      req = getdata (node);
+      if (req->sock != sock)
+        continue;
+      stream_free (req->s);
+      XFREE (MTYPE_TMP, req);
+      list_delete_node (ospf_rsvp_cspf_queue, node);
+    }
+}
+
+static int ospf_rsvp_read_request (int sock);
+
+/* Answer everything already waiting on the socket; path computations
+   found there are queued. */
+static int
+ospf_rsvp_read_pending (int sock)
+{
+  int pending;
+
+  while (ioctl (sock, FIONREAD, &pending) == 0 && pending > 0)
+    if (ospf_rsvp_read_request (sock) < 0)
+      return -1;
+  return 0;
+}
+
+/* Run one queued path computation and answer the lookups that came in
+   meanwhile before the next one.  thread_fetch () runs events ahead of
+   reads, so the socket is polled here rather than left to ospf_rsvp_read
+   (), which would not get to run before the queue is empty. */
+static int
+ospf_rsvp_cspf_run (struct thread *thread)
 {
+  struct ospf_rsvp_request *req;
+  listnode node;
   int sock;
+
+  ospf_rsvp_cspf_thread = NULL;
+  if ((node = listhead (ospf_rsvp_cspf_queue)) == NULL)
+    return 0;
+
+  req = getdata (node);
+  list_delete_node (ospf_rsvp_cspf_queue, node);
+  sock = req->sock;
+  ospf_rsvp_request_id = req->id;
+  if (req->command == GetExplicitRoutesByOSPF)
+    ospf_get_explicit_routes (req->s, sock);
+  else
+    ospf_get_explicit_route (req->s, sock);
+  stream_free (req->s);
+  XFREE (MTYPE_TMP, req);
+
+  if (ospf_rsvp_read_pending (sock) < 0)
+    ospf_rsvp_cspf_purge (sock);
+
+  if (listcount (ospf_rsvp_cspf_queue) > 0)
+    ospf_rsvp_cspf_thread = thread_add_event (master, ospf_rsvp_cspf_run, NULL, 0);
+  return 0;
+}
+
+/* Read and answer one request. */
+static int
+ospf_rsvp_read_request (int sock)
+{
   int nbyte;
   u_short length;
   u_char command;
@@ -1225,15 +1752,11 @@ ospf_rsvp_read (struct thread *thread)
   u_int8_t hold_flag;
   u_int8_t uni_id;
   u_int8_t otnx_if_id;
-  u_int8_t* ts;
-  list ts_list;
+  u_int8_t ts[255];
   int i;
   float bandwidth, tmpbw;
   u_int32_t opvcx_range;
 
-  /* Get thread data.  Reset reading thread because I'm running. */
-  sock = THREAD_FD (thread);
-
   s = stream_new (ZEBRA_MAX_PACKET_SIZ);
   
   /* Read length and command. */
@@ -1248,6 +1771,12 @@ ospf_rsvp_read (struct thread *thread)
   command = stream_getc (s);
 
  length -= 2;
+  if (length < OSPF_RSVP_REQUEST_ID_SIZE)
+    {
+      zlog_warn ("ospf-rsvp request %d without request ID on socket [%d]", command, sock);
+      stream_free (s);
+      return -1;
+    }
 
   /* Read rest of data. */
   if (length)
@@ -1260,6 +1789,8 @@ ospf_rsvp_read (struct thread *thread)
 	  return -1;
 	}
     }
+  ospf_rsvp_request_id = stream_getl (s);
+  length -= OSPF_RSVP_REQUEST_ID_SIZE;
 
   switch (command) 
     {
@@ -1281,7 +1812,9 @@ ospf_rsvp_read (struct thread *thread)
       break;
 
     case GetExplicitRouteByOSPF:
-	ospf_get_explicit_route(s, sock);
+    case GetExplicitRoutesByOSPF:
+	ospf_rsvp_cspf_defer(sock, command, s);
+	s = NULL;
      break;
 		
     case GetVLSRRoutebyOSPF:
@@ -1313,15 +1846,9 @@ ospf_rsvp_read (struct thread *thread)
 	hold_flag = stream_getc(s);
 	length -= 5;
 	assert (length > 0);
-	ts_list = list_new();
 	for (i = 0; i < length; i++)
-	{
-		ts = (u_int8_t*)malloc(1);
-		*ts = stream_getc(s);
-		listnode_add(ts_list, ts);
-	}
-	ospf_hold_timeslots(port, ts_list, hold_flag);
-	list_delete(ts_list);
+		ts[i] = stream_getc(s);
+	ospf_hold_timeslots(port, ts, length, hold_flag);
      break;
 
     case HoldOTNXChennelsByOSPF:
@@ -1333,6 +1860,10 @@ ospf_rsvp_read (struct thread *thread)
 	ospf_hold_otnx_channels(port, opvcx_range, hold_flag);
      break;
 
+    case HoldResourcesbyOSPF:
+	ospf_rsvp_hold_resources(s, length);
+     break;
+
     case OspfPathTear:
     case OspfResv:
     case OspfResvTear:
@@ -1364,8 +1895,33 @@ ospf_rsvp_read (struct thread *thread)
       break;
     }
 
-  stream_free (s);
-  
+  if (s)
+    stream_free (s);
+
+  return 0;
+}
+
+int
+ospf_rsvp_read (struct thread *thread)
+{
+  int sock;
+
+  /* Get thread data.  Reset reading thread because I'm running. */
+  sock = THREAD_FD (thread);
+
+  /* Answer everything already waiting on the socket before the path
+     computations queued meanwhile, so that cheap lookups are not held up
+     behind them; RSVPD matches the replies by request ID. */
+  if (ospf_rsvp_read_request (sock) < 0 || ospf_rsvp_read_pending (sock) < 0)
+    {
+      ospf_rsvp_cspf_purge (sock);
+      return -1;
+    }
+
+  if (ospf_rsvp_cspf_queue && listcount (ospf_rsvp_cspf_queue) > 0
+      && ospf_rsvp_cspf_thread == NULL)
+    ospf_rsvp_cspf_thread = thread_add_event (master, ospf_rsvp_cspf_run, NULL, 0);
+
   /* Create new zebra client. */
   thread_add_read (master, ospf_rsvp_read, NULL, sock);
 
@@ -998,6 +998,7 @@ ospf_te_del_if (struct ospf_interface *oi)
 	list_delete(oi->te_para.link_srlg.srlg_list);
   }
   oi->te_enabled = INTERFACE_NO_TE;
+  ospf_rsvp_port_index_invalidate ();
   memset(&oi->te_para, 0, sizeof(struct te_area_lsa_para));
   
   /* router ID TE LSA is not flushed because we are only disabling one TE interface, not all */
@@ -1923,6 +1924,7 @@ ospf_te_verify_config(struct ospf_interface *oi, struct ospf_te_config_para *oc)
 			memcpy(&oi->vlsr_if, &oc->vlsr_if, sizeof(struct vlsr_if));
 	      ospf_te_set_default_link_para(oi);
 	      ospf_te_set_configed_link_para(oi, oc);
+	      ospf_rsvp_port_index_invalidate();
   	}
 	return ret;
 }
@@ -1975,6 +1977,12 @@ static void ospf_te_config_write (struct vty *vty)
 
   if (ntohl(OspfTeRouterAddr.header.type)!=0)
   	vty_out(vty, "  ospf-te router-address %s%s", inet_ntoa (OspfTeRouterAddr.value), VTY_NEWLINE);
+  if (OspfTeLsaDamping.threshold_percent != 0)
+  	vty_out(vty, "  ospf-te lsa-threshold percent %u%s", OspfTeLsaDamping.threshold_percent, VTY_NEWLINE);
+  if (OspfTeLsaDamping.threshold_abs != 0)
+  	vty_out(vty, "  ospf-te lsa-threshold absolute %.0f%s", OspfTeLsaDamping.threshold_abs, VTY_NEWLINE);
+  if (OspfTeLsaDamping.damp_max != 0)
+  	vty_out(vty, "  ospf-te lsa-damping %u%s", OspfTeLsaDamping.damp_max, VTY_NEWLINE);
 
   LIST_LOOP (om->ospf, ospf, node1){		/* for each ospf instance */
   	LIST_LOOP(ospf->oiflist, oi, node2){
@@ -2265,6 +2273,75 @@ DEFUN (ospf_te_router_addr,
 }
 
 
+DEFUN (ospf_te_lsa_threshold_percent,
+       ospf_te_lsa_threshold_percent_cmd,
+       "ospf-te lsa-threshold percent <1-100>",
+       "OSPF-TE specific commands\n"
+       "Smallest bandwidth change that triggers a TE link LSA refresh\n"
+       "Relative to the max reservable bandwidth of the link\n"
+       "Percent\n")
+{
+  OspfTeLsaDamping.threshold_percent = strtoul (argv[0], NULL, 10);
+  return CMD_SUCCESS;
+}
+
+DEFUN (ospf_te_lsa_threshold_absolute,
+       ospf_te_lsa_threshold_absolute_cmd,
+       "ospf-te lsa-threshold absolute BANDWIDTH",
+       "OSPF-TE specific commands\n"
+       "Smallest bandwidth change that triggers a TE link LSA refresh\n"
+       "Absolute bandwidth\n"
+       "Bytes/second (IEEE floating point format)\n")
+{
+  float bw;
+
+  if (sscanf (argv[0], "%g", &bw) != 1 || bw < 0)
+    {
+      vty_out (vty, "ospf_te_lsa_threshold_absolute: invalid bandwidth %s%s", argv[0], VTY_NEWLINE);
+      return CMD_WARNING;
+    }
+  OspfTeLsaDamping.threshold_abs = bw;
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_ospf_te_lsa_threshold,
+       no_ospf_te_lsa_threshold_cmd,
+       "no ospf-te lsa-threshold (percent|absolute)",
+       NO_STR
+       "OSPF-TE specific commands\n"
+       "Smallest bandwidth change that triggers a TE link LSA refresh\n"
+       "Relative to the max reservable bandwidth of the link\n"
+       "Absolute bandwidth\n")
+{
+  if (strncmp (argv[0], "p", 1) == 0)
+    OspfTeLsaDamping.threshold_percent = 0;
+  else
+    OspfTeLsaDamping.threshold_abs = 0;
+  return CMD_SUCCESS;
+}
+
+DEFUN (ospf_te_lsa_damping,
+       ospf_te_lsa_damping_cmd,
+       "ospf-te lsa-damping <10-1800>",
+       "OSPF-TE specific commands\n"
+       "Exponential back-off of TE link LSA refreshes on churning links\n"
+       "Maximum hold-down in seconds\n")
+{
+  OspfTeLsaDamping.damp_max = strtoul (argv[0], NULL, 10);
+  return CMD_SUCCESS;
+}
+
+DEFUN (no_ospf_te_lsa_damping,
+       no_ospf_te_lsa_damping_cmd,
+       "no ospf-te lsa-damping",
+       NO_STR
+       "OSPF-TE specific commands\n"
+       "Exponential back-off of TE link LSA refreshes on churning links\n")
+{
+  OspfTeLsaDamping.damp_max = 0;
+  return CMD_SUCCESS;
+}
+
 /* <0-4294967296>*/
 DEFUN (ospf_te_data_interface,
        ospf_te_data_interface_cmd,
@@ -3390,6 +3467,8 @@ DEFUN (show_ospf_te_router,
        "OSPF-TE information\n"
        "TE router address\n")
 {
+  unsigned long in_use, allocated;
+
   if (ntohs(OspfTeRouterAddr.header.type) == TE_TLV_ROUTER_ADDR)
   {
       vty_out (vty, "--- OSPF-TE router parameters ---%s", VTY_NEWLINE);
@@ -3397,6 +3476,15 @@ DEFUN (show_ospf_te_router,
   }
   else if (vty != NULL)
         vty_out (vty, "  N/A%s", VTY_NEWLINE);
+  vty_out (vty, "  TE link LSA threshold: %u%%, %.0f Bytes/s; damping: %us max%s",
+	   OspfTeLsaDamping.threshold_percent, OspfTeLsaDamping.threshold_abs,
+	   OspfTeLsaDamping.damp_max, VTY_NEWLINE);
+  vty_out (vty, "  TE link LSAs originated %lu, refreshes suppressed %lu, damped %lu%s",
+	   OspfTeLsaDamping.originated, OspfTeLsaDamping.suppressed,
+	   OspfTeLsaDamping.deferred, VTY_NEWLINE);
+  ospf_te_lsa_para_stats (&in_use, &allocated);
+  vty_out (vty, "  Parsed TE-LSA records in use %lu, pooled %lu%s",
+	   in_use, allocated, VTY_NEWLINE);
   return CMD_SUCCESS;
 }
 
@@ -3488,6 +3576,9 @@ show_ospf_te_link_sub_detail (struct vty *vty, struct ospf_interface *oi)
       	   if (ntohs(oi->te_para.link_te_lambda.header.type)!=0)
 	          show_vty_link_subtlv_te_lambda(vty, &oi->te_para.link_te_lambda.header);
       }
+      vty_out (vty, "  TE link LSA originated %u times, refreshes suppressed %u, damped %u, hold-down %us%s",
+	       oi->te_lsa_link_orig_count, oi->te_lsa_link_suppressed,
+	       oi->te_lsa_link_deferred, oi->te_lsa_link_damp, VTY_NEWLINE);
   }
   else
     {
@@ -3656,6 +3747,11 @@ ospf_te_register_vty (void)
   install_element (ENABLE_NODE, &show_ospf_te_db_brief_cmd);
 
   install_element (OSPF_NODE, &ospf_te_router_addr_cmd);
+  install_element (OSPF_NODE, &ospf_te_lsa_threshold_percent_cmd);
+  install_element (OSPF_NODE, &ospf_te_lsa_threshold_absolute_cmd);
+  install_element (OSPF_NODE, &no_ospf_te_lsa_threshold_cmd);
+  install_element (OSPF_NODE, &ospf_te_lsa_damping_cmd);
+  install_element (OSPF_NODE, &no_ospf_te_lsa_damping_cmd);
   install_element (OSPF_NODE, &ospf_te_interface_ifname_cmd);
   /*@@@@ UNI hacks ==> Obsolete*/
   /*
@@ -525,6 +525,7 @@ extern void ospf_te_nsm_change (struct ospf_neighbor *nbr, int old_status);
 extern void set_ospf_te_router_addr (struct in_addr ipv4);
 extern struct prefix * get_if_ip_addr(struct interface *ifp);
 extern void ospf_rsvp_init ();
+extern void ospf_rsvp_port_index_invalidate ();
 extern void set_linkparams_unrsv_bw (struct te_link_subtlv_unrsv_bw *para, int priority, float *fp);
 
 #endif /* _ZEBRA_OSPF_TE_H */
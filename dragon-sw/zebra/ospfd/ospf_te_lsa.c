@@ -456,6 +456,101 @@ out:
 }
 
 
+/* Parsed TE-LSA records are carved from chunks of TE_LSA_PARA_CHUNK and
+   recycled through a free list; every TE-LSA received is parsed, so this
+   keeps parsing free of allocations once the pool has grown to the size
+   of the TE-LSDB.  The chunks are released once no record is in use, see
+   ospf_te_lsa_para_pool_release(). */
+#define TE_LSA_PARA_CHUNK	64
+
+struct te_lsa_para_chunk
+{
+  struct te_lsa_para_chunk *next;
+  struct te_lsa_para_ptr para[TE_LSA_PARA_CHUNK];
+};
+
+static struct te_lsa_para_chunk *te_lsa_para_chunks = NULL;
+static struct te_lsa_para_ptr *te_lsa_para_free_list = NULL;
+static unsigned long te_lsa_para_allocated = 0;
+static unsigned long te_lsa_para_in_use = 0;
+
+struct te_lsa_para_ptr *
+ospf_te_lsa_para_new ()
+{
+  struct te_lsa_para_chunk *chunk;
+  struct te_lsa_para_ptr *para;
+  int i;
+
+  if (te_lsa_para_free_list == NULL)
+    {
+      chunk = XMALLOC (MTYPE_OSPF_TE_LSA_PARA, sizeof (struct te_lsa_para_chunk));
+      chunk->next = te_lsa_para_chunks;
+      te_lsa_para_chunks = chunk;
+      for (i = 0; i < TE_LSA_PARA_CHUNK; i++)
+	{
+	  chunk->para[i].next_free = te_lsa_para_free_list;
+	  te_lsa_para_free_list = &chunk->para[i];
+	}
+      te_lsa_para_allocated += TE_LSA_PARA_CHUNK;
+    }
+
+  para = te_lsa_para_free_list;
+  te_lsa_para_free_list = para->next_free;
+  te_lsa_para_in_use++;
+  return para;
+}
+
+/* Free the chunks of the pool; records still in use keep it. */
+void
+ospf_te_lsa_para_pool_release ()
+{
+  struct te_lsa_para_chunk *chunk;
+
+  if (te_lsa_para_in_use > 0)
+    return;
+  while ((chunk = te_lsa_para_chunks) != NULL)
+    {
+      te_lsa_para_chunks = chunk->next;
+      XFREE (MTYPE_OSPF_TE_LSA_PARA, chunk);
+    }
+  te_lsa_para_free_list = NULL;
+  te_lsa_para_allocated = 0;
+}
+
+void
+ospf_te_lsa_para_free (struct te_lsa_para_ptr *para)
+{
+  para->next_free = te_lsa_para_free_list;
+  te_lsa_para_free_list = para;
+  te_lsa_para_in_use--;
+}
+
+void
+ospf_te_lsa_para_stats (unsigned long *in_use, unsigned long *allocated)
+{
+  *in_use = te_lsa_para_in_use;
+  *allocated = te_lsa_para_allocated;
+}
+
+/* Fill in the host order values of a parsed link TE-LSA. */
+static void
+ospf_te_lsa_para_decode (struct te_lsa_para_ptr *para)
+{
+  u_char swcap;
+  int i;
+
+  para->te_metric = para->p_te_metric ? ntohl (para->p_te_metric->value) : 1;
+  para->rsc_clsclr = para->p_rsc_clsclr ? ntohl (para->p_rsc_clsclr->value) : 0;
+  if (para->p_unrsv_bw)
+    for (i = 0; i < LINK_MAX_PRIORITY; i++)
+      ntohf (&para->p_unrsv_bw->value[i], &para->unrsv_bw[i]);
+  for (i = 0; i < para->link_ifswcap_num; i++)
+    {
+      swcap = para->p_link_ifswcap[i]->link_ifswcap_data.switching_cap;
+      para->swcap_mask[swcap >> 3] |= 1 << (swcap & 7);
+    }
+}
+
 struct ospf_lsa *
 ospf_te_lsa_parse (struct ospf_lsa *new)
 {
@@ -491,7 +586,7 @@ ospf_te_lsa_parse (struct ospf_lsa *new)
 	/* Otherwise, it is a TE-LSA, do rest of the parsing process */
 	tlvh = TLV_HDR_TOP(new->data);
 	if (new->tepara_ptr == NULL) 
-		new->tepara_ptr = (struct te_lsa_para_ptr *) XMALLOC (MTYPE_OSPF_IF_PARAMS, sizeof(struct te_lsa_para_ptr));
+		new->tepara_ptr = ospf_te_lsa_para_new ();
   	memset (new->tepara_ptr, 0, sizeof(struct te_lsa_para_ptr));
 
 	/* First, determine top-level tlv pointer */
@@ -552,22 +647,12 @@ ospf_te_lsa_parse (struct ospf_lsa *new)
 					new->tepara_ptr->p_link_protype = (struct te_link_subtlv_link_protype *)sub_tlvh;
 					break;
 				case TE_LINK_SUBTLV_LINK_IFSWCAP:
-					if (!new->tepara_ptr->p_link_ifswcap_list)
-						new->tepara_ptr->p_link_ifswcap_list = list_new();
-					/*uncompress VLAN tag bitmask*/
-					/*
-					swcap = (struct te_link_subtlv_link_ifswcap *)sub_tlvh;
-					if ((ntohs(swcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.version) & IFSWCAP_SPECIFIC_VLAN_BASIC) &&
-					  (ntohs(swcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.version) & IFSWCAP_SPECIFIC_VLAN_ALLOC) &&
-					  (ntohs(swcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.version) & IFSWCAP_SPECIFIC_VLAN_COMPRESS_Z)) {
-					  	z_len = sizeof(struct link_ifswcap_specific_vlan) - 4;
-						uncompress(z_buffer, &z_len, swcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask, ntohs(swcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.length) - 4);
-						assert(z_len == sizeof(struct link_ifswcap_specific_vlan) - 4);
-						memcpy(swcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.bitmask, z_buffer, z_len);
-						swcap->link_ifswcap_data.ifswcap_specific_info.ifswcap_specific_vlan.version &= ~(htons(IFSWCAP_SPECIFIC_VLAN_COMPRESS_Z));
+					if (new->tepara_ptr->link_ifswcap_num == TE_LSA_MAX_IFSWCAP)
+					{
+						zlog_warn ("ospf_te_lsa_parse: more than %d ISCDs, ignoring the rest.", TE_LSA_MAX_IFSWCAP);
+						break;
 					}
-					*/
-					listnode_add(new->tepara_ptr->p_link_ifswcap_list, sub_tlvh);
+					new->tepara_ptr->p_link_ifswcap[new->tepara_ptr->link_ifswcap_num++] = (struct te_link_subtlv_link_ifswcap *)sub_tlvh;
 					break;
 				case TE_LINK_SUBTLV_LINK_SRLG:
 					new->tepara_ptr->p_link_srlg = (struct te_tlv_header *)sub_tlvh;
@@ -586,19 +671,17 @@ ospf_te_lsa_parse (struct ospf_lsa *new)
 		if (new->tepara_ptr->p_link_type == NULL || new->tepara_ptr->p_link_id == NULL)
 		{
 			zlog_info ("ospf_te_lsa_parse: This TE-LSA lacks some mandatory TE parameters.");
-			if (new->tepara_ptr->p_link_ifswcap_list != NULL)
-				list_delete(new->tepara_ptr->p_link_ifswcap_list);
-			XFREE(MTYPE_OSPF_IF_PARAMS, new->tepara_ptr);
+			ospf_te_lsa_para_free(new->tepara_ptr);
 			new->te_lsa_type = NOT_TE_LSA;
 			new->tepara_ptr = NULL;
 		}
+		else
+			ospf_te_lsa_para_decode(new->tepara_ptr);
 	}
 	else
 	{
 		zlog_info ("ospf_te_lsa_parse: Unrecognized TE-LSA due to incorrect TLV header info.");
-		if (new->tepara_ptr->p_link_ifswcap_list != NULL)
-			list_delete(new->tepara_ptr->p_link_ifswcap_list);
-		XFREE(MTYPE_OSPF_IF_PARAMS, new->tepara_ptr);
+		ospf_te_lsa_para_free(new->tepara_ptr);
 		new->te_lsa_type = NOT_TE_LSA;
 		new->tepara_ptr = NULL;
 	}
@@ -643,6 +726,219 @@ ospf_te_lsa_check_content(struct ospf_lsa *new)
 	}
 }
 
+/*------------------------------------------------------------------------*
+ * Damping of TE link LSA refreshes triggered by resource changes.
+ *
+ * A triggered refresh is suppressed when the only differences from the
+ * advertised LSA are bandwidth changes below the configured thresholds,
+ * and is held back while the link is churning: every refresh that follows
+ * the previous one too closely doubles the hold-down of the link, up to
+ * damp_max seconds. The periodic refresh is never held back.
+ *------------------------------------------------------------------------*/
+
+struct ospf_te_lsa_damping OspfTeLsaDamping;
+
+/* Does a bandwidth change from old_bw to new_bw (network order) need to be
+   advertised? Running out of or getting back bandwidth always does. */
+static int
+ospf_te_bw_change_significant (float *old_nbw, float *new_nbw, float ref_bw)
+{
+  float old_bw, new_bw, delta;
+
+  ntohf (old_nbw, &old_bw);
+  ntohf (new_nbw, &new_bw);
+  if (old_bw == new_bw)
+    return 0;
+  if (old_bw == 0 || new_bw == 0)
+    return 1;
+  if (OspfTeLsaDamping.threshold_percent == 0 && OspfTeLsaDamping.threshold_abs == 0)
+    return 1;
+
+  delta = new_bw > old_bw ? new_bw - old_bw : old_bw - new_bw;
+  if (OspfTeLsaDamping.threshold_abs != 0 && delta >= OspfTeLsaDamping.threshold_abs)
+    return 1;
+  if (OspfTeLsaDamping.threshold_percent != 0
+      && delta * 100 >= ref_bw * OspfTeLsaDamping.threshold_percent)
+    return 1;
+  return 0;
+}
+
+static int
+ospf_te_bw_array_significant (float *old_nbw, float *new_nbw, float ref_bw)
+{
+  int i;
+
+  for (i = 0; i < LINK_MAX_PRIORITY; i++)
+    if (ospf_te_bw_change_significant (&old_nbw[i], &new_nbw[i], ref_bw))
+      return 1;
+  return 0;
+}
+
+static struct te_tlv_header *
+ospf_te_link_subtlv_skip_gri (struct te_tlv_header *tlvh, char *end)
+{
+  while ((char *) tlvh + TLV_HDR_SIZE <= end
+	 && ntohs (tlvh->type) == TE_LINK_SUBTLV_LINK_DRAGON_GRI)
+    tlvh = SUBTLV_HDR_NEXT (tlvh);
+  return tlvh;
+}
+
+/* Compare the Link TLV of the advertised LSA with a freshly built one. Only
+   unreserved bandwidth and the max LSP bandwidth of the ISCDs are compared
+   against the thresholds; the DRAGON GRI sub-TLV only accompanies bandwidth
+   changes and is ignored; any other difference is significant. */
+static int
+ospf_te_link_tlv_significant (struct ospf_interface *oi,
+			      struct te_tlv_header *old_tlvh, int old_len,
+			      struct te_tlv_header *new_tlvh, int new_len)
+{
+  struct te_tlv_header *old_sub, *new_sub;
+  char *old_end, *new_end;
+  float ref_bw;
+  int len;
+
+  if (old_len < TLV_HDR_SIZE || new_len < TLV_HDR_SIZE
+      || old_tlvh->type != new_tlvh->type)
+    return 1;
+
+  old_end = (char *) old_tlvh + old_len;
+  if ((char *) old_tlvh + TLV_SIZE (old_tlvh) < old_end)
+    old_end = (char *) old_tlvh + TLV_SIZE (old_tlvh);
+  new_end = (char *) new_tlvh + new_len;
+  if ((char *) new_tlvh + TLV_SIZE (new_tlvh) < new_end)
+    new_end = (char *) new_tlvh + TLV_SIZE (new_tlvh);
+  ntohf (&oi->te_para.max_rsv_bw.value, &ref_bw);
+
+  old_sub = SUBTLV_HDR_TOP (old_tlvh);
+  new_sub = SUBTLV_HDR_TOP (new_tlvh);
+  while (1)
+    {
+      old_sub = ospf_te_link_subtlv_skip_gri (old_sub, old_end);
+      new_sub = ospf_te_link_subtlv_skip_gri (new_sub, new_end);
+      if ((char *) old_sub + TLV_HDR_SIZE > old_end
+	  || (char *) new_sub + TLV_HDR_SIZE > new_end)
+	break;
+      if (old_sub->type != new_sub->type || old_sub->length != new_sub->length
+	  || (char *) old_sub + TLV_SIZE (old_sub) > old_end
+	  || (char *) new_sub + TLV_SIZE (new_sub) > new_end)
+	return 1;
+
+      len = ntohs (old_sub->length);
+      switch (ntohs (old_sub->type))
+	{
+	case TE_LINK_SUBTLV_UNRSV_BW:
+	  if (len != sizeof (float) * LINK_MAX_PRIORITY)
+	    goto compare;
+	  if (ospf_te_bw_array_significant ((float *) (old_sub + 1),
+					    (float *) (new_sub + 1), ref_bw))
+	    return 1;
+	  break;
+	case TE_LINK_SUBTLV_LINK_IFSWCAP:
+	  /* switching_cap, encoding, reserved, max_lsp_bw_at_priority[8], specific */
+	  if (len < 4 + sizeof (float) * LINK_MAX_PRIORITY)
+	    goto compare;
+	  if (memcmp (old_sub + 1, new_sub + 1, 4) != 0
+	      || ospf_te_bw_array_significant ((float *) ((char *) (old_sub + 1) + 4),
+					       (float *) ((char *) (new_sub + 1) + 4), ref_bw)
+	      || memcmp ((char *) (old_sub + 1) + 4 + sizeof (float) * LINK_MAX_PRIORITY,
+			 (char *) (new_sub + 1) + 4 + sizeof (float) * LINK_MAX_PRIORITY,
+			 len - 4 - sizeof (float) * LINK_MAX_PRIORITY) != 0)
+	    return 1;
+	  break;
+	default:
+	compare:
+	  if (memcmp (old_sub + 1, new_sub + 1, len) != 0)
+	    return 1;
+	  break;
+	}
+      old_sub = SUBTLV_HDR_NEXT (old_sub);
+      new_sub = SUBTLV_HDR_NEXT (new_sub);
+    }
+
+  /* One of them has sub-TLVs the other has not. */
+  return (char *) old_sub + TLV_HDR_SIZE <= old_end
+	 || (char *) new_sub + TLV_HDR_SIZE <= new_end;
+}
+
+/* Returns 1 if the triggered refresh of the TE link LSA of oi is held back,
+   in which case the refresh timer has been rescheduled. */
+static int
+ospf_te_area_lsa_link_damped (struct ospf_interface *oi)
+{
+  struct ospf_lsa *lsa = oi->te_area_lsa_link_self;
+  struct stream *s;
+  struct timeval now;
+  long elapsed, hold;
+  int significant;
+
+  if (OspfTeLsaDamping.threshold_percent == 0 && OspfTeLsaDamping.threshold_abs == 0
+      && OspfTeLsaDamping.damp_max == 0)
+    return 0;
+  /* Flushing and re-originating are left to ospf_te_area_lsa_link_refresh(). */
+  if (!INTERFACE_MPLS_ENABLED(oi) || !is_mandated_params_set_for_linktlv(oi)
+      || !IPV4_ADDR_SAME (&lsa->data->adv_router, &OspfTeRouterAddr.value))
+    return 0;
+
+  gettimeofday (&now, NULL);
+  elapsed = now.tv_sec - oi->te_lsa_link_originated.tv_sec;
+  if (elapsed >= OSPF_LS_REFRESH_TIME - OSPF_MIN_LS_INTERVAL)
+    return 0;
+
+  s = stream_new (OSPF_MAX_LSA_SIZE);
+  ospf_te_area_lsa_link_body_set (s, oi);
+  significant = ospf_te_link_tlv_significant (oi, TLV_HDR_TOP (lsa->data),
+			ntohs (lsa->data->length) - OSPF_LSA_HEADER_SIZE,
+			(struct te_tlv_header *) STREAM_DATA (s), stream_get_endp (s));
+  stream_free (s);
+
+  if (!significant)
+    {
+      oi->te_lsa_link_suppressed++;
+      OspfTeLsaDamping.suppressed++;
+      hold = OSPF_LS_REFRESH_TIME - elapsed;
+    }
+  else if (elapsed < oi->te_lsa_link_damp)
+    {
+      oi->te_lsa_link_deferred++;
+      OspfTeLsaDamping.deferred++;
+      hold = oi->te_lsa_link_damp - elapsed;
+    }
+  else
+    return 0;
+
+  if (IS_DEBUG_OSPF (lsa, LSA_REFRESH))
+    zlog_info ("TE link LSA of %s %s, next refresh in %ld seconds", oi->ifp->name,
+	       significant ? "damped" : "unchanged", hold);
+  OSPF_INTERFACE_TIMER_ON (oi->t_te_area_lsa_link_self, ospf_te_area_lsa_link_timer, hold);
+  return 1;
+}
+
+/* Account for a (re)origination of the TE link LSA of oi and adjust its
+   hold-down: doubled if it follows the previous one within twice the
+   hold-down, cleared otherwise. */
+static void
+ospf_te_area_lsa_link_originated (struct ospf_interface *oi)
+{
+  struct timeval now;
+  long elapsed, hold;
+
+  gettimeofday (&now, NULL);
+  elapsed = now.tv_sec - oi->te_lsa_link_originated.tv_sec;
+  hold = oi->te_lsa_link_damp > OSPF_MIN_LS_INTERVAL ? oi->te_lsa_link_damp : OSPF_MIN_LS_INTERVAL;
+
+  if (OspfTeLsaDamping.damp_max == 0 || oi->te_lsa_link_originated.tv_sec == 0
+      || elapsed >= 2 * hold)
+    oi->te_lsa_link_damp = 0;
+  else if (2 * hold > OspfTeLsaDamping.damp_max)
+    oi->te_lsa_link_damp = OspfTeLsaDamping.damp_max;
+  else
+    oi->te_lsa_link_damp = 2 * hold;
+
+  oi->te_lsa_link_originated = now;
+  oi->te_lsa_link_orig_count++;
+  OspfTeLsaDamping.originated++;
+}
+
 /* Install TE-LSA to an area. */
 struct ospf_lsa *
 ospf_te_lsa_install (struct ospf_lsa *new, struct ospf_interface *oi)
@@ -733,6 +1029,7 @@ ospf_te_lsa_install (struct ospf_lsa *new, struct ospf_interface *oi)
       else if (new->te_lsa_type == LINK_TE_LSA){
 	      OSPF_TIMER_OFF (oi->t_te_area_lsa_link_self);
 	      OSPF_INTERFACE_TIMER_ON (oi->t_te_area_lsa_link_self, ospf_te_area_lsa_link_timer, OSPF_LS_REFRESH_TIME);
+	      ospf_te_area_lsa_link_originated (oi);
 	      
 	      /* Set self-originated te-area-LSA. */
 	      ospf_lsa_unlock (oi->te_area_lsa_link_self);
@@ -1141,6 +1438,8 @@ ospf_te_area_lsa_link_timer(struct thread *t)
    oi->t_te_area_lsa_link_self = NULL;
 
    if (oi->te_area_lsa_link_self) {
+       if (ospf_te_area_lsa_link_damped (oi))
+         return 0;
        rc = ospf_te_area_lsa_link_refresh(oi->te_area_lsa_link_self);
      }
    else {
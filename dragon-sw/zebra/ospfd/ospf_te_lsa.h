@@ -25,9 +25,16 @@
 #define _ZEBRA_OSPF_TE_LSA_H
 
 #ifdef HAVE_OPAQUE_LSA
-/* A group of pointers to different TE-LSA tlvs and sub-tlvs */
+#define TE_LSA_MAX_IFSWCAP	8
+
+/* A parsed TE-LSA: pointers to its tlvs and sub-tlvs inside the LSA data,
+ * and the link values used by CSPF decoded in host order, in one fixed-size
+ * record taken from a pool (see ospf_te_lsa_para_new()).
+ */
 struct te_lsa_para_ptr
 {
+  struct te_lsa_para_ptr *next_free;	/* Pool free list */
+
   struct te_tlv_router_addr  *p_router_addr;
   struct te_tlv_link *p_link;
   struct te_tlv_link_local_id *p_link_local_id;
@@ -43,11 +50,50 @@ struct te_lsa_para_ptr
   struct te_link_subtlv_rsc_clsclr *p_rsc_clsclr;
   struct te_link_subtlv_link_lcrmt_id *p_link_lcrmt_id;
   struct te_link_subtlv_link_protype  *p_link_protype;
-  list   p_link_ifswcap_list;
   struct te_tlv_header	*p_link_srlg;   
   struct te_link_subtlv_link_te_lambda  *p_link_te_lambda;
+  u_char link_ifswcap_num;
+  struct te_link_subtlv_link_ifswcap *p_link_ifswcap[TE_LSA_MAX_IFSWCAP];
+
+  /* Link TLV values in host order */
+  u_int32_t te_metric;			/* 1 if not advertised */
+  u_int32_t rsc_clsclr;			/* 0 if not advertised */
+  float unrsv_bw[LINK_MAX_PRIORITY];	/* Bytes/sec, 0 if not advertised */
+  u_char swcap_mask[32];		/* Switching capabilities of the ISCDs */
+};
+
+#define TE_LSA_HAS_SWCAP(para, swcap) \
+	((para)->swcap_mask[(u_char)(swcap) >> 3] & (1 << ((u_char)(swcap) & 7)))
+
+
+/* Constraints of a CSPF path request; zero fields do not constrain the path. */
+#define CSPF_ANY_VTAG 0xffff  /* Any VLAN tag that is free end-to-end */
+struct cspf_constraint
+{
+  u_int8_t switching_cap;
+  u_int8_t setup_priority;	/* 0-7, selects the unreserved bandwidth */
+  float bandwidth;		/* Bytes/sec */
+  u_int32_t include_any;	/* Administrative group masks */
+  u_int32_t include_all;
+  u_int32_t exclude_any;
+  u_int32_t vtag;		/* Required VLAN tag or CSPF_ANY_VTAG */
+  int srlg_num;
+  u_int32_t *srlg_exclude;	/* SRLGs the path must avoid */
 };
 
+/* Damping of triggered TE link LSA refreshes; all zero disables it. */
+struct ospf_te_lsa_damping
+{
+  u_int32_t threshold_percent;	/* of the max reservable bandwidth */
+  float threshold_abs;		/* Bytes/sec */
+  u_int32_t damp_max;		/* Max hold-down of a churning link, seconds */
+
+  /* Statistics */
+  unsigned long originated;
+  unsigned long suppressed;	/* Refreshes without a significant change */
+  unsigned long deferred;	/* Refreshes held back by the hold-down */
+};
+extern struct ospf_te_lsa_damping OspfTeLsaDamping;
 
 /*Type-9 and type-10 TE-LSA */
 /* ospf_te_lsa is the same as ospf_lsa */
@@ -65,8 +111,26 @@ extern int ospf_te_linklocal_lsa_refresh (struct ospf_lsa *lsa);
 extern int ospf_te_linklocal_lsa_originate (struct ospf_interface *oi);
 extern struct ospf_lsa *ospf_te_lsa_install (struct ospf_lsa *new, struct ospf_interface *oi);
 extern struct ospf_lsa *ospf_te_lsa_parse (struct ospf_lsa *new);
+extern struct te_lsa_para_ptr *ospf_te_lsa_para_new ();
+extern void ospf_te_lsa_para_free (struct te_lsa_para_ptr *para);
+extern void ospf_te_lsa_para_pool_release ();
+extern void ospf_te_lsa_para_stats (unsigned long *in_use, unsigned long *allocated);
 extern list ospf_cspf_calculate (struct ospf_area *area, struct in_addr source_ip, struct in_addr dest_ip, 
                     u_int8_t SwitchingCapability);
+extern list ospf_cspf_calculate_constrained (struct ospf_area *area, struct in_addr source_ip,
+                    struct in_addr dest_ip, struct cspf_constraint *cons);
+extern int ospf_cspf_calculate_disjoint (struct ospf_area *area, struct in_addr source_ip,
+                    struct in_addr dest_ip, struct cspf_constraint *cons, int srlg_disjoint,
+                    list *primary, list *secondary);
+extern list ospf_cspf_calculate_kshortest (struct ospf_area *area, struct in_addr source_ip,
+                    struct in_addr dest_ip, struct cspf_constraint *cons, int k);
+extern void ospf_cspf_path_free (list explicit_path);
+extern void ospf_cspf_cache_stats (struct cspf_graph *graph, unsigned long *hits,
+                    unsigned long *misses, unsigned long *entries);
+extern struct cspf_graph *ospf_cspf_graph_new ();
+extern void ospf_cspf_graph_free (struct cspf_graph *graph);
+extern int ospf_cspf_graph_add_lsa (struct ospf_lsa *lsa);
+extern int ospf_cspf_graph_del_lsa (struct ospf_lsa *lsa);
 extern void ospf_te_cspf_calculate_schedule (struct ospf_area *area);
 
 #endif
@@ -26,6 +26,8 @@
 #include "prefix.h"
 #include "table.h"
 #include "memory.h"
+#include "hash.h"
+#include "linklist.h"
 #include "log.h"
 
 #include "ospfd/ospfd.h"
@@ -37,6 +39,75 @@
 
 #ifdef HAVE_OPAQUE_LSA
 
+static unsigned int
+ospf_te_lsdb_router_hash_key (struct ospf_te_lsdb_router *router)
+{
+  return ntohl (router->adv_router.s_addr);
+}
+
+static int
+ospf_te_lsdb_router_hash_cmp (struct ospf_te_lsdb_router *router1,
+			      struct ospf_te_lsdb_router *router2)
+{
+  return router1->adv_router.s_addr == router2->adv_router.s_addr;
+}
+
+static void *
+ospf_te_lsdb_router_alloc (struct ospf_te_lsdb_router *key)
+{
+  struct ospf_te_lsdb_router *router;
+
+  router = XCALLOC (MTYPE_OSPF_TE_LSDB, sizeof (struct ospf_te_lsdb_router));
+  router->adv_router = key->adv_router;
+  router->lsa_list = list_new ();
+  return router;
+}
+
+static void
+ospf_te_lsdb_router_free (struct ospf_te_lsdb_router *router)
+{
+  list_delete (router->lsa_list);
+  XFREE (MTYPE_OSPF_TE_LSDB, router);
+}
+
+static struct ospf_te_lsdb_router *
+ospf_te_lsdb_router_lookup (struct ospf_te_lsdb *lsdb, struct in_addr adv_router)
+{
+  struct ospf_te_lsdb_router key;
+
+  key.adv_router = adv_router;
+  return hash_lookup (lsdb->adv_router_index, &key);
+}
+
+/* Keep the adv_router index in step with the route table. */
+static void
+ospf_te_lsdb_index_add (struct ospf_te_lsdb *lsdb, struct ospf_lsa *lsa)
+{
+  struct ospf_te_lsdb_router key;
+  struct ospf_te_lsdb_router *router;
+
+  key.adv_router = lsa->data->adv_router;
+  router = hash_get (lsdb->adv_router_index, &key, ospf_te_lsdb_router_alloc);
+  listnode_add (router->lsa_list, lsa);
+}
+
+static void
+ospf_te_lsdb_index_delete (struct ospf_te_lsdb *lsdb, struct ospf_lsa *lsa)
+{
+  struct ospf_te_lsdb_router *router;
+
+  router = ospf_te_lsdb_router_lookup (lsdb, lsa->data->adv_router);
+  if (router == NULL)
+    return;
+
+  listnode_delete (router->lsa_list, lsa);
+  if (listcount (router->lsa_list) == 0)
+    {
+      hash_release (lsdb->adv_router_index, router);
+      ospf_te_lsdb_router_free (router);
+    }
+}
+
 struct ospf_te_lsdb *
 ospf_te_lsdb_new ()
 {
@@ -44,6 +115,8 @@ ospf_te_lsdb_new ()
 
   new = XCALLOC (MTYPE_OSPF_TE_LSDB, sizeof (struct ospf_te_lsdb));
   new->db = route_table_init ();
+  new->adv_router_index = hash_create (ospf_te_lsdb_router_hash_key,
+				       ospf_te_lsdb_router_hash_cmp);
   return new;
 }
 
@@ -63,6 +136,7 @@ ospf_te_lsdb_cleanup (struct ospf_te_lsdb *lsdb)
   ospf_te_lsdb_delete_all (lsdb);
   
   route_table_finish (lsdb->db);
+  hash_free (lsdb->adv_router_index);
 }
 
 /* Each te_lsdb entry is uniquely identified by adv_router,
@@ -103,11 +177,15 @@ ospf_te_lsdb_add (struct ospf_te_lsdb *lsdb, struct ospf_lsa *lsa)
       if (rn->info == lsa)
 	return;
       
+      if (lsdb->del_lsa_hook != NULL)
+        (* lsdb->del_lsa_hook)(rn->info);
+      ospf_te_lsdb_index_delete (lsdb, rn->info);
       ospf_lsa_unlock (rn->info);
       route_unlock_node (rn);
   }
   else
   	 lsdb->total++;
+  ospf_te_lsdb_index_add (lsdb, lsa);
   if (lsdb->new_lsa_hook != NULL)
     (* lsdb->new_lsa_hook)(lsa);
 
@@ -134,6 +212,7 @@ ospf_te_lsdb_delete (struct ospf_te_lsdb *lsdb, struct ospf_lsa *lsa)
 	route_unlock_node (rn);
        if (lsdb->del_lsa_hook != NULL)
           (* lsdb->del_lsa_hook)(lsa);
+	ospf_te_lsdb_index_delete (lsdb, lsa);
 	ospf_lsa_unlock (lsa);
 	return;
       }
@@ -154,6 +233,7 @@ ospf_te_lsdb_delete_all (struct ospf_te_lsdb *lsdb)
 	    route_unlock_node (rn);
            if (lsdb->del_lsa_hook != NULL)
               (* lsdb->del_lsa_hook)(lsa);
+	    ospf_te_lsdb_index_delete (lsdb, lsa);
 	    ospf_lsa_unlock (lsa);
 	  }
 }
@@ -181,26 +261,35 @@ ospf_te_lsdb_lookup (struct ospf_te_lsdb *lsdb, struct ospf_lsa *lsa)
   return NULL;
 }
 
+/* Returns a newly allocated copy of the LSA set of adv_router, or NULL.
+   Use TE_LSDB_ADV_ROUTER_LOOP to walk the set without allocating. */
 list
 ospf_te_lsdb_lookup_by_adv_router (struct ospf_te_lsdb *lsdb, struct in_addr adv_router)
 {
-  struct route_node *rn;
+  listnode node;
   struct ospf_lsa *lsa;
   list lsa_list = NULL;
   
-  LSDB_LOOP (lsdb->db, rn, lsa)
+  TE_LSDB_ADV_ROUTER_LOOP (lsdb, adv_router, node, lsa)
   {
-  	if (ntohl(lsa->data->adv_router.s_addr) == ntohl(adv_router.s_addr))
-  	{
-  		if (!lsa_list) 
-  			lsa_list = list_new();
-  		listnode_add(lsa_list, lsa);
-  	}
+  	if (!lsa_list) 
+  		lsa_list = list_new();
+  	listnode_add(lsa_list, lsa);
   }
   return lsa_list;
 
 }
 
+/* First node of the LSA set of adv_router in the secondary index. */
+listnode
+ospf_te_lsdb_adv_router_head (struct ospf_te_lsdb *lsdb, struct in_addr adv_router)
+{
+  struct ospf_te_lsdb_router *router;
+
+  router = ospf_te_lsdb_router_lookup (lsdb, adv_router);
+  return router ? listhead (router->lsa_list) : NULL;
+}
+
 unsigned long
 ospf_te_lsdb_count (struct ospf_te_lsdb *lsdb)
 {
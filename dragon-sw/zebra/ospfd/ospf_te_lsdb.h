@@ -34,11 +34,22 @@
 struct ospf_te_lsdb{
 	struct route_table *db; /* db->routing_node->info = ospf_te_lsa (area_lsa ONLY!!!) */
 	unsigned long total;	/* Count of TE LSAs */
+	struct hash *adv_router_index;	/* adv_router -> struct ospf_te_lsdb_router */
 	/* Hooks for callback functions to catch every add/del event. */
 	int (* new_lsa_hook)(struct ospf_lsa *);
 	int (* del_lsa_hook)(struct ospf_lsa *);
 };
 
+/* Secondary index entry: all TE-LSAs originated by one advertising router. */
+struct ospf_te_lsdb_router{
+	struct in_addr adv_router;
+	list lsa_list;
+};
+
+/* Iterate over the TE-LSAs of one advertising router without allocation. */
+#define TE_LSDB_ADV_ROUTER_LOOP(D,R,N,L)                                     \
+  for ((N) = ospf_te_lsdb_adv_router_head ((D), (R)); (N); (N) = (N)->next)  \
+    if (((L) = (N)->data) != NULL)
 
 /* OSPF TE-LSDB related functions. */
 extern struct ospf_te_lsdb *ospf_te_lsdb_new ();
@@ -49,6 +60,7 @@ extern void ospf_te_lsdb_delete (struct ospf_te_lsdb *lsdb, struct ospf_lsa *lsa
 extern void ospf_te_lsdb_delete_all (struct ospf_te_lsdb *lsdb);
 extern struct ospf_lsa *ospf_te_lsdb_lookup (struct ospf_te_lsdb *lsdb, struct ospf_lsa *lsa);
 extern list ospf_te_lsdb_lookup_by_adv_router (struct ospf_te_lsdb *lsdb, struct in_addr adv_router);
+extern listnode ospf_te_lsdb_adv_router_head (struct ospf_te_lsdb *lsdb, struct in_addr adv_router);
 extern unsigned long ospf_te_lsdb_count (struct ospf_te_lsdb *lsdb);
 extern unsigned long ospf_te_lsdb_isempty (struct ospf_te_lsdb *lsdb);
 
@@ -2426,6 +2426,18 @@ show_ip_ospf_area (struct vty *vty, struct ospf_area *area)
   vty_out (vty, "   SPF algorithm executed %d times%s",
 	   area->spf_calculation, VTY_NEWLINE);
 
+#ifdef HAVE_OPAQUE_LSA
+  /* Show CSPF path cache statistics. */
+  if (area->te_graph)
+    {
+      unsigned long hits, misses, entries;
+
+      ospf_cspf_cache_stats (area->te_graph, &hits, &misses, &entries);
+      vty_out (vty, "   CSPF path cache: %lu entries, %lu hits, %lu misses%s",
+	       entries, hits, misses, VTY_NEWLINE);
+    }
+#endif /* HAVE_OPAQUE_LSA */
+
   /* Show number of LSA. */
   vty_out (vty, "   Number of LSA %ld%s", area->lsdb->total, VTY_NEWLINE);
 
@@ -490,6 +490,10 @@ ospf_finish (struct ospf *ospf)
   ospf_delete (ospf);
 
   XFREE (MTYPE_OSPF_TOP, ospf);
+
+  /* The TE-LSAs of the last instance are gone with its LSDBs. */
+  if (listcount (om->ospf) == 0)
+    ospf_te_lsa_para_pool_release ();
 }
 
  
@@ -520,6 +524,9 @@ ospf_area_new (struct ospf *ospf, struct in_addr area_id)
   ospf_opaque_type10_lsa_init (new);
   new->te_lsdb = ospf_te_lsdb_new();
   new->te_rtid_db = ospf_te_lsdb_new();
+  new->te_graph = ospf_cspf_graph_new();
+  new->te_lsdb->new_lsa_hook = ospf_cspf_graph_add_lsa;
+  new->te_lsdb->del_lsa_hook = ospf_cspf_graph_del_lsa;
 #endif /* HAVE_OPAQUE_LSA */
 
   new->oiflist = list_new ();
@@ -566,6 +573,7 @@ ospf_area_free (struct ospf_area *area)
   ospf_te_lsdb_free (area->te_lsdb);
   ospf_te_lsdb_delete_all (area->te_rtid_db);
   ospf_te_lsdb_free (area->te_rtid_db);
+  ospf_cspf_graph_free (area->te_graph);
   ospf_opaque_type10_lsa_term (area);
 #endif /* HAVE_OPAQUE_LSA */
   ospf_lsa_unlock (area->router_lsa_self);
@@ -365,6 +365,7 @@ struct ospf_area
   list opaque_lsa_self;			/* Type-10 Opaque-LSAs */
   struct ospf_te_lsdb *te_lsdb;		/* TE-LSDB for this area (for link TLVs) */
   struct ospf_te_lsdb *te_rtid_db;  /* TE-LSDB for this area (for route ID TLVs) */
+  struct cspf_graph *te_graph;		/* CSPF topology, maintained from te_lsdb hooks */
   /* list te_area_lsa_self;  */			/* This is distributed to ospf_interface structures */
 #endif /* HAVE_OPAQUE_LSA */
 